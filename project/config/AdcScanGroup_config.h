@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#ifndef SOURCES_PMD_ADCSCANGROUP_CONFIG_DESCRIPTION_H_
+#define SOURCES_PMD_ADCSCANGROUP_CONFIG_DESCRIPTION_H_
+
+enum Description {
+    SLOW_SENSORS,
+    __ENUM__SIZE
+};
+
+static constexpr const size_t MAX_CHANNELS = 8;
+static constexpr const size_t MAX_OVERSAMPLING = 16;
+
+#else
+#ifndef SOURCES_PMD_ADCSCANGROUP_CONFIG_CONTAINER_H_
+#define SOURCES_PMD_ADCSCANGROUP_CONFIG_CONTAINER_H_
+
+// Scans at the 1 kHz of Tim::ADC_SCAN, averages of 8 scans every 8 ms
+static constexpr std::array<const AdcScanGroup, AdcScanGroup::__ENUM__SIZE> Container =
+{ {
+      AdcScanGroup(AdcScanGroup::SLOW_SENSORS,
+                   hal::Factory<hal::Adc>::get<hal::Adc::Description::PMD_ADC1>(),
+                   hal::Factory<hal::Dma>::get<hal::Dma::Description::ADC1_DMA>(),
+                   hal::Factory<hal::Tim>::get<hal::Tim::Description::ADC_SCAN>(),
+                   ADC_ExternalTrigConvEvent_13, // TIM6_TRGO
+                   {hal::Adc::Channel::BATTERY_U,
+                    hal::Adc::Channel::BATTERY_I,
+                    hal::Adc::Channel::NTC_BATTERY,
+                    hal::Adc::Channel::INTERNAL_TEMP,
+                    hal::Adc::Channel::NTC_MOTOR,
+                    hal::Adc::Channel::NTC_FET},
+                   8)
+  } };
+
+#endif /* SOURCES_PMD_ADCSCANGROUP_CONFIG_CONTAINER_H_ */
+#endif /* SOURCES_PMD_ADCSCANGROUP_CONFIG_DESCRIPTION_H_ */
@@ -6,7 +6,7 @@
 #ifndef SOURCES_PMD_DMA_INTERRUPTS_H_
 #define SOURCES_PMD_DMA_INTERRUPTS_H_
 
-#define DMA1_CHANNEL1_INTERRUPT_ENABLED false
+#define DMA1_CHANNEL1_INTERRUPT_ENABLED true
 #define DMA1_CHANNEL2_INTERRUPT_ENABLED false
 #define DMA1_CHANNEL3_INTERRUPT_ENABLED false
 #define DMA1_CHANNEL4_INTERRUPT_ENABLED true
@@ -26,6 +26,7 @@
 
 enum Description {
     // DMA1
+    ADC1_DMA,
     USART1_RX,
     USART1_TX,
     // DMA2
@@ -42,6 +43,13 @@ enum Description {
 
 static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
 { {
+      Dma(Dma::ADC1_DMA,
+          DMA1_Channel1_BASE,
+          DMA_InitTypeDef { ADC1_BASE + 0x40, 0, DMA_DIR_PeripheralSRC, 0, DMA_PeripheralInc_Disable,
+                            DMA_MemoryInc_Enable, DMA_PeripheralDataSize_HalfWord,
+                            DMA_MemoryDataSize_HalfWord, DMA_Mode_Circular,
+                            DMA_Priority_Low, DMA_M2M_Disable },
+          DMA_IT_TC | DMA_IT_HT, IRQn_Type::DMA1_Channel1_IRQn),
       Dma(Dma::USART1_RX,
           DMA1_Channel4_BASE,
           DMA_InitTypeDef { USART1_BASE + 0x24, 0, DMA_DIR_PeripheralSRC, 0, DMA_PeripheralInc_Disable,
@@ -72,7 +80,7 @@ static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_HalfWord,
                             DMA_MemoryDataSize_HalfWord, DMA_Mode_Circular,
                             DMA_Priority_Medium, DMA_M2M_Disable },
-          DMA_IT_TC, IRQn_Type::DMA2_Channel4_IRQn),
+          DMA_IT_TC | DMA_IT_HT, IRQn_Type::DMA2_Channel4_IRQn),
       Dma(Dma::ADC3_DMA,
           DMA2_Channel5_BASE,
           DMA_InitTypeDef { ADC3_BASE + 0x40, 0, DMA_DIR_PeripheralSRC, 0, DMA_PeripheralInc_Disable,
@@ -12,12 +12,15 @@ enum Description {
     HALL_METER,
     BUZZER,
     HBRIDGE,
+    ADC_SCAN,
     __ENUM__SIZE
 };
 
 static constexpr const uint32_t HALFBRIDGE_PERIODE = 7200;
 static constexpr const uint32_t HALL_SENSOR_PRESCALER = 179;
 static constexpr const uint32_t BUZZER_PWM_PERIODE = 72000;
+static constexpr const uint32_t ADC_SCAN_PRESCALER = 71; // 1 MHz
+static constexpr const uint32_t ADC_SCAN_PERIODE = 999; // 1 kHz scans
 
 #else
 #ifndef SOURCES_PMD_TIM_CONFIG_CONTAINER_H_
@@ -40,6 +43,10 @@ static constexpr const std::array<const Tim, Tim::__ENUM__SIZE + 1> Container =
       Tim(Tim::HBRIDGE,
           TIM20_BASE,
           TIM_TimeBaseInitTypeDef {0, TIM_CounterMode_Up, Tim::HALFBRIDGE_PERIODE, TIM_CKD_DIV1, 0}),
+      Tim(Tim::ADC_SCAN,
+          TIM6_BASE,
+          TIM_TimeBaseInitTypeDef {Tim::ADC_SCAN_PRESCALER, TIM_CounterMode_Up, Tim::ADC_SCAN_PERIODE, TIM_CKD_DIV1,
+                                   0}),
       Tim(Tim::__ENUM__SIZE,
           0xffffffff,
           TIM_TimeBaseInitTypeDef {0, TIM_CounterMode_Up, 0, TIM_CKD_DIV1, 0}),
@@ -52,6 +59,7 @@ static constexpr const std::array<const uint32_t, Tim::__ENUM__SIZE> Clocks =
       RCC_APB2Periph_TIM8,
       RCC_APB2Periph_TIM15,
       RCC_APB2Periph_TIM20,
+      RCC_APB1Periph_TIM6,
   } };
 
 #endif /* SOURCES_PMD_TIM_CONFIG_CONTAINER_H_ */
@@ -37,6 +37,7 @@
 #include "Rtc.h"
 #include "Adc.h"
 #include "AdcWithDma.h"
+#include "AdcScanGroup.h"
 #include "CRC.h"
 #include "I2c.h"
 #include "Comp.h"
@@ -96,6 +97,7 @@ int main(void)
     hal::initFactory<hal::Factory<hal::Adc> >();
     hal::initFactory<hal::Factory<hal::Adc::Channel> >();
     hal::initFactory<hal::Factory<hal::AdcWithDma> >();
+    hal::initFactory<hal::Factory<hal::AdcScanGroup> >();
     hal::initFactory<hal::Factory<hal::PhaseCurrentSensor> >();
     hal::initFactory<hal::Factory<hal::Crc> >();
     hal::initFactory<hal::Factory<hal::I2c> >();
@@ -113,7 +115,8 @@ int main(void)
 
     g_motorCtrl = new app::MotorController(
                                            dev::Factory<dev::SensorBLDC>::get<dev::SensorBLDC::BLDC>(),
-                                           *battery, 200000, 80000);
+                                           *battery, 200000, 80000,
+                                           app::MotorController::ControlLoop::INTERRUPT);
 
     auto vMotor = new virt::MotorController();
 
@@ -194,6 +197,35 @@ int main(void)
         [[gnu::unused]] auto steering = new app::SteeringController(*balancer, *vBalancer, straingaugeSensor);
     }
 
+    // compare the cycles of the float and the fixed point phase current filter for one half buffer
+    new os::TaskInterruptable("filter benchmark", 1024, os::Task::Priority::LOW, [](const bool& join){
+        static constexpr size_t MAX_LENGTH = hal::PhaseCurrentSensor::MAX_NUMBER_OF_MEASUREMENTS;
+        static uint16_t samples[MAX_LENGTH];
+        const hal::PhaseCurrentSensor& sensor =
+            hal::Factory<hal::PhaseCurrentSensor>::get<hal::PhaseCurrentSensor::I_TOTAL_FB>();
+
+        for (size_t i = 0; i < MAX_LENGTH; i++) {
+            samples[i] = static_cast<uint16_t>(2048 + (i % 16) * 8);
+        }
+
+        os::ThisTask::sleep(std::chrono::seconds(1));
+
+        for (size_t length = 1; (length <= MAX_LENGTH) && !join; length *= 2) {
+            const auto result = sensor.benchmarkFilter(samples, length);
+            Trace(ZONE_INFO, "phase current filter %2u samples: float %5u fixed point %5u cycles\r\n",
+                  static_cast<unsigned>(result.length), static_cast<unsigned>(result.floatCycles),
+                  static_cast<unsigned>(result.fixedPointCycles));
+        }
+    });
+
+    // watch how much of the phase current interrupt period the torque controller takes
+    new os::TaskInterruptable("control budget", 1024, os::Task::Priority::LOW, [](const bool& join){
+        do {
+            os::ThisTask::sleep(std::chrono::seconds(5));
+            g_motorCtrl->traceControlLoopBudget();
+        } while (!join);
+    });
+
     os::Task::startScheduler();
 
     while (1) {}
@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include "BusLogger.h"
+
+// Frames are tapped in buffered receive mode, which MotorECU or DashBoard enable.
+// Build with CAN_BUS_LOGGER=1 to open the acceptance filters for all identifiers.
+app::CanLogger app::BusLogger(hal::Factory<hal::Can>::get<hal::Can::MAINCAN>(),
+                              hal::Factory<hal::UsartWithDma>::get<hal::Usart::LOGGER_IF>(),
+                              250000);
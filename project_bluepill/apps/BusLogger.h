@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include "CanLogger.h"
+
+namespace app
+{
+extern CanLogger BusLogger;
+}
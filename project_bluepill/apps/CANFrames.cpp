@@ -5,11 +5,11 @@
 
 #include "trace.h"
 #include "CANFrames.h"
-#include <cstring>
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
 using app::msg;
+namespace frames = app::frames;
 
 void msg::setType(const msg::type t)
 {
@@ -23,83 +23,51 @@ msg::type msg::getType(void) const
     return static_cast<msg::type>(StdId);
 }
 
-void msg::setData(const uint32_t data)
+template<typename Frame>
+static void encode(msg& m, const uint32_t data)
 {
-    memset(&Data, 0, sizeof(Data));
+    Frame::encode(m.Data, data);
+    m.DLC = Frame::dlc;
+}
 
+void msg::setData(const uint32_t data)
+{
     switch (static_cast<msg::type>(StdId)) {
     case type::tempomat:
-        Data[0] = 0xff000000 & data >> 24;
-        Data[1] = 0xff0000 & data >> 16;
-        Data[2] = 0xff00 & data >> 8;
-        Data[3] = 0xff & data >> 0;
-        DLC = 4;
+        encode<frames::Tempomat>(*this, data);
         break;
 
     case type::ignition:
-        {
-            const auto ignitionData = data & 0x01;
-            Data[4] = 0xff & ignitionData;
-            Data[5] = ~(0xff & ignitionData);
-            DLC = 6;
-            break;
-        }
+        encode<frames::Ignition>(*this, data);
+        break;
 
     case type::start:
-        {
-            const auto startDate = data & 0x01;
-            Data[0] = 0xff & startDate;
-            Data[1] = ~(0xff & startDate);
-            DLC = 2;
-            break;
-        }
+        encode<frames::Start>(*this, data);
+        break;
 
     case type::speed:
-        Data[0] = 0x00;
-        Data[1] = 0x00;
-        Data[2] = 0x00;
-        Data[3] = 0x00;
-        Data[4] = 0xff000000 & data >> 24;
-        Data[5] = 0xff0000 & data >> 16;
-        Data[6] = 0xff00 & data >> 8;
-        Data[7] = 0xff & data >> 0;
-        DLC = 8;
+        encode<frames::Speed>(*this, data);
         break;
 
     case type::fuelLevel:
-        // max 255 l
-        Data[0] = 0xff & data;
+        encode<frames::FuelLevel>(*this, data);
         break;
 
     case type::oilLevel:
-        // max. 15l
-        Data[0] = 0x0f & data;
+        encode<frames::OilLevel>(*this, data);
         break;
 
     case type::engineTemperature:
-        // max 255
-        Data[0] = 0x00;
-        Data[1] = 0xff & data;
+        encode<frames::EngineTemperature>(*this, data);
         break;
 
     case type::engineRPM:
-        // max 12.287 (0x2FFF)
-        Data[0] = 0x00;
-        Data[1] = 0x00;
-        Data[2] = 0x00;
-        Data[3] = 0x2f00 & data >> 8;
-        Data[4] = 0xff & data >> 0;
-        DLC = 5;
+        encode<frames::EngineRPM>(*this, data);
         break;
 
     case type::malfunction:
-        {
-            const auto malData = data & 0x01;
-            Data[3] = 0xff & malData;
-            Data[4] = ~(0xff & malData);
-            DLC = 5;
-            break;
-        }
+        encode<frames::Malfunction>(*this, data);
+        break;
     }
 }
 
@@ -107,37 +75,31 @@ uint32_t msg::getData(void) const
 {
     switch (static_cast<msg::type>(StdId)) {
     case type::tempomat:
-        return (Data[0] << 24) +
-               (Data[1] << 16) +
-               (Data[2] << 8) +
-               (Data[3] << 0);
+        return frames::Tempomat::decode(Data);
 
     case type::ignition:
-        return 0xff == (Data[4] ^ Data[5]) ? Data[4] : 0;
+        return frames::Ignition::decode(Data);
 
     case type::start:
-        return 0xff == (Data[0] ^ Data[1]) ? Data[0] : 0;
+        return frames::Start::decode(Data);
 
     case type::speed:
-        return (Data[4] << 24) +
-               (Data[5] << 16) +
-               (Data[6] << 8) +
-               (Data[7] << 0);
+        return frames::Speed::decode(Data);
 
     case type::fuelLevel:
-        return Data[0];
+        return frames::FuelLevel::decode(Data);
 
     case type::oilLevel:
-        return Data[0];
+        return frames::OilLevel::decode(Data);
 
     case type::engineTemperature:
-        return Data[1];
+        return frames::EngineTemperature::decode(Data);
 
     case type::engineRPM:
-        return (Data[3] << 8) +
-               (Data[4] << 0);
+        return frames::EngineRPM::decode(Data);
 
     case type::malfunction:
-        return 0xff == (Data[3] ^ Data[4]) ? Data[3] : 0;
+        return frames::Malfunction::decode(Data);
     }
+    return 0;
 }
@@ -6,22 +6,75 @@
 #pragma once
 
 #include "Can.h"
+#include "CanSignalCodec.h"
 #include <cstddef>
 
 namespace app
 {
+namespace frames
+{
+/// Frame with a single numeric signal
+template<uint32_t ID, uint8_t DLC, typename Signal>
+struct ValueFrame : CanMessage<ID, DLC> {
+    using value = Signal;
+
+    static constexpr uint32_t decode(const CanPayload::Data& data)
+    {
+        return CanPayload::get<value>(data);
+    }
+
+    static constexpr void encode(CanPayload::Data& data, const uint32_t v)
+    {
+        CanPayload::pack<value>(data, v);
+    }
+};
+
+/// Frame with an on/off state, protected by its inverted copy in the next byte
+template<uint32_t ID, uint8_t DLC, uint8_t STATE_BYTE>
+struct SwitchFrame : CanMessage<ID, DLC> {
+    using state = CanSignal<STATE_BYTE * 8, 8>;
+    using stateInverted = CanSignal<STATE_BYTE * 8 + 8, 8>;
+
+    /// @return 0 if the inverted copy doesn't match
+    static constexpr uint32_t decode(const CanPayload::Data& data)
+    {
+        const auto [s, inverted] = CanPayload::unpack<state, stateInverted>(data);
+        return (s ^ inverted) == 0xff ? s : 0;
+    }
+
+    static constexpr void encode(CanPayload::Data& data, const uint32_t v)
+    {
+        CanPayload::pack<state, stateInverted>(data, v & 0x01, (v & 0x01) ^ 0xff);
+    }
+};
+
+using Tempomat = ValueFrame<0x143, 4, CanSignal<7, 32, CanByteOrder::Motorola> >;
+using Ignition = SwitchFrame<0x23, 6, 4>;
+using Start = SwitchFrame<0x453, 2, 0>;
+using Speed = ValueFrame<0x3c9, 8, CanSignal<39, 32, CanByteOrder::Motorola> >;
+// max 255 l
+using FuelLevel = ValueFrame<0x210, 1, CanSignal<0, 8> >;
+// max 15 l
+using OilLevel = ValueFrame<0x116, 1, CanSignal<0, 4> >;
+// max 255
+using EngineTemperature = ValueFrame<0x156, 2, CanSignal<8, 8> >;
+// max 12.287 (0x2FFF)
+using EngineRPM = ValueFrame<0x3ff, 5, CanSignal<31, 16, CanByteOrder::Motorola> >;
+using Malfunction = SwitchFrame<0x4ac, 5, 3>;
+}
+
 struct msg :
     CanTxMsg {
     enum class type : uint32_t {
-        tempomat = 0x143,
-        ignition = 0x23,
-        start = 0x453,
-        speed = 0x3c9,
-        fuelLevel = 0x210,
-        oilLevel = 0x116,
-        engineTemperature = 0x156,
-        engineRPM = 0x3ff,
-        malfunction = 0x4ac
+        tempomat = frames::Tempomat::id,
+        ignition = frames::Ignition::id,
+        start = frames::Start::id,
+        speed = frames::Speed::id,
+        fuelLevel = frames::FuelLevel::id,
+        oilLevel = frames::OilLevel::id,
+        engineTemperature = frames::EngineTemperature::id,
+        engineRPM = frames::EngineRPM::id,
+        malfunction = frames::Malfunction::id
     };
 
     void setType(const msg::type t);
@@ -6,78 +6,63 @@
 #include "Gpio.h"
 #include "trace.h"
 #include "Can.h"
+#include "CanDispatchTable.h"
+#include "CanCyclicScheduler.h"
 #include "DashBoard.h"
-#include <cstring>
 #include "CANFrames.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
-const os::TaskEndless DashBoard("Dash",
-                                2048, os::Task::Priority::MEDIUM, [](const bool&){
-                                constexpr const hal::Can& can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
-                                Trace(ZONE_INFO, "Hello MITM Challange Dashboard\r\n");
-                                while (true) {
-                                    app::msg msg;
-
-                                    os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                    msg.setType(app::msg::type::tempomat);
-                                    msg.setData(0);
-                                    can.send(msg);
-                                    os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                    msg.setType(app::msg::type::ignition);
-                                    msg.setData(0);
-                                    can.send(msg);
-                                    os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                    msg.setType(app::msg::type::start);
-                                    msg.setData(0);
-                                    can.send(msg);
-                                }
-    });
+template<typename Frame>
+static bool provideSwitchOff(CanTxMsg& frame)
+{
+    Frame::init(frame);
+    Frame::encode(frame.Data, 0);
+    return true;
+}
+
+static constexpr auto DashBoardTxSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideSwitchOff<app::frames::Tempomat>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideSwitchOff<app::frames::Ignition>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideSwitchOff<app::frames::Start>));
+
+static_assert(DashBoardTxSchedule.hasValidPeriods(), "Invalid period in DashBoardTx schedule");
+static_assert(DashBoardTxSchedule.maxFramesPerTick() == 1, "DashBoardTx frames are sent in bursts");
+
+static app::CanCyclicScheduler<DashBoardTxSchedule.size()> DashBoardTx(
+    hal::Factory<hal::Can>::get<hal::Can::MAINCAN>(), DashBoardTxSchedule);
+
+static constexpr auto DashBoardRxTable = hal::makeCanDispatchTable(
+    hal::CanDispatchEntry::standard(app::frames::Speed::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set Speed to %d\r\n", app::frames::Speed::decode(f.msg.Data));
+}),
+    hal::CanDispatchEntry::standard(app::frames::FuelLevel::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set fuelLevel to %d\r\n", app::frames::FuelLevel::decode(f.msg.Data));
+}),
+    hal::CanDispatchEntry::standard(app::frames::OilLevel::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set oilLevel to %d\r\n", app::frames::OilLevel::decode(f.msg.Data));
+}),
+    hal::CanDispatchEntry::standard(app::frames::EngineTemperature::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set engineTemperature to %d\r\n", app::frames::EngineTemperature::decode(f.msg.Data));
+}),
+    hal::CanDispatchEntry::standard(app::frames::EngineRPM::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set engineRPM to %d\r\n", app::frames::EngineRPM::decode(f.msg.Data));
+}),
+    hal::CanDispatchEntry::standard(app::frames::Malfunction::id, [](const hal::Can::RxFrame& f) {
+    Trace(ZONE_INFO, "Set mal to %d\r\n", app::frames::Malfunction::decode(f.msg.Data));
+}));
+
+static_assert(DashBoardRxTable.hasUniqueKeys(), "Duplicated CAN id in DashBoardRx dispatch table");
 
 const os::TaskEndless DashBoardRx("DashRx",
                                   2048, os::Task::Priority::HIGH, [](const bool&) {
                                   constexpr const hal::Can& can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
                                   Trace(ZONE_INFO, "Hello MITM Dashboard Receive\r\n");
 
+                                  can.enableBufferedReceive();
+
                                   while (true) {
                                       os::ThisTask::sleep(std::chrono::milliseconds(5));
-
-                                      CanRxMsg rxmsg;
-                                      std::memset(&rxmsg, 0, sizeof(rxmsg));
-                                      auto retReceive = can.receive(rxmsg);
-
-                                      if (retReceive) {
-                                          app::msg rxm;
-                                          memcpy(&rxm, &rxmsg, sizeof(rxm));
-
-                                          switch (rxm.getType()) {
-                                          case app::msg::type::speed:
-                                              Trace(ZONE_INFO, "Set Speed to %d\r\n", rxm.getData());
-                                              break;
-
-                                          case app::msg::type::fuelLevel:
-                                              Trace(ZONE_INFO, "Set fuelLevel to %d\r\n", rxm.getData());
-                                              break;
-
-                                          case app::msg::type::oilLevel:
-                                              Trace(ZONE_INFO, "Set fuelLevel to %d\r\n", rxm.getData());
-                                              break;
-
-                                          case app::msg::type::engineTemperature:
-                                              Trace(ZONE_INFO, "Set engineTemperature to %d\r\n", rxm.getData());
-                                              break;
-
-                                          case app::msg::type::engineRPM:
-                                              Trace(ZONE_INFO, "Set engineRPM to %d\r\n", rxm.getData());
-                                              break;
-
-                                          case app::msg::type::malfunction:
-                                              Trace(ZONE_INFO, "Set mal to %d\r\n", rxm.getData());
-                                              break;
-                                          }
-                                      }
+                                      can.dispatchBuffered(DashBoardRxTable);
                                   }
     });
@@ -9,6 +9,5 @@
 
 namespace app
 {
-extern const os::TaskEndless DashBoard;
 extern const os::TaskEndless DashBoardRx;
 }
@@ -7,8 +7,9 @@
 #include "Gpio.h"
 #include "trace.h"
 #include "Can.h"
+#include "CanDispatchTable.h"
+#include "CanCyclicScheduler.h"
 #include "MotorECU.h"
-#include <cstring>
 #include "CANFrames.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
@@ -47,47 +48,32 @@ public:
     }
 };
 
-const os::TaskEndless MotorECU("MotorECU",
-                               2048, os::Task::Priority::MEDIUM, [](const bool&){
-                               constexpr const hal::Can& can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
-                               Trace(ZONE_INFO, "Hello MITM Challange MotorECU\r\n");
-                               while (true) {
-                                   if (!challangeSolved) {
-                                       app::msg msg;
-
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::speed);
-                                       msg.setData(speed);
-                                       can.send(msg);
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::fuelLevel);
-                                       msg.setData(fuelLevel);
-                                       can.send(msg);
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::oilLevel);
-                                       msg.setData(oilLevel);
-                                       can.send(msg);
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::engineTemperature);
-                                       msg.setData(engineTemperature);
-                                       can.send(msg);
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::engineRPM);
-                                       msg.setData(engineRpm);
-                                       can.send(msg);
-                                       os::ThisTask::sleep(std::chrono::milliseconds(300));
-
-                                       msg.setType(app::msg::type::malfunction);
-                                       msg.setData(malFunction);
-                                       can.send(msg);
-                                   }
-                               }
-    });
+template<typename Frame, const uint32_t& data>
+static bool provideState(CanTxMsg& frame)
+{
+    if (challangeSolved) {
+        return false;
+    }
+    Frame::init(frame);
+    Frame::encode(frame.Data, data);
+    return true;
+}
+
+static constexpr auto MotorECUTxSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800), provideState<app::frames::Speed, speed>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800), provideState<app::frames::FuelLevel, fuelLevel>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800), provideState<app::frames::OilLevel, oilLevel>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800),
+                               provideState<app::frames::EngineTemperature, engineTemperature>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800), provideState<app::frames::EngineRPM, engineRpm>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1800),
+                               provideState<app::frames::Malfunction, malFunction>));
+
+static_assert(MotorECUTxSchedule.hasValidPeriods(), "Invalid period in MotorECUTx schedule");
+static_assert(MotorECUTxSchedule.maxFramesPerTick() == 1, "MotorECUTx frames are sent in bursts");
+
+static app::CanCyclicScheduler<MotorECUTxSchedule.size()> MotorECUTx(
+    hal::Factory<hal::Can>::get<hal::Can::MAINCAN>(), MotorECUTxSchedule);
 
 const os::TaskEndless MotorECUSimu("MotorECUSimu",
                                    2048, os::Task::Priority::MEDIUM, [](const bool&){
@@ -180,40 +166,33 @@ const os::TaskEndless MotorECUSimu("MotorECUSimu",
                                    }
     });
 
+static constexpr auto MotorECURxTable = hal::makeCanDispatchTable(
+    hal::CanDispatchEntry::standard(app::frames::Tempomat::id, [](const hal::Can::RxFrame& f) {
+    tempomat = app::frames::Tempomat::decode(f.msg.Data);
+    Trace(ZONE_INFO, "Set tempomat to %d\r\n", tempomat);
+}),
+    hal::CanDispatchEntry::standard(app::frames::Ignition::id, [](const hal::Can::RxFrame& f) {
+    ignition = app::frames::Ignition::decode(f.msg.Data);
+    Trace(ZONE_INFO, "Set ignition to %d\r\n", ignition);
+}),
+    hal::CanDispatchEntry::standard(app::frames::Start::id, [](const hal::Can::RxFrame& f) {
+    start = app::frames::Start::decode(f.msg.Data);
+    Trace(ZONE_INFO, "Set motor start to %d\r\n", start);
+}));
+
+static_assert(MotorECURxTable.hasUniqueKeys(), "Duplicated CAN id in MotorECURx dispatch table");
+
 const os::TaskEndless MotorECURx("MotorECURx",
                                  2048, os::Task::Priority::HIGH, [](const bool&) {
                                  constexpr const hal::Can& can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
                                  Trace(ZONE_INFO, "Hello MITM Challange MotorECU Receive\r\n");
 
+                                 can.enableBufferedReceive();
+
                                  while (true) {
+                                     os::ThisTask::sleep(std::chrono::milliseconds(1));
                                      if (!challangeSolved) {
-                                         os::ThisTask::sleep(std::chrono::milliseconds(1));
-
-                                         CanRxMsg rxmsg;
-                                         std::memset(&rxmsg, 0, sizeof(rxmsg));
-                                         auto retReceive = can.receive(rxmsg);
-
-                                         if (retReceive) {
-                                             app::msg rxm;
-                                             memcpy(&rxm, &rxmsg, sizeof(rxm));
-
-                                             switch (rxm.getType()) {
-                                             case app::msg::type::tempomat:
-                                                 Trace(ZONE_INFO, "Set tempomat to %d\r\n", rxm.getData());
-                                                 tempomat = rxm.getData();
-                                                 break;
-
-                                             case app::msg::type::ignition:
-                                                 Trace(ZONE_INFO, "Set ignition to %d\r\n", rxm.getData());
-                                                 ignition = rxm.getData();
-                                                 break;
-
-                                             case app::msg::type::start:
-                                                 Trace(ZONE_INFO, "Set motor start to %d\r\n", rxm.getData());
-                                                 start = rxm.getData();
-                                                 break;
-                                             }
-                                         }
+                                         can.dispatchBuffered(MotorECURxTable);
                                      }
                                  }
     });
@@ -9,7 +9,6 @@
 
 namespace app
 {
-extern const os::TaskEndless MotorECU;
 extern const os::TaskEndless MotorECURx;
 extern const os::TaskEndless MotorECUSimu;
 }
@@ -6,6 +6,7 @@
 #ifndef SOURCES_CAN_INTERRUPTS_H_
 #define SOURCES_CAN_INTERRUPTS_H_
 
+#define USB_HP_CAN1_TX_INTERRUPT_ENABLED true
 #define USB_LP_CAN1_RX0_INTERRUPT_ENABLED true
 #define CAN1_RX1_INTERRUPT_ENABLED true
 
@@ -27,17 +28,33 @@ static constexpr const std::array<const Can, Can::__ENUM__SIZE + 1> Container =
 { {
       Can(Can::MAINCAN,
           CAN1_BASE,
-          CAN_InitTypeDef { 9, CAN_Mode_Normal, CAN_SJW_1tq, CAN_BS1_13tq, CAN_BS2_2tq, DISABLE, DISABLE,
+          CAN_InitTypeDef { 9, CAN_Mode_Normal, CAN_SJW_1tq, CAN_BS1_13tq, CAN_BS2_2tq, ENABLE, DISABLE,
                             DISABLE, DISABLE, DISABLE, DISABLE}),
       Can(Can::__ENUM__SIZE, 0, CAN_InitTypeDef { 0, 0, 0, 0, 0, DISABLE, DISABLE,
                                                   DISABLE, DISABLE, DISABLE, DISABLE})
   }};
 
-static constexpr const std::array<const CAN_FilterInitTypeDef, 1> CanFilterContainer =
-{ {
-      CAN_FilterInitTypeDef{0x0000 << 5, 0x0000, 0x0000 << 5, 0x0000, 0, 0,
-                            CAN_FilterMode_IdMask, CAN_FilterScale_32bit, ENABLE}
-  }};
+#if CAN_BUS_LOGGER
+// The bus logger records complete captures
+static constexpr const CanFilterBanks CanFilterContainer = makeCanFilterBanks(
+    CanIdRange::standard(0x000, 0x7ff),
+    CanIdRange::extended(0x00000000, 0x1fffffff));
+#else
+static constexpr const CanFilterBanks CanFilterContainer = makeCanFilterBanks(
+    CanIdRange::standard(0x023), // ignition
+    CanIdRange::standard(0x116), // oilLevel
+    CanIdRange::standard(0x143), // tempomat
+    CanIdRange::standard(0x156), // engineTemperature
+    CanIdRange::standard(0x210), // fuelLevel
+    CanIdRange::standard(0x3c9), // speed
+    CanIdRange::standard(0x3ff), // engineRPM
+    CanIdRange::standard(0x453), // start
+    CanIdRange::standard(0x4ac), // malfunction
+    CanIdRange::standard(0x456), // TestIsoTp
+    CanIdRange::standard(0x734), // TestIsoTp
+    CanIdRange::standard(0x520), // MITMChallange
+    CanIdRange::standard(0x700)); // TestCan
+#endif
 
 #endif /* SOURCES_CAN_CONFIG_CONTAINER_H_ */
 #endif /* SOURCES_CAN_CONFIG_DESCRIPTION_H_ */
@@ -8,6 +8,8 @@
 
 enum Description {
     // ===PORTA===
+    USART1_TX,
+    USART1_RX,
     CANRX,
     CANTX,
     SWDIO,
@@ -27,6 +29,14 @@ static constexpr const std::array<const Gpio, Gpio::__ENUM__SIZE + 1> Container
 { {
       // ===================PORTA=================
 
+      Gpio(Gpio::USART1_TX,
+           GPIOA_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_9, GPIO_Speed_50MHz, GPIO_Mode_AF_PP},
+           GPIO_PinSource9),
+      Gpio(Gpio::USART1_RX,
+           GPIOA_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_10, GPIO_Speed_50MHz, GPIO_Mode_IN_FLOATING},
+           GPIO_PinSource10),
       Gpio(Gpio::CANRX,
            GPIOA_BASE,
            GPIO_InitTypeDef {GPIO_Pin_11, GPIO_Speed_50MHz, GPIO_Mode_IN_FLOATING},
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#ifndef SOURCES_PMD_USARTWITHDMA_CONFIG_CONTAINER_H_
+#define SOURCES_PMD_USARTWITHDMA_CONFIG_CONTAINER_H_
+
+static const size_t CONTAINERSIZE = 1;
+
+static constexpr const std::array<const UsartWithDma, CONTAINERSIZE> Container =
+{ {
+      UsartWithDma(Factory<Usart>::get<Usart::LOGGER_IF>(), USART_DMAReq_Tx,
+                   &Factory<Dma>::get<Dma::USART1_TX>(), nullptr)
+  } };
+
+#endif /* SOURCES_PMD_USART_CONFIG_CONTAINER_H_ */
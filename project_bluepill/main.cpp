@@ -22,6 +22,9 @@
 #include "hal_Factory.h"
 #include "Gpio.h"
 #include "Can.h"
+#include "Usart.h"
+#include "Dma.h"
+#include "UsartWithDma.h"
 
 /* DEV LAYER INLCUDES */
 
@@ -42,6 +45,9 @@ const std::string VERSION(&_version_start, (&_version_end - &_version_start));
 int main(void)
 {
     hal::initFactory<hal::Factory<hal::Gpio> >();
+    hal::initFactory<hal::Factory<hal::Usart> >();
+    hal::initFactory<hal::Factory<hal::Dma> >();
+    hal::initFactory<hal::Factory<hal::UsartWithDma> >();
     hal::initFactory<hal::Factory<hal::Can> >();
 
     TraceInit();
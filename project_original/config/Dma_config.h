@@ -78,7 +78,7 @@ static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_HalfWord,
                             DMA_MemoryDataSize_HalfWord, DMA_Mode_Circular,
                             DMA_Priority_Medium, DMA_M2M_Disable },
-          DMA_IT_TC, IRQn_Type::DMA2_Channel4_IRQn),
+          DMA_IT_TC | DMA_IT_HT, IRQn_Type::DMA2_Channel4_IRQn),
       Dma(Dma::ADC3_DMA,
           DMA2_Channel5_BASE,
           DMA_InitTypeDef { ADC3_BASE + 0x40, 0, DMA_DIR_PeripheralSRC, 0, DMA_PeripheralInc_Disable,
@@ -16,6 +16,8 @@ enum Description {
     TEST_ADC,
     DISCO_DEMO_COM_RX,
     DISCO_DEMO_COM_TX,
+    MEMS_SPI_RX,
+    MEMS_SPI_TX,
     __ENUM__SIZE
 };
 
@@ -27,10 +29,11 @@ static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
 { {
       Dma(Dma::MEMORY,
           DMA2_Stream3_BASE,
-          DMA_InitTypeDef {0, 0, 0, 0, 1, 0}),
+          DMA_InitTypeDef {0, 0, 0, 0, 1, 0},
+          DMA_IT_TC, &Factory<Nvic>::get<Nvic::MEMORY_DMA>()),
       Dma(Dma::TEST_ADC,
           DMA2_Stream0_BASE,
-          DMA_InitTypeDef { DMA_Channel_0, reinterpret_cast<uint32_t>(&(ADC1->DR)), 0,
+          DMA_InitTypeDef { DMA_Channel_0, ADC1_BASE + offsetof(ADC_TypeDef, DR), 0,
                             DMA_DIR_PeripheralToMemory, 1, DMA_PeripheralInc_Disable,
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_HalfWord,
                             DMA_MemoryDataSize_HalfWord, DMA_Mode_Normal,
@@ -39,22 +42,39 @@ static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
           DMA_IT_TC, &Factory<Nvic>::get<Nvic::ADC1_DMA_INT>()),
       Dma(Dma::DISCO_DEMO_COM_RX,
           DMA1_Stream2_BASE,
-          DMA_InitTypeDef { DMA_Channel_4, reinterpret_cast<uint32_t>(&(UART4->DR)), 0,
+          DMA_InitTypeDef { DMA_Channel_4, UART4_BASE + offsetof(USART_TypeDef, DR), 0,
                             DMA_DIR_PeripheralToMemory, 15, DMA_PeripheralInc_Disable,
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_Byte,
                             DMA_MemoryDataSize_Byte, DMA_Mode_Normal,
                             DMA_Priority_High, DMA_FIFOMode_Disable, DMA_FIFOThreshold_3QuartersFull,
                             DMA_MemoryBurst_Single, DMA_PeripheralBurst_Single},
-          DMA_IT_TC, &Factory<Nvic>::get<Nvic::USART4_DMA_RX>()),
+          DMA_IT_TC | DMA_IT_HT, &Factory<Nvic>::get<Nvic::USART4_DMA_RX>()),
       Dma(Dma::DISCO_DEMO_COM_TX,
           DMA1_Stream4_BASE,
-          DMA_InitTypeDef { DMA_Channel_4, reinterpret_cast<uint32_t>(&(UART4->DR)), 0,
+          DMA_InitTypeDef { DMA_Channel_4, UART4_BASE + offsetof(USART_TypeDef, DR), 0,
                             DMA_DIR_MemoryToPeripheral, 15, DMA_PeripheralInc_Disable,
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_Byte,
                             DMA_MemoryDataSize_Byte, DMA_Mode_Normal,
                             DMA_Priority_High, DMA_FIFOMode_Disable, DMA_FIFOThreshold_3QuartersFull,
                             DMA_MemoryBurst_Single, DMA_PeripheralBurst_Single},
           DMA_IT_TC, &Factory<Nvic>::get<Nvic::USART4_DMA_TX>()),
+      Dma(Dma::MEMS_SPI_RX,
+          DMA2_Stream2_BASE,
+          DMA_InitTypeDef { DMA_Channel_3, SPI1_BASE + offsetof(SPI_TypeDef, DR), 0,
+                            DMA_DIR_PeripheralToMemory, 1, DMA_PeripheralInc_Disable,
+                            DMA_MemoryInc_Enable, DMA_PeripheralDataSize_Byte,
+                            DMA_MemoryDataSize_Byte, DMA_Mode_Normal,
+                            DMA_Priority_High, DMA_FIFOMode_Disable, DMA_FIFOThreshold_3QuartersFull,
+                            DMA_MemoryBurst_Single, DMA_PeripheralBurst_Single},
+          DMA_IT_TC, &Factory<Nvic>::get<Nvic::MEMS_SPI_DMA_RX>()),
+      Dma(Dma::MEMS_SPI_TX,
+          DMA2_Stream5_BASE,
+          DMA_InitTypeDef { DMA_Channel_3, SPI1_BASE + offsetof(SPI_TypeDef, DR), 0,
+                            DMA_DIR_MemoryToPeripheral, 1, DMA_PeripheralInc_Disable,
+                            DMA_MemoryInc_Enable, DMA_PeripheralDataSize_Byte,
+                            DMA_MemoryDataSize_Byte, DMA_Mode_Normal,
+                            DMA_Priority_High, DMA_FIFOMode_Disable, DMA_FIFOThreshold_3QuartersFull,
+                            DMA_MemoryBurst_Single, DMA_PeripheralBurst_Single}),
       Dma(Dma::__ENUM__SIZE,
           0,
           DMA_InitTypeDef { })
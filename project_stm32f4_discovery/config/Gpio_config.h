@@ -9,6 +9,12 @@
 enum Description {
     // ===PORTA===
     USER_BUTTON,
+    MEMS_SPI_SCK,
+    MEMS_SPI_MISO,
+    MEMS_SPI_MOSI,
+    // ===PORTB===
+    CODEC_I2C_SCL,
+    CODEC_I2C_SDA,
     // ===PORTC===
     ADC_DEMO_PIN,
     PERIOD_MEASUREMENT_1,
@@ -16,12 +22,15 @@ enum Description {
     DISCO_DEMO_COM_TX,
     DISCO_DEMO_COM_RX,
     // ===PORTD===
+    CODEC_RESET,
     DEBUG_IF_TX,
     DEBUG_IF_RX,
     LED_GREEN,
     LED_ORANGE,
     LED_RED,
     LED_BLUE,
+    // ===PORTE===
+    MEMS_CS,
     __ENUM__SIZE
 };
 
@@ -36,6 +45,37 @@ static constexpr const std::array<const Gpio, Gpio::__ENUM__SIZE + 1> Container
            GPIOA_BASE,
            GPIO_InitTypeDef {GPIO_Pin_0, GPIO_Mode_IN, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_DOWN},
            GPIO_PinSource0),
+      // Motion sensor
+      Gpio(Gpio::MEMS_SPI_SCK,
+           GPIOA_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_5, GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_NOPULL},
+           GPIO_PinSource5,
+           GPIO_AF_SPI1),
+      Gpio(Gpio::MEMS_SPI_MISO,
+           GPIOA_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_6, GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_NOPULL},
+           GPIO_PinSource6,
+           GPIO_AF_SPI1),
+      Gpio(Gpio::MEMS_SPI_MOSI,
+           GPIOA_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_7, GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_NOPULL},
+           GPIO_PinSource7,
+           GPIO_AF_SPI1),
+
+      // ===================PORTB=================
+      // Audio codec, pulled up on the board. Reconfigurable to clock a hung bus free.
+      Gpio(Gpio::CODEC_I2C_SCL,
+           GPIOB_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_6, GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_OD, GPIO_PuPd_NOPULL},
+           GPIO_PinSource6,
+           GPIO_AF_I2C1,
+           true),
+      Gpio(Gpio::CODEC_I2C_SDA,
+           GPIOB_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_9, GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_OD, GPIO_PuPd_NOPULL},
+           GPIO_PinSource9,
+           GPIO_AF_I2C1,
+           true),
 
       // ===================PORTC=================
       Gpio(Gpio::ADC_DEMO_PIN,
@@ -63,6 +103,9 @@ static constexpr const std::array<const Gpio, Gpio::__ENUM__SIZE + 1> Container
            GPIO_AF_UART4),
 
       // ===================PORTD=================
+      Gpio(Gpio::CODEC_RESET,
+           GPIOD_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_4, GPIO_Mode_OUT, GPIO_Speed_2MHz, GPIO_OType_PP, GPIO_PuPd_NOPULL}),
       Gpio(Gpio::DEBUG_IF_TX,
            GPIOD_BASE,
            GPIO_InitTypeDef { GPIO_Pin_8, GPIO_Mode_AF, GPIO_Speed_2MHz, GPIO_OType_PP, GPIO_PuPd_UP},
@@ -86,6 +129,11 @@ static constexpr const std::array<const Gpio, Gpio::__ENUM__SIZE + 1> Container
            GPIOD_BASE,
            GPIO_InitTypeDef {GPIO_Pin_15, GPIO_Mode_OUT, GPIO_Speed_25MHz, GPIO_OType_PP, GPIO_PuPd_UP}),
 
+      // ===================PORTE=================
+      Gpio(Gpio::MEMS_CS,
+           GPIOE_BASE,
+           GPIO_InitTypeDef {GPIO_Pin_3, GPIO_Mode_OUT, GPIO_Speed_25MHz, GPIO_OType_PP, GPIO_PuPd_UP}),
+
       // =================== END =================
       Gpio(Gpio::__ENUM__SIZE,
            GPIOG_BASE,
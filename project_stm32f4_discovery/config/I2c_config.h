@@ -7,6 +7,7 @@
 #define SOURCES_PMD_I2C_CONFIG_DESCRIPTION_H_
 
 enum Description {
+    CODEC_I2C,
     __ENUM__SIZE
 };
 #else
@@ -18,10 +19,21 @@ enum Description {
 
 static constexpr const std::array<const I2c, I2c::__ENUM__SIZE> Container =
 { {
+      I2c(I2c::CODEC_I2C,
+          I2C1_BASE,
+          I2C_InitTypeDef { 100000, I2C_Mode_I2C, I2C_DutyCycle_2, 0x00, I2C_Ack_Enable,
+                            I2C_AcknowledgedAddress_7bit },
+          &Factory<Nvic>::get<Nvic::CODEC_I2C_EVENT>(),
+          &Factory<Nvic>::get<Nvic::CODEC_I2C_ERROR>(),
+          nullptr,
+          nullptr,
+          &Factory<Gpio>::getAlternateFunctionGpio<Gpio::CODEC_I2C_SCL>(),
+          &Factory<Gpio>::getAlternateFunctionGpio<Gpio::CODEC_I2C_SDA>())
   }};
 
 static constexpr const std::array<const uint32_t, I2c::__ENUM__SIZE> Clocks =
 { {
+      RCC_APB1Periph_I2C1
   }};
 
 #endif /* SOURCES_PMD_I2C_CONFIG_CONTAINER_H_ */
@@ -28,6 +28,10 @@ enum Description {
     DEBUG_IF,
     USART4_DMA_RX,
     USART4_DMA_TX,
+    MEMORY_DMA,
+    CODEC_I2C_EVENT,
+    CODEC_I2C_ERROR,
+    MEMS_SPI_DMA_RX,
     __ENUM__SIZE
 };
 
@@ -44,6 +48,10 @@ static constexpr const std::array<const Nvic, Nvic::__ENUM__SIZE + 1> Container
       Nvic(Nvic::DEBUG_IF, IRQn::USART3_IRQn),
       Nvic(Nvic::USART4_DMA_RX, IRQn::DMA1_Stream2_IRQn),
       Nvic(Nvic::USART4_DMA_TX, IRQn::DMA1_Stream4_IRQn),
+      Nvic(Nvic::MEMORY_DMA, IRQn::DMA2_Stream3_IRQn),
+      Nvic(Nvic::CODEC_I2C_EVENT, IRQn::I2C1_EV_IRQn),
+      Nvic(Nvic::CODEC_I2C_ERROR, IRQn::I2C1_ER_IRQn),
+      Nvic(Nvic::MEMS_SPI_DMA_RX, IRQn::DMA2_Stream2_IRQn),
       Nvic(Nvic::__ENUM__SIZE, IRQn::FPU_IRQn)
   }};
 #endif /* SOURCES_PMD_NVIC_CONFIG_CONTAINER_H_ */
@@ -94,8 +102,8 @@ static constexpr const std::array<const Nvic, Nvic::__ENUM__SIZE + 1> Container
 #define TIM2_IRQn_ENABLE false    /*!< TIM2 global Interrupt                                             */
 #define TIM3_IRQn_ENABLE false    /*!< TIM3 global Interrupt                                             */
 #define TIM4_IRQn_ENABLE false    /*!< TIM4 global Interrupt                                             */
-#define I2C1_EV_IRQn_ENABLE false    /*!< I2C1 Event Interrupt                                              */
-#define I2C1_ER_IRQn_ENABLE false    /*!< I2C1 Error Interrupt                                              */
+#define I2C1_EV_IRQn_ENABLE true    /*!< I2C1 Event Interrupt                                              */
+#define I2C1_ER_IRQn_ENABLE true    /*!< I2C1 Error Interrupt                                              */
 #define I2C2_EV_IRQn_ENABLE false    /*!< I2C2 Event Interrupt                                              */
 #define I2C2_ER_IRQn_ENABLE false    /*!< I2C2 Error Interrupt                                              */
 #define SPI1_IRQn_ENABLE false    /*!< SPI1 global Interrupt                                             */
@@ -121,8 +129,8 @@ static constexpr const std::array<const Nvic, Nvic::__ENUM__SIZE + 1> Container
 #define TIM7_IRQn_ENABLE false    /*!< TIM7 global interrupt                                             */
 #define DMA2_Stream0_IRQn_ENABLE true    /*!< DMA2 Stream 0 global Interrupt                                    */
 #define DMA2_Stream1_IRQn_ENABLE false    /*!< DMA2 Stream 1 global Interrupt                                    */
-#define DMA2_Stream2_IRQn_ENABLE false    /*!< DMA2 Stream 2 global Interrupt                                    */
-#define DMA2_Stream3_IRQn_ENABLE false    /*!< DMA2 Stream 3 global Interrupt                                    */
+#define DMA2_Stream2_IRQn_ENABLE true    /*!< DMA2 Stream 2 global Interrupt                                    */
+#define DMA2_Stream3_IRQn_ENABLE true    /*!< DMA2 Stream 3 global Interrupt                                    */
 #define DMA2_Stream4_IRQn_ENABLE false    /*!< DMA2 Stream 4 global Interrupt                                    */
 #define ETH_IRQn_ENABLE false    /*!< Ethernet global Interrupt                                         */
 #define ETH_WKUP_IRQn_ENABLE false    /*!< Ethernet Wakeup through EXTI line Interrupt                       */
@@ -8,5 +8,7 @@
 
 static constexpr const std::array<const SpiWithDma, Spi::__ENUM__SIZE> Container =
 { {
+      SpiWithDma(&Factory<Spi>::get<Spi::MEMS_SPI>(), SPI_I2S_DMAReq_Tx | SPI_I2S_DMAReq_Rx,
+                 &Factory<Dma>::get<Dma::MEMS_SPI_TX>(), &Factory<Dma>::get<Dma::MEMS_SPI_RX>())
   } };
 #endif /* SOURCES_PMD_SPI_CONFIG_CONTAINER_H_ */
@@ -7,6 +7,7 @@
 #define SOURCES_PMD_SPI_CONFIG_DESCRIPTION_H_
 
 enum Description {
+    MEMS_SPI,
     __ENUM__SIZE
 };
 
@@ -16,10 +17,15 @@ enum Description {
 
 static constexpr const std::array<const Spi, Spi::__ENUM__SIZE> Container =
 { {
+      Spi(Spi::MEMS_SPI,
+          SPI1_BASE,
+          SPI_InitTypeDef { SPI_Direction_2Lines_FullDuplex, SPI_Mode_Master, SPI_DataSize_8b, SPI_CPOL_High,
+                            SPI_CPHA_2Edge, SPI_NSS_Soft, SPI_BaudRatePrescaler_16, SPI_FirstBit_MSB, 7 })
   } };
 
 static constexpr const std::array<const uint32_t, Spi::__ENUM__SIZE> Clocks =
 { {
+      RCC_APB2Periph_SPI1,
   } };
 
 #endif /* SOURCES_PMD_SPI_CONFIG_CONTAINER_H_ */
@@ -28,6 +28,7 @@
 #include "Tim.h"
 #include "TimPwm.h"
 #include "Dma.h"
+#include "DmaMemcpy.h"
 #include "Usart.h"
 #include "UsartWithDma.h"
 #include "Spi.h"
@@ -75,6 +76,7 @@ int main(void)
     hal::initFactory<hal::Factory<hal::Nvic> >();
     hal::initFactory<hal::Factory<hal::Exti> >();
     hal::initFactory<hal::Factory<hal::Dma> >();
+    hal::DmaMemcpy::initialize();
     hal::initFactory<hal::Factory<hal::Usart> >();
     hal::initFactory<hal::Factory<hal::UsartWithDma> >();
     hal::initFactory<hal::Factory<hal::Spi> >();
@@ -132,6 +134,63 @@ int main(void)
         }
     });
 
+    // compare std::memcpy and the DMA once to find the crossover
+    new os::TaskInterruptable("memcpy benchmark", 2048, os::Task::Priority::LOW, [](const bool& join){
+        // Static in SRAM, the heap is too small and DMA2 can't reach the CCM RAM
+        static constexpr size_t MAX_LENGTH = 4096;
+        static uint8_t src[MAX_LENGTH + 3];
+        static uint8_t dest[MAX_LENGTH + 3];
+
+        os::ThisTask::sleep(std::chrono::seconds(1));
+
+        for (size_t length = 16; (length <= MAX_LENGTH) && !join; length *= 2) {
+            const auto aligned = hal::DmaMemcpy::benchmark(dest, src, length);
+            const auto unaligned = hal::DmaMemcpy::benchmark(dest + 3, src + 1, length);
+            Trace(ZONE_INFO, "memcpy %5u bytes: cpu %6u dma %6u cycles, unaligned cpu %6u dma %6u cycles\r\n",
+                  static_cast<unsigned>(length), static_cast<unsigned>(aligned.cpuCycles),
+                  static_cast<unsigned>(aligned.dmaCycles), static_cast<unsigned>(unaligned.cpuCycles),
+                  static_cast<unsigned>(unaligned.dmaCycles));
+        }
+    });
+
+    // read the chip id of the audio codec through the interrupt driven I2c
+    new os::TaskInterruptable("codec id", 1024, os::Task::Priority::LOW, [](const bool& join){
+        static constexpr uint16_t CS43L22_ADDRESS = 0x4a;
+        static constexpr uint8_t CS43L22_ID_REGISTER = 0x01;
+        const hal::I2c& i2c = hal::Factory<hal::I2c>::get<hal::I2c::CODEC_I2C>();
+
+        hal::Factory<hal::Gpio>::get<hal::Gpio::CODEC_RESET>() = true;
+        os::ThisTask::sleep(std::chrono::milliseconds(1));
+
+        uint8_t id = 0;
+        if (i2c.read(CS43L22_ADDRESS, CS43L22_ID_REGISTER, &id, sizeof(id)) == sizeof(id)) {
+            Trace(ZONE_INFO, "audio codec id 0x%02x\r\n", id);
+        } else {
+            Trace(ZONE_ERROR, "audio codec doesn't answer, %u bus recoveries\r\n",
+                  static_cast<unsigned>(i2c.getStatistics().recoveries));
+        }
+    });
+
+    // read the id of the motion sensor in one chip selected transaction on the SPI queue
+    new os::TaskInterruptable("mems id", 1024, os::Task::Priority::LOW, [](const bool& join){
+        static constexpr uint8_t READ = 0x80;
+        static constexpr uint8_t WHO_AM_I_REGISTER = 0x0f;
+        // Static in SRAM, DMA2 can't reach the CCM RAM
+        static const uint8_t command = READ | WHO_AM_I_REGISTER;
+        static uint8_t id = 0;
+        const hal::SpiWithDma& spi = hal::Factory<hal::SpiWithDma>::get<hal::Spi::MEMS_SPI>();
+        const hal::Gpio& chipSelect = hal::Factory<hal::Gpio>::get<hal::Gpio::MEMS_CS>();
+        const hal::SpiWithDma::Segment segments[] = {{&command, nullptr, 1}, {nullptr, &id, 1}};
+
+        chipSelect = true;
+        if (spi.transfer(hal::SpiWithDma::Transaction {&chipSelect, hal::SpiWithDma::Mode::MODE3, segments, 2,
+                                                       nullptr}))
+        {
+            // 0x3f is a LIS3DSH, 0x3b a LIS302DL on older boards
+            Trace(ZONE_INFO, "motion sensor id 0x%02x\r\n", id);
+        }
+    });
+
     // create timer period demo task
     auto* const periodMeasurement = new os::TaskInterruptable("timer capture", 2048, os::Task::Priority::LOW,
                                                               [](const bool& join) {
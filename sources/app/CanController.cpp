@@ -4,11 +4,12 @@
  */
 
 #include "CanController.h"
+#include "FirmwareDelta.h"
 #include "trace.h"
-#include <algorithm>
-#include <cstring>
 
 using app::CanController;
+using app::Stm32Bootloader;
+namespace FirmwareDelta = app::FirmwareDelta;
 
 static const int __attribute__((unused)) g_DebugZones = 0; //ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
@@ -17,6 +18,10 @@ os::StreamBuffer<char, CanController::BUFFERSIZE> CanController::ReceiveBuffer;
 extern "C" char _binary_start;
 extern "C" char _binary_end;
 
+// Only linked if the project provides a deltafile.bin
+extern "C" char _delta_start __attribute__((weak));
+extern "C" char _delta_end __attribute__((weak));
+
 void CanController::CanControllerInterruptHandler(uint8_t data)
 {
     if (ReceiveBuffer.isFull()) {
@@ -37,7 +42,8 @@ CanController::CanController(const hal::UsartWithDma& interface,
 }),
     mInterface(interface),
     mCanSupplyVoltage(supplyPin),
-    mUsartTxPin(usartTxPin)
+    mUsartTxPin(usartTxPin),
+    mBootloader(*this)
 {
     mInterface.mUsart.enableNonBlockingReceive(CanControllerInterruptHandler);
 }
@@ -72,144 +78,46 @@ void CanController::taskFunction(const bool& join)
 
 void CanController::flashSecCoFirmware(void)
 {
-    mWasFirmwareUpdateSuccessful = false;
-    mWasFirmwareUpdateSuccessful = flash(std::string_view(
-                                                          reinterpret_cast<char*>(&_binary_start),
-                                                          reinterpret_cast<char*>(&_binary_end) -
-                                                          reinterpret_cast<char*>(&_binary_start)),
-                                         0x8000000);
+    const size_t baudRate = mInterface.mUsart.getBaudRate();
+    const std::string_view image(&_binary_start, &_binary_end - &_binary_start);
+    const std::string_view delta(&_delta_start, &_delta_start != nullptr ? &_delta_end - &_delta_start : 0);
+    FirmwareDelta::Header header;
 
-    mIsPerformingFirmwareUpdate = false;
-}
+    mWasFirmwareUpdateSuccessful = false;
+    if (FirmwareDelta::readHeader(delta, header) && FirmwareDelta::resultsIn(header, image)) {
+        Trace(ZONE_INFO, "Applying delta with %d blocks\r\n", header.blockCount);
+        mWasFirmwareUpdateSuccessful = mBootloader.flashDelta(delta, Stm32Bootloader::FLASH_BASE_ADDRESS);
+    }
+    if (!mWasFirmwareUpdateSuccessful) {
+        mWasFirmwareUpdateSuccessful = mBootloader.flash(image, Stm32Bootloader::FLASH_BASE_ADDRESS);
+    }
 
-bool CanController::connectToBootloader(void)
-{
-    ReceiveBuffer.reset();
-    Trace(ZONE_INFO, "Connecting to bootloader... ");
-    mInterface.send("\x7f");
-    return receiveResponseFromBootloader();
-}
+    const auto statistics = mBootloader.getStatistics();
+    Trace(ZONE_INFO, "%d baud, %d pages erased, %d skipped, %d blocks written\r\n",
+          statistics.baudRate, statistics.pagesErased, statistics.pagesSkipped, statistics.blocksWritten);
 
-bool CanController::sendCommandToBootloader(std::string_view cmd)
-{
-    sendToBootloaderWithChecksum(cmd, 0xff);
-    return receiveResponseFromBootloader();
+    mInterface.mUsart.setBaudRate(baudRate);
+    mIsPerformingFirmwareUpdate = false;
 }
 
-size_t CanController::sendToBootloaderWithChecksum(std::string_view data, uint8_t initvalue)
+void CanController::setBaudRate(const uint32_t baudRate)
 {
-    uint8_t sum = initvalue;
-    std::for_each(
-                  data.begin(),
-                  data.end(),
-                  [&sum](const auto& d){
-        sum ^= d;
-    });
-
-    ReceiveBuffer.reset();
-    auto ret = mInterface.send(data, 100);
-    mInterface.send(&sum, 1);
-    return ret + 1;
+    mInterface.mUsart.setBaudRate(baudRate);
 }
 
-bool CanController::receiveResponseFromBootloader(void)
+void CanController::send(uint8_t const* const data, const size_t length)
 {
-    static constexpr const uint8_t ACK = 0x79;
-
-    char uret;
-    if (!ReceiveBuffer.receive(uret, std::chrono::milliseconds(100))) {
-        Trace(ZONE_INFO, "Nothing received... \r\n");
-        return false;
-    }
-    if (uret != ACK) { return false; }
-    Trace(ZONE_INFO, "ACK.\r\n");
-    return true;
+    mInterface.send(data, length, 100);
 }
 
-uint32_t CanController::swap(const uint32_t num)
+bool CanController::receive(uint8_t& byte, const std::chrono::milliseconds timeout)
 {
-    return ((num >> 24) & 0xff) | // move byte 3 to byte 0
-           ((num << 8) & 0xff0000) | // move byte 1 to byte 2
-           ((num >> 8) & 0xff00) | // move byte 2 to byte 1
-           ((num << 24) & 0xff000000); // byte 0 to byte 3
+    return ReceiveBuffer.receive(reinterpret_cast<char&>(byte), timeout);
 }
 
-bool CanController::eraseChip(void)
+void CanController::discardReceived(void)
 {
-    resetToBootloader();
-
-    if (!connectToBootloader()) {
-        return false;
-    }
-
-    Trace(ZONE_INFO, "Sending erase... ");
-    auto ret = sendCommandToBootloader("\x43");
-    if (ret) {
-        Trace(ZONE_INFO, "Sending global erase... ");
-        if (!sendCommandToBootloader("\xFF")) { return false; }
-    } else {
-        Trace(ZONE_INFO, "Sending readout unprotect command... ");
-        if (!sendCommandToBootloader("\x92")) { return false; }
-        if (!receiveResponseFromBootloader()) { return false; }
-    }
-    return true;
-}
-
-bool CanController::sendGoCommand(const uint32_t goAddress)
-{
-    Trace(ZONE_INFO, "Sending go command... ");
-
-    if (!sendCommandToBootloader("\x21")) {
-        return false;
-    }
-
-    Trace(ZONE_INFO, "Sending go address... ");
-    auto dst_be = swap(goAddress);
-    sendToBootloaderWithChecksum(std::string_view(reinterpret_cast<const char*>(&dst_be), 4));
-    if (!receiveResponseFromBootloader()) { return false; }
-    return true;
-}
-
-bool CanController::flash(std::string_view data, const size_t address)
-{
-    Trace(ZONE_INFO, "Flash 0x%x bytes. \r\n", data.length());
-
-    if (!eraseChip()) {
-        return false;
-    }
-
-    resetToBootloader();
-
-    if (!connectToBootloader()) {
-        return false;
-    }
-
-    uint8_t N = 0;
-    size_t dst = address;
-    size_t src_idx = 0;
-    size_t len = data.length();
-
-    while (len > 0) {
-        Trace(ZONE_INFO, "Sending write command... ");
-        if (!sendCommandToBootloader("\x31")) { return false; }
-
-        Trace(ZONE_INFO, "Sending write address... ");
-        auto dst_be = swap(dst);
-        sendToBootloaderWithChecksum(std::string_view(reinterpret_cast<const char*>(&dst_be), 4));
-        if (!receiveResponseFromBootloader()) { return false; }
-
-        Trace(ZONE_INFO, "Sending data to write... ");
-        N = len >= 256 ? 255 : len - 1;
-        mInterface.send(&N, 1, 100);
-        sendToBootloaderWithChecksum(std::string_view(&data.data()[src_idx], N + 1), N);
-        if (!receiveResponseFromBootloader()) { return false; }
-
-        len -= N + 1;
-        dst += N + 1;
-        src_idx += N + 1;
-    }
-
-    return sendGoCommand(address);
+    ReceiveBuffer.reset();
 }
 
 void CanController::resetToBootloader(void)
@@ -9,6 +9,7 @@
 #include "os_StreamBuffer.h"
 #include "UsartWithDma.h"
 #include "Gpio.h"
+#include "Stm32Bootloader.h"
 #include <string_view>
 #include <array>
 
@@ -16,7 +17,8 @@ namespace app
 {
 class CanTunnel;
 
-class CanController final
+class CanController final :
+    private Stm32Bootloader::Link
 {
     static constexpr size_t STACKSIZE = 1024;
     static constexpr size_t BUFFERSIZE = 2048;
@@ -31,6 +33,8 @@ class CanController final
     const hal::Gpio& mCanSupplyVoltage;
     const hal::Gpio& mUsartTxPin;
 
+    Stm32Bootloader mBootloader;
+
     std::function<void(std::string_view)> mReceiveCallback;
 
     bool mIsPerformingFirmwareUpdate = false;
@@ -38,15 +42,12 @@ class CanController final
 
     void taskFunction(const bool&);
     void flashSecCoFirmware(void);
-    bool flash(std::string_view data, size_t length);
-    void resetToBootloader(void);
-    bool connectToBootloader(void);
-    bool sendCommandToBootloader(std::string_view cmd);
-    uint32_t swap(const uint32_t);
-    bool receiveResponseFromBootloader(void);
-    size_t sendToBootloaderWithChecksum(std::string_view, uint8_t initvalue = 0);
-    bool eraseChip(void);
-    bool sendGoCommand(const uint32_t goAddress);
+
+    void resetToBootloader(void) override;
+    void setBaudRate(const uint32_t baudRate) override;
+    void send(uint8_t const* const data, const size_t length) override;
+    bool receive(uint8_t& byte, const std::chrono::milliseconds timeout) override;
+    void discardReceived(void) override;
 
 public:
     CanController(const hal::UsartWithDma& interface,
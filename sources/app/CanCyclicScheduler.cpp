@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include "CanCyclicScheduler.h"
+
+using app::CanCyclicSchedulerBase;
+
+CanCyclicSchedulerBase* CanCyclicSchedulerBase::First = nullptr;
+
+CanCyclicSchedulerBase::CanCyclicSchedulerBase(void) : mNext(First)
+{
+    First = this;
+    os::Task::setTickHook(&CanCyclicSchedulerBase::tickAll);
+}
+
+void CanCyclicSchedulerBase::tickAll(void)
+{
+    for (CanCyclicSchedulerBase* scheduler = First; scheduler != nullptr; scheduler = scheduler->mNext) {
+        scheduler->tick();
+    }
+}
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "os_Task.h"
+#include "Can.h"
+
+namespace app
+{
+struct CanCyclicEntry {
+    /**
+     * Fills the frame for the next transmission. Called from the tick
+     * interrupt, return false to skip this cycle.
+     */
+    using Provider = bool (*)(CanTxMsg&);
+
+    /// Offsets of all entries with this marker are spread evenly over their period
+    static constexpr uint32_t AUTO_OFFSET = 0xffffffff;
+
+    uint32_t period;
+    uint32_t offset;
+    Provider provider;
+
+    static constexpr uint32_t toTicks(const std::chrono::milliseconds ms)
+    {
+        return static_cast<uint32_t>(ms.count() * configTICK_RATE_HZ / 1000);
+    }
+
+    static constexpr CanCyclicEntry every(const std::chrono::milliseconds period, const Provider provider)
+    {
+        return CanCyclicEntry {toTicks(period), AUTO_OFFSET, provider};
+    }
+
+    static constexpr CanCyclicEntry every(const std::chrono::milliseconds period,
+                                          const std::chrono::milliseconds offset,
+                                          const Provider                  provider)
+    {
+        return CanCyclicEntry {toTicks(period), toTicks(offset), provider};
+    }
+};
+
+/**
+ * Constant transmit table of a CanCyclicScheduler. Automatic offsets are
+ * resolved at compile time: entries sharing a period are spread evenly over
+ * it, so their frames don't burst onto the bus in the same tick.
+ */
+template<size_t n>
+class CanCyclicSchedule
+{
+    std::array<CanCyclicEntry, n> mEntries;
+
+    static constexpr std::array<CanCyclicEntry, n> resolveOffsets(const std::array<CanCyclicEntry, n>& entries)
+    {
+        std::array<CanCyclicEntry, n> resolved = entries;
+
+        for (size_t i = 0; i < n; i++) {
+            if (entries[i].period == 0) {
+                continue;
+            }
+            if (entries[i].offset != CanCyclicEntry::AUTO_OFFSET) {
+                resolved[i].offset = entries[i].offset % entries[i].period;
+                continue;
+            }
+            size_t count = 0;
+            size_t position = 0;
+            for (size_t j = 0; j < n; j++) {
+                if ((entries[j].period == entries[i].period) && (entries[j].offset == CanCyclicEntry::AUTO_OFFSET)) {
+                    position += j < i ? 1 : 0;
+                    count++;
+                }
+            }
+            resolved[i].offset = static_cast<uint32_t>(position * entries[i].period / count);
+        }
+        return resolved;
+    }
+
+public:
+    /// Upper bound of the evaluated hyperperiod in maxFramesPerTick()
+    static constexpr uint32_t MAX_HYPERPERIOD = 60000;
+
+    constexpr CanCyclicSchedule(const std::array<CanCyclicEntry, n>& entries) :
+        mEntries(resolveOffsets(entries)) {}
+
+    constexpr const CanCyclicEntry& operator[](const size_t i) const
+    {
+        return mEntries[i];
+    }
+
+    static constexpr size_t size(void)
+    {
+        return n;
+    }
+
+    constexpr bool hasValidPeriods(void) const
+    {
+        for (const auto& entry : mEntries) {
+            if ((entry.period == 0) || (entry.provider == nullptr)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Highest number of frames queued in a single tick. A value above
+     * Can::NUMBER_OF_TX_MAILBOXES means bursts wait in the software queue.
+     */
+    constexpr size_t maxFramesPerTick(void) const
+    {
+        uint32_t hyperperiod = 1;
+        for (const auto& entry : mEntries) {
+            uint32_t a = hyperperiod;
+            uint32_t b = entry.period;
+            while (b != 0) {
+                const uint32_t t = a % b;
+                a = b;
+                b = t;
+            }
+            hyperperiod = hyperperiod / a * entry.period;
+            if (hyperperiod > MAX_HYPERPERIOD) {
+                hyperperiod = MAX_HYPERPERIOD;
+                break;
+            }
+        }
+
+        size_t maxFrames = 0;
+        for (uint32_t tick = 0; tick < hyperperiod; tick++) {
+            size_t frames = 0;
+            for (const auto& entry : mEntries) {
+                frames += (tick % entry.period) == entry.offset ? 1 : 0;
+            }
+            maxFrames = frames > maxFrames ? frames : maxFrames;
+        }
+        return maxFrames;
+    }
+};
+
+template<typename ... Entries>
+constexpr CanCyclicSchedule<sizeof ... (Entries)> makeCanCyclicSchedule(const Entries& ... entries)
+{
+    return CanCyclicSchedule<sizeof ... (Entries)>(std::array<CanCyclicEntry, sizeof ... (Entries)> {{entries ...}});
+}
+
+/**
+ * Sends periodic CAN frames from the system tick interrupt.
+ *
+ * All schedulers are driven by the os tick hook, so periodic frames need no
+ * task stacks and their cycle times don't drift with task execution times.
+ * The jitter is the tick interrupt latency plus the provider runtime.
+ * Schedulers have to be static objects, they register themselves on
+ * construction and are never removed.
+ */
+class CanCyclicSchedulerBase
+{
+    static CanCyclicSchedulerBase* First;
+    CanCyclicSchedulerBase* const mNext;
+
+protected:
+    CanCyclicSchedulerBase(void);
+    ~CanCyclicSchedulerBase(void) = default;
+
+public:
+    struct Statistics {
+        uint32_t sent;
+        uint32_t skipped;
+        uint32_t dropped;
+    };
+
+    CanCyclicSchedulerBase(const CanCyclicSchedulerBase&) = delete;
+    CanCyclicSchedulerBase& operator=(const CanCyclicSchedulerBase&) = delete;
+
+    virtual void tick(void) = 0;
+
+    /// Installed as os tick hook
+    static void tickAll(void);
+};
+
+template<size_t n>
+class CanCyclicScheduler : public CanCyclicSchedulerBase
+{
+    const hal::Can& mInterface;
+    const CanCyclicSchedule<n>& mSchedule;
+    std::array<uint32_t, n> mCountdown;
+    Statistics mStatistics {};
+    CanTxMsg mCanTxMsg;
+
+public:
+    CanCyclicScheduler(const hal::Can& interface, const CanCyclicSchedule<n>& schedule) :
+        mInterface(interface), mSchedule(schedule)
+    {
+        for (size_t i = 0; i < n; i++) {
+            mCountdown[i] = mSchedule[i].offset;
+        }
+    }
+
+    void tick(void) override
+    {
+        for (size_t i = 0; i < n; i++) {
+            if (mCountdown[i] != 0) {
+                mCountdown[i]--;
+                continue;
+            }
+            mCountdown[i] = mSchedule[i].period - 1;
+
+            mCanTxMsg = CanTxMsg {};
+            if (!mSchedule[i].provider(mCanTxMsg)) {
+                mStatistics.skipped++;
+            } else if (mInterface.sendFromISR(mCanTxMsg)) {
+                mStatistics.sent++;
+            } else {
+                mStatistics.dropped++;
+            }
+        }
+    }
+
+    /// Only consistent if read from the tick interrupt or a critical section
+    Statistics getStatistics(void) const
+    {
+        return mStatistics;
+    }
+};
+}
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "unittest.h"
+#include "CanCyclicScheduler.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+//--------------------------BUFFERS--------------------------
+struct SentFrame {
+    uint32_t tick;
+    uint32_t id;
+    uint8_t data;
+};
+
+static void (* g_TickHook)(void) = nullptr;
+static uint32_t g_Tick = 0;
+static std::vector<SentFrame> g_SentFrames;
+static bool g_SendSucceeds = true;
+
+static bool g_ProviderEnabled = true;
+static uint8_t g_ProviderData = 0;
+
+static constexpr const hal::Can& g_can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
+
+//--------------------------MOCKING--------------------------
+
+void os::Task::setTickHook(void (* hook)(void))
+{
+    g_TickHook = hook;
+}
+
+bool hal::Can::sendFromISR(CanTxMsg& msg) const
+{
+    if (!g_SendSucceeds) {
+        return false;
+    }
+    g_SentFrames.push_back(SentFrame {g_Tick, msg.StdId, msg.Data[0]});
+    return true;
+}
+
+static void runTicks(const uint32_t ticks)
+{
+    for (uint32_t i = 0; i < ticks; i++) {
+        g_TickHook();
+        g_Tick++;
+    }
+}
+
+template<uint32_t id>
+static bool provideFrame(CanTxMsg& msg)
+{
+    msg.StdId = id;
+    msg.DLC = 1;
+    msg.Data[0] = g_ProviderData++;
+    return true;
+}
+
+static bool provideOptionalFrame(CanTxMsg& msg)
+{
+    msg.StdId = 0x300;
+    return g_ProviderEnabled;
+}
+
+static bool provideUntouchedFrame(CanTxMsg& msg)
+{
+    // Leftovers of previous frames must not leak into this one
+    return (msg.StdId == 0) && (msg.DLC == 0) && (msg.Data[0] == 0);
+}
+
+static constexpr auto g_SpreadSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideFrame<0x100>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideFrame<0x101>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(900), provideFrame<0x102>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(100), std::chrono::milliseconds(250), provideFrame<0x103>));
+
+static_assert(g_SpreadSchedule.hasValidPeriods(), "Invalid period in test schedule");
+static_assert(g_SpreadSchedule[0].offset == 0, "Automatic offsets have to start at 0");
+static_assert(g_SpreadSchedule[1].offset == 300, "Automatic offsets have to spread over the period");
+static_assert(g_SpreadSchedule[2].offset == 600, "Automatic offsets have to spread over the period");
+static_assert(g_SpreadSchedule[3].offset == 50, "Explicit offsets are taken modulo the period");
+static_assert(g_SpreadSchedule.maxFramesPerTick() == 1, "Spread frames must not share a tick");
+
+static constexpr auto g_BurstSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(10), std::chrono::milliseconds(0), provideFrame<0x100>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(20), std::chrono::milliseconds(0), provideFrame<0x101>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(30), std::chrono::milliseconds(0), provideFrame<0x102>));
+
+static_assert(g_BurstSchedule.maxFramesPerTick() == 3, "All frames are due at tick 0 of the hyperperiod");
+
+static constexpr auto g_InvalidSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(0), provideFrame<0x100>));
+
+static_assert(!g_InvalidSchedule.hasValidPeriods(), "A period of zero must be rejected");
+
+static constexpr auto g_OptionalSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(10), provideOptionalFrame),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(10), provideFrame<0x301>));
+
+static constexpr auto g_UntouchedSchedule = app::makeCanCyclicSchedule(
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1), provideFrame<0x400>),
+    app::CanCyclicEntry::every(std::chrono::milliseconds(1), provideUntouchedFrame));
+
+// Schedulers register themselves before main(), like in the firmware
+static app::CanCyclicScheduler<4> g_SpreadScheduler(g_can, g_SpreadSchedule);
+static app::CanCyclicScheduler<2> g_OptionalScheduler(g_can, g_OptionalSchedule);
+static app::CanCyclicScheduler<2> g_UntouchedScheduler(g_can, g_UntouchedSchedule);
+
+static size_t countFrames(const uint32_t id)
+{
+    size_t count = 0;
+    for (const auto& frame : g_SentFrames) {
+        count += frame.id == id ? 1 : 0;
+    }
+    return count;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_TickHookInstalled(void)
+{
+    TestCaseBegin();
+
+    CHECK(g_TickHook == &app::CanCyclicSchedulerBase::tickAll);
+
+    TestCaseEnd();
+}
+
+int ut_Periods(void)
+{
+    TestCaseBegin();
+
+    g_Tick = 0;
+    g_SentFrames.clear();
+    g_ProviderEnabled = false;
+
+    runTicks(9000);
+
+    std::vector<uint32_t> ticks[4];
+    for (const auto& frame : g_SentFrames) {
+        if ((frame.id >= 0x100) && (frame.id <= 0x103)) {
+            ticks[frame.id - 0x100].push_back(frame.tick);
+        }
+    }
+
+    const uint32_t offsets[] = {0, 300, 600, 50};
+    const uint32_t periods[] = {900, 900, 900, 100};
+    for (size_t i = 0; i < 4; i++) {
+        CHECK(ticks[i].size() == 9000 / periods[i]);
+        for (size_t j = 0; j < ticks[i].size(); j++) {
+            // Every frame is sent in exactly its tick, no drift accumulates
+            CHECK(ticks[i][j] == offsets[i] + j * periods[i]);
+        }
+    }
+
+    TestCaseEnd();
+}
+
+int ut_SkippedAndDropped(void)
+{
+    TestCaseBegin();
+
+    g_Tick = 0;
+    g_SentFrames.clear();
+    g_ProviderEnabled = true;
+
+    const auto before = g_OptionalScheduler.getStatistics();
+    runTicks(100);
+    auto statistics = g_OptionalScheduler.getStatistics();
+    CHECK(statistics.sent - before.sent == 20);
+    CHECK(statistics.skipped == before.skipped);
+    CHECK(countFrames(0x300) == 10);
+
+    g_ProviderEnabled = false;
+    runTicks(100);
+    statistics = g_OptionalScheduler.getStatistics();
+    CHECK(statistics.sent - before.sent == 30);
+    CHECK(statistics.skipped - before.skipped == 10);
+    CHECK(countFrames(0x300) == 10);
+
+    g_SendSucceeds = false;
+    runTicks(100);
+    g_SendSucceeds = true;
+    statistics = g_OptionalScheduler.getStatistics();
+    CHECK(statistics.sent - before.sent == 30);
+    CHECK(statistics.skipped - before.skipped == 20);
+    CHECK(statistics.dropped - before.dropped == 10);
+
+    TestCaseEnd();
+}
+
+int ut_FreshFrames(void)
+{
+    TestCaseBegin();
+
+    g_SentFrames.clear();
+    const auto before = g_UntouchedScheduler.getStatistics();
+    runTicks(10);
+    const auto statistics = g_UntouchedScheduler.getStatistics();
+
+    CHECK(statistics.skipped == before.skipped);
+    CHECK(statistics.sent - before.sent == 20);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_TickHookInstalled);
+    RunTest(true, ut_Periods);
+    RunTest(true, ut_SkippedAndDropped);
+    RunTest(true, ut_FreshFrames);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include "os_Task.h"
+#include "Can.h"
+#include "CanDispatchTable.h"
+#include "CanSignalCodec.h"
+#include "delegate.h"
+
+namespace app
+{
+/**
+ * Rule of a CanGatewayTable. A rule matches on the identifier under a mask
+ * and optionally on payload bytes. Matching frames are dropped or forwarded,
+ * forwarded frames may get bytes rewritten and may be delayed.
+ *
+ * @code
+ * app::CanGatewayRule::standard(0x3c9).whereByte(0, 0x01).rewriteByte(1, 0xff)
+ * app::CanGatewayRule::extended(0x18daf100, 0x1fffff00).delay(std::chrono::milliseconds(10))
+ * @endcode
+ */
+struct CanGatewayRule {
+    enum Action : uint8_t {
+        DROP,
+        FORWARD
+    };
+
+    uint32_t key;
+    uint32_t keyMask;
+    uint64_t dataValue;
+    uint64_t dataMask;
+    uint8_t minDlc;
+    Action action;
+    uint64_t rewriteValue;
+    uint64_t rewriteMask;
+    uint32_t delayTicks;
+
+    static constexpr CanGatewayRule standard(const uint32_t stdId, const uint32_t mask = 0x7ff)
+    {
+        return CanGatewayRule {stdId & mask & 0x7ff, hal::CanDispatchEntry::EXTENDED_ID | (mask & 0x7ff),
+                               0, 0, 0, FORWARD, 0, 0, 0};
+    }
+
+    static constexpr CanGatewayRule extended(const uint32_t extId, const uint32_t mask = 0x1fffffff)
+    {
+        return CanGatewayRule {hal::CanDispatchEntry::EXTENDED_ID | (extId & mask & 0x1fffffff),
+                               hal::CanDispatchEntry::EXTENDED_ID | (mask & 0x1fffffff),
+                               0, 0, 0, FORWARD, 0, 0, 0};
+    }
+
+    /// Matches every frame, useful as last rule
+    static constexpr CanGatewayRule any(void)
+    {
+        return CanGatewayRule {0, 0, 0, 0, 0, FORWARD, 0, 0, 0};
+    }
+
+    /// Additionally requires (Data[index] & mask) == value, frames shorter than index + 1 don't match
+    constexpr CanGatewayRule whereByte(const uint8_t index, const uint8_t value, const uint8_t mask = 0xff) const
+    {
+        CanGatewayRule rule = *this;
+        rule.dataValue |= static_cast<uint64_t>(value & mask) << (8 * index);
+        rule.dataMask |= static_cast<uint64_t>(mask) << (8 * index);
+        rule.minDlc = index + 1 > minDlc ? index + 1 : minDlc;
+        return rule;
+    }
+
+    constexpr CanGatewayRule drop(void) const
+    {
+        CanGatewayRule rule = *this;
+        rule.action = DROP;
+        return rule;
+    }
+
+    constexpr CanGatewayRule forward(void) const
+    {
+        CanGatewayRule rule = *this;
+        rule.action = FORWARD;
+        return rule;
+    }
+
+    /// Replaces the bits of mask in Data[index] of forwarded frames
+    constexpr CanGatewayRule rewriteByte(const uint8_t index, const uint8_t value, const uint8_t mask = 0xff) const
+    {
+        CanGatewayRule rule = *this;
+        rule.rewriteValue |= static_cast<uint64_t>(value & mask) << (8 * index);
+        rule.rewriteMask |= static_cast<uint64_t>(mask) << (8 * index);
+        return rule;
+    }
+
+    /// Forwards matching frames after the delay, rounded to os ticks
+    constexpr CanGatewayRule delay(const std::chrono::milliseconds delay) const
+    {
+        CanGatewayRule rule = *this;
+        rule.delayTicks = static_cast<uint32_t>(delay.count() * configTICK_RATE_HZ / 1000);
+        return rule;
+    }
+
+    constexpr bool matches(const uint32_t frameKey, const uint64_t data, const uint8_t dlc) const
+    {
+        return (((frameKey ^ key) & keyMask) | ((data ^ dataValue) & dataMask)) == 0 && dlc >= minDlc;
+    }
+};
+
+/**
+ * Constant rule table of a CanGateway. The first matching rule decides,
+ * frames without a matching rule get the default action.
+ *
+ * Matching is a linear scan of branch free mask compares over a constant
+ * array, so the worst case in the receive path is size() compares,
+ * independent of the traffic.
+ */
+template<size_t n>
+class CanGatewayTable
+{
+    std::array<CanGatewayRule, n> mRules;
+    CanGatewayRule::Action mDefaultAction;
+
+public:
+    constexpr CanGatewayTable(const std::array<CanGatewayRule, n>& rules,
+                              const CanGatewayRule::Action        defaultAction) :
+        mRules(rules), mDefaultAction(defaultAction) {}
+
+    /// @return index of the first matching rule, size() if none matches
+    constexpr size_t find(const uint32_t key, const uint64_t data, const uint8_t dlc) const
+    {
+        for (size_t i = 0; i < n; i++) {
+            if (mRules[i].matches(key, data, dlc)) {
+                return i;
+            }
+        }
+        return n;
+    }
+
+    constexpr const CanGatewayRule& operator[](const size_t i) const
+    {
+        return mRules[i];
+    }
+
+    constexpr CanGatewayRule::Action getDefaultAction(void) const
+    {
+        return mDefaultAction;
+    }
+
+    /// Detects rules that can never match, because an earlier rule catches all their frames
+    constexpr bool hasReachableRules(void) const
+    {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < i; j++) {
+                const CanGatewayRule& earlier = mRules[j];
+                const CanGatewayRule& later = mRules[i];
+                const bool keyCovered = ((earlier.keyMask & ~later.keyMask) == 0) &&
+                                        (((earlier.key ^ later.key) & earlier.keyMask) == 0);
+                const bool dataCovered = ((earlier.dataMask & ~later.dataMask) == 0) &&
+                                         (((earlier.dataValue ^ later.dataValue) & earlier.dataMask) == 0) &&
+                                         (earlier.minDlc <= later.minDlc);
+                if (keyCovered && dataCovered) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static constexpr size_t size(void)
+    {
+        return n;
+    }
+};
+
+template<typename ... Rules>
+constexpr CanGatewayTable<sizeof ... (Rules)> makeCanGatewayTable(const CanGatewayRule::Action defaultAction,
+                                                                  const Rules& ... rules)
+{
+    return CanGatewayTable<sizeof ... (Rules)>(std::array<CanGatewayRule, sizeof ... (Rules)> {{rules ...}},
+                                               defaultAction);
+}
+
+/**
+ * Applies a CanGatewayTable to frames flowing in one direction. Use one
+ * gateway per direction.
+ *
+ * process() runs in the receive path, usually the receive interrupt of the
+ * input interface, and hands forwarded frames directly to the output, so the
+ * forwarding latency is the rule scan plus the transmission on the output.
+ * Delayed frames are parked in DELAY_SLOTS slots and sent by service(),
+ * which is meant to be called every tick. Each slot is owned by exactly one
+ * side at a time, so process() and service() need no locks.
+ */
+template<size_t n, size_t DELAY_SLOTS = 8>
+class CanGateway
+{
+public:
+    /**
+     * Sends a frame on the output interface or tunnel, called from process()
+     * and service(). A Delegate, so the receive interrupt never allocates.
+     */
+    using Output = utility::Delegate<bool (CanTxMsg&)>;
+
+    struct Statistics {
+        uint32_t forwarded;
+        uint32_t dropped;
+        uint32_t delayed;
+        uint32_t lost;
+    };
+
+private:
+    enum SlotState : uint8_t {
+        FREE,
+        PENDING
+    };
+
+    struct DelaySlot {
+        CanTxMsg msg;
+        uint32_t due;
+        std::atomic<uint8_t> state {FREE};
+    };
+
+    const CanGatewayTable<n>& mTable;
+    const Output mOutput;
+    std::array<std::atomic<uint32_t>, n + 1> mHits {};
+    std::array<DelaySlot, DELAY_SLOTS> mDelaySlots;
+    std::atomic<uint32_t> mForwarded {0};
+    std::atomic<uint32_t> mDropped {0};
+    std::atomic<uint32_t> mDelayed {0};
+    std::atomic<uint32_t> mLost {0};
+
+    void send(CanTxMsg& msg)
+    {
+        if (mOutput(msg)) {
+            mForwarded.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            mLost.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    CanGateway(const CanGatewayTable<n>& table, Output output) :
+        mTable(table), mOutput(output) {}
+
+    CanGateway(const CanGateway&) = delete;
+    CanGateway(CanGateway&&) = delete;
+    CanGateway& operator=(const CanGateway&) = delete;
+    CanGateway& operator=(CanGateway&&) = delete;
+
+    /**
+     * Applies the first matching rule to a received frame.
+     * @param tick os tick at reception, the time base of delays
+     */
+    void process(const CanRxMsg& rx, const uint32_t tick)
+    {
+        const uint64_t data = CanPayload::load(rx.Data, CanByteOrder::Intel);
+        const uint8_t dlc = rx.RTR == CAN_RTR_Remote ? 0 : rx.DLC;
+        const size_t index = mTable.find(hal::CanDispatchEntry::keyOf(rx), data, dlc);
+        mHits[index].fetch_add(1, std::memory_order_relaxed);
+
+        const bool matched = index < n;
+        const CanGatewayRule::Action action = matched ? mTable[index].action : mTable.getDefaultAction();
+        if (action == CanGatewayRule::DROP) {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        CanTxMsg msg;
+        msg.StdId = rx.StdId;
+        msg.ExtId = rx.ExtId;
+        msg.IDE = rx.IDE;
+        msg.RTR = rx.RTR;
+        msg.DLC = rx.DLC;
+        std::memcpy(msg.Data, rx.Data, sizeof(msg.Data));
+
+        if (!matched) {
+            send(msg);
+            return;
+        }
+
+        const CanGatewayRule& rule = mTable[index];
+        if (rule.rewriteMask != 0) {
+            CanPayload::clear(msg.Data);
+            CanPayload::store(msg.Data, (data & ~rule.rewriteMask) | rule.rewriteValue, CanByteOrder::Intel);
+        }
+
+        if (rule.delayTicks == 0) {
+            send(msg);
+            return;
+        }
+
+        for (auto& slot : mDelaySlots) {
+            if (slot.state.load(std::memory_order_acquire) == FREE) {
+                slot.msg = msg;
+                slot.due = tick + rule.delayTicks;
+                slot.state.store(PENDING, std::memory_order_release);
+                mDelayed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        mLost.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Sends all delayed frames that are due at tick
+    void service(const uint32_t tick)
+    {
+        for (auto& slot : mDelaySlots) {
+            if ((slot.state.load(std::memory_order_acquire) == PENDING) &&
+                (static_cast<int32_t>(tick - slot.due) >= 0))
+            {
+                send(slot.msg);
+                slot.state.store(FREE, std::memory_order_release);
+            }
+        }
+    }
+
+    /// @param rule index into the table, size() counts frames without a matching rule
+    uint32_t getHits(const size_t rule) const
+    {
+        return rule <= n ? mHits[rule].load(std::memory_order_relaxed) : 0;
+    }
+
+    Statistics getStatistics(void) const
+    {
+        return Statistics {mForwarded.load(std::memory_order_relaxed),
+                           mDropped.load(std::memory_order_relaxed),
+                           mDelayed.load(std::memory_order_relaxed),
+                           mLost.load(std::memory_order_relaxed)};
+    }
+};
+}
@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "unittest.h"
+#include "os_Task.h"
+#include "VirtualCanBus.h"
+#include "CanGateway.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+#define NUM_TEST_LOOPS 200
+#define NUM_BENCHMARK_LOOPS 1000000
+
+using app::CanGatewayRule;
+
+//--------------------------BUFFERS--------------------------
+bool executeMockupTasks = true;
+
+static constexpr const hal::Can& g_can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
+
+static constexpr auto g_Rules = app::makeCanGatewayTable(
+    CanGatewayRule::FORWARD,
+    CanGatewayRule::standard(0x100).drop(),
+    CanGatewayRule::standard(0x200).whereByte(0, 0x01).rewriteByte(1, 0xff),
+    CanGatewayRule::standard(0x200).whereByte(0, 0x80, 0x80).drop(),
+    CanGatewayRule::standard(0x300, 0x700).delay(std::chrono::milliseconds(20)),
+    CanGatewayRule::extended(0x18daf100, 0x1fffff00).rewriteByte(0, 0x0f, 0x0f));
+
+static_assert(g_Rules.hasReachableRules(), "Rule hidden by an earlier rule");
+
+//--------------------------MOCKING--------------------------
+
+uint32_t os::Task::getTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                                 std::chrono::steady_clock::now().time_since_epoch())
+           .count();
+}
+
+static CanRxMsg makeRx(const uint32_t id, const bool extended, const uint8_t dlc, const uint8_t first = 0)
+{
+    CanRxMsg msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.IDE = extended ? CAN_Id_Extended : CAN_Id_Standard;
+    msg.RTR = CAN_RTR_Data;
+    msg.StdId = extended ? 0 : id;
+    msg.ExtId = extended ? id : 0;
+    msg.DLC = dlc;
+    for (size_t i = 0; i < dlc; i++) {
+        msg.Data[i] = static_cast<uint8_t>(first + i);
+    }
+    return msg;
+}
+
+static CanTxMsg toTx(const CanRxMsg& rx)
+{
+    CanTxMsg tx;
+    std::memset(&tx, 0, sizeof(tx));
+    tx.StdId = rx.StdId;
+    tx.ExtId = rx.ExtId;
+    tx.IDE = rx.IDE;
+    tx.RTR = rx.RTR;
+    tx.DLC = rx.DLC;
+    std::memcpy(tx.Data, rx.Data, sizeof(tx.Data));
+    return tx;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_RuleMatching(void)
+{
+    TestCaseBegin();
+
+    static_assert(g_Rules.find(0x100, 0, 0) == 0, "Standard identifier");
+    static_assert(g_Rules.find(hal::CanDispatchEntry::EXTENDED_ID | 0x100, 0, 0) == g_Rules.size(),
+                  "Extended frames don't match standard rules");
+    static_assert(g_Rules.find(0x200, 0x01, 1) == 1, "Data byte");
+    static_assert(g_Rules.find(0x200, 0x01, 0) == g_Rules.size(), "Data byte beyond DLC");
+    static_assert(g_Rules.find(0x200, 0x81, 1) == 2, "Masked data byte");
+    static_assert(g_Rules.find(0x3ff, 0, 0) == 3, "Identifier mask");
+    static_assert(g_Rules.find(0x400, 0, 0) == g_Rules.size(), "Identifier mask");
+    static_assert(g_Rules.find(hal::CanDispatchEntry::EXTENDED_ID | 0x18daf1aa, 0, 8) == 4, "Extended mask");
+
+    // Earlier rules catching every frame of later ones are detected
+    static_assert(!app::makeCanGatewayTable(CanGatewayRule::FORWARD,
+                                            CanGatewayRule::standard(0x200, 0x700).drop(),
+                                            CanGatewayRule::standard(0x234)).hasReachableRules(),
+                  "Hidden rule");
+    static_assert(!app::makeCanGatewayTable(CanGatewayRule::FORWARD,
+                                            CanGatewayRule::standard(0x234),
+                                            CanGatewayRule::standard(0x234).whereByte(2, 0x10)).hasReachableRules(),
+                  "Hidden rule");
+    static_assert(app::makeCanGatewayTable(CanGatewayRule::FORWARD,
+                                           CanGatewayRule::standard(0x234).whereByte(2, 0x10),
+                                           CanGatewayRule::standard(0x234)).hasReachableRules(),
+                  "More specific rule first");
+
+    CHECK(g_Rules[1].rewriteMask == 0xff00);
+    CHECK(g_Rules[3].delayTicks == 20);
+    CHECK(g_Rules.getDefaultAction() == CanGatewayRule::FORWARD);
+
+    TestCaseEnd();
+}
+
+int ut_Actions(void)
+{
+    TestCaseBegin();
+
+    std::vector<CanTxMsg> sent;
+    bool outputReady = true;
+    app::CanGateway<g_Rules.size(), 2> gateway(g_Rules, [&](CanTxMsg& msg) {
+        if (outputReady) {
+            sent.push_back(msg);
+        }
+        return outputReady;
+    });
+
+    // Drop
+    gateway.process(makeRx(0x100, false, 8), 0);
+    CHECK(sent.empty());
+
+    // Rewrite only matching frames
+    gateway.process(makeRx(0x200, false, 4, 0x01), 0);
+    gateway.process(makeRx(0x200, false, 4, 0x02), 0);
+    CHECK(sent.size() == 2);
+    CHECK(sent.size() == 2 && sent[0].Data[0] == 0x01 && sent[0].Data[1] == 0xff && sent[0].Data[2] == 0x03);
+    CHECK(sent.size() == 2 && sent[1].Data[0] == 0x02 && sent[1].Data[1] == 0x03);
+
+    // Masked rewrite keeps the other bits
+    gateway.process(makeRx(0x18daf133, true, 2, 0xa0), 0);
+    CHECK(sent.size() == 3 && sent[2].Data[0] == 0xaf && sent[2].Data[1] == 0xa1 && sent[2].ExtId == 0x18daf133);
+
+    // Delay, the third delayed frame finds no free slot
+    gateway.process(makeRx(0x301, false, 1), 100);
+    gateway.process(makeRx(0x302, false, 1), 105);
+    gateway.process(makeRx(0x303, false, 1), 106);
+    CHECK(sent.size() == 3);
+    gateway.service(119);
+    CHECK(sent.size() == 3);
+    gateway.service(120);
+    CHECK(sent.size() == 4 && sent[3].StdId == 0x301);
+    gateway.service(130);
+    CHECK(sent.size() == 5 && sent[4].StdId == 0x302);
+
+    // Output busy
+    outputReady = false;
+    gateway.process(makeRx(0x555, false, 0), 130);
+    outputReady = true;
+
+    CHECK(gateway.getHits(0) == 1);
+    CHECK(gateway.getHits(1) == 1);
+    CHECK(gateway.getHits(2) == 0);
+    CHECK(gateway.getHits(3) == 3);
+    CHECK(gateway.getHits(4) == 1);
+    CHECK(gateway.getHits(g_Rules.size()) == 2);
+
+    const auto statistics = gateway.getStatistics();
+    CHECK(statistics.forwarded == 5);
+    CHECK(statistics.dropped == 1);
+    CHECK(statistics.delayed == 2);
+    CHECK(statistics.lost == 2);
+
+    TestCaseEnd();
+}
+
+int ut_GatewayBetweenBuses(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus busA(500000);
+    hal::VirtualCanBus busB(500000);
+    auto& ecu = busA.addNode("ECU");
+    auto& gatewayA = busA.addNode("GatewayA");
+    auto& gatewayB = busB.addNode("GatewayB");
+    auto& tester = busB.addNode("Tester");
+
+    using Clock = std::chrono::steady_clock;
+    std::array<Clock::time_point, NUM_TEST_LOOPS> received {};
+    std::array<Clock::time_point, NUM_TEST_LOOPS> forwarded {};
+    std::array<CanRxMsg, NUM_TEST_LOOPS> frames {};
+    size_t count = 0;
+
+    // Every fourth frame is delayed by 20 ms, about 20 frames are parked at once.
+    // Forwarded frames enter bus B through the gateway node, from whatever thread forwards them.
+    app::CanGateway<g_Rules.size(), 32> gateway(g_Rules, [&gatewayB](CanTxMsg& msg) {
+        gatewayB.attach();
+        return g_can.sendFromISR(msg);
+    });
+
+    gatewayA.attach();
+    g_can.enableNonBlockingReceive([&](CanRxMsg msg) {
+        received[msg.Data[7]] = Clock::now();
+        gateway.process(msg, os::Task::getTickCount());
+    });
+
+    tester.attach();
+    g_can.enableNonBlockingReceive([&](CanRxMsg msg) {
+        forwarded[msg.Data[7]] = Clock::now();
+        frames[count++] = msg;
+    });
+
+    busA.start();
+    busB.start();
+
+    std::atomic<bool> done {false};
+    {
+        os::Task delayService("GatewayService", 1024, os::Task::Priority::HIGH, [&](const bool&) {
+            while (!done) {
+                gateway.service(os::Task::getTickCount());
+                os::ThisTask::sleep(std::chrono::milliseconds(1));
+            }
+        });
+
+        ecu.attach();
+        static const uint32_t ids[] = {0x100, 0x200, 0x210, 0x301};
+        for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+            CanTxMsg msg = toTx(makeRx(ids[i % 4], false, 8, static_cast<uint8_t>(i % 3)));
+            msg.Data[7] = static_cast<uint8_t>(i);
+            while (!g_can.send(msg)) {
+                std::this_thread::yield();
+            }
+        }
+        CHECK(busA.waitIdle(std::chrono::milliseconds(1000)));
+        os::ThisTask::sleep(std::chrono::milliseconds(50));
+        CHECK(busB.waitIdle(std::chrono::milliseconds(1000)));
+        done = true;
+    }
+
+    // 0x100 is dropped, everything else passes, 0x200 frames starting with 0x01 are rewritten
+    CHECK(count == NUM_TEST_LOOPS / 4 * 3);
+    size_t rewritten = 0;
+    for (size_t i = 0; i < count; i++) {
+        CHECK(frames[i].StdId != 0x100);
+        if ((frames[i].StdId == 0x200) && (frames[i].Data[0] == 0x01)) {
+            CHECK(frames[i].Data[1] == 0xff);
+            rewritten++;
+        }
+    }
+    CHECK(rewritten == gateway.getHits(1));
+    CHECK(gateway.getHits(3) == NUM_TEST_LOOPS / 4);
+    CHECK(gateway.getStatistics().lost == 0);
+
+    // Latency from the end of a frame on bus A to the start of the forwarded frame on bus B
+    Clock::duration worstCase {0};
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        if ((forwarded[i] == Clock::time_point {}) || (i % 4 == 3)) {
+            continue;
+        }
+        const auto latency = forwarded[i] - received[i] - busB.frameTime(toTx(makeRx(0x200, false, 8)));
+        worstCase = latency > worstCase ? latency : worstCase;
+    }
+    printf("Worst case forwarding latency %lld us\n",
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(worstCase).count()));
+
+    // Frames arrive slower on A than they leave on B, so nothing queues up in the gateway
+    CHECK(worstCase < std::chrono::milliseconds(5));
+
+    TestCaseEnd();
+}
+
+int ut_WorstCaseProcessing(void)
+{
+    TestCaseBegin();
+
+    // Frames matching only the last rule or none scan the whole table
+    static constexpr auto table = app::makeCanGatewayTable(
+        CanGatewayRule::DROP,
+        CanGatewayRule::standard(0x010), CanGatewayRule::standard(0x011), CanGatewayRule::standard(0x012),
+        CanGatewayRule::standard(0x013), CanGatewayRule::standard(0x014), CanGatewayRule::standard(0x015),
+        CanGatewayRule::standard(0x016), CanGatewayRule::standard(0x017), CanGatewayRule::standard(0x018),
+        CanGatewayRule::standard(0x019), CanGatewayRule::standard(0x01a), CanGatewayRule::standard(0x01b),
+        CanGatewayRule::standard(0x01c), CanGatewayRule::standard(0x01d), CanGatewayRule::standard(0x01e),
+        CanGatewayRule::standard(0x020, 0x7f0).whereByte(0, 0x55).rewriteByte(7, 0xaa));
+
+    size_t sent = 0;
+    app::CanGateway<table.size()> gateway(table, [&sent](CanTxMsg&) {
+        sent++;
+        return true;
+    });
+
+    const CanRxMsg last = makeRx(0x02f, false, 8, 0x55);
+    const CanRxMsg none = makeRx(0x7ff, false, 8);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        gateway.process(i % 2 ? last : none, 0);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(sent == NUM_BENCHMARK_LOOPS / 2);
+    CHECK(gateway.getHits(table.size() - 1) == NUM_BENCHMARK_LOOPS / 2);
+    CHECK(gateway.getHits(table.size()) == NUM_BENCHMARK_LOOPS / 2);
+
+    printf("Processing with %zu rules: %lld ns per frame\n", table.size(),
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                                  NUM_BENCHMARK_LOOPS));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_RuleMatching);
+    RunTest(true, ut_Actions);
+    RunTest(true, ut_GatewayBetweenBuses);
+    RunTest(true, ut_WorstCaseProcessing);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include "CanLogBuffer.h"
+
+using app::CanLogBuffer;
+
+CanLogBuffer::CanLogBuffer(const uint32_t bitrate) :
+    mBitrate(static_cast<uint16_t>(bitrate / 1000))
+{
+    mBlocks[0].fill = 0;
+    mBlocks[0].state = FILLING;
+    mBlocks[1].fill = 0;
+    mBlocks[1].state = FREE;
+}
+
+bool CanLogBuffer::startBlock(const size_t index)
+{
+    Block& block = mBlocks[index];
+
+    if (block.state.load(std::memory_order_acquire) != FREE) {
+        return false;
+    }
+    block.fill.store(0, std::memory_order_relaxed);
+    block.state.store(FILLING, std::memory_order_relaxed);
+    mFilling = index;
+    return true;
+}
+
+bool CanLogBuffer::log(const hal::Can::RxFrame& frame, const uint32_t tick)
+{
+    bool blockReady = false;
+    Block* block = &mBlocks[mFilling];
+
+    // The consumer may have flushed the filling block meanwhile
+    const bool filling = block->state.load(std::memory_order_acquire) == FILLING;
+
+    if (!filling || (block->fill.load(std::memory_order_relaxed) + CanLog::MAX_RECORD_SIZE > BLOCK_SIZE)) {
+        if (filling) {
+            block->state.store(READY, std::memory_order_release);
+            mCompletedBlocks.fetch_add(1, std::memory_order_relaxed);
+            blockReady = true;
+        }
+        if (!startBlock(mFilling ^ 1)) {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            mDroppedSinceBlock += mDroppedSinceBlock < 0xffff ? 1 : 0;
+            return blockReady;
+        }
+        block = &mBlocks[mFilling];
+    }
+
+    size_t fill = block->fill.load(std::memory_order_relaxed);
+    if (fill == 0) {
+        CanLog::writeBlockHeader(block->data.data(),
+                                 CanLog::BlockHeader {mSequence++, 0, mDroppedSinceBlock, mBitrate});
+        fill = CanLog::BLOCK_HEADER_SIZE;
+        mDroppedSinceBlock = 0;
+        mEncoder.reset();
+    }
+
+    fill += mEncoder.encode(block->data.data() + fill, frame, tick);
+    block->fill.store(fill, std::memory_order_release);
+    mLogged.fetch_add(1, std::memory_order_relaxed);
+    return blockReady;
+}
+
+const uint8_t* CanLogBuffer::acquire(size_t& length, const bool flush)
+{
+    Block& block = mBlocks[mSending];
+    uint8_t state = block.state.load(std::memory_order_acquire);
+
+    // Only a block with records is worth flushing. The producer never touches
+    // a block again once it isn't FILLING anymore.
+    if (flush && (state == FILLING) && (block.fill.load(std::memory_order_relaxed) > 0) &&
+        block.state.compare_exchange_strong(state, READY, std::memory_order_acq_rel))
+    {
+        mCompletedBlocks.fetch_add(1, std::memory_order_relaxed);
+        state = READY;
+    }
+
+    if (state != READY) {
+        return nullptr;
+    }
+
+    length = block.fill.load(std::memory_order_acquire);
+    CanLog::put(block.data.data() + 4, static_cast<uint16_t>(length - CanLog::BLOCK_HEADER_SIZE), 2);
+    return block.data.data();
+}
+
+void CanLogBuffer::release(void)
+{
+    Block& block = mBlocks[mSending];
+
+    if (block.state.load(std::memory_order_acquire) == READY) {
+        block.state.store(FREE, std::memory_order_release);
+        mSending ^= 1;
+    }
+}
+
+CanLogBuffer::Statistics CanLogBuffer::getStatistics(void) const
+{
+    return Statistics {mLogged.load(std::memory_order_relaxed),
+                       mDropped.load(std::memory_order_relaxed),
+                       mCompletedBlocks.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "CanLogFormat.h"
+
+namespace app
+{
+/**
+ * Double buffer of CanLog blocks.
+ *
+ * The receive interrupt encodes frames into the filling block while a task
+ * transmits the other one. If both blocks are occupied, frames are dropped
+ * and the count is reported in the header of the next block. Blocks are
+ * handed over strictly alternating, neither side disables interrupts.
+ */
+class CanLogBuffer
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 1024;
+
+    struct Statistics {
+        uint32_t logged;
+        uint32_t dropped;
+        uint32_t blocks;
+    };
+
+    explicit CanLogBuffer(const uint32_t bitrate);
+
+    CanLogBuffer(const CanLogBuffer&) = delete;
+    CanLogBuffer(CanLogBuffer&&) = delete;
+    CanLogBuffer& operator=(const CanLogBuffer&) = delete;
+    CanLogBuffer& operator=(CanLogBuffer&&) = delete;
+
+    /**
+     * Producer side, called from the receive interrupt.
+     * @return true if a block became ready for transmission
+     */
+    bool log(const hal::Can::RxFrame& frame, const uint32_t tick);
+
+    /**
+     * Consumer side. Returns the next complete block, or with flush the
+     * partially filled one. The block stays valid until release().
+     * @return nullptr if no block is ready
+     */
+    const uint8_t* acquire(size_t& length, const bool flush);
+    void release(void);
+
+    Statistics getStatistics(void) const;
+
+private:
+    enum State : uint8_t {
+        FREE,
+        FILLING,
+        READY
+    };
+
+    struct Block {
+        std::array<uint8_t, BLOCK_SIZE> data;
+        std::atomic<size_t> fill;
+        std::atomic<uint8_t> state;
+    };
+
+    const uint16_t mBitrate;
+    std::array<Block, 2> mBlocks;
+    size_t mFilling = 0;
+    size_t mSending = 0;
+    uint16_t mSequence = 0;
+    uint16_t mDroppedSinceBlock = 0;
+    CanLog::Encoder mEncoder;
+    std::atomic<uint32_t> mLogged {0};
+    std::atomic<uint32_t> mDropped {0};
+    std::atomic<uint32_t> mCompletedBlocks {0};
+
+    bool startBlock(const size_t index);
+};
+}
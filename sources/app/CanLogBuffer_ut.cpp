@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "unittest.h"
+#include "CanLogBuffer.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+using app::CanLogBuffer;
+namespace CanLog = app::CanLog;
+
+//--------------------------BUFFERS--------------------------
+
+static constexpr uint32_t BITRATE = 500000;
+
+/// Bit times of a standard data frame with 8 bytes and worst case stuffing
+static constexpr uint16_t FULL_FRAME_BITS = 135;
+
+//--------------------------MOCKING--------------------------
+
+static hal::Can::RxFrame makeFrame(const uint16_t timestamp, const uint32_t id, const bool extended,
+                                   const bool remote, const uint8_t dlc)
+{
+    hal::Can::RxFrame frame;
+    std::memset(&frame, 0, sizeof(frame));
+    frame.timestamp = timestamp;
+    frame.msg.IDE = extended ? CAN_Id_Extended : CAN_Id_Standard;
+    frame.msg.RTR = remote ? CAN_RTR_Remote : CAN_RTR_Data;
+    frame.msg.StdId = extended ? 0 : id;
+    frame.msg.ExtId = extended ? id : 0;
+    frame.msg.DLC = dlc;
+    for (uint8_t i = 0; i < dlc; i++) {
+        frame.msg.Data[i] = static_cast<uint8_t>(id + i);
+    }
+    return frame;
+}
+
+/// Decodes all records of a block, decoder keeps the time base of previous blocks
+static std::vector<CanLog::Frame> decodeBlock(const uint8_t* block, const size_t length,
+                                              CanLog::BlockHeader& header, CanLog::Decoder& decoder)
+{
+    std::vector<CanLog::Frame> frames;
+    if (!CanLog::readBlockHeader(block, length, header) ||
+        (header.length + CanLog::BLOCK_HEADER_SIZE != length))
+    {
+        return frames;
+    }
+
+    decoder.reset(header);
+    size_t position = CanLog::BLOCK_HEADER_SIZE;
+    while (position < length) {
+        CanLog::Frame frame;
+        const size_t consumed = decoder.decode(block + position, length - position, frame);
+        if (consumed == 0) {
+            break;
+        }
+        frames.push_back(frame);
+        position += consumed;
+    }
+    return frames;
+}
+
+static std::vector<CanLog::Frame> decodeBlock(const uint8_t* block, const size_t length,
+                                              CanLog::BlockHeader& header)
+{
+    CanLog::Decoder decoder;
+    return decodeBlock(block, length, header, decoder);
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_RecordRoundtrip(void)
+{
+    TestCaseBegin();
+
+    uint8_t block[512];
+    CanLog::Encoder encoder;
+    size_t length = CanLog::BLOCK_HEADER_SIZE;
+
+    const hal::Can::RxFrame frames[] = {
+        makeFrame(0xfff0, 0x123, false, false, 8),
+        makeFrame(0x0010, 0x7ff, false, false, 0),
+        makeFrame(0x2010, 0x1abcdef0, true, false, 5),
+        makeFrame(0x2020, 0x456, false, true, 4),
+        makeFrame(0x4e10, 0x00000001, true, true, 0),
+    };
+    const uint32_t ticks[] = {1000, 1000, 1016, 1016, 1040};
+
+    for (size_t i = 0; i < 5; i++) {
+        length += encoder.encode(block + length, frames[i], ticks[i]);
+    }
+    CanLog::writeBlockHeader(block,
+                             CanLog::BlockHeader {7, static_cast<uint16_t>(length - CanLog::BLOCK_HEADER_SIZE), 3,
+                                                  BITRATE / 1000});
+
+    // SYNC, DELTA8, DELTA16, DELTA8 and SYNC after SYNC_INTERVAL_MS
+    CHECK(block[CanLog::BLOCK_HEADER_SIZE] >> 6 == 2);
+    CHECK(length == CanLog::BLOCK_HEADER_SIZE + (1 + 6 + 2 + 8) + (1 + 1 + 2) + (1 + 2 + 4 + 5) +
+          (1 + 1 + 2) + (1 + 6 + 4));
+
+    CanLog::BlockHeader header;
+    const auto decoded = decodeBlock(block, length, header);
+    CHECK(header.sequence == 7);
+    CHECK(header.dropped == 3);
+    CHECK(header.bitrate == 500);
+    CHECK(decoded.size() == 5);
+    if (decoded.size() != 5) {
+        TestCaseEnd();
+    }
+
+    for (size_t i = 0; i < 5; i++) {
+        const CanRxMsg& msg = frames[i].msg;
+        CHECK(decoded[i].extended == (msg.IDE == CAN_Id_Extended));
+        CHECK(decoded[i].remote == (msg.RTR == CAN_RTR_Remote));
+        CHECK(decoded[i].id == (decoded[i].extended ? msg.ExtId : msg.StdId));
+        CHECK(decoded[i].dlc == msg.DLC);
+        CHECK(decoded[i].remote || (std::memcmp(decoded[i].data, msg.Data, msg.DLC) == 0));
+    }
+
+    // Deltas are bit times at 500 kbit/s, 2 µs each
+    CHECK(decoded[0].timeUs == 1000000);
+    CHECK(decoded[1].timeUs == 1000000 + 0x20 * 2);
+    CHECK(decoded[2].timeUs == 1000000 + 0x2020 * 2);
+    CHECK(decoded[3].timeUs == 1000000 + 0x2030 * 2);
+    // The SYNC after 40 ms continues the bit timer instead of the coarse os tick
+    CHECK(decoded[4].timeUs == 1040000);
+
+    // Truncated records are rejected
+    CanLog::Decoder decoder;
+    decoder.reset(header);
+    CanLog::Frame frame;
+    CHECK(decoder.decode(block + CanLog::BLOCK_HEADER_SIZE, 10, frame) == 0);
+
+    TestCaseEnd();
+}
+
+int ut_BlockHandover(void)
+{
+    TestCaseBegin();
+
+    CanLogBuffer buffer(BITRATE);
+    size_t length;
+
+    CHECK(buffer.acquire(length, false) == nullptr);
+    CHECK(buffer.acquire(length, true) == nullptr);
+
+    CHECK(!buffer.log(makeFrame(100, 0x100, false, false, 8), 10));
+    CHECK(!buffer.log(makeFrame(200, 0x101, false, false, 8), 10));
+
+    // Without flush only complete blocks are handed over
+    CHECK(buffer.acquire(length, false) == nullptr);
+
+    const uint8_t* block = buffer.acquire(length, true);
+    CHECK(block != nullptr);
+    CanLog::BlockHeader header;
+    auto frames = decodeBlock(block, length, header);
+    CHECK(frames.size() == 2);
+    CHECK(header.sequence == 0);
+
+    // The producer continues in the other block meanwhile
+    CHECK(!buffer.log(makeFrame(300, 0x102, false, false, 8), 11));
+    buffer.release();
+
+    block = buffer.acquire(length, true);
+    CHECK(block != nullptr);
+    frames = decodeBlock(block, length, header);
+    CHECK(frames.size() == 1);
+    CHECK(header.sequence == 1);
+    CHECK(frames.size() == 1 && frames[0].id == 0x102);
+    buffer.release();
+
+    // Filling a whole block reports it ready
+    size_t logged = 0;
+    bool ready = false;
+    while (!ready) {
+        ready = buffer.log(makeFrame(static_cast<uint16_t>(logged * FULL_FRAME_BITS), 0x200, false, false, 8), 12);
+        logged++;
+    }
+    block = buffer.acquire(length, false);
+    CHECK(block != nullptr);
+    CHECK(length <= CanLogBuffer::BLOCK_SIZE);
+    CHECK(length + CanLog::MAX_RECORD_SIZE > CanLogBuffer::BLOCK_SIZE);
+    frames = decodeBlock(block, length, header);
+    CHECK(frames.size() == logged - 1);
+    CHECK(header.sequence == 2);
+    buffer.release();
+
+    const auto statistics = buffer.getStatistics();
+    CHECK(statistics.logged == logged + 3);
+    CHECK(statistics.dropped == 0);
+    CHECK(statistics.blocks == 3);
+
+    TestCaseEnd();
+}
+
+int ut_DropAccounting(void)
+{
+    TestCaseBegin();
+
+    CanLogBuffer buffer(BITRATE);
+    size_t length;
+    uint32_t logged = 0;
+
+    // Nobody drains, both blocks fill up and further frames are dropped
+    while (buffer.getStatistics().dropped < 10) {
+        buffer.log(makeFrame(static_cast<uint16_t>(logged * FULL_FRAME_BITS), 0x300, false, false, 8), 20);
+        logged++;
+    }
+    CHECK(buffer.getStatistics().blocks == 2);
+    CHECK(buffer.getStatistics().logged + 10 == logged);
+
+    CanLog::BlockHeader header;
+    const uint8_t* block = buffer.acquire(length, false);
+    CHECK(block != nullptr);
+    CHECK(decodeBlock(block, length, header).size() > 0);
+    CHECK(header.dropped == 0);
+    buffer.release();
+
+    // The next block reports the loss
+    buffer.log(makeFrame(0, 0x301, false, false, 1), 21);
+    buffer.acquire(length, false);
+    buffer.release();
+    block = buffer.acquire(length, true);
+    CHECK(block != nullptr);
+    const auto frames = decodeBlock(block, length, header);
+    CHECK(header.dropped == 10);
+    CHECK(header.sequence == 2);
+    CHECK(frames.size() == 1 && frames[0].id == 0x301);
+    buffer.release();
+
+    TestCaseEnd();
+}
+
+int ut_FullBusLoad(void)
+{
+    TestCaseBegin();
+
+    // One second of a fully loaded 500 kbit/s bus with mixed frames. The consumer
+    // drains one block per period of a 1 Mbaud UART, 100 bytes per ms.
+    CanLogBuffer buffer(BITRATE);
+    static constexpr size_t UART_BYTES_PER_MS = 100;
+    static constexpr uint32_t BITS_PER_MS = BITRATE / 1000;
+
+    std::srand(0x3210);
+    uint64_t busBits = 0;
+    size_t uartBudget = 0;
+    size_t pending = 0;
+    size_t sentBytes = 0;
+    size_t decodedFrames = 0;
+    uint64_t lastTimeUs = 0;
+    bool monotonic = true;
+    CanLog::Decoder decoder;
+
+    for (uint32_t tick = 0; tick < 1000; tick++) {
+        while (busBits < uint64_t(tick + 1) * BITS_PER_MS) {
+            const bool extended = (std::rand() & 0x3) == 0;
+            const uint8_t dlc = static_cast<uint8_t>(std::rand() & 0x7) + 1;
+            busBits += (extended ? 64 : 44) + 10 * dlc + 3;
+            buffer.log(makeFrame(static_cast<uint16_t>(busBits), extended ? 0x1234567 : 0x123, extended, false, dlc),
+                       tick);
+        }
+
+        uartBudget += UART_BYTES_PER_MS;
+        size_t length;
+        const uint8_t* block;
+        while ((block = buffer.acquire(length, false)) != nullptr) {
+            if (pending == 0) {
+                pending = length;
+            }
+            if (uartBudget < pending) {
+                break;
+            }
+            uartBudget -= pending;
+            pending = 0;
+            sentBytes += length;
+
+            CanLog::BlockHeader header;
+            const auto frames = decodeBlock(block, length, header, decoder);
+            for (const auto& frame : frames) {
+                monotonic = monotonic && (frame.timeUs >= lastTimeUs);
+                lastTimeUs = frame.timeUs;
+            }
+            decodedFrames += frames.size();
+            buffer.release();
+        }
+        uartBudget = pending == 0 ? 0 : uartBudget;
+    }
+
+    const auto statistics = buffer.getStatistics();
+    printf("Full bus load: %u frames, %u dropped, %zu bytes in %u blocks\n",
+           statistics.logged, statistics.dropped, sentBytes, statistics.blocks);
+
+    CHECK(statistics.logged > 4000);
+    CHECK(statistics.dropped == 0);
+    CHECK(monotonic);
+    CHECK(decodedFrames + 2 * (CanLogBuffer::BLOCK_SIZE / 4) > statistics.logged);
+    CHECK(sentBytes < 1000 * UART_BYTES_PER_MS);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_RecordRoundtrip);
+    RunTest(true, ut_BlockHandover);
+    RunTest(true, ut_DropAccounting);
+    RunTest(true, ut_FullBusLoad);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Can.h"
+
+/**
+ * Binary CAN log format, written by app::CanLogger and converted on the host
+ * by utilities/canlog.py.
+ *
+ * A log is a sequence of blocks. Each block starts with a 10 byte header,
+ * all fields little endian:
+ *   uint16_t magic     0x4c43 ("CL")
+ *   uint16_t sequence  incremented per block, gaps mean lost blocks
+ *   uint16_t length    number of record bytes following the header
+ *   uint16_t dropped   frames dropped right before this block
+ *   uint16_t bitrate   bus bitrate in kbit/s, the unit of time deltas
+ *
+ * Each record starts with a flags byte: bits 7..6 record type, bit 5 RTR,
+ * bit 4 IDE, bits 3..0 DLC. It is followed by the time field, the identifier
+ * (2 bytes standard, 4 bytes extended) and DLC data bytes for data frames.
+ * Time fields are:
+ *   DELTA8   uint8_t   bit times since the previous frame
+ *   DELTA16  uint16_t  bit times since the previous frame
+ *   SYNC     uint32_t  os tick in ms, followed by the uint16_t bxCAN bit timer
+ * Every block starts with a SYNC record, so blocks decode independently.
+ * Later SYNC records keep the 16 bit timer deltas unambiguous.
+ */
+namespace app
+{
+namespace CanLog
+{
+static constexpr uint16_t BLOCK_MAGIC = 0x4c43;
+static constexpr size_t BLOCK_HEADER_SIZE = 10;
+static constexpr size_t MAX_RECORD_SIZE = 1 + 6 + 4 + 8;
+
+/// Deltas of the 16 bit bit timer stay unambiguous up to 1 Mbit/s
+static constexpr uint32_t SYNC_INTERVAL_MS = 32;
+
+enum class RecordType : uint8_t {
+    DELTA8 = 0,
+    DELTA16 = 1,
+    SYNC = 2,
+};
+
+struct BlockHeader {
+    uint16_t sequence;
+    uint16_t length;
+    uint16_t dropped;
+    uint16_t bitrate;
+};
+
+/// Frame with its reconstructed time stamp
+struct Frame {
+    uint64_t timeUs;
+    uint32_t id;
+    bool extended;
+    bool remote;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+inline size_t put(uint8_t* const out, const uint32_t value, const size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return bytes;
+}
+
+inline uint32_t get(const uint8_t* const in, const size_t bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void writeBlockHeader(uint8_t* const out, const BlockHeader& header)
+{
+    put(out + 0, BLOCK_MAGIC, 2);
+    put(out + 2, header.sequence, 2);
+    put(out + 4, header.length, 2);
+    put(out + 6, header.dropped, 2);
+    put(out + 8, header.bitrate, 2);
+}
+
+/// @return false if in doesn't start with a block header
+inline bool readBlockHeader(const uint8_t* const in, const size_t length, BlockHeader& header)
+{
+    if ((length < BLOCK_HEADER_SIZE) || (get(in, 2) != BLOCK_MAGIC)) {
+        return false;
+    }
+    header.sequence = static_cast<uint16_t>(get(in + 2, 2));
+    header.length = static_cast<uint16_t>(get(in + 4, 2));
+    header.dropped = static_cast<uint16_t>(get(in + 6, 2));
+    header.bitrate = static_cast<uint16_t>(get(in + 8, 2));
+    return true;
+}
+
+/**
+ * Record encoder, keeps the time base of the previous record. Call reset()
+ * at the start of every block.
+ */
+class Encoder
+{
+    uint32_t mSyncTick = 0;
+    uint16_t mLastTimer = 0;
+    bool mSynced = false;
+
+public:
+    void reset(void)
+    {
+        mSynced = false;
+    }
+
+    /**
+     * @param out has to provide MAX_RECORD_SIZE bytes
+     * @param tick os tick in ms at reception of the frame
+     * @return number of bytes written
+     */
+    size_t encode(uint8_t* const out, const hal::Can::RxFrame& frame, const uint32_t tick)
+    {
+        const CanRxMsg& msg = frame.msg;
+        const bool remote = msg.RTR == CAN_RTR_Remote;
+        const bool extended = msg.IDE == CAN_Id_Extended;
+        const uint8_t dlc = msg.DLC > 8 ? 8 : msg.DLC;
+        const uint16_t delta = static_cast<uint16_t>(frame.timestamp - mLastTimer);
+
+        RecordType type = RecordType::SYNC;
+        if (mSynced && (tick - mSyncTick < SYNC_INTERVAL_MS)) {
+            type = delta <= 0xff ? RecordType::DELTA8 : RecordType::DELTA16;
+        }
+
+        out[0] = static_cast<uint8_t>((static_cast<uint8_t>(type) << 6) | (remote ? 0x20 : 0) |
+                                      (extended ? 0x10 : 0) | (msg.DLC & 0x0f));
+        size_t length = 1;
+
+        switch (type) {
+        case RecordType::DELTA8:
+            length += put(out + length, delta, 1);
+            break;
+
+        case RecordType::DELTA16:
+            length += put(out + length, delta, 2);
+            break;
+
+        case RecordType::SYNC:
+            length += put(out + length, tick, 4);
+            length += put(out + length, frame.timestamp, 2);
+            mSyncTick = tick;
+            mSynced = true;
+            break;
+        }
+        mLastTimer = frame.timestamp;
+
+        length += extended ? put(out + length, msg.ExtId, 4) : put(out + length, msg.StdId, 2);
+        if (!remote) {
+            std::memcpy(out + length, msg.Data, dlc);
+            length += dlc;
+        }
+        return length;
+    }
+};
+
+/**
+ * Record decoder, reconstructs time stamps in µs since boot. The os tick of
+ * SYNC records only anchors the time base. As long as the bit timer can't
+ * have wrapped since the previous record, time continues from the bit timer,
+ * so time stamps stay monotonic across SYNC records and blocks. Call reset()
+ * with the header of every block.
+ */
+class Decoder
+{
+    uint32_t mBitrate = 1;
+    uint64_t mAnchorUs = 0;
+    uint64_t mBitsSinceAnchor = 0;
+    uint32_t mLastSyncTick = 0;
+    uint16_t mLastTimer = 0;
+    bool mAnchored = false;
+    bool mBlockSynced = false;
+
+public:
+    void reset(const BlockHeader& header)
+    {
+        mBitrate = header.bitrate != 0 ? header.bitrate * 1000u : 1;
+        mBlockSynced = false;
+    }
+
+    /**
+     * @return number of consumed bytes, 0 if the record is truncated or
+     *         its time can't be reconstructed
+     */
+    size_t decode(const uint8_t* const in, const size_t available, Frame& frame)
+    {
+        if (available < 1) {
+            return 0;
+        }
+        const RecordType type = static_cast<RecordType>(in[0] >> 6);
+        frame.remote = in[0] & 0x20;
+        frame.extended = in[0] & 0x10;
+        frame.dlc = in[0] & 0x0f;
+
+        const size_t timeLength = type == RecordType::DELTA8 ? 1 : type == RecordType::DELTA16 ? 2 : 6;
+        const size_t dataLength = frame.remote ? 0 : (frame.dlc > 8 ? 8 : frame.dlc);
+        const size_t length = 1 + timeLength + (frame.extended ? 4 : 2) + dataLength;
+
+        if ((in[0] >> 6) > static_cast<uint8_t>(RecordType::SYNC) || (available < length)) {
+            return 0;
+        }
+        if ((type != RecordType::SYNC) && !mBlockSynced) {
+            return 0;
+        }
+
+        size_t position = 1;
+        if (type == RecordType::SYNC) {
+            const uint32_t tick = get(in + position, 4);
+            const uint16_t timer = static_cast<uint16_t>(get(in + position + 4, 2));
+            const uint64_t maxElapsedBits = (static_cast<uint64_t>(tick - mLastSyncTick) + 1) * mBitrate / 1000;
+
+            if (mAnchored && (tick - mLastSyncTick < SYNC_INTERVAL_MS * 4) && (maxElapsedBits < 0x10000)) {
+                mBitsSinceAnchor += static_cast<uint16_t>(timer - mLastTimer);
+            } else {
+                mAnchorUs = static_cast<uint64_t>(tick) * 1000;
+                mBitsSinceAnchor = 0;
+                mAnchored = true;
+            }
+            mLastSyncTick = tick;
+            mLastTimer = timer;
+            mBlockSynced = true;
+        } else {
+            const uint16_t delta = static_cast<uint16_t>(get(in + position, timeLength));
+            mBitsSinceAnchor += delta;
+            mLastTimer += delta;
+        }
+        position += timeLength;
+        frame.timeUs = mAnchorUs + mBitsSinceAnchor * 1000000 / mBitrate;
+
+        const size_t idLength = frame.extended ? 4 : 2;
+        frame.id = get(in + position, idLength);
+        position += idLength;
+
+        std::memset(frame.data, 0, sizeof(frame.data));
+        std::memcpy(frame.data, in + position, dataLength);
+        return position + dataLength;
+    }
+};
+}
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include "CanLogger.h"
+#include "trace.h"
+
+using app::CanLogger;
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+CanLogger::CanLogger(const hal::Can& can, const hal::UsartWithDma& interface, const uint32_t bitrate) :
+    mCan(can),
+    mInterface(interface),
+    mBuffer(bitrate),
+    mTxTask("CanLogger",
+            CanLogger::STACKSIZE,
+            os::Task::Priority::HIGH,
+            [this](const bool& join)
+{
+    txTaskFunction(join);
+})
+{}
+
+void CanLogger::txTaskFunction(const bool&)
+{
+    mCan.setReceiveTap([this](const hal::Can::RxFrame& frame){
+        if (mBuffer.log(frame, os::Task::getTickCountFromISR())) {
+            mBlockReady.giveFromISR();
+        }
+    });
+
+    uint32_t reportedDrops = 0;
+    while (true) {
+        // Partially filled blocks are flushed on timeout, so a quiet bus still shows up timely
+        const bool blockReady = mBlockReady.take(FLUSH_INTERVAL);
+
+        size_t length;
+        for (const uint8_t* block = mBuffer.acquire(length, !blockReady); block != nullptr;
+             block = mBuffer.acquire(length, false))
+        {
+            mInterface.send(block, length);
+            mBuffer.release();
+        }
+
+        const auto statistics = mBuffer.getStatistics();
+        if (statistics.dropped != reportedDrops) {
+            reportedDrops = statistics.dropped;
+            Trace(ZONE_WARNING, "Logged %u frames, dropped %u\r\n", statistics.logged, statistics.dropped);
+        }
+    }
+}
+
+app::CanLogBuffer::Statistics CanLogger::getStatistics(void) const
+{
+    return mBuffer.getStatistics();
+}
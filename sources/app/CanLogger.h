@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include "TaskEndless.h"
+#include "Semaphore.h"
+#include "UsartWithDma.h"
+#include "Can.h"
+#include "CanLogBuffer.h"
+
+namespace app
+{
+/**
+ * Records every frame received in buffered mode into CanLog blocks and
+ * streams them over a DMA UART. Convert the stream with utilities/canlog.py.
+ *
+ * A full bus at 500 kbit/s produces about 55 kByte/s of log data, so the
+ * interface should run at 1 Mbaud or faster.
+ */
+class CanLogger final
+{
+    static constexpr size_t STACKSIZE = 256;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL {20};
+
+    const hal::Can& mCan;
+    const hal::UsartWithDma& mInterface;
+    CanLogBuffer mBuffer;
+    os::Semaphore mBlockReady;
+    os::TaskEndless mTxTask;
+
+    void txTaskFunction(const bool&);
+
+public:
+    CanLogger(const hal::Can& can, const hal::UsartWithDma& interface, const uint32_t bitrate);
+
+    CanLogger(const CanLogger&) = delete;
+    CanLogger(CanLogger&&) = delete;
+    CanLogger& operator=(const CanLogger&) = delete;
+    CanLogger& operator=(CanLogger&&) = delete;
+
+    CanLogBuffer::Statistics getStatistics(void) const;
+};
+}
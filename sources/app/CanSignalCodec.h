@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+
+namespace app
+{
+/// Byte order of a signal, named like in DBC files
+enum class CanByteOrder {
+    Intel,
+    Motorola
+};
+
+/**
+ * Compile time description of a signal in a CAN payload, following the DBC
+ * conventions: START_BIT is the least significant bit of Intel signals and
+ * the most significant bit of Motorola signals, both numbered bytewise with
+ * bit 0 as the LSB of Data[0]. The physical value is raw * Factor + Offset.
+ *
+ * The position is resolved into a single shift and mask of the payload,
+ * loaded as 64 bit word in the signals byte order. Encoding and decoding
+ * compile to a few shifts without any branches.
+ */
+template<uint8_t START_BIT,
+         uint8_t LENGTH,
+         CanByteOrder ORDER = CanByteOrder::Intel,
+         bool SIGNED = false,
+         typename Factor = std::ratio<1>,
+         typename Offset = std::ratio<0> >
+struct CanSignal {
+    static_assert(LENGTH > 0 && LENGTH <= 32, "Signals have to be between 1 and 32 bits long");
+    static_assert(START_BIT < 64, "Start bit is outside of the payload");
+    static_assert(Factor::num != 0, "Factor must not be zero");
+
+    using Raw = std::conditional_t<SIGNED, int32_t, uint32_t>;
+
+    static constexpr CanByteOrder order = ORDER;
+    static constexpr uint64_t mask = (uint64_t(1) << LENGTH) - 1;
+
+    /// Position of the LSB in the payload word of the signals byte order
+    static constexpr size_t shift = ORDER == CanByteOrder::Intel ?
+                                    START_BIT :
+                                    64 - ((START_BIT / 8) * 8 + (7 - START_BIT % 8)) - LENGTH;
+
+    static_assert(ORDER == CanByteOrder::Motorola || START_BIT + LENGTH <= 64,
+                  "Signal exceeds the payload");
+    static_assert(ORDER == CanByteOrder::Intel ||
+                  (START_BIT / 8) * 8 + (7 - START_BIT % 8) + LENGTH <= 64,
+                  "Signal exceeds the payload");
+
+    static constexpr Raw extract(const uint64_t word)
+    {
+        if constexpr (SIGNED) {
+            return static_cast<Raw>(static_cast<int64_t>(word << (64 - shift - LENGTH)) >> (64 - LENGTH));
+        } else {
+            return static_cast<Raw>((word >> shift) & mask);
+        }
+    }
+
+    static constexpr uint64_t insert(const Raw raw)
+    {
+        return (static_cast<uint64_t>(raw) & mask) << shift;
+    }
+
+    template<typename T = Raw>
+    static constexpr T toPhysical(const Raw raw)
+    {
+        if constexpr (std::ratio_equal<Factor, std::ratio<1> >::value &&
+                      std::ratio_equal<Offset, std::ratio<0> >::value)
+        {
+            return static_cast<T>(raw);
+        } else {
+            return static_cast<T>(raw) * Factor::num / Factor::den + static_cast<T>(Offset::num) / Offset::den;
+        }
+    }
+
+    template<typename T>
+    static constexpr Raw fromPhysical(const T value)
+    {
+        if constexpr (std::ratio_equal<Factor, std::ratio<1> >::value &&
+                      std::ratio_equal<Offset, std::ratio<0> >::value)
+        {
+            return static_cast<Raw>(value);
+        } else {
+            return static_cast<Raw>((value - static_cast<T>(Offset::num) / Offset::den) * Factor::den / Factor::num);
+        }
+    }
+};
+
+namespace CanPayload
+{
+using Data = uint8_t[8];
+
+constexpr uint64_t load(const Data& data, const CanByteOrder order)
+{
+    uint64_t word = 0;
+    for (size_t i = 0; i < sizeof(Data); i++) {
+        const size_t byte = order == CanByteOrder::Intel ? i : sizeof(Data) - 1 - i;
+        word |= static_cast<uint64_t>(data[byte]) << (8 * i);
+    }
+    return word;
+}
+
+constexpr void store(Data& data, const uint64_t word, const CanByteOrder order)
+{
+    for (size_t i = 0; i < sizeof(Data); i++) {
+        const size_t byte = order == CanByteOrder::Intel ? i : sizeof(Data) - 1 - i;
+        data[byte] |= static_cast<uint8_t>(word >> (8 * i));
+    }
+}
+
+constexpr void clear(Data& data)
+{
+    for (auto& byte : data) {
+        byte = 0;
+    }
+}
+
+template<typename ... Signals>
+constexpr bool usesOrder(const CanByteOrder order)
+{
+    return ((Signals::order == order) || ...);
+}
+
+/// Decodes the raw values of all Signals, loading the payload only once per byte order
+template<typename ... Signals>
+constexpr std::tuple<typename Signals::Raw ...> unpack(const Data& data)
+{
+    const uint64_t intel = usesOrder<Signals ...>(CanByteOrder::Intel) ? load(data, CanByteOrder::Intel) : 0;
+    const uint64_t motorola = usesOrder<Signals ...>(CanByteOrder::Motorola) ? load(data, CanByteOrder::Motorola) : 0;
+    return std::tuple<typename Signals::Raw ...>(
+                                                 Signals::extract(Signals::order == CanByteOrder::Intel ? intel : motorola) ...);
+}
+
+/// Encodes the raw values of all Signals, bits not covered by a signal are cleared
+template<typename ... Signals>
+constexpr void pack(Data& data, const typename Signals::Raw... raws)
+{
+    const uint64_t intel = ((Signals::order == CanByteOrder::Intel ? Signals::insert(raws) : 0) | ... | 0);
+    const uint64_t motorola = ((Signals::order == CanByteOrder::Motorola ? Signals::insert(raws) : 0) | ... | 0);
+    clear(data);
+    store(data, intel, CanByteOrder::Intel);
+    store(data, motorola, CanByteOrder::Motorola);
+}
+
+template<typename Signal>
+constexpr typename Signal::Raw get(const Data& data)
+{
+    return std::get<0>(unpack<Signal>(data));
+}
+
+/// Replaces a single signal and keeps the rest of the payload
+template<typename Signal>
+constexpr void set(Data& data, const typename Signal::Raw raw)
+{
+    const uint64_t word = (load(data, Signal::order) & ~(Signal::mask << Signal::shift)) | Signal::insert(raw);
+    clear(data);
+    store(data, word, Signal::order);
+}
+}
+
+/**
+ * Compile time description of a CAN message with a standard identifier.
+ * Signals are declared as member types of a derived struct.
+ */
+template<uint32_t ID, uint8_t DLC>
+struct CanMessage {
+    static_assert(ID <= 0x7ff, "Only standard identifiers are supported");
+    static_assert(DLC <= 8, "Classic CAN frames carry at most 8 bytes");
+
+    static constexpr uint32_t id = ID;
+    static constexpr uint8_t dlc = DLC;
+
+    template<typename Frame>
+    static constexpr bool matches(const Frame& frame)
+    {
+        return (frame.IDE == 0) && (frame.StdId == ID);
+    }
+
+    /// Sets header and DLC of frame and clears its payload
+    template<typename Frame>
+    static void init(Frame& frame)
+    {
+        frame.StdId = ID;
+        frame.ExtId = 0;
+        frame.IDE = 0;
+        frame.RTR = 0;
+        frame.DLC = DLC;
+        std::memset(frame.Data, 0, sizeof(frame.Data));
+    }
+};
+}
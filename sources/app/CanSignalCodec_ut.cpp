@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "unittest.h"
+#include "CanSignalCodec.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+#define NUM_TEST_LOOPS 10000
+#define NUM_BENCHMARK_LOOPS 1000000
+
+using app::CanByteOrder;
+using app::CanSignal;
+namespace CanPayload = app::CanPayload;
+
+//--------------------------BUFFERS--------------------------
+
+/// Runtime description, as a generic DBC interpreter would use it
+struct SignalDescription {
+    uint8_t startBit;
+    uint8_t length;
+    CanByteOrder order;
+    bool isSigned;
+};
+
+template<typename Signal, uint8_t START_BIT, uint8_t LENGTH, CanByteOrder ORDER, bool SIGNED>
+struct Described {
+    using signal = Signal;
+    static constexpr SignalDescription description {START_BIT, LENGTH, ORDER, SIGNED};
+};
+
+#define DESCRIBE(START_BIT, LENGTH, ORDER, SIGNED) \
+    Described<CanSignal<START_BIT, LENGTH, ORDER, SIGNED>, START_BIT, LENGTH, ORDER, SIGNED>
+
+// Multi-signal frame of a typical powertrain message
+using Rpm = CanSignal<7, 16, CanByteOrder::Motorola, false, std::ratio<1, 4> >;
+using Torque = CanSignal<16, 12, CanByteOrder::Intel, true, std::ratio<1, 2>, std::ratio<-100> >;
+using Gear = CanSignal<28, 4>;
+using Temperature = CanSignal<39, 8, CanByteOrder::Motorola, false, std::ratio<1>, std::ratio<-40> >;
+using Counter = CanSignal<60, 4>;
+
+static const SignalDescription g_RuntimeFrame[] = {
+    {7, 16, CanByteOrder::Motorola, false},
+    {16, 12, CanByteOrder::Intel, true},
+    {28, 4, CanByteOrder::Intel, false},
+    {39, 8, CanByteOrder::Motorola, false},
+    {60, 4, CanByteOrder::Intel, false},
+};
+
+//--------------------------MOCKING--------------------------
+
+/// Generic decoder walking the signal bit by bit, like a DBC interpreter does
+static int64_t decodeRuntime(const SignalDescription& signal, const uint8_t* data)
+{
+    uint64_t raw = 0;
+    size_t bit = signal.startBit;
+
+    for (size_t i = 0; i < signal.length; i++) {
+        const uint64_t value = (data[bit / 8] >> (bit % 8)) & 0x1;
+        if (signal.order == CanByteOrder::Intel) {
+            raw |= value << i;
+            bit++;
+        } else {
+            raw = (raw << 1) | value;
+            bit = (bit % 8) == 0 ? bit + 15 : bit - 1;
+        }
+    }
+
+    if (signal.isSigned && (raw & (uint64_t(1) << (signal.length - 1)))) {
+        return static_cast<int64_t>(raw) - (int64_t(1) << signal.length);
+    }
+    return static_cast<int64_t>(raw);
+}
+
+static void randomPayload(uint8_t (& data)[8])
+{
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(std::rand());
+    }
+}
+
+template<typename ... Signals>
+static size_t checkEquivalence(void)
+{
+    size_t errors = 0;
+    uint8_t data[8];
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        randomPayload(data);
+        ((errors += CanPayload::get<typename Signals::signal>(data) ==
+                    decodeRuntime(Signals::description, data) ? 0 : 1), ...);
+    }
+    return errors;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_IntelLayout(void)
+{
+    TestCaseBegin();
+
+    const uint8_t data[8] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0};
+    CHECK((CanPayload::get<CanSignal<0, 8> >(data) == 0x12));
+    CHECK((CanPayload::get<CanSignal<0, 16> >(data) == 0x3412));
+    CHECK((CanPayload::get<CanSignal<4, 8> >(data) == 0x41));
+    CHECK((CanPayload::get<CanSignal<32, 32> >(data) == 0xf0debc9a));
+    CHECK((CanPayload::get<CanSignal<63, 1> >(data) == 1));
+
+    static_assert(CanPayload::get<CanSignal<8, 4> >({0x00, 0xab}) == 0xb, "Intel decoding at compile time");
+
+    TestCaseEnd();
+}
+
+int ut_MotorolaLayout(void)
+{
+    TestCaseBegin();
+
+    const uint8_t data[8] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0};
+    CHECK((CanPayload::get<CanSignal<7, 8, CanByteOrder::Motorola> >(data) == 0x12));
+    CHECK((CanPayload::get<CanSignal<7, 16, CanByteOrder::Motorola> >(data) == 0x1234));
+    CHECK((CanPayload::get<CanSignal<3, 8, CanByteOrder::Motorola> >(data) == 0x23));
+    CHECK((CanPayload::get<CanSignal<39, 32, CanByteOrder::Motorola> >(data) == 0x9abcdef0));
+    CHECK((CanPayload::get<CanSignal<0, 1, CanByteOrder::Motorola> >(data) == 0));
+
+    static_assert(CanSignal<7, 32, CanByteOrder::Motorola>::shift == 32, "Motorola signal in the first four bytes");
+    static_assert(CanSignal<56, 1, CanByteOrder::Motorola>::shift == 0, "Motorola signal in the last bit");
+
+    TestCaseEnd();
+}
+
+int ut_SignedAndScaled(void)
+{
+    TestCaseBegin();
+
+    uint8_t data[8];
+    CanPayload::pack<Torque>(data, -1);
+    CHECK(data[2] == 0xff && data[3] == 0x0f);
+    CHECK(CanPayload::get<Torque>(data) == -1);
+
+    CanPayload::pack<Torque>(data, -2048);
+    CHECK(CanPayload::get<Torque>(data) == -2048);
+
+    CHECK(Torque::toPhysical<int32_t>(Torque::fromPhysical(50)) == 50);
+    CHECK(Torque::fromPhysical(50) == 300);
+    CHECK(Rpm::toPhysical<uint32_t>(Rpm::fromPhysical(3000u)) == 3000);
+    CHECK(Temperature::fromPhysical(-40) == 0);
+    CHECK(Temperature::toPhysical<int32_t>(255) == 215);
+    CHECK(Rpm::toPhysical<float>(1) == 0.25f);
+
+    TestCaseEnd();
+}
+
+int ut_PackUnpack(void)
+{
+    TestCaseBegin();
+
+    uint8_t data[8];
+    std::memset(data, 0xa5, sizeof(data));
+    CanPayload::pack<Rpm, Torque, Gear, Temperature, Counter>(data, 0xbeef, -300, 5, 90, 0xc);
+
+    const auto [rpm, torque, gear, temperature, counter] =
+        CanPayload::unpack<Rpm, Torque, Gear, Temperature, Counter>(data);
+    CHECK(rpm == 0xbeef);
+    CHECK(torque == -300);
+    CHECK(gear == 5);
+    CHECK(temperature == 90);
+    CHECK(counter == 0xc);
+
+    // Bits outside of all signals are cleared
+    CHECK((CanPayload::get<CanSignal<47, 12, CanByteOrder::Motorola> >(data) == 0));
+    CHECK((CanPayload::get<CanSignal<56, 4> >(data) == 0));
+
+    CanPayload::set<Gear>(data, 9);
+    CHECK(CanPayload::get<Gear>(data) == 9);
+    CHECK(CanPayload::get<Torque>(data) == -300);
+    CHECK(CanPayload::get<Rpm>(data) == 0xbeef);
+
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        const uint32_t value = static_cast<uint32_t>(std::rand());
+        CanPayload::pack<CanSignal<39, 32, CanByteOrder::Motorola>, CanSignal<0, 32> >(data, value, ~value);
+        CHECK((CanPayload::get<CanSignal<39, 32, CanByteOrder::Motorola> >(data) == value));
+        CHECK((CanPayload::get<CanSignal<0, 32> >(data) == ~value));
+    }
+
+    TestCaseEnd();
+}
+
+int ut_RuntimeEquivalence(void)
+{
+    TestCaseBegin();
+
+    std::srand(0x1234);
+    CHECK((checkEquivalence<DESCRIBE(0, 1, CanByteOrder::Intel, false),
+                            DESCRIBE(5, 11, CanByteOrder::Intel, false),
+                            DESCRIBE(13, 7, CanByteOrder::Intel, true),
+                            DESCRIBE(32, 32, CanByteOrder::Intel, true),
+                            DESCRIBE(57, 7, CanByteOrder::Intel, false)>() == 0));
+    CHECK((checkEquivalence<DESCRIBE(7, 1, CanByteOrder::Motorola, false),
+                            DESCRIBE(2, 11, CanByteOrder::Motorola, false),
+                            DESCRIBE(20, 13, CanByteOrder::Motorola, true),
+                            DESCRIBE(39, 32, CanByteOrder::Motorola, true),
+                            DESCRIBE(59, 4, CanByteOrder::Motorola, false)>() == 0));
+
+    TestCaseEnd();
+}
+
+/**
+ * The codec relies on inlining. Test builds run without optimization and
+ * with coverage, there the compile time codec is about half as fast as the
+ * runtime decoder. Compare at -Os or -O2 like the firmware.
+ */
+int ut_Benchmark(void)
+{
+    TestCaseBegin();
+
+    std::srand(0x4321);
+    static uint8_t frames[256][8];
+    for (auto& frame : frames) {
+        randomPayload(frame);
+    }
+
+    volatile int64_t sink = 0;
+    int64_t runtimeSum = 0;
+    const auto runtimeStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        for (const auto& signal : g_RuntimeFrame) {
+            runtimeSum += decodeRuntime(signal, frames[i % 256]);
+        }
+    }
+    const auto runtime = std::chrono::steady_clock::now() - runtimeStart;
+    sink = runtimeSum;
+
+    int64_t compiledSum = 0;
+    const auto compiledStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        const auto [rpm, torque, gear, temperature, counter] =
+            CanPayload::unpack<Rpm, Torque, Gear, Temperature, Counter>(frames[i % 256]);
+        compiledSum += int64_t(rpm) + torque + gear + temperature + counter;
+    }
+    const auto compiled = std::chrono::steady_clock::now() - compiledStart;
+    sink = compiledSum;
+    (void)sink;
+
+    CHECK(compiledSum == runtimeSum);
+
+    printf("Decoding of a 5 signal frame: runtime %lld ns, compile time %lld ns\n",
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(runtime).count() /
+                                  NUM_BENCHMARK_LOOPS),
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(compiled).count() /
+                                  NUM_BENCHMARK_LOOPS));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_IntelLayout);
+    RunTest(true, ut_MotorolaLayout);
+    RunTest(true, ut_SignedAndScaled);
+    RunTest(true, ut_PackUnpack);
+    RunTest(true, ut_RuntimeEquivalence);
+    RunTest(true, ut_Benchmark);
+    UnitTestMainEnd();
+}
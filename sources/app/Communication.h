@@ -10,6 +10,7 @@
 #include "DeepSleepInterface.h"
 #include "UsartWithDma.h"
 #include "Gpio.h"
+#include "Cobs.h"
 
 namespace com
 {
@@ -20,16 +21,32 @@ enum class ErrorCode : uint8_t {
     NO_COMMUNICATION_ERROR,
     TX_ERROR
 };
+
+/**
+ * DELTA_FRAMES only transmits the fields that changed since the last frame,
+ * with a keyframe of all fields every KEYFRAME_INTERVAL frames. Both sides of
+ * the link have to use the same encoding.
+ */
+enum class Encoding : uint8_t {
+    FULL_FRAMES = 0,
+    DELTA_FRAMES
+};
 }
 
 namespace app
 {
+/**
+ * Exchanges two DataTransferObjects periodically over a UART. Frames are
+ * COBS encoded, the receiver decodes them from a circular DMA buffer and
+ * resynchronizes at the next frame delimiter after a corrupted byte.
+ */
 template<typename rxDto, typename txDto>
 struct Communication final :
     private os::DeepSleepModule {
     Communication(const hal::UsartWithDma& interface, rxDto&, txDto&,
                   const std::chrono::milliseconds& transferPeriodMS,
-                  std::function<void(com::ErrorCode)> errorCallback = nullptr);
+                  std::function<void(com::ErrorCode)> errorCallback = nullptr,
+                  const com::Encoding encoding = com::Encoding::FULL_FRAMES);
     Communication(const hal::UsartWithDma& interface,
                   rxDto& rx, txDto& tx,
                   std::function<void(com::ErrorCode)> errorCallback = nullptr) :
@@ -55,32 +72,50 @@ private:
     virtual void exitDeepSleep(void) override;
 
     static constexpr uint32_t STACKSIZE = 1024;
+    static constexpr uint8_t KEYFRAME_INTERVAL = 10;
+    static constexpr size_t RX_BUFFERSIZE = 4 * com::cobsEncodedLength(rxDto::MAX_FRAME_LENGTH);
+    // The connection is lost without a valid frame for two transfer periods
+    static constexpr uint8_t MAX_POLLS_WITHOUT_FRAME = 4;
 
     const hal::UsartWithDma& mInterface;
     rxDto& mRxDto;
     txDto& mTxDto;
     const uint8_t mTransferPeriod;
     std::function<void(com::ErrorCode)> mErrorCallback;
+    const com::Encoding mEncoding;
     bool mConnected = false;
+    uint8_t mFramesSinceKeyframe = 0;
+
+    std::array<uint8_t, com::cobsEncodedLength(txDto::MAX_FRAME_LENGTH)> mTxFrame;
+    std::array<uint8_t, RX_BUFFERSIZE> mRxBuffer;
+    com::CobsDecoder mRxDecoder;
+    size_t mRxPosition = 0;
+    bool mReceiving = false;
+    uint8_t mPollsWithoutFrame = 0;
 
     os::TaskInterruptable mTxTask;
     os::TaskInterruptable mRxTask;
 
     void TxTaskFunction(const bool&);
     void RxTaskFunction(const bool&);
+    bool handleFrame(const size_t length);
 };
 }
 
 template<typename rxDto, typename txDto>
 app::Communication<rxDto, txDto>::Communication(const hal::UsartWithDma& interface, rxDto& rx_dto, txDto& tx_dto,
                                                 const std::chrono::milliseconds& transferPeriodMS,
-                                                std::function<void(com::ErrorCode)> errorCallback) :
+                                                std::function<void(com::ErrorCode)> errorCallback,
+                                                const com::Encoding encoding) :
     os::DeepSleepModule(),
         mInterface(interface),
     mRxDto(rx_dto),
     mTxDto(tx_dto),
     mTransferPeriod(transferPeriodMS.count()),
     mErrorCallback(errorCallback),
+    mEncoding(encoding),
+    mRxDecoder(encoding == com::Encoding::DELTA_FRAMES ? rx_dto.deltaData() : rx_dto.data(),
+               encoding == com::Encoding::DELTA_FRAMES ? rx_dto.maxDeltaLength() : rx_dto.length()),
     mTxTask("4ComTx",
             Communication::STACKSIZE,
             os::Task::Priority::VERY_HIGH,
@@ -100,9 +135,10 @@ app::Communication<rxDto, txDto>::Communication(const hal::UsartWithDma& interfa
 template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::enterDeepSleep(void)
 {
-    //interface stop;
     mTxTask.join();
     mRxTask.join();
+    mInterface.stopNonBlockingReceive();
+    mReceiving = false;
 }
 
 template<typename rxDto, typename txDto>
@@ -116,14 +152,27 @@ template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::TxTaskFunction(const bool& join)
 {
     do {
-        mTxDto.prepareForTx();
+        uint8_t const* frame = mTxDto.data();
+        size_t frameLength = mTxDto.length();
+
+        if (mEncoding == com::Encoding::DELTA_FRAMES) {
+            frame = mTxDto.deltaData();
+            frameLength = mTxDto.prepareDeltaForTx(mFramesSinceKeyframe == 0);
+            mFramesSinceKeyframe = (mFramesSinceKeyframe + 1) % KEYFRAME_INTERVAL;
+        } else {
+            mTxDto.prepareForTx();
+        }
+
+        const size_t encodedLength = com::cobsEncode(frame, frameLength, mTxFrame.data());
 
         constexpr uint32_t ticksToWaitForTx = 30;
-        const auto bytesTransmitted = mInterface.send(mTxDto.data(),
-                                                      mTxDto.length(),
+        const auto bytesTransmitted = mInterface.send(mTxFrame.data(),
+                                                      encodedLength,
                                                       ticksToWaitForTx);
 
-        if (bytesTransmitted != mTxDto.length()) {
+        if (bytesTransmitted != encodedLength) {
+            // The receiver may have lost changes, resend all fields
+            mFramesSinceKeyframe = 0;
             if (mErrorCallback) {
                 mErrorCallback(com::ErrorCode::TX_ERROR);
             }
@@ -135,45 +184,66 @@ void app::Communication<rxDto, txDto>::TxTaskFunction(const bool& join)
 template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::RxTaskFunction(const bool& join)
 {
-    mInterface.enableReceiveTimeout(10);
-    const uint32_t ticksToWaitForRx = mTransferPeriod * 2;
-    const std::chrono::milliseconds rxPeriod = std::chrono::milliseconds(mTransferPeriod - 1);
+    const std::chrono::milliseconds rxPeriod = std::chrono::milliseconds(std::max(mTransferPeriod / 2, 1));
+
+    if (!mReceiving) {
+        mRxDecoder.reset();
+        mRxPosition = 0;
+        mInterface.receiveNonBlocking(mRxBuffer.data(), mRxBuffer.size(), true);
+        mReceiving = true;
+    }
 
     do {
-        const auto bytesReceived = mInterface.receiveWithTimeout(mRxDto.data(),
-                                                                 mRxDto.length(),
-                                                                 ticksToWaitForRx);
+        const size_t end = (mRxBuffer.size() - mInterface.getRemainingNonBlockingReceive()) % mRxBuffer.size();
+        bool frameReceived = false;
 
-        if (bytesReceived != mRxDto.length()) {
-            if (mErrorCallback) {
-                mErrorCallback(com::ErrorCode::NO_COMMUNICATION_ERROR);
+        while (mRxPosition != end) {
+            const size_t length = mRxDecoder.decode(mRxBuffer[mRxPosition]);
+            mRxPosition = (mRxPosition + 1) % mRxBuffer.size();
+
+            if ((length > 0) && handleFrame(length)) {
+                frameReceived = true;
             }
-            mConnected = false;
-            continue;
         }
 
-        if (!mRxDto.isValid()) {
+        if (frameReceived) {
+            mPollsWithoutFrame = 0;
+        } else if (mPollsWithoutFrame < MAX_POLLS_WITHOUT_FRAME) {
+            mPollsWithoutFrame++;
+        } else {
             if (mErrorCallback) {
-                mErrorCallback(com::ErrorCode::CRC_ERROR);
+                mErrorCallback(com::ErrorCode::NO_COMMUNICATION_ERROR);
             }
             mConnected = false;
-            // consume remaining bytes in hardware buffer
-            auto bytesReceived = mInterface.receiveWithTimeout(mRxDto.data(),
-                                                               mRxDto.length(),
-                                                               mTransferPeriod / 2);
-            continue;
         }
 
-        mRxDto.updateTuple();
+        os::ThisTask::sleep(rxPeriod);
+    } while (!join);
+}
+
+template<typename rxDto, typename txDto>
+bool app::Communication<rxDto, txDto>::handleFrame(const size_t length)
+{
+    const bool valid = (mEncoding == com::Encoding::DELTA_FRAMES) ?
+                       mRxDto.updateFromDelta(length) :
+                       ((length == mRxDto.length()) && mRxDto.isValid());
 
-        // This is only reached if a connection is established.
+    if (!valid) {
         if (mErrorCallback) {
-            mErrorCallback(com::ErrorCode::NO_COMMUNICATION_ERROR);
+            mErrorCallback(com::ErrorCode::CRC_ERROR);
         }
-        mConnected = true;
+        mConnected = false;
+        return false;
+    }
 
-        os::ThisTask::sleep(rxPeriod);
-    } while (!join);
+    if (mEncoding == com::Encoding::FULL_FRAMES) {
+        mRxDto.updateTuple();
+    }
 
-    mInterface.disableReceiveTimeout();
+    // This is only reached if a connection is established.
+    if (mErrorCallback) {
+        mErrorCallback(com::ErrorCode::NO_COMMUNICATION_ERROR);
+    }
+    mConnected = true;
+    return true;
 }
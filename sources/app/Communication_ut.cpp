@@ -4,24 +4,40 @@
  * Modified 2019 by Henning Mende
  */
 
+#include <atomic>
 #include <cmath>
 #include <thread>
 #include <iostream>
 #include <cstring>
+#include <random>
 #include "unittest.h"
 #include "Communication.h"
 #include "DataTransferObject.h"
 
 #define NUM_TEST_LOOPS 255
+#define NUM_NOISE_FRAMES 5000
 
 //--------------------------BUFFERS--------------------------
 uint32_t g_currentTickCount;
 bool g_taskJoined, g_taskStarted;
 std::thread::id g_masterThreadId, g_slaveThreadId;
-static constexpr size_t MEMORYSIZE = 255;
-uint8_t g_masterRxMemroy[MEMORYSIZE], g_slaveRxMemory[MEMORYSIZE];
 bool g_comError = false;
 
+// Circular receive buffer of one side, written like by the DMA
+struct RxRing {
+    uint8_t* data = nullptr;
+    size_t length = 0;
+    std::atomic<size_t> position {0};
+};
+RxRing g_masterRxRing, g_slaveRxRing;
+size_t g_lastSentLength;
+
+// Every byte on the wire is flipped with this probability
+double g_byteErrorRate = 0;
+std::mt19937 g_noise;
+size_t g_corruptedBytes;
+bool g_lastByteCorrupted;
+
 #ifdef CRC_32BIT
 uint32_t g_crc;
 #else
@@ -76,56 +92,103 @@ uint32_t os::Task::getTickCount(void)
     return g_currentTickCount;
 }
 
+static uint8_t crc8(uint8_t const* const data, const size_t length)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
 #ifdef CRC_32BIT
 uint32_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
 {
-    return g_crc;
+    return crc8(data, length) ^ g_crc;
 }
 #else
 uint8_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
 {
-    return g_crc;
+    return crc8(data, length) ^ g_crc;
 }
 #endif // CRC_32BIT
 
-size_t hal::UsartWithDma::send(uint8_t const* const data, const size_t length, const uint32_t ticksToWait) const
+static RxRing& ownRxRing(void)
+{
+    return (std::this_thread::get_id() == g_slaveThreadId) ? g_slaveRxRing : g_masterRxRing;
+}
+
+static void writeToRing(RxRing& ring, const uint8_t byte)
 {
-    if (std::this_thread::get_id() == g_masterThreadId) {
-        std::memcpy(g_slaveRxMemory, data, length);
-    } else {
-        std::memcpy(g_masterRxMemroy, data, length);
+    if (ring.data != nullptr) {
+        const size_t position = ring.position;
+        ring.data[position] = byte;
+        ring.position = (position + 1) % ring.length;
     }
-    return g_comError ? 0 : length;
 }
 
-size_t hal::UsartWithDma::receive(uint8_t* const data, const size_t length, const uint32_t ticksToWait) const
+size_t hal::UsartWithDma::send(uint8_t const* const data, const size_t length, const uint32_t ticksToWait) const
 {
-    if (std::this_thread::get_id() == g_slaveThreadId) {
-        std::memcpy(data, g_slaveRxMemory, length);
-    } else {
-        std::memcpy(data, g_masterRxMemroy, length);
+    RxRing& ring = (std::this_thread::get_id() == g_masterThreadId) ? g_slaveRxRing : g_masterRxRing;
+    std::uniform_real_distribution<double> probability(0, 1);
+    std::uniform_int_distribution<int> flip(1, 0xff);
+
+    g_lastByteCorrupted = false;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        g_lastByteCorrupted = (g_byteErrorRate > 0) && (probability(g_noise) < g_byteErrorRate);
+        if (g_lastByteCorrupted) {
+            byte ^= flip(g_noise);
+            g_corruptedBytes++;
+        }
+        writeToRing(ring, byte);
     }
+    g_lastSentLength = length;
     return g_comError ? 0 : length;
 }
 
-#ifndef NO_USART_HARDWARE_TIMEOUT
-void hal::UsartWithDma::enableReceiveTimeout(const size_t) const {}
-#endif
+void hal::UsartWithDma::receiveNonBlocking(uint8_t const* const data, const size_t length, const bool repeat) const
+{
+    RxRing& ring = ownRxRing();
+
+    ring.data = const_cast<uint8_t*>(data);
+    ring.length = length;
+    ring.position = 0;
+}
 
-size_t hal::UsartWithDma::receiveWithTimeout(uint8_t* const data, const size_t length,
-                                             const uint32_t ticksToWait) const
+void hal::UsartWithDma::stopNonBlockingReceive(void) const
 {
-    return receive(data, length, ticksToWait);
+    ownRxRing().data = nullptr;
 }
 
-#ifndef NO_USART_HARDWARE_TIMEOUT
-void hal::UsartWithDma::disableReceiveTimeout() const {}
-#endif
+size_t hal::UsartWithDma::getRemainingNonBlockingReceive(void) const
+{
+    const RxRing& ring = ownRxRing();
+    return ring.length - ring.position;
+}
 
 void os::ThisTask::enterCriticalSection() {}
 
 void os::ThisTask::exitCriticalSection() {}
 
+// Rings of destroyed Communication objects must not be written
+static void resetRxRings(void)
+{
+    g_masterRxRing.data = nullptr;
+    g_slaveRxRing.data = nullptr;
+}
+
+// Routes frames sent by this thread to the slave if master, to the master otherwise
+static void actAs(const bool master)
+{
+    g_masterThreadId = master ? std::this_thread::get_id() : std::thread::id();
+    g_slaveThreadId = master ? std::thread::id() : std::this_thread::get_id();
+}
+
 //-------------------------TESTCASES-------------------------
 
 int ut_CrcError(void)
@@ -135,6 +198,7 @@ int ut_CrcError(void)
     g_crc = 0x00;
     g_currentTickCount = 0;
     g_comError = false;
+    resetRxRings();
 
     auto crcError = false;
 
@@ -158,22 +222,29 @@ int ut_CrcError(void)
                                                                   txDto,
                                                                   rxDto);
 
-    masterCom.triggerTxTaskExecution();
+    actAs(true);
     masterCom.triggerRxTaskExecution();
-    slaveCom.triggerTxTaskExecution();
+    actAs(false);
     slaveCom.triggerRxTaskExecution();
 
+    actAs(true);
     masterCom.triggerTxTaskExecution();
+    actAs(false);
     slaveCom.triggerTxTaskExecution();
-    masterCom.triggerRxTaskExecution();
     slaveCom.triggerRxTaskExecution();
+    actAs(true);
+    masterCom.triggerRxTaskExecution();
 
     CHECK(crcError == false);
     CHECK(masterCom.isConnected() == true);
     CHECK(slaveCom.isConnected() == true);
 
+    actAs(false);
+    slaveCom.triggerTxTaskExecution();
+
     g_crc = 0x11;
 
+    actAs(true);
     masterCom.triggerRxTaskExecution();
 
     CHECK(crcError == true);
@@ -190,8 +261,7 @@ int ut_DeepSleep(void)
     g_crc = 0;
     g_currentTickCount = 0;
     g_comError = false;
-    memset(g_masterRxMemroy, 0, MEMORYSIZE);
-    memset(g_slaveRxMemory, 0, MEMORYSIZE);
+    resetRxRings();
 
     CHECK(false == g_taskJoined);
     CHECK(false == g_taskStarted);
@@ -224,6 +294,7 @@ int ut_ValueExchange(void)
     g_crc = 0;
     g_currentTickCount = 0;
     g_comError = false;
+    resetRxRings();
 
     uint32_t mRx, mTx, sRx, sTx;
 
@@ -285,11 +356,205 @@ int ut_ValueExchange(void)
     TestCaseEnd();
 }
 
+int ut_DeltaFrames(void)
+{
+    TestCaseBegin();
+
+    g_crc = 0;
+    g_currentTickCount = 0;
+    g_comError = false;
+    resetRxRings();
+
+    auto crcError = false;
+
+    uint32_t a = 1, b = 2, c = 3;
+    uint32_t rxA = 0, rxB = 0, rxC = 0;
+
+    auto txDto = com::make_dto(a, b, c);
+    auto rxDto = com::make_dto(rxA, rxB, rxC);
+
+    app::Communication<decltype(rxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
+                                                                                                        COM_INTERFACE>(),
+                                                                   rxDto,
+                                                                   txDto,
+                                                                   std::chrono::milliseconds(10),
+                                                                   nullptr,
+                                                                   com::Encoding::DELTA_FRAMES);
+    app::Communication<decltype(txDto), decltype(rxDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
+                                                                                                       COM_INTERFACE>(),
+                                                                  rxDto,
+                                                                  txDto,
+                                                                  std::chrono::milliseconds(10),
+                                                                  [&](auto error)
+        {
+                                                                  if (error == com::ErrorCode::CRC_ERROR) {
+                                                                      crcError = true;
+                                                                  }
+        },
+                                                                  com::Encoding::DELTA_FRAMES);
+
+    // COBS adds a code byte and the delimiter
+    const size_t header = sizeof(uint32_t) + 1 + sizeof(g_crc) + 2;
+
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+
+    actAs(true);
+    masterCom.triggerTxTaskExecution();
+    CHECK(g_lastSentLength == header + 3 * sizeof(uint32_t));
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+    CHECK(slaveCom.isConnected() == true);
+    CHECK(rxA == 1);
+    CHECK(rxB == 2);
+    CHECK(rxC == 3);
+
+    actAs(true);
+    masterCom.triggerTxTaskExecution();
+    CHECK(g_lastSentLength == header);
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+    CHECK(slaveCom.isConnected() == true);
+
+    b = 20;
+    actAs(true);
+    masterCom.triggerTxTaskExecution();
+    CHECK(g_lastSentLength == header + sizeof(uint32_t));
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+    CHECK(rxA == 1);
+    CHECK(rxB == 20);
+    CHECK(rxC == 3);
+
+    // A corrupted delta is repaired by the next keyframe
+    c = 30;
+    g_crc = 0x11;
+    actAs(true);
+    masterCom.triggerTxTaskExecution();
+    g_crc = 0;
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+    CHECK(crcError == true);
+    CHECK(slaveCom.isConnected() == false);
+    CHECK(rxC == 3);
+
+    size_t frames = 4;
+    do {
+        actAs(true);
+        masterCom.triggerTxTaskExecution();
+        actAs(false);
+        slaveCom.triggerRxTaskExecution();
+        const bool keyframe = (frames % 10) == 0;
+        CHECK(rxC == (keyframe ? 30 : 3));
+    } while (frames++ % 10);
+    CHECK(g_lastSentLength == header + 3 * sizeof(uint32_t));
+    CHECK(slaveCom.isConnected() == true);
+
+    TestCaseEnd();
+}
+
+int ut_NoiseRecovery(void)
+{
+    TestCaseBegin();
+
+    g_crc = 0;
+    g_currentTickCount = 0;
+    g_comError = false;
+    resetRxRings();
+
+    size_t crcErrors = 0;
+
+    uint32_t a = 0, b = 0, c = 0, masterRx = 0, slaveTx = 0;
+    uint32_t rxA = 0, rxB = ~0u, rxC = 0;
+
+    auto txDto = com::make_dto(a, b, c);
+    auto rxDto = com::make_dto(rxA, rxB, rxC);
+    auto masterRxDto = com::make_dto(masterRx);
+    auto slaveTxDto = com::make_dto(slaveTx);
+
+    app::Communication<decltype(masterRxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                              Usart::
+                                                                                                              COM_INTERFACE>(),
+                                                                         masterRxDto,
+                                                                         txDto);
+    app::Communication<decltype(rxDto), decltype(slaveTxDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                            Usart::
+                                                                                                            COM_INTERFACE>(),
+                                                                       rxDto,
+                                                                       slaveTxDto,
+                                                                       [&](auto error)
+        {
+                                                                       if (error == com::ErrorCode::CRC_ERROR) {
+                                                                           crcErrors++;
+                                                                       }
+        });
+
+    actAs(false);
+    slaveCom.triggerRxTaskExecution();
+
+    g_noise.seed(42);
+    g_byteErrorRate = 0.002;
+    g_corruptedBytes = 0;
+
+    std::uniform_int_distribution<int> burstLength(1, 32);
+    std::uniform_int_distribution<int> burstByte(0, 0xff);
+    size_t expected = 0, recovered = 0, wrong = 0;
+    bool synchronized = true;
+
+    for (uint32_t i = 1; i <= NUM_NOISE_FRAMES; i++) {
+        a = i;
+        b = ~i;
+        c = i * 3;
+
+        // Frames are lost only if they or the delimiter in front of them are corrupted
+        const size_t corruptedBytes = g_corruptedBytes;
+        actAs(true);
+        masterCom.triggerTxTaskExecution();
+        if (synchronized && (corruptedBytes == g_corruptedBytes)) {
+            expected++;
+        }
+        synchronized = !g_lastByteCorrupted;
+
+        if (i % 100 == 50) {
+            for (int n = burstLength(g_noise); n > 0; n--) {
+                const uint8_t byte = burstByte(g_noise);
+                writeToRing(g_slaveRxRing, byte);
+                synchronized = (byte == 0);
+            }
+        }
+
+        const uint32_t lastA = rxA;
+        actAs(false);
+        slaveCom.triggerRxTaskExecution();
+        if (rxA == i) {
+            recovered++;
+        }
+        if (((rxA != i) && (rxA != lastA)) || (rxB != ~rxA) || (rxC != rxA * 3)) {
+            wrong++;
+        }
+    }
+    g_byteErrorRate = 0;
+
+    std::cout << "Recovered " << recovered << " of " << NUM_NOISE_FRAMES << " frames, " << g_corruptedBytes <<
+        " corrupted bytes, " << crcErrors << " crc errors" << std::endl;
+
+    CHECK(g_corruptedBytes > 0);
+    CHECK(crcErrors > 0);
+    CHECK(wrong == 0);
+    CHECK(recovered == expected);
+    CHECK(recovered > NUM_NOISE_FRAMES * 9 / 10);
+    CHECK(slaveCom.isConnected() == true);
+
+    TestCaseEnd();
+}
+
 int main(int argc, const char* argv[])
 {
     UnitTestMainBegin();
     RunTest(true, ut_DeepSleep);
     RunTest(true, ut_CrcError);
     RunTest(true, ut_ValueExchange);
+    RunTest(true, ut_DeltaFrames);
+    RunTest(true, ut_NoiseRecovery);
     UnitTestMainEnd();
 }
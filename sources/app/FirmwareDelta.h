@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Block based firmware delta, generated on the host by utilities/fwdelta.py
+ * and applied to the SecCo by app::Stm32Bootloader::flashDelta().
+ *
+ * Images are identified by a 12 byte trailer, appended by the tool to every
+ * image at a word aligned offset, all fields little endian:
+ *   uint32_t magic   0x4d495746 ("FWIM")
+ *   uint32_t length  image length including the trailer
+ *   uint32_t crc     CRC-32 (zlib) of the image bytes before the trailer
+ *
+ * A delta starts with a 24 byte header:
+ *   uint32_t magic        0x4c445746 ("FWDL")
+ *   uint16_t blockSize    multiple of the flash page size of the target
+ *   uint16_t blockCount   number of block records following the header
+ *   uint32_t baseLength   length of the image the delta applies to
+ *   uint32_t baseCrc      crc of its trailer
+ *   uint32_t targetLength length of the resulting image
+ *   uint32_t targetCrc    crc of its trailer
+ * Each record is a uint16_t block index followed by blockSize bytes, padded
+ * with 0xff behind the target image. Records are sorted by index and the
+ * block with the trailer of the target image comes last, so an interrupted
+ * update never leaves a valid trailer behind.
+ */
+namespace app
+{
+namespace FirmwareDelta
+{
+static constexpr uint32_t DELTA_MAGIC = 0x4c445746;
+static constexpr uint32_t TRAILER_MAGIC = 0x4d495746;
+static constexpr size_t HEADER_SIZE = 24;
+static constexpr size_t TRAILER_SIZE = 12;
+static constexpr size_t RECORD_HEADER_SIZE = 2;
+
+struct Header {
+    uint16_t blockSize;
+    uint16_t blockCount;
+    uint32_t baseLength;
+    uint32_t baseCrc;
+    uint32_t targetLength;
+    uint32_t targetCrc;
+};
+
+struct Trailer {
+    uint32_t length;
+    uint32_t crc;
+};
+
+inline uint32_t get(const uint8_t* const in, const size_t bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+/// @return false if delta is truncated or inconsistent
+inline bool readHeader(std::string_view delta, Header& header)
+{
+    const uint8_t* const in = reinterpret_cast<const uint8_t*>(delta.data());
+
+    if ((delta.length() < HEADER_SIZE) || (get(in, 4) != DELTA_MAGIC)) {
+        return false;
+    }
+    header.blockSize = static_cast<uint16_t>(get(in + 4, 2));
+    header.blockCount = static_cast<uint16_t>(get(in + 6, 2));
+    header.baseLength = get(in + 8, 4);
+    header.baseCrc = get(in + 12, 4);
+    header.targetLength = get(in + 16, 4);
+    header.targetCrc = get(in + 20, 4);
+
+    return (header.blockSize != 0) &&
+           (delta.length() ==
+            HEADER_SIZE + static_cast<size_t>(header.blockCount) * (RECORD_HEADER_SIZE + header.blockSize));
+}
+
+/**
+ * @param record index of the record, has to be smaller than blockCount
+ * @return data of the block at offset blockIndex * blockSize of the image
+ */
+inline std::string_view getBlock(std::string_view delta, const Header& header, const size_t record,
+                                 uint16_t& blockIndex)
+{
+    const size_t position = HEADER_SIZE + record * (RECORD_HEADER_SIZE + header.blockSize);
+
+    blockIndex = static_cast<uint16_t>(get(reinterpret_cast<const uint8_t*>(delta.data()) + position, 2));
+    return delta.substr(position + RECORD_HEADER_SIZE, header.blockSize);
+}
+
+/// @return false if in isn't a trailer of an image with length bytes
+inline bool readTrailer(const uint8_t* const in, const uint32_t length, Trailer& trailer)
+{
+    if ((get(in, 4) != TRAILER_MAGIC) || (get(in + 4, 4) != length)) {
+        return false;
+    }
+    trailer.length = length;
+    trailer.crc = get(in + 8, 4);
+    return true;
+}
+
+/// @return true if applying the delta results in image
+inline bool resultsIn(const Header& header, std::string_view image)
+{
+    Trailer trailer;
+
+    return (image.length() == header.targetLength) && (image.length() >= TRAILER_SIZE) &&
+           readTrailer(reinterpret_cast<const uint8_t*>(image.data()) + image.length() - TRAILER_SIZE,
+                       header.targetLength, trailer) && (trailer.crc == header.targetCrc);
+}
+}
+}
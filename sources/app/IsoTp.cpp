@@ -62,6 +62,20 @@ size_t ISOTP::receive_Message(char* buffer, const size_t length, const std::chro
     return 0;
 }
 
+bool ISOTP::sendFrame(void)
+{
+    // The transmit queue drains at bus speed. Wait for a free slot instead of
+    // silently dropping frames of a consecutive frame burst.
+    for (size_t retries = 0; retries < MAX_SEND_RETRIES; retries++) {
+        if (mInterface.send(mCanTxMsg)) {
+            return true;
+        }
+        os::ThisTask::sleep(std::chrono::milliseconds(1));
+    }
+    Trace(ZONE_WARNING, "CAN transmit queue full, frame dropped.\r\n");
+    return false;
+}
+
 size_t ISOTP::send_SF(const std::string_view message)
 {
     if (mSid > 0x7ff) {
@@ -73,8 +87,7 @@ size_t ISOTP::send_SF(const std::string_view message)
     mCanTxMsg.DLC = message.size() + 1;
     mCanTxMsg.Data[0] = (FrameTypes::SINGLE_FRAME << 4) + (message.size() & 0x0f);
     std::memcpy(mCanTxMsg.Data + 1, message.data(), message.size());
-    mInterface.send(mCanTxMsg);
-    return message.size();
+    return sendFrame() ? message.size() : 0;
 }
 
 void ISOTP::send_FF(const std::string_view message)
@@ -89,7 +102,7 @@ void ISOTP::send_FF(const std::string_view message)
     mCanTxMsg.Data[0] = (FrameTypes::FIRST_FRAME << 4) + ((message.size() & 0xf00) >> 8);
     mCanTxMsg.Data[1] = message.size() & 0xff;
     std::memcpy(mCanTxMsg.Data + 2, message.data(), 6);
-    mInterface.send(mCanTxMsg);
+    sendFrame();
 }
 
 void ISOTP::send_FC(const size_t length, const FlowControlStatus& status)
@@ -100,7 +113,7 @@ void ISOTP::send_FC(const size_t length, const FlowControlStatus& status)
     mCanTxMsg.Data[0] = (FrameTypes::FLOW_CONTROL << 4) + (status & 0x0f);
     mCanTxMsg.Data[1] = length / 7;
     mCanTxMsg.Data[2] = std::chrono::milliseconds(1).count();
-    mInterface.send(mCanTxMsg);
+    sendFrame();
 }
 
 size_t ISOTP::send_CF(const std::string_view message)
@@ -114,13 +127,15 @@ size_t ISOTP::send_CF(const std::string_view message)
         if (mSeperationTime.count()) {
             os::ThisTask::sleep(mSeperationTime);
         }
-        const auto framelength = std::min(MAX_SINGLE_FRAME_PAYLOAD, static_cast<uint8_t>(message.size() - index));
+        const auto framelength = static_cast<uint8_t>(std::min<size_t>(MAX_SINGLE_FRAME_PAYLOAD, message.size() - index));
         mCanTxMsg.DLC = framelength + 1;
         std::memset(mCanTxMsg.Data, 0, sizeof(mCanTxMsg.Data));
         mCanTxMsg.Data[0] = (FrameTypes::CONSECUTIVE_FRAME << 4) + sequenzNumber;
         sequenzNumber = (sequenzNumber + 1) & 0x0F;
         std::memcpy(mCanTxMsg.Data + 1, message.data() + index, framelength);
-        mInterface.send(mCanTxMsg);
+        if (!sendFrame()) {
+            return 0;
+        }
         index += framelength;
     }
     return index;
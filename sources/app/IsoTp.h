@@ -8,6 +8,7 @@ class ISOTP
 {
     static constexpr const uint16_t MAX_ISOTP_PAYLOAD = 4095;
     static constexpr const uint8_t MAX_SINGLE_FRAME_PAYLOAD = 7;
+    static constexpr const size_t MAX_SEND_RETRIES = 50;
 
     enum FrameTypes {
         SINGLE_FRAME = 0x00,
@@ -31,6 +32,7 @@ class ISOTP
     size_t mBlockSize;
     size_t mRxMsgLength;
 
+    bool sendFrame(void);
     size_t send_SF(const std::string_view message);
     void send_FF(const std::string_view message);
     size_t send_CF(const std::string_view message);
@@ -21,7 +21,7 @@ static constexpr size_t MEMORYSIZE = 1024;
 uint8_t g_usartMemory[MEMORYSIZE];
 bool g_usartError = false;
 bool g_usartNonBlockingEnabled = false;
-std::function<void(uint8_t)> g_usartCallback;
+utility::Delegate<void(uint8_t)> g_usartCallback;
 
 bool g_gpioState = false;
 
@@ -87,7 +87,7 @@ size_t hal::UsartWithDma::receive(uint8_t* const data, const size_t length, cons
     return g_usartError ? 0 : length;
 }
 
-void hal::Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const
+void hal::Usart::enableNonBlockingReceive(utility::Delegate<void(uint8_t)> callback) const
 {
     g_usartNonBlockingEnabled = true;
     g_usartCallback = callback;
@@ -12,11 +12,13 @@ using app::MotorController;
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
 constexpr std::chrono::milliseconds MotorController::controllerInterval;
+constexpr size_t MotorController::MEASUREMENTS_PER_CONTROL_STEP;
 
 MotorController::MotorController(const dev::SensorBLDC& motor,
                                  const dev::Battery&    battery,
                                  const float            Kp,
-                                 const float            Ki) :
+                                 const float            Ki,
+                                 const ControlLoop      controlLoop) :
     os::DeepSleepModule(),
     mMotorControllerTask("MotorControl",
                          MotorController::STACKSIZE,
@@ -27,6 +29,7 @@ MotorController::MotorController(const dev::SensorBLDC& motor,
 }),
     mMotor(motor),
     mBattery(battery),
+    mControlLoop(controlLoop),
     mController(mCurrentTorque,
                 mOutputTorque,
                 mSetTorque,
@@ -42,7 +45,11 @@ MotorController::MotorController(const dev::SensorBLDC& motor,
     setTorque(0.00001);
     mSetTorque = 0.00001;
 
-    mMotor.mPhaseCurrentSensor.registerValueAvailableSemaphore(&mPhaseCurrentValueAvailable);
+    if (mControlLoop == ControlLoop::INTERRUPT) {
+        mMotor.setNumberOfMeasurementsPerValue(MEASUREMENTS_PER_CONTROL_STEP);
+    } else {
+        mMotor.mPhaseCurrentSensor.registerValueAvailableSemaphore(&mPhaseCurrentValueAvailable);
+    }
 
     mMotor.start();
 }
@@ -50,6 +57,7 @@ MotorController::MotorController(const dev::SensorBLDC& motor,
 void MotorController::enterDeepSleep(void)
 {
     mMotorControllerTask.join();
+    mMotor.mPhaseCurrentSensor.unregisterValueAvailableCallback();
     mMotor.stop();
 }
 
@@ -64,6 +72,21 @@ void MotorController::motorControllerTaskFunction(const bool& join)
     mMotor.calibrate();
     mMotor.setPulsWidthInMill(0);
 
+    if (mControlLoop == ControlLoop::INTERRUPT) {
+        // Sample time and PWM scale have to be valid for the first step
+        outerLoopStep();
+        mMotor.mPhaseCurrentSensor.resetInterruptTiming();
+        mMotor.mPhaseCurrentSensor.registerValueAvailableCallback([this] {
+            this->controlStepFromISR();
+        });
+
+        do {
+            os::ThisTask::sleep(controllerInterval);
+            outerLoopStep();
+        } while (!join);
+        return;
+    }
+
     do {
         float newSetTorque;
         if (mSetTorqueQueue.receive(newSetTorque, 0)) {
@@ -71,7 +94,7 @@ void MotorController::motorControllerTaskFunction(const bool& join)
         }
 
         mCurrentTorque = mMotor.getActualTorqueInNewtonMeter();
-        adjustControllerLimits();
+        adjustControllerLimits(mBattery.getVoltage());
         mController.compute();
         updatePwmOutput();
         updateQuadrant();
@@ -110,9 +133,39 @@ void MotorController::motorControllerTaskFunction(const bool& join)
     } while (!join);
 }
 
-void MotorController::adjustControllerLimits(void)
+void MotorController::outerLoopStep(void)
 {
-    const float MAXIMUM_VOLTAGE = mBattery.getVoltage();
+    float newSetTorque;
+    if (mSetTorqueQueue.receive(newSetTorque, 0)) {
+        mSetTorque = newSetTorque;
+    }
+
+    const float batteryVoltage = mBattery.getVoltage();
+
+    // The interrupt must not compute with half updated limits and tunings
+    os::ThisTask::enterCriticalSection();
+    mMotor.modifyPulsWidthPeriode();
+    // The compare values were scaled to the former period
+    mMotor.setPulsWidthInMillFromISR(mMotor.getActualPulsWidthPerMill());
+    mController.setSampleTime(mMotor.getPhaseCurrentValuePeriode());
+    adjustControllerLimits(batteryVoltage);
+    mPwmPerTorque = mMotor.mMotorCoilResistance / batteryVoltage;
+    os::ThisTask::exitCriticalSection();
+
+    updateQuadrant();
+    mMotor.checkMotor();
+}
+
+void MotorController::controlStepFromISR(void)
+{
+    mCurrentTorque = mMotor.getActualTorqueInNewtonMeter();
+    mController.computeFromISR();
+    mMotor.setPulsWidthInMillFromISR(static_cast<int32_t>(mOutputTorque * mPwmPerTorque));
+}
+
+void MotorController::adjustControllerLimits(const float batteryVoltage)
+{
+    const float MAXIMUM_VOLTAGE = batteryVoltage;
     static constexpr const float MAXIMUM_PULSWIDTH = 1000.0; //because of pwm per mill
     const float MAXIMUM_CONTROLLER_OUTPUT = MAXIMUM_VOLTAGE * MAXIMUM_PULSWIDTH / mMotor.mMotorCoilResistance;
 
@@ -165,3 +218,15 @@ float MotorController::getCurrentRPS(void) const
 {
     return mMotor.getActualRPS();
 }
+
+void MotorController::traceControlLoopBudget(void) const
+{
+    const auto __attribute__((unused)) timing = mMotor.mPhaseCurrentSensor.getInterruptTiming();
+    const uint32_t __attribute__((unused)) maxLoad =
+        (timing.periodCycles > 0) ?
+        static_cast<uint32_t>(static_cast<uint64_t>(timing.maxCycles) * 100 / timing.periodCycles) : 0;
+
+    Trace(ZONE_INFO, "%s loop: %u calls, period %u cycles, last %u cycles, max %u cycles (%u%%), %u overruns\r\n",
+          mControlLoop == ControlLoop::INTERRUPT ? "Interrupt" : "Task",
+          timing.calls, timing.periodCycles, timing.lastCycles, timing.maxCycles, maxLoad, timing.overruns);
+}
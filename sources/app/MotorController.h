@@ -24,6 +24,19 @@ class MotorController final :
 
     static constexpr uint32_t STACKSIZE = 2048;
 
+public:
+    /**
+     * TASK computes the torque controller in the task at controllerInterval.
+     * INTERRUPT computes it in the phase current interrupt, every
+     * MEASUREMENTS_PER_CONTROL_STEP periods of the half bridge PWM, the task
+     * only adapts limits, PWM frequency and direction.
+     */
+    enum class ControlLoop {
+        TASK,
+        INTERRUPT
+    };
+
+private:
     os::TaskInterruptable mMotorControllerTask;
     const dev::SensorBLDC& mMotor;
     const dev::Battery& mBattery;
@@ -31,21 +44,27 @@ class MotorController final :
     float mCurrentTorque = std::numeric_limits<float>::epsilon();
     float mOutputTorque = std::numeric_limits<float>::epsilon();
     float mSetPwm = std::numeric_limits<float>::epsilon();
+    /// Coil resistance / battery voltage, written by the task for the interrupt
+    float mPwmPerTorque = 0;
+    const ControlLoop mControlLoop;
 
     dev::PIDController mController;
 
     os::Queue<float, 1> mSetTorqueQueue;
 
     static constexpr std::chrono::milliseconds controllerInterval = std::chrono::milliseconds(4);
+    static constexpr size_t MEASUREMENTS_PER_CONTROL_STEP = 4;
 
     void motorControllerTaskFunction(const bool&);
+    void outerLoopStep(void);
+    void controlStepFromISR(void);
     void updatePwmOutput(void);
     void updateQuadrant(void);
-    void adjustControllerLimits(void);
+    void adjustControllerLimits(const float batteryVoltage);
 
 public:
     MotorController(const dev::SensorBLDC& motor, const dev::Battery& battery, const float Kp,
-                    const float Ki);
+                    const float Ki, const ControlLoop controlLoop = ControlLoop::TASK);
 
     MotorController(const MotorController&) = delete;
     MotorController(MotorController&&) = delete;
@@ -54,6 +73,10 @@ public:
 
     virtual void setTorque(const float) override;
     virtual float getCurrentRPS(void) const override;
+
+    /// Traces the cycles of the phase current interrupt against its period
+    void traceControlLoopBudget(void) const;
+
     os::Semaphore mPhaseCurrentValueAvailable;
 
 #ifdef UNITTEST
@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include "Stm32Bootloader.h"
+#include "FirmwareDelta.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+using app::Stm32Bootloader;
+
+static const int __attribute__((unused)) g_DebugZones = 0; //ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+constexpr std::array<uint32_t, 4> Stm32Bootloader::BAUD_RATES;
+constexpr std::chrono::milliseconds Stm32Bootloader::COMMAND_TIMEOUT;
+constexpr std::chrono::milliseconds Stm32Bootloader::PAGE_ERASE_TIMEOUT;
+constexpr std::chrono::milliseconds Stm32Bootloader::MASS_ERASE_TIMEOUT;
+
+struct FlashGeometry {
+    uint16_t productId;
+    uint16_t pageSize;
+};
+
+static constexpr std::array<FlashGeometry, 12> Geometries {{
+    {0x412, 1024}, // STM32F10x low density
+    {0x410, 1024}, // STM32F10x medium density
+    {0x414, 2048}, // STM32F10x high density
+    {0x430, 2048}, // STM32F10x XL density
+    {0x418, 2048}, // STM32F10x connectivity line
+    {0x420, 1024}, // STM32F10x value line
+    {0x428, 2048}, // STM32F10x value line high density
+    {0x422, 2048}, // STM32F302xB/C, STM32F303xB/C
+    {0x446, 2048}, // STM32F302xD/E, STM32F303xD/E
+    {0x432, 2048}, // STM32F37x
+    {0x438, 2048}, // STM32F303x6/8, STM32F334
+    {0x439, 2048}, // STM32F301, STM32F302x6/8
+}};
+
+Stm32Bootloader::Stm32Bootloader(Link& link) :
+    mLink(link) {}
+
+uint8_t Stm32Bootloader::checksum(uint8_t const* const data, const size_t length, const uint8_t initValue)
+{
+    uint8_t sum = initValue;
+    for (size_t i = 0; i < length; i++) {
+        sum ^= data[i];
+    }
+    return sum;
+}
+
+bool Stm32Bootloader::receiveAck(const std::chrono::milliseconds timeout)
+{
+    if (!mLink.receive(mResponse, timeout)) {
+        Trace(ZONE_INFO, "Nothing received... \r\n");
+        mResponse = 0;
+        return false;
+    }
+    return mResponse == ACK;
+}
+
+bool Stm32Bootloader::sendCommand(const uint8_t command)
+{
+    const uint8_t frame[] = {command, static_cast<uint8_t>(command ^ 0xff)};
+
+    mLink.discardReceived();
+    mLink.send(frame, sizeof(frame));
+    return receiveAck();
+}
+
+bool Stm32Bootloader::sendAddress(const uint32_t address)
+{
+    uint8_t frame[5] = {static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+                        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+    frame[4] = checksum(frame, 4);
+
+    mLink.send(frame, sizeof(frame));
+    return receiveAck();
+}
+
+bool Stm32Bootloader::synchronize(void)
+{
+    const uint8_t sync = SYNC;
+
+    mLink.discardReceived();
+    mLink.send(&sync, 1);
+    return receiveAck();
+}
+
+bool Stm32Bootloader::identify(void)
+{
+    uint8_t count;
+    uint8_t byte;
+
+    // GET answers with the bootloader version followed by the supported commands
+    if (!sendCommand(GET) || !mLink.receive(count, COMMAND_TIMEOUT)) {
+        return false;
+    }
+    mHasExtendedErase = false;
+    for (size_t i = 0; i <= count; i++) {
+        if (!mLink.receive(byte, COMMAND_TIMEOUT)) {
+            return false;
+        }
+        mHasExtendedErase |= (i > 0) && (byte == EXTENDED_ERASE);
+    }
+    if (!receiveAck()) {
+        return false;
+    }
+
+    if (!sendCommand(GET_ID) || !mLink.receive(count, COMMAND_TIMEOUT)) {
+        return false;
+    }
+    mProductId = 0;
+    for (size_t i = 0; i <= count; i++) {
+        if (!mLink.receive(byte, COMMAND_TIMEOUT)) {
+            return false;
+        }
+        mProductId = static_cast<uint16_t>((mProductId << 8) | byte);
+    }
+    return receiveAck();
+}
+
+bool Stm32Bootloader::connect(void)
+{
+    for (const uint32_t baudRate : BAUD_RATES) {
+        if (baudRate > mBaudRateLimit) {
+            continue;
+        }
+
+        // Autobauding of the bootloader only works on the first byte after reset
+        mLink.setBaudRate(baudRate);
+        mLink.resetToBootloader();
+        if (synchronize() && identify()) {
+            Trace(ZONE_INFO, "Connected with %d baud to 0x%x\r\n", baudRate, mProductId);
+            mBaudRateLimit = baudRate;
+            mStatistics.baudRate = baudRate;
+            return true;
+        }
+    }
+    mBaudRateLimit = BAUD_RATES[0];
+    mStatistics.baudRate = 0;
+    return false;
+}
+
+size_t Stm32Bootloader::getPageSize(void) const
+{
+    for (const auto& geometry : Geometries) {
+        if (geometry.productId == mProductId) {
+            return geometry.pageSize;
+        }
+    }
+    return 0;
+}
+
+size_t Stm32Bootloader::getPage(const uint32_t address) const
+{
+    const size_t pageSize = getPageSize();
+    return pageSize != 0 ? (address - FLASH_BASE_ADDRESS) / pageSize : 0;
+}
+
+bool Stm32Bootloader::read(const uint32_t address, uint8_t* const data, const size_t length)
+{
+    size_t offset = 0;
+
+    while (offset < length) {
+        const size_t chunk = std::min(BLOCK_SIZE, length - offset);
+        const uint8_t count[] = {static_cast<uint8_t>(chunk - 1), static_cast<uint8_t>((chunk - 1) ^ 0xff)};
+
+        if (!sendCommand(READ_MEMORY) || !sendAddress(address + offset)) {
+            return false;
+        }
+        mLink.send(count, sizeof(count));
+        if (!receiveAck()) {
+            return false;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            if (!mLink.receive(data[offset + i], COMMAND_TIMEOUT)) {
+                return false;
+            }
+        }
+        offset += chunk;
+        mStatistics.blocksRead++;
+    }
+    return true;
+}
+
+bool Stm32Bootloader::compare(std::string_view image, const uint32_t address, PageSet& changed)
+{
+    const size_t pageSize = getPageSize();
+    size_t offset = 0;
+
+    changed.reset();
+    while (offset < image.length()) {
+        const size_t page = getPage(address + offset);
+        if ((pageSize == 0) || (page >= MAX_PAGES)) {
+            return false;
+        }
+
+        const size_t pageEnd = FLASH_BASE_ADDRESS + (page + 1) * pageSize - address;
+        const size_t length = std::min({BLOCK_SIZE, pageEnd - offset, image.length() - offset});
+        if (!read(address + offset, mReadBuffer.data(), length)) {
+            return false;
+        }
+
+        // The first difference decides, the rest of the page isn't read back
+        if (std::memcmp(mReadBuffer.data(), image.data() + offset, length) != 0) {
+            changed.set(page);
+            offset = pageEnd;
+        } else {
+            offset += length;
+        }
+    }
+    return true;
+}
+
+bool Stm32Bootloader::erase(const PageSet& pages)
+{
+    const size_t count = pages.count();
+
+    if (count == 0) {
+        return true;
+    }
+    if (count == MAX_PAGES) {
+        return eraseAll();
+    }
+
+    Trace(ZONE_INFO, "Erasing %u pages... ", static_cast<unsigned>(count));
+    if (!sendCommand(mHasExtendedErase ? EXTENDED_ERASE : ERASE)) {
+        return false;
+    }
+
+    // Page numbers are 16 bit big endian for the extended erase and 8 bit otherwise
+    const size_t width = mHasExtendedErase ? 2 : 1;
+    uint8_t sum = 0;
+    uint8_t number[2] = {static_cast<uint8_t>((count - 1) >> 8), static_cast<uint8_t>(count - 1)};
+    mLink.send(number + 2 - width, width);
+    sum = checksum(number + 2 - width, width, sum);
+
+    for (size_t page = 0; page < MAX_PAGES; page++) {
+        if (pages[page]) {
+            number[0] = static_cast<uint8_t>(page >> 8);
+            number[1] = static_cast<uint8_t>(page);
+            mLink.send(number + 2 - width, width);
+            sum = checksum(number + 2 - width, width, sum);
+        }
+    }
+    mLink.send(&sum, 1);
+
+    if (!receiveAck(COMMAND_TIMEOUT + PAGE_ERASE_TIMEOUT * count)) {
+        return false;
+    }
+    mStatistics.pagesErased += count;
+    return true;
+}
+
+bool Stm32Bootloader::eraseAll(void)
+{
+    static constexpr const uint8_t GlobalErase[] = {0xff, 0x00};
+    static constexpr const uint8_t ExtendedMassErase[] = {0xff, 0xff, 0x00};
+
+    Trace(ZONE_INFO, "Sending global erase... ");
+    if (!sendCommand(mHasExtendedErase ? EXTENDED_ERASE : ERASE)) {
+        return false;
+    }
+    if (mHasExtendedErase) {
+        mLink.send(ExtendedMassErase, sizeof(ExtendedMassErase));
+    } else {
+        mLink.send(GlobalErase, sizeof(GlobalErase));
+    }
+    return receiveAck(MASS_ERASE_TIMEOUT);
+}
+
+bool Stm32Bootloader::readoutUnprotect(void)
+{
+    Trace(ZONE_INFO, "Sending readout unprotect command... ");
+
+    // The second ACK follows the mass erase, afterwards the target resets
+    if (!sendCommand(READOUT_UNPROTECT) || !receiveAck(MASS_ERASE_TIMEOUT)) {
+        return false;
+    }
+    mLink.resetToBootloader();
+    return synchronize() && identify();
+}
+
+bool Stm32Bootloader::nextBlock(std::string_view data, const uint32_t address, const PageSet& pages,
+                                size_t& offset) const
+{
+    for ( ; offset < data.length(); offset += BLOCK_SIZE) {
+        const size_t length = std::min(BLOCK_SIZE, data.length() - offset);
+        const bool erased = std::all_of(data.begin() + offset, data.begin() + offset + length,
+                                        [](const char c) { return static_cast<uint8_t>(c) == 0xff; });
+
+        const size_t page = getPage(address + offset);
+
+        if ((page < MAX_PAGES ? pages[page] : pages.all()) && !erased) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Stm32Bootloader::prepareFrame(WriteFrame& frame, std::string_view data, const uint32_t address,
+                                   const size_t offset) const
+{
+    const uint32_t destination = address + offset;
+    const size_t length = std::min(BLOCK_SIZE, data.length() - offset);
+
+    // The bootloader writes words, so the tail is padded with erased bytes
+    const size_t padded = (length + 3) & ~static_cast<size_t>(3);
+
+    frame.address[0] = static_cast<uint8_t>(destination >> 24);
+    frame.address[1] = static_cast<uint8_t>(destination >> 16);
+    frame.address[2] = static_cast<uint8_t>(destination >> 8);
+    frame.address[3] = static_cast<uint8_t>(destination);
+    frame.address[4] = checksum(frame.address.data(), 4);
+
+    frame.data[0] = static_cast<uint8_t>(padded - 1);
+    std::memcpy(frame.data.data() + 1, data.data() + offset, length);
+    std::memset(frame.data.data() + 1 + length, 0xff, padded - length);
+    frame.data[1 + padded] = checksum(frame.data.data(), 1 + padded);
+    frame.length = padded + 2;
+}
+
+bool Stm32Bootloader::write(const uint32_t address, std::string_view data, const PageSet& pages)
+{
+    size_t offset = 0;
+    size_t current = 0;
+
+    if (!nextBlock(data, address, pages, offset)) {
+        return true;
+    }
+    prepareFrame(mFrames[current], data, address, offset);
+
+    for ( ; ; ) {
+        const WriteFrame& frame = mFrames[current];
+
+        if (!sendCommand(WRITE_MEMORY)) {
+            return false;
+        }
+        mLink.send(frame.address.data(), frame.address.size());
+        if (!receiveAck()) {
+            return false;
+        }
+        mLink.send(frame.data.data(), frame.length);
+
+        // The target programs the block now, meanwhile the next frame is prepared
+        offset += BLOCK_SIZE;
+        const bool hasNext = nextBlock(data, address, pages, offset);
+        if (hasNext) {
+            prepareFrame(mFrames[current ^ 1], data, address, offset);
+        }
+
+        if (!receiveAck()) {
+            return false;
+        }
+        mStatistics.blocksWritten++;
+
+        if (!hasNext) {
+            return true;
+        }
+        current ^= 1;
+    }
+}
+
+bool Stm32Bootloader::go(const uint32_t address)
+{
+    Trace(ZONE_INFO, "Sending go command... ");
+    return sendCommand(GO) && sendAddress(address);
+}
+
+bool Stm32Bootloader::programAndStart(std::string_view image, const uint32_t address)
+{
+    const size_t firstPage = getPage(address);
+    const size_t lastPage = getPage(address + image.length() - 1);
+    PageSet changed;
+
+    if ((getPageSize() == 0) || (lastPage >= MAX_PAGES)) {
+        Trace(ZONE_INFO, "Unknown flash layout of 0x%x\r\n", mProductId);
+        changed.set();
+        if (!eraseAll()) {
+            return false;
+        }
+    } else if (compare(image, address, changed)) {
+        mStatistics.pagesSkipped = static_cast<uint16_t>(lastPage - firstPage + 1 - changed.count());
+        if (!erase(changed)) {
+            return false;
+        }
+    } else {
+        // Reading is refused while the readout protection is active
+        if ((mResponse != NACK) || !readoutUnprotect()) {
+            return false;
+        }
+        for (size_t page = firstPage; page <= lastPage; page++) {
+            changed.set(page);
+        }
+    }
+
+    return write(address, image, changed) && go(address);
+}
+
+bool Stm32Bootloader::flash(std::string_view image, const uint32_t address)
+{
+    Trace(ZONE_INFO, "Flash 0x%x bytes. \r\n", static_cast<unsigned>(image.length()));
+
+    mStatistics = Statistics {};
+    if (image.empty()) {
+        return false;
+    }
+
+    while (connect()) {
+        if (programAndStart(image, address)) {
+            return true;
+        }
+
+        // A rate that answered GET may still corrupt long frames
+        const auto lower = std::find(BAUD_RATES.begin(), BAUD_RATES.end(), mBaudRateLimit) + 1;
+        if (lower >= BAUD_RATES.end()) {
+            break;
+        }
+        mBaudRateLimit = *lower;
+    }
+    return false;
+}
+
+bool Stm32Bootloader::flashDelta(std::string_view delta, const uint32_t address)
+{
+    FirmwareDelta::Header header;
+    FirmwareDelta::Trailer trailer;
+    uint8_t installed[FirmwareDelta::TRAILER_SIZE];
+    uint16_t index;
+
+    mStatistics = Statistics {};
+    if (!FirmwareDelta::readHeader(delta, header) || (header.baseLength < FirmwareDelta::TRAILER_SIZE) ||
+        !connect())
+    {
+        return false;
+    }
+
+    const size_t pageSize = getPageSize();
+    if ((pageSize == 0) || (header.blockSize % pageSize != 0)) {
+        Trace(ZONE_INFO, "Delta blocks don't fit the pages of 0x%x\r\n", mProductId);
+        return false;
+    }
+
+    // The trailer identifies the installed image without reading all of it
+    if (!read(address + header.baseLength - FirmwareDelta::TRAILER_SIZE, installed, sizeof(installed)) ||
+        !FirmwareDelta::readTrailer(installed, header.baseLength, trailer) || (trailer.crc != header.baseCrc))
+    {
+        Trace(ZONE_INFO, "Installed image isn't the base of the delta\r\n");
+        return false;
+    }
+
+    PageSet changed;
+    for (size_t record = 0; record < header.blockCount; record++) {
+        FirmwareDelta::getBlock(delta, header, record, index);
+        const size_t firstPage = getPage(address + index * header.blockSize);
+        const size_t lastPage = firstPage + header.blockSize / pageSize - 1;
+        if (lastPage >= MAX_PAGES) {
+            return false;
+        }
+        for (size_t page = firstPage; page <= lastPage; page++) {
+            changed.set(page);
+        }
+    }
+    const size_t pages = (std::max(header.baseLength, header.targetLength) + pageSize - 1) / pageSize;
+    mStatistics.pagesSkipped = static_cast<uint16_t>(pages - std::min(pages, changed.count()));
+
+    // Erasing invalidates the trailer before any block is written, the new
+    // trailer is part of the last record
+    if (!erase(changed)) {
+        return false;
+    }
+    for (size_t record = 0; record < header.blockCount; record++) {
+        const std::string_view block = FirmwareDelta::getBlock(delta, header, record, index);
+        if (!write(address + index * header.blockSize, block, changed)) {
+            return false;
+        }
+    }
+    return go(address);
+}
+
+Stm32Bootloader::Statistics Stm32Bootloader::getStatistics(void) const
+{
+    return mStatistics;
+}
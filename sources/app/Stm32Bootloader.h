@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace app
+{
+/**
+ * Host side of the USART protocol of the STM32 ROM bootloader (AN3155).
+ *
+ * flash() only erases and writes the pages whose read-back differs from the
+ * image. Blocks are written pipelined: while the target programs one block,
+ * the frame of the next block is prepared, so the wire never waits for the
+ * host. The baud rate is negotiated on connect(), starting with the highest
+ * rate and falling back until a GET command is answered correctly.
+ */
+class Stm32Bootloader
+{
+public:
+    /// Connection to the target, implemented by the owner of the interface
+    class Link
+    {
+    public:
+        virtual ~Link(void) = default;
+
+        /// Power cycles the target into its ROM bootloader
+        virtual void resetToBootloader(void) = 0;
+        virtual void setBaudRate(const uint32_t baudRate) = 0;
+        virtual void send(uint8_t const* const data, const size_t length) = 0;
+        virtual bool receive(uint8_t& byte, const std::chrono::milliseconds timeout) = 0;
+        virtual void discardReceived(void) = 0;
+    };
+
+    static constexpr uint32_t FLASH_BASE_ADDRESS = 0x08000000;
+    static constexpr size_t BLOCK_SIZE = 256;
+    static constexpr size_t MAX_PAGES = 256;
+    static constexpr std::array<uint32_t, 4> BAUD_RATES {{460800, 230400, 115200, 57600}};
+
+    using PageSet = std::bitset<MAX_PAGES>;
+
+    struct Statistics {
+        uint32_t baudRate;
+        uint16_t pagesErased;
+        uint16_t pagesSkipped;
+        uint16_t blocksWritten;
+        uint16_t blocksRead;
+    };
+
+    explicit Stm32Bootloader(Link& link);
+
+    Stm32Bootloader(const Stm32Bootloader&) = delete;
+    Stm32Bootloader(Stm32Bootloader&&) = delete;
+    Stm32Bootloader& operator=(const Stm32Bootloader&) = delete;
+    Stm32Bootloader& operator=(Stm32Bootloader&&) = delete;
+
+    /**
+     * Resets the target and negotiates the baud rate. Later connects start
+     * at the last working rate.
+     */
+    bool connect(void);
+
+    /// Programs image to address and starts it, retries at lower baud rates
+    bool flash(std::string_view image, const uint32_t address);
+
+    /**
+     * Applies a FirmwareDelta to the image installed at address and starts it.
+     * Only the trailer of the installed image is read back.
+     * @return false if the installed image isn't the base of the delta or the
+     *         update failed, the caller falls back to flash() then
+     */
+    bool flashDelta(std::string_view delta, const uint32_t address);
+
+    bool read(const uint32_t address, uint8_t* const data, const size_t length);
+    bool erase(const PageSet& pages);
+    bool eraseAll(void);
+
+    /**
+     * Writes data to erased flash. Blocks of pages outside of pages and
+     * blocks that are completely erased (0xff) are skipped.
+     */
+    bool write(const uint32_t address, std::string_view data, const PageSet& pages);
+    bool go(const uint32_t address);
+
+    /// @return 0 if the target is unknown, flash() then erases the whole chip
+    size_t getPageSize(void) const;
+    size_t getPage(const uint32_t address) const;
+
+    /// Marks the pages of image whose read-back differs
+    bool compare(std::string_view image, const uint32_t address, PageSet& changed);
+
+    Statistics getStatistics(void) const;
+
+private:
+    static constexpr uint8_t ACK = 0x79;
+    static constexpr uint8_t NACK = 0x1f;
+    static constexpr uint8_t SYNC = 0x7f;
+    static constexpr uint8_t GET = 0x00;
+    static constexpr uint8_t GET_ID = 0x02;
+    static constexpr uint8_t READ_MEMORY = 0x11;
+    static constexpr uint8_t GO = 0x21;
+    static constexpr uint8_t WRITE_MEMORY = 0x31;
+    static constexpr uint8_t ERASE = 0x43;
+    static constexpr uint8_t EXTENDED_ERASE = 0x44;
+    static constexpr uint8_t READOUT_UNPROTECT = 0x92;
+
+    static constexpr std::chrono::milliseconds COMMAND_TIMEOUT {100};
+    static constexpr std::chrono::milliseconds PAGE_ERASE_TIMEOUT {50};
+    static constexpr std::chrono::milliseconds MASS_ERASE_TIMEOUT {2000};
+
+    struct WriteFrame {
+        std::array<uint8_t, 5> address;
+        std::array<uint8_t, 1 + BLOCK_SIZE + 1> data;
+        size_t length;
+    };
+
+    Link& mLink;
+    uint32_t mBaudRateLimit = BAUD_RATES[0];
+    uint16_t mProductId = 0;
+    bool mHasExtendedErase = false;
+    uint8_t mResponse = 0;
+    Statistics mStatistics {};
+    std::array<WriteFrame, 2> mFrames;
+    std::array<uint8_t, BLOCK_SIZE> mReadBuffer;
+
+    bool synchronize(void);
+    bool identify(void);
+    bool sendCommand(const uint8_t command);
+    bool sendAddress(const uint32_t address);
+    bool receiveAck(const std::chrono::milliseconds timeout = COMMAND_TIMEOUT);
+    bool readoutUnprotect(void);
+    bool programAndStart(std::string_view image, const uint32_t address);
+    bool nextBlock(std::string_view data, const uint32_t address, const PageSet& pages, size_t& offset) const;
+    void prepareFrame(WriteFrame& frame, std::string_view data, const uint32_t address, const size_t offset) const;
+
+    static uint8_t checksum(uint8_t const* const data, const size_t length, const uint8_t initValue = 0);
+};
+}
@@ -0,0 +1,680 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "unittest.h"
+#include "Stm32Bootloader.h"
+#include "FirmwareDelta.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+using app::Stm32Bootloader;
+namespace FirmwareDelta = app::FirmwareDelta;
+
+//--------------------------BUFFERS--------------------------
+
+static constexpr uint32_t FLASH_BASE = Stm32Bootloader::FLASH_BASE_ADDRESS;
+
+static std::string makeImage(const size_t length, const unsigned int seed)
+{
+    std::string image(length, '\0');
+    std::srand(seed);
+    for (auto& c : image) {
+        c = static_cast<char>(std::rand());
+    }
+    return image;
+}
+
+static void put(std::string& out, const uint32_t value, const size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+/// CRC-32 as computed by zlib and utilities/fwdelta.py
+static uint32_t crc32(std::string_view data)
+{
+    uint32_t crc = 0xffffffff;
+    for (const char c : data) {
+        crc ^= static_cast<uint8_t>(c);
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+/// Appends the trailer, like fwdelta.py stamp
+static std::string stamp(std::string image)
+{
+    image.append((4 - image.length() % 4) % 4, '\xff');
+    const uint32_t crc = crc32(image);
+    put(image, FirmwareDelta::TRAILER_MAGIC, 4);
+    put(image, image.length() + 8, 4);
+    put(image, crc, 4);
+    return image;
+}
+
+static std::string getBlock(const std::string& image, const size_t index, const size_t blockSize)
+{
+    std::string block = index * blockSize < image.length() ? image.substr(index * blockSize, blockSize) : "";
+    block.append(blockSize - block.length(), '\xff');
+    return block;
+}
+
+/// Generates the delta of two stamped images, like fwdelta.py diff
+static std::string makeDelta(const std::string& base, const std::string& target, const size_t blockSize)
+{
+    const size_t blocks = (std::max(base.length(), target.length()) + blockSize - 1) / blockSize;
+    const size_t trailerBlock = (target.length() - 1) / blockSize;
+    std::vector<size_t> changed;
+
+    for (size_t i = 0; i < blocks; i++) {
+        if ((i != trailerBlock) && (getBlock(base, i, blockSize) != getBlock(target, i, blockSize))) {
+            changed.push_back(i);
+        }
+    }
+    changed.push_back(trailerBlock);
+
+    std::string delta;
+    put(delta, FirmwareDelta::DELTA_MAGIC, 4);
+    put(delta, blockSize, 2);
+    put(delta, changed.size(), 2);
+    put(delta, base.length(), 4);
+    put(delta, crc32(std::string_view(base).substr(0, base.length() - FirmwareDelta::TRAILER_SIZE)), 4);
+    put(delta, target.length(), 4);
+    put(delta, crc32(std::string_view(target).substr(0, target.length() - FirmwareDelta::TRAILER_SIZE)), 4);
+    for (const size_t i : changed) {
+        put(delta, i, 2);
+        delta += getBlock(target, i, blockSize);
+    }
+    return delta;
+}
+
+//--------------------------MOCKING--------------------------
+
+/**
+ * ROM bootloader on the other side of the link. Parses the byte stream like
+ * the target, independent of how the host splits its sends.
+ */
+class SimulatedBootloader final :
+    public Stm32Bootloader::Link
+{
+    enum class State {
+        STOPPED,
+        SYNC,
+        COMMAND,
+        ADDRESS,
+        READ_COUNT,
+        WRITE_COUNT,
+        WRITE_DATA,
+        ERASE_COUNT,
+        ERASE_PAGES,
+        EXTENDED_ERASE_COUNT,
+        EXTENDED_ERASE_PAGES,
+        MASS_ERASE,
+    };
+
+    State mState = State::STOPPED;
+    size_t mNeed = 0;
+    std::vector<uint8_t> mInput;
+    std::deque<uint8_t> mOutput;
+    uint32_t mBaudRate = 0;
+    bool mCorrupted = false;
+    uint8_t mCommand = 0;
+    uint32_t mAddress = 0;
+    size_t mCount = 0;
+    uint8_t mCountChecksum = 0;
+
+    void expect(const State state, const size_t need)
+    {
+        mState = state;
+        mNeed = need;
+    }
+
+    void reply(const std::vector<uint8_t>& bytes)
+    {
+        mOutput.insert(mOutput.end(), bytes.begin(), bytes.end());
+    }
+
+    static uint8_t xorOf(const std::vector<uint8_t>& bytes, const size_t length)
+    {
+        uint8_t sum = 0;
+        for (size_t i = 0; i < length; i++) {
+            sum ^= bytes[i];
+        }
+        return sum;
+    }
+
+    void erasePage(const size_t page)
+    {
+        if ((page + 1) * pageSize <= memory.size()) {
+            std::fill(memory.begin() + page * pageSize, memory.begin() + (page + 1) * pageSize, 0xff);
+            pageErases++;
+        }
+    }
+
+    void eraseAll(void)
+    {
+        std::fill(memory.begin(), memory.end(), 0xff);
+        massErases++;
+    }
+
+    void onCommand(void)
+    {
+        static constexpr uint8_t ACK = 0x79;
+        static constexpr uint8_t NACK = 0x1f;
+
+        switch (mState) {
+        case State::STOPPED:
+            break;
+
+        case State::SYNC:
+            if (mInput[0] == 0x7f) {
+                reply({ACK});
+                expect(State::COMMAND, 2);
+            }
+            break;
+
+        case State::COMMAND:
+            mCommand = mInput[0];
+            expect(State::COMMAND, 2);
+            if (mInput[1] != (mCommand ^ 0xff)) {
+                reply({NACK});
+            } else if (mCommand == 0x00) {
+                reply({ACK, 9, 0x22, 0x00, 0x01, 0x02, 0x11, 0x21, 0x31,
+                       static_cast<uint8_t>(extendedErase ? 0x44 : 0x43), 0x63, 0x92, ACK});
+            } else if (mCommand == 0x02) {
+                reply({ACK, 1, static_cast<uint8_t>(productId >> 8), static_cast<uint8_t>(productId), ACK});
+            } else if (readoutProtected && (mCommand != 0x92)) {
+                reply({NACK});
+            } else if ((mCommand == 0x11) || (mCommand == 0x21) || (mCommand == 0x31)) {
+                reply({ACK});
+                expect(State::ADDRESS, 5);
+            } else if ((mCommand == 0x43) && !extendedErase) {
+                reply({ACK});
+                expect(State::ERASE_COUNT, 1);
+            } else if ((mCommand == 0x44) && extendedErase) {
+                reply({ACK});
+                expect(State::EXTENDED_ERASE_COUNT, 2);
+            } else if (mCommand == 0x92) {
+                eraseAll();
+                readoutProtected = false;
+                reply({ACK, ACK});
+                expect(State::STOPPED, 0);
+            } else {
+                reply({NACK});
+            }
+            break;
+
+        case State::ADDRESS:
+            mAddress = (mInput[0] << 24) | (mInput[1] << 16) | (mInput[2] << 8) | mInput[3];
+            if ((xorOf(mInput, 4) != mInput[4]) || (mAddress < FLASH_BASE) ||
+                (mAddress >= FLASH_BASE + memory.size()))
+            {
+                reply({NACK});
+                expect(State::COMMAND, 2);
+            } else if (mCommand == 0x21) {
+                startAddress = mAddress;
+                reply({ACK});
+                expect(State::STOPPED, 0);
+            } else {
+                reply({ACK});
+                expect(mCommand == 0x11 ? State::READ_COUNT : State::WRITE_COUNT, mCommand == 0x11 ? 2 : 1);
+            }
+            break;
+
+        case State::READ_COUNT:
+            expect(State::COMMAND, 2);
+            if (mInput[1] != (mInput[0] ^ 0xff)) {
+                reply({NACK});
+            } else {
+                reply({ACK});
+                const size_t offset = mAddress - FLASH_BASE;
+                mOutput.insert(mOutput.end(), memory.begin() + offset, memory.begin() + offset + mInput[0] + 1);
+            }
+            break;
+
+        case State::WRITE_COUNT:
+            mCount = mInput[0] + 1;
+            expect(State::WRITE_DATA, mCount + 1);
+            break;
+
+        case State::WRITE_DATA:
+            expect(State::COMMAND, 2);
+            if (blocksWritten >= writeLimit) {
+                // Power loss, the block isn't programmed anymore
+                expect(State::STOPPED, 0);
+                break;
+            }
+            if ((xorOf(mInput, mCount) ^ static_cast<uint8_t>(mCount - 1)) != mInput[mCount]) {
+                reply({NACK});
+                break;
+            }
+            for (size_t i = 0; i < mCount; i++) {
+                uint8_t& cell = memory[mAddress - FLASH_BASE + i];
+
+                // Programming only clears bits, words have to be erased before
+                programmingErrors += (cell != 0xff) && (mInput[i] != 0xff);
+                cell &= mInput[i];
+            }
+            programmingErrors += (mCount % 4) != 0;
+            blocksWritten++;
+            reply({ACK});
+            break;
+
+        case State::ERASE_COUNT:
+            mCount = mInput[0] + 1;
+            if (mInput[0] == 0xff) {
+                expect(State::MASS_ERASE, 1);
+            } else {
+                expect(State::ERASE_PAGES, mCount + 1);
+            }
+            break;
+
+        case State::ERASE_PAGES:
+            expect(State::COMMAND, 2);
+            if ((xorOf(mInput, mCount) ^ static_cast<uint8_t>(mCount - 1)) != mInput[mCount]) {
+                reply({NACK});
+                break;
+            }
+            for (size_t i = 0; i < mCount; i++) {
+                erasePage(mInput[i]);
+            }
+            reply({ACK});
+            break;
+
+        case State::EXTENDED_ERASE_COUNT:
+            mCount = ((mInput[0] << 8) | mInput[1]) + 1;
+            if (mCount == 0x10000) {
+                expect(State::MASS_ERASE, 1);
+            } else {
+                mCountChecksum = mInput[0] ^ mInput[1];
+                expect(State::EXTENDED_ERASE_PAGES, mCount * 2 + 1);
+            }
+            break;
+
+        case State::EXTENDED_ERASE_PAGES:
+            expect(State::COMMAND, 2);
+            if ((xorOf(mInput, mCount * 2) ^ mCountChecksum) != mInput[mCount * 2]) {
+                reply({NACK});
+                break;
+            }
+            for (size_t i = 0; i < mCount; i++) {
+                erasePage((mInput[2 * i] << 8) | mInput[2 * i + 1]);
+            }
+            reply({ACK});
+            break;
+
+        case State::MASS_ERASE:
+            expect(State::COMMAND, 2);
+            if (mInput[0] != 0x00) {
+                reply({NACK});
+                break;
+            }
+            eraseAll();
+            reply({ACK});
+            break;
+        }
+        mInput.clear();
+    }
+
+public:
+    std::vector<uint8_t> memory;
+    size_t pageSize = 1024;
+    uint16_t productId = 0x410;
+    bool extendedErase = false;
+    bool readoutProtected = false;
+    uint32_t maxBaudRate = 115200;
+
+    size_t resets = 0;
+    size_t pageErases = 0;
+    size_t massErases = 0;
+    size_t blocksWritten = 0;
+    size_t programmingErrors = 0;
+    size_t writeLimit = SIZE_MAX;
+    size_t bytesOnWire = 0;
+    uint32_t startAddress = 0;
+
+    SimulatedBootloader(const size_t flashSize = 64 * 1024) :
+        memory(flashSize, 0xff) {}
+
+    void resetToBootloader(void) override
+    {
+        resets++;
+        mInput.clear();
+        mOutput.clear();
+        mCorrupted = mBaudRate > maxBaudRate;
+        expect(State::SYNC, 1);
+    }
+
+    void setBaudRate(const uint32_t baudRate) override
+    {
+        mBaudRate = baudRate;
+    }
+
+    void send(uint8_t const* const data, const size_t length) override
+    {
+        bytesOnWire += length;
+        for (size_t i = 0; i < length; i++) {
+            if (mState == State::STOPPED) {
+                continue;
+            }
+
+            // Autobauding still locks on the sync byte, the bytes after it
+            // are sampled with the wrong bit timing
+            const bool isSync = mState == State::SYNC;
+            mInput.push_back(mCorrupted && !isSync ? data[i] ^ 0x24 : data[i]);
+            if (mInput.size() == mNeed) {
+                onCommand();
+            }
+        }
+    }
+
+    bool receive(uint8_t& byte, const std::chrono::milliseconds) override
+    {
+        if (mOutput.empty()) {
+            return false;
+        }
+        byte = mOutput.front();
+        mOutput.pop_front();
+        bytesOnWire++;
+        return true;
+    }
+
+    void discardReceived(void) override
+    {
+        mOutput.clear();
+    }
+
+    bool contains(const std::string& image) const
+    {
+        return std::memcmp(memory.data(), image.data(), image.length()) == 0;
+    }
+};
+
+//-------------------------TESTCASES-------------------------
+
+int ut_BaudRateNegotiation(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    Stm32Bootloader bootloader(target);
+
+    // 460800 and 230400 answer the sync byte, but not GET
+    CHECK(bootloader.connect());
+    CHECK(bootloader.getStatistics().baudRate == 115200);
+    CHECK(target.resets == 3);
+    CHECK(bootloader.getPageSize() == 1024);
+
+    // Later connects start at the working rate
+    CHECK(bootloader.connect());
+    CHECK(target.resets == 4);
+
+    target.maxBaudRate = 9600;
+    CHECK(!bootloader.connect());
+    CHECK(bootloader.getStatistics().baudRate == 0);
+
+    TestCaseEnd();
+}
+
+int ut_FlashChangedPagesOnly(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    Stm32Bootloader bootloader(target);
+
+    // Odd length, the last block is padded to whole words
+    std::string image = makeImage(10 * 1024 - 3, 1);
+    std::fill(image.begin() + 2048, image.begin() + 2048 + 512, '\xff');
+
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(target.contains(image));
+    CHECK(target.startAddress == FLASH_BASE);
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.massErases == 0);
+    CHECK(target.pageErases == 10);
+    CHECK(bootloader.getStatistics().pagesErased == 10);
+
+    // Erased blocks aren't written
+    CHECK(target.blocksWritten == 40 - 2);
+
+    const size_t fullTransfer = target.bytesOnWire;
+    target.pageErases = 0;
+    target.blocksWritten = 0;
+    target.bytesOnWire = 0;
+    image[5000] ^= 0x01;
+    image[5001] ^= 0x80;
+
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(target.contains(image));
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.pageErases == 1);
+    CHECK(target.blocksWritten == 4);
+    CHECK(bootloader.getStatistics().pagesSkipped == 9);
+    CHECK(bootloader.getStatistics().blocksWritten == 4);
+    CHECK(target.bytesOnWire < fullTransfer);
+
+    // Nothing to do for an identical image, it is started anyway
+    target.pageErases = 0;
+    target.blocksWritten = 0;
+    target.startAddress = 0;
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(target.pageErases == 0);
+    CHECK(target.blocksWritten == 0);
+    CHECK(target.startAddress == FLASH_BASE);
+
+    TestCaseEnd();
+}
+
+int ut_ExtendedErase(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target(256 * 1024);
+    target.productId = 0x446;
+    target.pageSize = 2048;
+    target.extendedErase = true;
+    Stm32Bootloader bootloader(target);
+
+    const std::string image = makeImage(200 * 1024, 2);
+    std::fill(target.memory.begin(), target.memory.begin() + image.length(), 0);
+    std::memcpy(target.memory.data(), image.data(), image.length());
+    target.memory[150 * 1024] = 0;
+    target.memory[3 * 2048 + 17] = 0;
+
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(bootloader.getPageSize() == 2048);
+    CHECK(target.contains(image));
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.pageErases == 2);
+    CHECK(target.blocksWritten == 16);
+    CHECK(bootloader.getStatistics().pagesSkipped == 98);
+
+    TestCaseEnd();
+}
+
+int ut_ReadoutProtection(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    target.readoutProtected = true;
+    std::fill(target.memory.begin(), target.memory.end(), 0x5a);
+    Stm32Bootloader bootloader(target);
+
+    const std::string image = makeImage(3000, 3);
+
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(!target.readoutProtected);
+    CHECK(target.massErases == 1);
+    CHECK(target.pageErases == 0);
+    CHECK(target.contains(image));
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.startAddress == FLASH_BASE);
+
+    TestCaseEnd();
+}
+
+int ut_UnknownTarget(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    target.productId = 0x499;
+    std::fill(target.memory.begin(), target.memory.end(), 0x00);
+    Stm32Bootloader bootloader(target);
+
+    const std::string image = makeImage(5000, 4);
+
+    CHECK(bootloader.flash(image, FLASH_BASE));
+    CHECK(bootloader.getPageSize() == 0);
+    CHECK(target.massErases == 1);
+    CHECK(target.contains(image));
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.blocksWritten == 20);
+
+    TestCaseEnd();
+}
+
+int ut_DeltaUpdate(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    Stm32Bootloader bootloader(target);
+
+    const std::string base = stamp(makeImage(20000, 5));
+    std::string next = makeImage(20000, 5);
+    next[100] ^= 0x10;
+    next[9000] ^= 0x01;
+    next.append("appended function");
+    const std::string update = stamp(next);
+    const std::string delta = makeDelta(base, update, 2048);
+
+    FirmwareDelta::Header header;
+    CHECK(FirmwareDelta::readHeader(delta, header));
+    CHECK(header.blockCount == 3);
+    CHECK(FirmwareDelta::resultsIn(header, update));
+    CHECK(!FirmwareDelta::resultsIn(header, base));
+
+    CHECK(bootloader.flash(base, FLASH_BASE));
+    CHECK(target.contains(base));
+
+    target.pageErases = 0;
+    target.blocksWritten = 0;
+    target.startAddress = 0;
+    CHECK(bootloader.flashDelta(delta, FLASH_BASE));
+    CHECK(target.contains(update));
+    CHECK(target.programmingErrors == 0);
+    CHECK(target.startAddress == FLASH_BASE);
+
+    // Three blocks of two 1 KiB pages, only the trailer was read back
+    CHECK(target.pageErases == 6);
+    CHECK(bootloader.getStatistics().blocksRead == 1);
+    CHECK(bootloader.getStatistics().pagesSkipped == 20 - 6);
+
+    // The result is the base of the next delta
+    const std::string shrunk = stamp(makeImage(6000, 6));
+    CHECK(bootloader.flashDelta(makeDelta(update, shrunk, 2048), FLASH_BASE));
+    CHECK(target.contains(shrunk));
+    CHECK(target.programmingErrors == 0);
+
+    TestCaseEnd();
+}
+
+int ut_DeltaFallback(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    Stm32Bootloader bootloader(target);
+
+    const std::string base = stamp(makeImage(20000, 7));
+    const std::string other = stamp(makeImage(20000, 8));
+    std::string next = base;
+    next[3000] ^= 0xff;
+    const std::string update = stamp(next.substr(0, 20000));
+    const std::string delta = makeDelta(base, update, 2048);
+
+    // Inconsistent deltas are refused without touching the target
+    CHECK(!bootloader.flashDelta(delta.substr(0, delta.length() - 1), FLASH_BASE));
+    CHECK(target.resets == 0);
+
+    // Blocks smaller than a page can't be applied
+    CHECK(bootloader.flash(base, FLASH_BASE));
+    target.pageErases = 0;
+    CHECK(!bootloader.flashDelta(makeDelta(base, update, 512), FLASH_BASE));
+    CHECK(target.pageErases == 0);
+
+    // An other image is installed
+    CHECK(bootloader.flash(other, FLASH_BASE));
+    target.pageErases = 0;
+    CHECK(!bootloader.flashDelta(delta, FLASH_BASE));
+    CHECK(target.pageErases == 0);
+    CHECK(target.contains(other));
+
+    // Legacy images without trailer
+    CHECK(bootloader.flash(makeImage(20000, 7), FLASH_BASE));
+    CHECK(!bootloader.flashDelta(delta, FLASH_BASE));
+
+    CHECK(bootloader.flash(update, FLASH_BASE));
+    CHECK(target.contains(update));
+
+    TestCaseEnd();
+}
+
+int ut_DeltaInterrupted(void)
+{
+    TestCaseBegin();
+
+    SimulatedBootloader target;
+    Stm32Bootloader bootloader(target);
+
+    const std::string base = stamp(makeImage(20000, 9));
+    std::string next = makeImage(20000, 9);
+    next[1000] ^= 0x01;
+    next[19000] ^= 0x01;
+    const std::string update = stamp(next);
+    const std::string delta = makeDelta(base, update, 2048);
+
+    CHECK(bootloader.flash(base, FLASH_BASE));
+    target.blocksWritten = 0;
+    target.writeLimit = 3;
+    CHECK(!bootloader.flashDelta(delta, FLASH_BASE));
+    CHECK(!target.contains(update));
+
+    // The trailer was erased first, so the half updated image isn't taken
+    // as base again and the full image repairs it
+    target.writeLimit = SIZE_MAX;
+    CHECK(!bootloader.flashDelta(delta, FLASH_BASE));
+    CHECK(bootloader.flash(update, FLASH_BASE));
+    CHECK(target.contains(update));
+    CHECK(target.programmingErrors == 0);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_BaudRateNegotiation);
+    RunTest(true, ut_FlashChangedPagesOnly);
+    RunTest(true, ut_ExtendedErase);
+    RunTest(true, ut_ReadoutProtection);
+    RunTest(true, ut_UnknownTarget);
+    RunTest(true, ut_DeltaUpdate);
+    RunTest(true, ut_DeltaFallback);
+    RunTest(true, ut_DeltaInterrupted);
+    UnitTestMainEnd();
+}
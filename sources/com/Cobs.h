@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Consistent Overhead Byte Stuffing. Encoded frames contain no zero bytes and
+ * end with a zero delimiter, so a receiver finds the next frame boundary with
+ * the first zero after a corruption.
+ */
+namespace com
+{
+static constexpr uint8_t COBS_DELIMITER = 0x00;
+
+/// @return maximum length of length bytes encoded, including the delimiter
+constexpr size_t cobsEncodedLength(const size_t length)
+{
+    return length + (length / 254) + 2;
+}
+
+/**
+ * @param out has to hold cobsEncodedLength(length) bytes
+ * @return length of the encoded frame including the delimiter
+ */
+inline size_t cobsEncode(uint8_t const* const in, const size_t length, uint8_t* const out)
+{
+    size_t codePosition = 0;
+    size_t position = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] != COBS_DELIMITER) {
+            out[position++] = in[i];
+            code++;
+        }
+        if ((in[i] == COBS_DELIMITER) || (code == 0xff)) {
+            out[codePosition] = code;
+            codePosition = position++;
+            code = 1;
+        }
+    }
+    out[codePosition] = code;
+    out[position++] = COBS_DELIMITER;
+    return position;
+}
+
+/// Decodes a byte stream frame by frame, e.g. from a circular DMA buffer
+class CobsDecoder
+{
+public:
+    CobsDecoder(uint8_t* const frame, const size_t capacity) :
+        mFrame(frame), mCapacity(capacity) {}
+
+    /**
+     * @return length of the frame in the buffer passed to the constructor if
+     *         byte completes one, 0 otherwise. Frames longer than the buffer
+     *         or with a broken structure are dropped.
+     */
+    inline size_t decode(const uint8_t byte)
+    {
+        if (byte == COBS_DELIMITER) {
+            const size_t length = (!mDiscard && (mRemaining == 0)) ? mLength : 0;
+            reset();
+            return length;
+        }
+
+        if (mDiscard) {
+            return 0;
+        }
+
+        if (mRemaining == 0) {
+            // The zero removed by the encoder, except after a full block
+            if ((mCode != 0) && (mCode != 0xff)) {
+                append(COBS_DELIMITER);
+            }
+            mCode = byte;
+            mRemaining = byte - 1;
+        } else {
+            append(byte);
+            mRemaining--;
+        }
+        return 0;
+    }
+
+    inline void reset(void)
+    {
+        mLength = 0;
+        mCode = 0;
+        mRemaining = 0;
+        mDiscard = false;
+    }
+
+private:
+    uint8_t* const mFrame;
+    const size_t mCapacity;
+    size_t mLength = 0;
+    uint8_t mCode = 0;
+    uint8_t mRemaining = 0;
+    bool mDiscard = false;
+
+    inline void append(const uint8_t byte)
+    {
+        if (mLength < mCapacity) {
+            mFrame[mLength++] = byte;
+        } else {
+            mDiscard = true;
+        }
+    }
+};
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <array>
+#include <cstring>
+
+#include "Cobs.h"
+#include "unittest.h"
+
+//--------------------------BUFFERS--------------------------
+static constexpr size_t MAX_LENGTH = 600;
+std::array<uint8_t, MAX_LENGTH> g_frame;
+std::array<uint8_t, com::cobsEncodedLength(MAX_LENGTH)> g_encoded;
+std::array<uint8_t, MAX_LENGTH> g_decoded;
+
+//--------------------------MOCKING--------------------------
+
+//-------------------------TESTCASES-------------------------
+
+static size_t decodeAll(com::CobsDecoder& decoder, uint8_t const* const data, const size_t length, size_t& frames)
+{
+    size_t lastLength = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        const size_t decodedLength = decoder.decode(data[i]);
+        if (decodedLength > 0) {
+            lastLength = decodedLength;
+            frames++;
+        }
+    }
+    return lastLength;
+}
+
+int ut_encode(void)
+{
+    TestCaseBegin();
+
+    const uint8_t zero[] = {0x00};
+    CHECK(com::cobsEncode(zero, sizeof(zero), g_encoded.data()) == 3);
+    CHECK(g_encoded[0] == 0x01);
+    CHECK(g_encoded[1] == 0x01);
+    CHECK(g_encoded[2] == 0x00);
+
+    const uint8_t data[] = {0x11, 0x22, 0x00, 0x33};
+    CHECK(com::cobsEncode(data, sizeof(data), g_encoded.data()) == 6);
+    CHECK(g_encoded[0] == 0x03);
+    CHECK(g_encoded[1] == 0x11);
+    CHECK(g_encoded[2] == 0x22);
+    CHECK(g_encoded[3] == 0x02);
+    CHECK(g_encoded[4] == 0x33);
+    CHECK(g_encoded[5] == 0x00);
+
+    TestCaseEnd();
+}
+
+int ut_roundTrip(void)
+{
+    TestCaseBegin();
+
+    com::CobsDecoder decoder(g_decoded.data(), g_decoded.size());
+
+    for (size_t length = 1; length <= MAX_LENGTH; length++) {
+        for (size_t i = 0; i < length; i++) {
+            g_frame[i] = (length % 3 == 0) ? ((i % 7) ? 0xA5 : 0x00) : ((i + length) & 0xff);
+        }
+
+        const size_t encodedLength = com::cobsEncode(g_frame.data(), length, g_encoded.data());
+        CHECK(encodedLength <= com::cobsEncodedLength(length));
+        CHECK(std::memchr(g_encoded.data(), 0, encodedLength - 1) == nullptr);
+
+        size_t frames = 0;
+        CHECK(decodeAll(decoder, g_encoded.data(), encodedLength, frames) == length);
+        CHECK(frames == 1);
+        CHECK(std::memcmp(g_decoded.data(), g_frame.data(), length) == 0);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_resynchronize(void)
+{
+    TestCaseBegin();
+
+    com::CobsDecoder decoder(g_decoded.data(), 8);
+
+    const uint8_t data[] = {1, 2, 3, 4, 5};
+    const size_t encodedLength = com::cobsEncode(data, sizeof(data), g_encoded.data());
+    size_t frames = 0;
+
+    // Tail of a frame received before
+    const uint8_t garbage[] = {0x12, 0x34, 0x56};
+    CHECK(decodeAll(decoder, garbage, sizeof(garbage), frames) == 0);
+    CHECK(decodeAll(decoder, g_encoded.data(), encodedLength, frames) == 0);
+    CHECK(frames == 0);
+    CHECK(decodeAll(decoder, g_encoded.data(), encodedLength, frames) == sizeof(data));
+    CHECK(frames == 1);
+
+    // Truncated by a delimiter
+    CHECK(decodeAll(decoder, g_encoded.data(), 3, frames) == 0);
+    CHECK(decoder.decode(0x00) == 0);
+    CHECK(decodeAll(decoder, g_encoded.data(), encodedLength, frames) == sizeof(data));
+    CHECK(frames == 2);
+
+    // Longer than the buffer
+    const uint8_t longData[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    const size_t longLength = com::cobsEncode(longData, sizeof(longData), g_encoded.data());
+    CHECK(decodeAll(decoder, g_encoded.data(), longLength, frames) == 0);
+    CHECK(frames == 2);
+
+    com::cobsEncode(data, sizeof(data), g_encoded.data());
+    CHECK(decodeAll(decoder, g_encoded.data(), encodedLength, frames) == sizeof(data));
+    CHECK(std::memcmp(g_decoded.data(), data, sizeof(data)) == 0);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_encode);
+    RunTest(true, ut_roundTrip);
+    RunTest(true, ut_resynchronize);
+    UnitTestMainEnd();
+}
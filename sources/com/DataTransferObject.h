@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <tuple>
 #include <cstring>
+#include <utility>
 #include "os_Task.h"
 #include "for_each_tuple.h"
 #include "CRC.h"
@@ -22,27 +25,94 @@ int ut_makeDto(void);
 
 namespace com
 {
+/**
+ * Binds variables to a frame of the master/slave link.
+ *
+ * updateTuple() publishes each valid frame into one of two snapshot buffers
+ * and flips them with a sequence counter (seqlock), then copies the fields
+ * to the bound variables. Only snapshot() reads under this protocol. The
+ * bound variables are written field by field, so tasks reading them
+ * directly may see fields of two frames, and the transmitting side packs
+ * them while their owners write them. Readers that need all fields of one
+ * frame, e.g. interrupt handlers, use snapshot().
+ *
+ * Besides the fixed size frame a DTO encodes delta frames of variable length:
+ *   uint32_t timestamp
+ *   uint8_t  bitmap[(number of fields + 7) / 8], bit i marks field i present
+ *   the present fields, packed in order
+ *   crc
+ * A keyframe contains all fields. Deltas are applied to the state of the last
+ * frames, so the receiver only publishes after its first keyframe.
+ */
 template<typename ... types>
 class DataTransferObject
 {
     std::tuple<types& ...> mTransferTuple;
 
     static constexpr size_t DATASIZE = pack_size<types ...> ::value;
+    static constexpr size_t NUMBER_OF_FIELDS = sizeof ... (types);
+    static constexpr size_t BITMAPSIZE = (NUMBER_OF_FIELDS + 7) / 8;
+    static constexpr std::array<size_t, NUMBER_OF_FIELDS> FIELDSIZES {{sizeof(types) ...}};
+
+    using crc_t = decltype(utility::getReturnType<const uint8_t* const>(&hal::Crc::getCrc));
 
     typedef struct __attribute__((packed)) {
         uint32_t timestamp;
         uint8_t data [DATASIZE];
-        decltype(utility::getReturnType<const uint8_t* const>(&hal::Crc::getCrc))crc;
+        crc_t crc;
     } DataTransferStruct;
 
     DataTransferStruct mTransferData;
 
+    // Odd while updateTuple() writes the buffer that isn't published
+    std::atomic<uint32_t> mSequence {0};
+    std::array<std::array<uint8_t, DATASIZE>, 2> mSnapshots {};
+
+    std::array<uint8_t, sizeof(uint32_t) + BITMAPSIZE + DATASIZE + sizeof(crc_t)> mDeltaFrame;
+    // Fields of the last delta frame sent
+    std::array<uint8_t, DATASIZE> mDeltaReference {};
+    bool mDeltaSynchronized = false;
+
+    void pack(void);
+
+    template<size_t index>
+    void encodeField(const bool keyframe, uint8_t* const bitmap, uint8_t*& ptr);
+    template<size_t index>
+    void decodeField(uint8_t const* const bitmap, uint8_t const*& ptr);
+
+    template<size_t ... indices>
+    inline void encodeFields(const bool keyframe, uint8_t* const bitmap, uint8_t*& ptr,
+                             std::index_sequence<indices ...> )
+    {
+        using swallow = int[];
+        (void)swallow {
+            1,
+            (encodeField<indices>(keyframe, bitmap, ptr), int {}) ...
+        };
+    }
+
+    template<size_t ... indices>
+    inline void decodeFields(uint8_t const* const bitmap, uint8_t const*& ptr, std::index_sequence<indices ...> )
+    {
+        using swallow = int[];
+        (void)swallow {
+            1,
+            (decodeField<indices>(bitmap, ptr), int {}) ...
+        };
+    }
+
 public:
+    // Keyframes are the longest frames
+    static constexpr size_t MAX_FRAME_LENGTH = sizeof(uint32_t) + BITMAPSIZE + DATASIZE + sizeof(crc_t);
+
     DataTransferObject(types& ... tuple) :
         mTransferTuple(tuple ...) {}
 
+    /// Binds the same variables, everything else starts over like a new object
+    DataTransferObject(DataTransferObject&& other) :
+        mTransferTuple(other.mTransferTuple) {}
+
     DataTransferObject(const DataTransferObject&) = delete;
-    DataTransferObject(DataTransferObject&&) = default;
     DataTransferObject& operator=(const DataTransferObject&) = delete;
     DataTransferObject& operator=(DataTransferObject&&) = delete;
 
@@ -50,6 +120,37 @@ public:
     void prepareForTx(void);
     bool isValid(void);
 
+    /**
+     * Copies the fields of the latest valid frame. Lock free, a reader
+     * preempted by updateTuple() retries, readers in interrupts never do.
+     * @return number of frames received so far, 0 leaves fields untouched
+     */
+    uint32_t snapshot(types& ... fields) const;
+
+    /**
+     * Encodes the bound variables to deltaData(). Fields equal to the last
+     * delta frame are left out unless keyframe is set.
+     * @return length of the frame
+     */
+    size_t prepareDeltaForTx(const bool keyframe);
+
+    /**
+     * Checks the delta frame of length bytes in deltaData() and applies it.
+     * The tuple is updated once a keyframe was received.
+     * @return false if the frame is corrupted
+     */
+    bool updateFromDelta(const size_t length);
+
+    inline uint8_t* deltaData(void)
+    {
+        return mDeltaFrame.data();
+    }
+
+    constexpr inline size_t maxDeltaLength(void) const
+    {
+        return mDeltaFrame.size();
+    }
+
     inline uint8_t* data(void)
     {
         return reinterpret_cast<uint8_t*>(&mTransferData);
@@ -82,7 +183,10 @@ make_dto(_Elements&& ... __args)
 }
 
 template<typename ... types>
-void com::DataTransferObject<types ...>::prepareForTx(void)
+constexpr std::array<size_t, com::DataTransferObject<types ...>::NUMBER_OF_FIELDS> com::DataTransferObject<types ...>::FIELDSIZES;
+
+template<typename ... types>
+void com::DataTransferObject<types ...>::pack(void)
 {
     mTransferData.timestamp = os::Task::getTickCount();
     uint8_t* ptr = mTransferData.data;
@@ -91,6 +195,12 @@ void com::DataTransferObject<types ...>::prepareForTx(void)
         std::memcpy(ptr, &x, sizeof(x));
         ptr += sizeof(x);
     });
+}
+
+template<typename ... types>
+void com::DataTransferObject<types ...>::prepareForTx(void)
+{
+    pack();
     const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
     mTransferData.crc = crcUnit.getCrc(this->data(), this->length() - sizeof(mTransferData.crc));
 }
@@ -112,11 +222,137 @@ bool com::DataTransferObject<types ...>::isValid(void)
 template<typename ... types>
 void com::DataTransferObject<types ...>::updateTuple(void)
 {
+    // Only the receiving task writes, so the counter needs no read-modify-write
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(mSnapshots[(sequence / 2 + 1) & 1].data(), mTransferData.data, DATASIZE);
+    mSequence.store(sequence + 2, std::memory_order_release);
+
     uint8_t const* ptr = mTransferData.data;
-    os::ThisTask::enterCriticalSection();
     for_each(mTransferTuple, [&ptr](auto& x){
         std::memcpy(&x, ptr, sizeof(x));
         ptr += sizeof(x);
     });
-    os::ThisTask::exitCriticalSection();
+}
+
+template<typename ... types>
+uint32_t com::DataTransferObject<types ...>::snapshot(types& ... fields) const
+{
+    std::array<uint8_t, DATASIZE> copy;
+    uint32_t sequence;
+    uint32_t current;
+
+    do {
+        sequence = mSequence.load(std::memory_order_acquire);
+        std::memcpy(copy.data(), mSnapshots[(sequence / 2) & 1].data(), DATASIZE);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        current = mSequence.load(std::memory_order_relaxed);
+
+        // The copied buffer is written again by the second update after it
+    } while (current - (sequence & ~1u) > 2);
+
+    if (sequence < 2) {
+        return 0;
+    }
+
+    uint8_t const* ptr = copy.data();
+    for_each(std::tuple<types& ...>(fields ...), [&ptr](auto& x){
+        std::memcpy(&x, ptr, sizeof(x));
+        ptr += sizeof(x);
+    });
+    return sequence / 2;
+}
+
+template<typename ... types>
+template<size_t index>
+void com::DataTransferObject<types ...>::encodeField(const bool keyframe, uint8_t* const bitmap, uint8_t*& ptr)
+{
+    constexpr size_t offset = pack_size_index<index, types ...>::value;
+    constexpr size_t size = FIELDSIZES[index];
+    uint8_t const* const field = mTransferData.data + offset;
+
+    if (keyframe || (std::memcmp(field, mDeltaReference.data() + offset, size) != 0)) {
+        bitmap[index / 8] |= 1 << (index % 8);
+        std::memcpy(ptr, field, size);
+        std::memcpy(mDeltaReference.data() + offset, field, size);
+        ptr += size;
+    }
+}
+
+template<typename ... types>
+template<size_t index>
+void com::DataTransferObject<types ...>::decodeField(uint8_t const* const bitmap, uint8_t const*& ptr)
+{
+    constexpr size_t offset = pack_size_index<index, types ...>::value;
+    constexpr size_t size = FIELDSIZES[index];
+
+    if (bitmap[index / 8] & (1 << (index % 8))) {
+        std::memcpy(mTransferData.data + offset, ptr, size);
+        ptr += size;
+    }
+}
+
+template<typename ... types>
+size_t com::DataTransferObject<types ...>::prepareDeltaForTx(const bool keyframe)
+{
+    pack();
+    std::memcpy(mDeltaFrame.data(), &mTransferData.timestamp, sizeof(mTransferData.timestamp));
+
+    uint8_t* const bitmap = mDeltaFrame.data() + sizeof(mTransferData.timestamp);
+    std::memset(bitmap, 0, BITMAPSIZE);
+    uint8_t* ptr = bitmap + BITMAPSIZE;
+    encodeFields(keyframe, bitmap, ptr, std::index_sequence_for<types ...> {});
+
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    const crc_t crc = crcUnit.getCrc(mDeltaFrame.data(), ptr - mDeltaFrame.data());
+    std::memcpy(ptr, &crc, sizeof(crc));
+
+    return ptr - mDeltaFrame.data() + sizeof(crc);
+}
+
+template<typename ... types>
+bool com::DataTransferObject<types ...>::updateFromDelta(const size_t length)
+{
+    uint8_t const* const bitmap = mDeltaFrame.data() + sizeof(mTransferData.timestamp);
+    size_t expectedLength = sizeof(mTransferData.timestamp) + BITMAPSIZE + sizeof(crc_t);
+    bool keyframe = true;
+
+    if ((length < expectedLength) || (length > mDeltaFrame.size())) {
+        return false;
+    }
+
+    for (size_t i = 0; i < BITMAPSIZE * 8; i++) {
+        const bool present = bitmap[i / 8] & (1 << (i % 8));
+        if (i >= NUMBER_OF_FIELDS) {
+            if (present) {
+                return false;
+            }
+        } else if (present) {
+            expectedLength += FIELDSIZES[i];
+        } else {
+            keyframe = false;
+        }
+    }
+    if (length != expectedLength) {
+        return false;
+    }
+
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    crc_t crc;
+    std::memcpy(&crc, mDeltaFrame.data() + length - sizeof(crc), sizeof(crc));
+    if (crcUnit.getCrc(mDeltaFrame.data(), length - sizeof(crc)) != crc) {
+        return false;
+    }
+
+    std::memcpy(&mTransferData.timestamp, mDeltaFrame.data(), sizeof(mTransferData.timestamp));
+    uint8_t const* ptr = bitmap + BITMAPSIZE;
+    decodeFields(bitmap, ptr, std::index_sequence_for<types ...> {});
+
+    mDeltaSynchronized = mDeltaSynchronized || keyframe;
+    if (mDeltaSynchronized) {
+        updateTuple();
+    }
+    return true;
 }
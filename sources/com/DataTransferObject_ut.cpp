@@ -4,15 +4,19 @@
  * Modified 2019 by Henning Mende
  */
 
+#include <atomic>
 #include <cmath>
 #include <iostream>
 #include <cstring>
+#include <thread>
+#include <vector>
 
 #include "DataTransferObject.h"
 #include "unittest.h"
 #include "os_Task.h"
 
 #define NUM_TEST_LOOPS 255
+#define NUM_SNAPSHOT_UPDATES 500000
 
 //--------------------------BUFFERS--------------------------
 uint32_t g_currentTickCount;
@@ -228,6 +232,195 @@ int ut_makeDto(void)
     TestCaseEnd();
 }
 
+int ut_snapshot(void)
+{
+    TestCaseBegin();
+
+    g_crc = 0x00;
+    g_currentTickCount = 0x00;
+
+    uint32_t a = 1;
+    uint16_t b = 2;
+    uint8_t c = 3;
+
+    com::DataTransferObject<uint32_t, uint16_t, uint8_t> dto(a, b, c);
+
+    uint32_t snapA = 0;
+    uint16_t snapB = 0;
+    uint8_t snapC = 0;
+
+    CHECK(dto.snapshot(snapA, snapB, snapC) == 0);
+    CHECK(snapA == 0);
+
+    dto.prepareForTx();
+    dto.updateTuple();
+    a = 4;
+    dto.prepareForTx();
+    dto.updateTuple();
+
+    CHECK(dto.snapshot(snapA, snapB, snapC) == 2);
+    CHECK(snapA == 4);
+    CHECK(snapB == 2);
+    CHECK(snapC == 3);
+
+    TestCaseEnd();
+}
+
+// Large enough that readers are often preempted in the middle of a copy
+struct SnapshotBlock {
+    uint32_t words[256];
+};
+
+int ut_snapshotConsistency(void)
+{
+    TestCaseBegin();
+
+    g_crc = 0x00;
+    g_currentTickCount = 0x00;
+
+    uint32_t txA = 0;
+    uint64_t txB = 0;
+    SnapshotBlock txC {};
+    uint32_t rxA = 0;
+    uint64_t rxB = 0;
+    SnapshotBlock rxC {};
+
+    com::DataTransferObject<uint32_t, uint64_t, SnapshotBlock> tx(txA, txB, txC);
+    com::DataTransferObject<uint32_t, uint64_t, SnapshotBlock> rx(rxA, rxB, rxC);
+
+    std::atomic<bool> done {false};
+    std::atomic<size_t> running {0};
+    std::atomic<size_t> reads {0};
+    std::atomic<size_t> torn {0};
+    std::atomic<size_t> reordered {0};
+
+    // Frame k carries k in every field, the receiving task publishes them
+    // while readers on other cores take snapshots
+    std::thread writer([&] {
+        while (running < 2) {}
+        for (uint32_t k = 1; k <= NUM_SNAPSHOT_UPDATES; k++) {
+            txA = k;
+            txB = k * 0x100000001ull;
+            for (auto& word : txC.words) {
+                word = k;
+            }
+            tx.prepareForTx();
+            std::memcpy(rx.data(), tx.data(), rx.length());
+            rx.updateTuple();
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 2; i++) {
+        readers.emplace_back([&] {
+            uint32_t last = 0;
+            running++;
+            while (!done) {
+                uint32_t a;
+                uint64_t b;
+                SnapshotBlock c;
+                const uint32_t frames = rx.snapshot(a, b, c);
+                if (frames == 0) {
+                    continue;
+                }
+                bool consistent = (frames == a) && (b == a * 0x100000001ull);
+                for (const auto word : c.words) {
+                    consistent &= word == a;
+                }
+                torn += consistent ? 0 : 1;
+                reordered += a < last ? 1 : 0;
+                last = a;
+                reads++;
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    uint32_t a;
+    uint64_t b;
+    SnapshotBlock c;
+    CHECK(rx.snapshot(a, b, c) == NUM_SNAPSHOT_UPDATES);
+    CHECK(a == NUM_SNAPSHOT_UPDATES);
+    CHECK(rxA == NUM_SNAPSHOT_UPDATES);
+    CHECK(reads > 0);
+    CHECK(torn == 0);
+    CHECK(reordered == 0);
+
+    TestCaseEnd();
+}
+
+int ut_deltaFrames(void)
+{
+    TestCaseBegin();
+
+    g_crc = 0x5A;
+    g_currentTickCount = 0x00;
+
+    uint32_t a = 0xDEADBEEF, rxA = 0;
+    uint16_t b = 0xABCD, rxB = 0;
+    uint8_t c = 0xEF, rxC = 0;
+
+    com::DataTransferObject<uint32_t, uint16_t, uint8_t> tx(a, b, c);
+    com::DataTransferObject<uint32_t, uint16_t, uint8_t> rx(rxA, rxB, rxC);
+
+    const size_t header = sizeof(uint32_t) + 1;
+    CHECK(tx.maxDeltaLength() == header + 7 + sizeof(g_crc));
+
+    // Nothing is published before the first keyframe
+    size_t length = tx.prepareDeltaForTx(false);
+    CHECK(length == header + 7 + sizeof(g_crc));
+    b = 0x1234;
+    length = tx.prepareDeltaForTx(false);
+    CHECK(length == header + sizeof(uint16_t) + sizeof(g_crc));
+    std::memcpy(rx.deltaData(), tx.deltaData(), length);
+    CHECK(rx.updateFromDelta(length) == true);
+    CHECK(rxB == 0);
+
+    length = tx.prepareDeltaForTx(true);
+    CHECK(length == header + 7 + sizeof(g_crc));
+    std::memcpy(rx.deltaData(), tx.deltaData(), length);
+    CHECK(rx.updateFromDelta(length) == true);
+    CHECK(rxA == 0xDEADBEEF);
+    CHECK(rxB == 0x1234);
+    CHECK(rxC == 0xEF);
+
+    // Unchanged fields keep the state of the previous frames
+    length = tx.prepareDeltaForTx(false);
+    CHECK(length == header + sizeof(g_crc));
+    c = 0x42;
+    a = 0x01020304;
+    length = tx.prepareDeltaForTx(false);
+    CHECK(length == header + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(g_crc));
+    std::memcpy(rx.deltaData(), tx.deltaData(), length);
+    CHECK(rx.updateFromDelta(length) == true);
+    CHECK(rxA == 0x01020304);
+    CHECK(rxB == 0x1234);
+    CHECK(rxC == 0x42);
+
+    // Truncated frames, unknown fields and crc errors are rejected
+    CHECK(rx.updateFromDelta(length - 1) == false);
+    CHECK(rx.updateFromDelta(rx.maxDeltaLength() + 1) == false);
+    c = 0x43;
+    length = tx.prepareDeltaForTx(false);
+    std::memcpy(rx.deltaData(), tx.deltaData(), length);
+    rx.deltaData()[sizeof(uint32_t)] |= 0x80;
+    CHECK(rx.updateFromDelta(length) == false);
+    rx.deltaData()[sizeof(uint32_t)] &= 0x7F;
+    g_crc = 0x11;
+    CHECK(rx.updateFromDelta(length) == false);
+    CHECK(rxC == 0x42);
+    g_crc = 0x5A;
+    CHECK(rx.updateFromDelta(length) == true);
+    CHECK(rxC == 0x43);
+
+    TestCaseEnd();
+}
+
 int main(int argc, const char* argv[])
 {
     UnitTestMainBegin();
@@ -237,6 +430,9 @@ int main(int argc, const char* argv[])
     RunTest(true, ut_tupleUpdate);
     RunTest(true, ut_tupleValid);
     RunTest(true, ut_makeDto);
+    RunTest(true, ut_snapshot);
+    RunTest(true, ut_snapshotConsistency);
+    RunTest(true, ut_deltaFrames);
 
     UnitTestMainEnd();
 }
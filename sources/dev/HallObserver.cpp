@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "HallObserver.h"
+
+using dev::HallObserver;
+
+constexpr float HallObserver::ALPHA;
+constexpr float HallObserver::BETA;
+constexpr float HallObserver::TWO_PI;
+constexpr float HallObserver::SECTOR;
+constexpr std::array<int8_t, 8> HallObserver::SECTOR_OF_HALL_STATE;
+
+void HallObserver::update(const uint32_t hallState, const uint32_t ticksSinceLastEdge)
+{
+    const int32_t sector = SECTOR_OF_HALL_STATE[hallState & 0x7];
+
+    if (sector < 0) {
+        mInvalidTransitions++;
+        return;
+    }
+
+    if (mSector < 0) {
+        // No edge known yet, the rotor is somewhere in the sector
+        mSector = sector;
+        mEdgesInDirection = 0;
+        mCurrent = {wrap(sector * SECTOR + SECTOR / 2), 0, 0, 0, false};
+        publish(mCurrent);
+        return;
+    }
+
+    const int32_t step = (sector - mSector + 6) % 6;
+    if (step == 0) {
+        // Bouncing sensor, the state didn't change
+        return;
+    }
+
+    mSector = sector;
+
+    if ((step != 1) && (step != 5)) {
+        // Lost at least one edge
+        mInvalidTransitions++;
+        mEdgesInDirection = 0;
+        mCurrent = {wrap(sector * SECTOR + SECTOR / 2), 0, 0, 0, false};
+        publish(mCurrent);
+        return;
+    }
+
+    const int32_t direction = (step == 1) ? 1 : -1;
+    const float edge = boundary(sector, direction);
+
+    if (direction != mCurrent.direction) {
+        mEdgesInDirection = 0;
+    }
+
+    Estimate next = {edge, 0, wrap(edge + direction * SECTOR), direction, false};
+
+    if ((mEdgesInDirection == 0) || (ticksSinceLastEdge == 0)) {
+        // After a reversal the last interval doesn't span a sector
+        mEdgesInDirection = 1;
+    } else if (mEdgesInDirection == 1) {
+        next.speed = direction * SECTOR / ticksSinceLastEdge;
+        next.locked = true;
+        mEdgesInDirection = 2;
+    } else {
+        // The rotor turned exactly one sector since the last edge
+        float offset = wrap(mLastEdge - mCurrent.angle);
+        if (offset > TWO_PI / 2) {
+            offset -= TWO_PI;
+        }
+        const float travel = mCurrent.speed * ticksSinceLastEdge;
+        const float error = offset + direction * SECTOR - travel;
+
+        if (std::abs(error) > SECTOR) {
+            // Far off after a sudden change of speed, start again from the interval
+            next.speed = direction * SECTOR / ticksSinceLastEdge;
+        } else {
+            next.angle = wrap(mCurrent.angle + travel + ALPHA * error);
+            next.speed = mCurrent.speed + BETA * error / ticksSinceLastEdge;
+        }
+        next.locked = true;
+    }
+
+    mLastEdge = edge;
+    mCurrent = next;
+    publish(mCurrent);
+}
+
+void HallObserver::reset(void)
+{
+    mSector = -1;
+    mEdgesInDirection = 0;
+    mCurrent = {};
+    publish(mCurrent);
+}
+
+float HallObserver::getAngle(const uint32_t ticksSinceLastEdge) const
+{
+    const Estimate estimate = getPublished();
+
+    if (estimate.direction == 0) {
+        return estimate.angle;
+    }
+
+    const float maximum = wrap(estimate.direction * (estimate.limit - estimate.angle));
+    const float travel = std::min(std::max(estimate.direction * estimate.speed * ticksSinceLastEdge, 0.0f),
+                                  maximum);
+
+    return wrap(estimate.angle + estimate.direction * travel);
+}
+
+float HallObserver::getSpeed(const uint32_t ticksSinceLastEdge) const
+{
+    const Estimate estimate = getPublished();
+
+    if (ticksSinceLastEdge == 0) {
+        return estimate.speed;
+    }
+
+    const float bound = SECTOR / ticksSinceLastEdge;
+    return std::min(std::max(estimate.speed, -bound), bound);
+}
+
+bool HallObserver::isLocked(void) const
+{
+    return getPublished().locked;
+}
+
+uint32_t HallObserver::getInvalidTransitions(void) const
+{
+    return mInvalidTransitions;
+}
+
+void HallObserver::publish(const Estimate& estimate)
+{
+    // Only the capture interrupt writes, so the counter needs no read-modify-write
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mState[(sequence / 2 + 1) & 1] = estimate;
+
+    mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+HallObserver::Estimate HallObserver::getPublished(void) const
+{
+    Estimate estimate;
+    uint32_t sequence;
+    uint32_t current;
+
+    do {
+        sequence = mSequence.load(std::memory_order_acquire);
+        estimate = mState[(sequence / 2) & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        current = mSequence.load(std::memory_order_relaxed);
+
+        // The copied buffer is written again by the second publish() after it
+    } while (current - (sequence & ~1u) > 2);
+
+    return estimate;
+}
+
+float HallObserver::wrap(const float angle)
+{
+    // All callers stay within one turn around [0, 2pi)
+    if (angle >= TWO_PI) {
+        return angle - TWO_PI;
+    } else if (angle < 0) {
+        return angle + TWO_PI;
+    }
+    return angle;
+}
+
+float HallObserver::boundary(const int32_t sector, const int32_t direction)
+{
+    // Forward the rotor enters a sector at its start, backward at its end
+    return wrap((direction > 0 ? sector : sector + 1) * SECTOR);
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+namespace dev
+{
+/**
+ * Tracks electrical angle and speed of a rotor with three hall sensors.
+ * update() runs in the capture interrupt of each hall edge with the timer
+ * ticks since the previous edge and costs the same at every speed. Between
+ * the edges getAngle() extrapolates with the tracked speed, but never past
+ * the next hall edge.
+ *
+ * Angle and speed are an alpha-beta tracking filter: the edge angle
+ * corrects the predicted angle by ALPHA and the speed by BETA of the error.
+ * This is a second order loop, so a constant speed is tracked without lag.
+ * BETA is a little above the Benedict-Bordner gain ALPHA^2 / (2 - ALPHA),
+ * which is 0.45, for a faster response to acceleration.
+ *
+ * Angles are electrical radians in [0, 2pi). 0 is the edge into hall state
+ * 1 when turning forward, forward is the sequence 1, 3, 2, 6, 4, 5 of
+ * SensorBLDC. Speeds are electrical radians per timer tick, positive
+ * forward.
+ *
+ * The state is published in one of two buffers flipped by a sequence
+ * counter, readers never block. A reader retries only if the capture
+ * interrupt published twice while it copied the state.
+ */
+struct HallObserver final {
+    HallObserver(void) = default;
+
+    HallObserver(const HallObserver&) = delete;
+    HallObserver(HallObserver&&) = delete;
+    HallObserver& operator=(const HallObserver&) = delete;
+    HallObserver& operator=(HallObserver&&) = delete;
+
+    void update(const uint32_t hallState, const uint32_t ticksSinceLastEdge);
+    /// Writes like update(), so never concurrently with it
+    void reset(void);
+
+    float getAngle(const uint32_t ticksSinceLastEdge) const;
+
+    /// Bounded by one sector per ticksSinceLastEdge, so a stalled rotor decays to 0
+    float getSpeed(const uint32_t ticksSinceLastEdge) const;
+
+    /// Two edges in the same direction after a reset, reversal or lost edge
+    bool isLocked(void) const;
+
+    /// Invalid hall states and skipped sectors
+    uint32_t getInvalidTransitions(void) const;
+
+    static constexpr float ALPHA = 0.75f;
+    static constexpr float BETA = 0.5f;
+    static constexpr float TWO_PI = 6.28318530717958647692f;
+    static constexpr float SECTOR = TWO_PI / 6;
+
+private:
+    struct Estimate {
+        /// At the last edge
+        float angle;
+        float speed;
+        /// The next hall edge in the direction of rotation
+        float limit;
+        int32_t direction;
+        bool locked;
+    };
+
+    void publish(const Estimate&);
+    Estimate getPublished(void) const;
+
+    static float wrap(const float angle);
+    static float boundary(const int32_t sector, const int32_t direction);
+
+    /// Sector of each hall state, -1 for the invalid states 0 and 7
+    static constexpr std::array<int8_t, 8> SECTOR_OF_HALL_STATE = {{-1, 0, 2, 1, 4, 5, 3, -1}};
+
+    // Only the capture interrupt writes these
+    Estimate mCurrent = {};
+    float mLastEdge = 0;
+    int32_t mSector = -1;
+    uint32_t mEdgesInDirection = 0;
+    uint32_t mInvalidTransitions = 0;
+
+    std::array<Estimate, 2> mState = {};
+    std::atomic<uint32_t> mSequence {0};
+};
+}
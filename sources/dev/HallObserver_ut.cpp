@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "unittest.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include "HallObserver.h"
+
+using dev::HallObserver;
+
+static constexpr float TWO_PI = HallObserver::TWO_PI;
+static constexpr float SECTOR = HallObserver::SECTOR;
+static constexpr float TIMER_FREQUENCY = 72000000;
+static constexpr uint32_t TICKS_PER_STEP = 360;
+
+//--------------------------BUFFERS--------------------------
+
+/// Hall state of each sector, forward is 1, 3, 2, 6, 4, 5
+static constexpr std::array<uint32_t, 6> HALL_STATE_OF_SECTOR = {{1, 3, 2, 6, 4, 5}};
+
+struct Result {
+    uint32_t edges;
+    float maxAngleError;
+    float maxSpeedError;
+    float lastSpeed;
+};
+
+//--------------------------MOCKING--------------------------
+
+static float angleDifference(const float a, const float b)
+{
+    float difference = std::fmod(a - b, TWO_PI);
+    if (difference > TWO_PI / 2) {
+        difference -= TWO_PI;
+    } else if (difference < -TWO_PI / 2) {
+        difference += TWO_PI;
+    }
+    return difference;
+}
+
+/**
+ * Turns a rotor with the electrical speed (rad per tick) over the tick,
+ * feeds the hall edges into the observer and compares its angle and speed
+ * with the rotor in between. Comparison starts after settleEdges edges.
+ */
+static Result simulate(HallObserver&                          observer,
+                       float&                                 angle,
+                       const uint32_t                         ticks,
+                       const std::function<float(uint32_t)>& speed,
+                       const uint32_t                         settleEdges,
+                       const std::array<float, 6>&            sensorOffsets = {})
+{
+    Result result {0, 0, 0, 0};
+    uint32_t ticksSinceLastEdge = 0;
+
+    const auto sectorOf = [&sensorOffsets](const float a) {
+        for (int32_t sector = 5; sector >= 0; sector--) {
+            if (a >= sector * SECTOR + sensorOffsets[sector]) {
+                return sector;
+            }
+        }
+        return 5;
+    };
+
+    int32_t sector = sectorOf(angle);
+
+    for (uint32_t tick = 0; tick < ticks; tick += TICKS_PER_STEP) {
+        const float currentSpeed = speed(tick);
+        angle = std::fmod(angle + currentSpeed * TICKS_PER_STEP + TWO_PI, TWO_PI);
+        ticksSinceLastEdge += TICKS_PER_STEP;
+
+        const int32_t current = sectorOf(angle);
+        if (current != sector) {
+            sector = current;
+            observer.update(HALL_STATE_OF_SECTOR[sector], ticksSinceLastEdge);
+            ticksSinceLastEdge = 0;
+            result.edges++;
+        }
+
+        if (result.edges > settleEdges) {
+            result.maxAngleError = std::max(result.maxAngleError,
+                                            std::abs(angleDifference(observer.getAngle(ticksSinceLastEdge), angle)));
+            result.maxSpeedError = std::max(result.maxSpeedError,
+                                            std::abs(observer.getSpeed(ticksSinceLastEdge) - currentSpeed) /
+                                            std::abs(currentSpeed));
+        }
+    }
+    result.lastSpeed = observer.getSpeed(ticksSinceLastEdge);
+    return result;
+}
+
+/// Electrical speed in rad per tick of a motor with 7 pole pairs
+static float fromRPS(const float rps)
+{
+    return rps * 7 * TWO_PI / TIMER_FREQUENCY;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_ConstantSpeed(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+    float angle = 0.1;
+
+    CHECK(!observer.isLocked());
+
+    const Result result = simulate(observer, angle, 72000000 / 4, [](uint32_t) {
+        return fromRPS(20);
+    }, 12);
+
+    CHECK(observer.isLocked());
+    CHECK(result.edges > 200);
+    // One simulation step is 0.035 rad at this speed
+    CHECK(result.maxAngleError < 0.05);
+    CHECK(result.maxSpeedError < 0.01);
+    CHECK(observer.getInvalidTransitions() == 0);
+
+    printf("Constant speed: max angle error %.4f rad, max speed error %.4f\n",
+           result.maxAngleError, result.maxSpeedError);
+
+    TestCaseEnd();
+}
+
+int ut_Acceleration(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+    float angle = 0;
+
+    // 5 rps to 45 rps in half a second
+    const Result result = simulate(observer, angle, 72000000 / 2, [](uint32_t tick) {
+        return fromRPS(5 + 80.0f * tick / TIMER_FREQUENCY);
+    }, 12);
+
+    CHECK(observer.isLocked());
+    CHECK(result.maxAngleError < 0.1);
+    CHECK(result.maxSpeedError < 0.1);
+    CHECK(std::abs(result.lastSpeed - fromRPS(45)) / fromRPS(45) < 0.02);
+
+    printf("Acceleration: max angle error %.4f rad, max speed error %.4f\n",
+           result.maxAngleError, result.maxSpeedError);
+
+    TestCaseEnd();
+}
+
+int ut_SensorOffsets(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+    float angle = 0.1;
+
+    // Hall sensors placed up to 3 degrees off
+    const std::array<float, 6> offsets = {{0.05, -0.03, 0.02, -0.05, 0.0, 0.04}};
+
+    const Result result = simulate(observer, angle, 72000000 / 4, [](uint32_t) {
+        return fromRPS(20);
+    }, 12, offsets);
+
+    CHECK(result.maxAngleError < 0.1);
+    CHECK(std::abs(result.lastSpeed - fromRPS(20)) / fromRPS(20) < 0.05);
+
+    printf("Sensor offsets: max angle error %.4f rad, max speed error %.4f\n",
+           result.maxAngleError, result.maxSpeedError);
+
+    TestCaseEnd();
+}
+
+int ut_Reversal(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+    float angle = 0.1;
+
+    Result result = simulate(observer, angle, 72000000 / 10, [](uint32_t) {
+        return fromRPS(10);
+    }, 0);
+    CHECK(observer.isLocked());
+    CHECK(result.lastSpeed > 0);
+
+    // The first edge backward only gives the direction
+    result = simulate(observer, angle, 72000000 / 10, [](uint32_t) {
+        return fromRPS(-10);
+    }, 0);
+    CHECK(observer.isLocked());
+    CHECK(result.lastSpeed < 0);
+    CHECK(std::abs(result.lastSpeed - fromRPS(-10)) / fromRPS(10) < 0.02);
+    CHECK(observer.getInvalidTransitions() == 0);
+
+    CHECK(result.edges > 10);
+
+    TestCaseEnd();
+}
+
+int ut_SuddenStop(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+    float angle = 0.1;
+
+    simulate(observer, angle, 72000000 / 4, [](uint32_t) {
+        return fromRPS(30);
+    }, 0);
+
+    const float speed = observer.getSpeed(0);
+    CHECK(speed > 0);
+
+    // The estimate decays with the time since the last edge
+    CHECK(observer.getSpeed(1000000) <= SECTOR / 1000000);
+    CHECK(observer.getSpeed(100000000) < speed / 100);
+
+    // Never extrapolated past the next hall edge
+    const float atEdge = observer.getAngle(0);
+    const float muchLater = observer.getAngle(100000000);
+    CHECK(std::abs(angleDifference(muchLater, atEdge)) <= SECTOR + 0.0001);
+
+    // Slow again, the first slow edge starts the speed from the interval
+    const Result result = simulate(observer, angle, 72000000 * 2, [](uint32_t) {
+        return fromRPS(1);
+    }, 2);
+    CHECK(result.edges > 10);
+    CHECK(std::abs(result.lastSpeed - fromRPS(1)) / fromRPS(1) < 0.02);
+
+    TestCaseEnd();
+}
+
+int ut_InvalidTransitions(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+
+    observer.update(1, 0);
+    observer.update(3, 1000);
+    observer.update(2, 1000);
+    observer.update(6, 1000);
+    CHECK(observer.isLocked());
+    CHECK(observer.getSpeed(0) > 0);
+
+    // Disconnected sensors
+    observer.update(0, 1000);
+    observer.update(7, 1000);
+    CHECK(observer.getInvalidTransitions() == 2);
+    CHECK(observer.isLocked());
+
+    // Bounce
+    observer.update(6, 10);
+    CHECK(observer.getInvalidTransitions() == 2);
+
+    // Sector 3 to sector 5 skips an edge
+    observer.update(5, 1000);
+    CHECK(observer.getInvalidTransitions() == 3);
+    CHECK(!observer.isLocked());
+    CHECK(observer.getSpeed(0) == 0);
+    CHECK(std::abs(angleDifference(observer.getAngle(0), 5.5 * SECTOR)) < 0.0001);
+
+    observer.update(1, 1000);
+    observer.update(3, 1000);
+    CHECK(observer.isLocked());
+
+    observer.reset();
+    CHECK(!observer.isLocked());
+    CHECK(observer.getSpeed(0) == 0);
+
+    TestCaseEnd();
+}
+
+int ut_EdgeAngles(void)
+{
+    TestCaseBegin();
+
+    HallObserver observer;
+
+    // Forward into sector k at its start, backward at its end
+    observer.update(1, 0);
+    observer.update(3, 1000);
+    CHECK(std::abs(angleDifference(observer.getAngle(0), 1 * SECTOR)) < 0.0001);
+    observer.update(1, 1000);
+    CHECK(std::abs(angleDifference(observer.getAngle(0), 1 * SECTOR)) < 0.0001);
+    observer.update(5, 1000);
+    CHECK(std::abs(angleDifference(observer.getAngle(0), 0)) < 0.0001);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_ConstantSpeed);
+    RunTest(true, ut_Acceleration);
+    RunTest(true, ut_SensorOffsets);
+    RunTest(true, ut_Reversal);
+    RunTest(true, ut_SuddenStop);
+    RunTest(true, ut_InvalidTransitions);
+    RunTest(true, ut_EdgeAngles);
+    UnitTestMainEnd();
+}
@@ -32,10 +32,25 @@ bool PIDController::compute(void)
     const auto now = os::Task::getTickCount();
     const auto timeChange = now - mLastTime;
 
-    if (timeChange < mSampleTime.count()) {
+    if (timeChange < std::chrono::duration_cast<std::chrono::milliseconds>(mSampleTime).count()) {
         return false;
     }
 
+    step();
+    mLastTime = now;
+    return true;
+}
+
+bool PIDController::computeFromISR(void)
+{
+    if (mMode == ControlMode::MANUAL) {return false; }
+
+    step();
+    return true;
+}
+
+void PIDController::step(void)
+{
     const float input = mInput;
     const float error = mSetPoint - input;
 
@@ -50,8 +65,6 @@ bool PIDController::compute(void)
     mOutput = output;
 
     mLastInput = input;
-    mLastTime = now;
-    return true;
 }
 
 void PIDController::setTunings(const float kp, const float ki, const float kd)
@@ -64,7 +77,7 @@ void PIDController::setTunings(const float kp, const float ki, const float kd)
     mDispKi = ki;
     mDispKd = kd;
 
-    const auto sampleTimeInSec = ((float)mSampleTime.count()) / 1000;
+    const auto sampleTimeInSec = ((float)mSampleTime.count()) / 1000000;
 
     mKp = kp;
     mKi = ki * sampleTimeInSec;
@@ -77,7 +90,7 @@ void PIDController::setTunings(const float kp, const float ki, const float kd)
     }
 }
 
-void PIDController::setSampleTime(const std::chrono::milliseconds newSampleTime)
+void PIDController::setSampleTime(const std::chrono::microseconds newSampleTime)
 {
     if (newSampleTime.count() <= 0) {
         return;
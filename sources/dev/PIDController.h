@@ -30,11 +30,17 @@ struct PIDController final {
 
     void setMode(const ControlMode);
     bool compute(void);
+
+    /**
+     * Calculates one step without looking at the tick count, for callers
+     * which are triggered once per sample time, e.g. by an interrupt.
+     */
+    bool computeFromISR(void);
     void setOutputLimits(const float, const float);
 
     void setTunings(const float kp, const float ki, const float kd);
     void setControllerDirection(const ControlDirection);
-    void setSampleTime(const std::chrono::milliseconds);
+    void setSampleTime(const std::chrono::microseconds);
 
     float getKp(void) const;
     float getKi(void) const;
@@ -50,6 +56,7 @@ private:
     PIDController& operator=(PIDController&&) = delete;
 
     void initalize(void);
+    void step(void);
     void checkLimits(float&);
 
     float mDispKp;
@@ -70,7 +77,7 @@ private:
     float mITerm;
     float mLastInput;
 
-    std::chrono::milliseconds mSampleTime = std::chrono::milliseconds(5);
+    std::chrono::microseconds mSampleTime = std::chrono::milliseconds(5);
     float mOutMin;
     float mOutMax;
     ControlMode mMode = ControlMode::MANUAL;
@@ -277,6 +277,34 @@ int ut_TestPID_D_Change(void)
 
     TestCaseEnd();
 }
+int ut_TestPIDFromISR(void)
+{
+    TestCaseBegin();
+
+    static constexpr const auto NUMBER_OF_VALUES = 1000;
+
+    float output = 0;
+    float input = 0;
+    float setPoint = 1;
+
+    dev::PIDController pid(input, output, setPoint, 0, 10, 0, dev::PIDController::ControlDirection::DIRECT);
+    pid.setSampleTime(std::chrono::microseconds(100));
+    pid.setMode(dev::PIDController::ControlMode::AUTOMATIC);
+
+    // The tick count doesn't move, every call is one sample
+    for (int i = 0; i < NUMBER_OF_VALUES; i++) {
+        CHECK(pid.computeFromISR());
+    }
+
+    // 10 * 1 * 1000 * 100us
+    CHECK(output <= 1.01 && output >= 0.99);
+
+    pid.setMode(dev::PIDController::ControlMode::MANUAL);
+    CHECK(!pid.computeFromISR());
+
+    TestCaseEnd();
+}
+
 int main(int argc, const char* argv[])
 {
     UnitTestMainBegin();
@@ -284,5 +312,6 @@ int main(int argc, const char* argv[])
     RunTest(true, ut_TestPID_P_Change);
     RunTest(true, ut_TestPID_I_Change);
     RunTest(true, ut_TestPID_D_Change);
+    RunTest(true, ut_TestPIDFromISR);
     UnitTestMainEnd();
 }
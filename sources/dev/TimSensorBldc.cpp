@@ -81,6 +81,9 @@ void SensorBLDC::modifyPulsWidthPeriode(void) const
 
     uint32_t samples = static_cast<uint32_t>(rps * 0.4) + 12;
     samples = std::max(MIN_SAMPLES, samples);
+    if (mNumberOfMeasurementsPerValue > 0) {
+        samples = mNumberOfMeasurementsPerValue;
+    }
 
     uint32_t pwm_freq = static_cast<uint32_t>(rps * 200) + 6000;
     pwm_freq = std::min(MAX_PWM_FREQ, pwm_freq);
@@ -92,11 +95,28 @@ void SensorBLDC::modifyPulsWidthPeriode(void) const
     mPhaseCurrentSensor.setNumberOfMeasurementsForPhaseCurrentValue(samples);
 }
 
-void SensorBLDC::setPulsWidthInMill(int32_t value) const
+void SensorBLDC::setNumberOfMeasurementsPerValue(const size_t value) const
 {
-    uint32_t absVal = std::abs(value);
+    mNumberOfMeasurementsPerValue = value;
+}
+
+std::chrono::microseconds SensorBLDC::getPhaseCurrentValuePeriode(void) const
+{
+    const uint64_t ticks = static_cast<uint64_t>(mHBridge.mTim.getPeriode()) *
+                           mPhaseCurrentSensor.getNumberOfMeasurementsForPhaseCurrentValue();
+
+    return std::chrono::microseconds(ticks * 1000000 / mHBridge.mTim.getTimerFrequency());
+}
 
+void SensorBLDC::setPulsWidthInMill(int32_t value) const
+{
     modifyPulsWidthPeriode();
+    setPulsWidthInMillFromISR(value);
+}
+
+void SensorBLDC::setPulsWidthInMillFromISR(int32_t value) const
+{
+    uint32_t absVal = std::abs(value);
 
     mHBridge.setPulsWidthPerMill(absVal);
     mPhaseCurrentSensor.setPulsWidthForTriggerPerMill(absVal);
@@ -218,6 +238,23 @@ float SensorBLDC::getActualTorqueInNewtonMeter(void) const
     return getActualPhaseCurrent() * mMotorConstant;
 }
 
+float SensorBLDC::getElectricalAngle(void) const
+{
+    return HallObservers[mDescription].getAngle(mHallMeter1.getTicksSinceLastCapture());
+}
+
+float SensorBLDC::getObservedRPS(void) const
+{
+    const float radPerTick = HallObservers[mDescription].getSpeed(mHallMeter1.getTicksSinceLastCapture());
+
+    return radPerTick * mHallMeter1.mTim.getTimerFrequency() / HallObserver::TWO_PI / getNumberOfPolePairs();
+}
+
+const dev::HallObserver& SensorBLDC::getHallObserver(void) const
+{
+    return HallObservers[mDescription];
+}
+
 void SensorBLDC::manualCommutation(const size_t hallPosition) const
 {
     /*
@@ -305,6 +342,15 @@ void SensorBLDC::start(void) const
         this->computeDirection();
     });
 
+    HallObservers[mDescription].reset();
+    mHallMeter1.registerCaptureCallback([this](uint32_t ticksSinceLastEdge) {
+        HallObservers[mDescription].update(mHallDecoder.getCurrentHallState(), ticksSinceLastEdge);
+    });
+    // No edge for a whole timer period, the last interval doesn't tell the speed anymore
+    mHallMeter1.registerOverflowCallback([this] {
+        HallObservers[mDescription].reset();
+    });
+
     mHallDecoder.mTim.enable();
     mHallMeter1.mTim.enable();
     mHallMeter2.mTim.enable();
@@ -333,6 +379,8 @@ void SensorBLDC::stop(void) const
 
     mHallDecoder.unregisterHallEventCheckCallback();
     mHallDecoder.unregisterCommutationCallback();
+    mHallMeter1.unregisterCaptureCallback();
+    mHallMeter1.unregisterOverflowCallback();
 }
 
 void SensorBLDC::checkMotor(void) const
@@ -347,3 +395,4 @@ uint32_t SensorBLDC::getNumberOfPolePairs(void) const
 
 constexpr std::array<const dev::SensorBLDC,
                      dev::SensorBLDC::Description::__ENUM__SIZE> dev::Factory<dev::SensorBLDC>::Container;
+std::array<dev::HallObserver, SensorBLDC::Description::__ENUM__SIZE> SensorBLDC::HallObservers;
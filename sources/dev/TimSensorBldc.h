@@ -7,11 +7,13 @@
 
 #include <cstdint>
 #include <array>
+#include <chrono>
 #include "dev_Factory.h"
 #include "TimHalfBridge.h"
 #include "TimHallDecoder.h"
 #include "TimHallMeter.h"
 #include "PhaseCurrentSensor.h"
+#include "HallObserver.h"
 
 namespace dev
 {
@@ -39,6 +41,15 @@ struct SensorBLDC {
     float getActualPhaseCurrent(void) const;
     float getActualTorqueInNewtonMeter(void) const;
 
+    /**
+     * Electrical rotor angle in rad of the HallObserver, interpolated since
+     * the last hall edge, for sinusoidal commutation.
+     */
+    float getElectricalAngle(void) const;
+    /// Speed of the HallObserver, positive in the forward hall sequence
+    float getObservedRPS(void) const;
+    const HallObserver& getHallObserver(void) const;
+
     uint32_t getNumberOfPolePairs(void) const;
 
     Direction getSetDirection(void) const;
@@ -46,6 +57,23 @@ struct SensorBLDC {
 
     void calibrate(void) const;
     void setPulsWidthInMill(int32_t) const;
+
+    /**
+     * Only writes the compare values, which the timer takes over at the next
+     * PWM period. The PWM frequency has to be adapted with
+     * modifyPulsWidthPeriode() from a task.
+     */
+    void setPulsWidthInMillFromISR(int32_t) const;
+    void modifyPulsWidthPeriode(void) const;
+
+    /**
+     * Fixes the number of PWM periods per phase current value, 0 lets
+     * modifyPulsWidthPeriode() adapt it to the speed.
+     */
+    void setNumberOfMeasurementsPerValue(const size_t) const;
+
+    /// Time between two phase current values at the current PWM frequency
+    std::chrono::microseconds getPhaseCurrentValuePeriode(void) const;
     void start(void) const;
     void stop(void) const;
     void checkMotor(void) const;
@@ -88,6 +116,7 @@ private:
     mutable Direction mCurrentDirection = Direction::FORWARD;
     mutable size_t mLastHallPosition = 0;
     mutable bool mManualCommutationActive = true;
+    mutable size_t mNumberOfMeasurementsPerValue = 0;
 
     Direction getCurrentDirection(const size_t lastHallPosition, const size_t currentHallPosition) const;
     void computeDirection(void) const;
@@ -96,11 +125,13 @@ private:
     void commutate(const size_t hallPosition) const;
     void disableManualCommutation(const size_t hallPosition) const;
     void enableManualCommutation(void) const;
-    void modifyPulsWidthPeriode(void) const;
 
     size_t getNextHallPosition(const size_t position) const;
     size_t getPreviousHallPosition(const size_t position) const;
 
+    /// Fed by the capture interrupt of mHallMeter1, which has a 32 bit timer
+    static std::array<HallObserver, Description::__ENUM__SIZE> HallObservers;
+
     friend class Factory<SensorBLDC>;
 };
 
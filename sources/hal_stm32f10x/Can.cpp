@@ -4,13 +4,23 @@
  */
 
 #include "Can.h"
+#include "os_Task.h"
 #include "trace.h"
+#include <algorithm>
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
 using hal::Can;
 using hal::Factory;
 
+#if USB_HP_CAN1_TX_INTERRUPT_ENABLED
+void    USB_HP_CAN1_TX_IRQHandler(void)
+{
+    constexpr const Can& can = Factory<Can>::get<Can::Description::MAINCAN>();
+    Can::Can_TX_IRQHandler(can);
+}
+#endif
+
 #if USB_LP_CAN1_RX0_INTERRUPT_ENABLED
 void    USB_LP_CAN1_RX0_IRQHandler(void)
 {
@@ -28,22 +38,67 @@ void    CAN1_RX1_IRQHandler(void)
 #endif
 
 void Can::Can_IRQHandler(const Can& peripherie)
+{
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie);
+
+    if (CAN_GetITStatus(can, CAN_IT_FMP0)) {
+        peripherie.receiveFromISR(CAN_FIFO0);
+        CAN_ClearITPendingBit(can, CAN_IT_FMP0);
+    }
+    if (CAN_GetITStatus(can, CAN_IT_FMP1)) {
+        peripherie.receiveFromISR(CAN_FIFO1);
+        CAN_ClearITPendingBit(can, CAN_IT_FMP1);
+    }
+    if (CAN_GetITStatus(can, CAN_IT_FOV0)) {
+        FifoOverruns[peripherie.mDescription]++;
+        CAN_ClearITPendingBit(can, CAN_IT_FOV0);
+    }
+    if (CAN_GetITStatus(can, CAN_IT_FOV1)) {
+        FifoOverruns[peripherie.mDescription]++;
+        CAN_ClearITPendingBit(can, CAN_IT_FOV1);
+    }
+}
+
+void Can::Can_TX_IRQHandler(const Can& peripherie)
+{
+    if (CAN_GetITStatus(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_IT_TME)) {
+        peripherie.transmitCompleteFromISR();
+    }
+}
+
+void Can::receiveFromISR(const uint8_t fifo) const
 {
     static CanRxMsg msg;
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(mPeripherie);
 
-    if (CAN_GetITStatus(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_IT_FMP0)) {
-        if (Can::ReceiveInterruptCallbacks[peripherie.mDescription]) {
-            CAN_Receive(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_FIFO0, &msg);
-            Can::ReceiveInterruptCallbacks[peripherie.mDescription](msg);
-        }
-        CAN_ClearITPendingBit(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_IT_FMP0);
+    if (Can::ReceiveInterruptCallbacks[mDescription]) {
+        CAN_Receive(can, fifo, &msg);
+        ReceivedFrames[mDescription]++;
+        Can::ReceiveInterruptCallbacks[mDescription](msg);
+        return;
     }
-    if (CAN_GetITStatus(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_IT_FMP1)) {
-        if (Can::ReceiveInterruptCallbacks[peripherie.mDescription]) {
-            CAN_Receive(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_FIFO1, &msg);
-            Can::ReceiveInterruptCallbacks[peripherie.mDescription](msg);
+
+    static RxFrame tapped;
+    auto& buffer = ReceiveBuffers[mDescription];
+    const auto& tap = ReceiveTaps[mDescription];
+
+    // Drain the whole hardware FIFO, it only holds three frames
+    while (CAN_MessagePending(can, fifo)) {
+        ReceivedFrames[mDescription]++;
+        RxFrame* const slot = buffer.beginPush();
+        if ((slot == nullptr) && !tap) {
+            CAN_FIFORelease(can, fifo);
+            continue;
+        }
+        RxFrame* const frame = slot != nullptr ? slot : &tapped;
+        frame->timestamp = static_cast<uint16_t>(can->sFIFOMailBox[fifo].RDTR >> 16);
+        CAN_Receive(can, fifo, &frame->msg);
+        if (tap) {
+            tap(*frame);
+        }
+        if (slot != nullptr) {
+            buffer.commitPush();
         }
-        CAN_ClearITPendingBit(reinterpret_cast<CAN_TypeDef*>(peripherie.mPeripherie), CAN_IT_FMP1);
     }
 }
 
@@ -53,13 +108,16 @@ void Can::initialize() const
     CAN_Init(reinterpret_cast<CAN_TypeDef*>(mPeripherie), &mConfiguration);
 
     // Initialize Interrupts
+    CAN_ITConfig(reinterpret_cast<CAN_TypeDef*>(mPeripherie), CAN_IT_TME, ENABLE);
+    NVIC_SetPriority(USB_HP_CAN1_TX_IRQn, 0xf);
+    NVIC_EnableIRQ(USB_HP_CAN1_TX_IRQn);
     NVIC_SetPriority(USB_LP_CAN1_RX0_IRQn, 0xf);
     NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
     NVIC_SetPriority(CAN1_RX1_IRQn, 0xf);
     NVIC_EnableIRQ(CAN1_RX1_IRQn);
 }
 
-void Can::enableNonBlockingReceive(std::function<void(CanRxMsg)> callback) const
+void Can::enableNonBlockingReceive(utility::Delegate<void(CanRxMsg)> callback) const
 {
     ReceiveInterruptCallbacks[mDescription] = callback;
 
@@ -71,14 +129,217 @@ void Can::enableNonBlockingReceive(std::function<void(CanRxMsg)> callback) const
 
 void Can::disableNonBlockingReceive(void) const
 {
-    CAN_ITConfig(reinterpret_cast<CAN_TypeDef*>(mPeripherie), CAN_IT_FMP0 | CAN_IT_FMP1, DISABLE);
+    CAN_ITConfig(reinterpret_cast<CAN_TypeDef*>(mPeripherie),
+                 CAN_IT_FMP0 | CAN_IT_FMP1 | CAN_IT_FOV0 | CAN_IT_FOV1,
+                 DISABLE);
+}
+
+void Can::enableBufferedReceive(void) const
+{
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(mPeripherie);
+
+    disableNonBlockingReceive();
+    ReceiveInterruptCallbacks[mDescription] = nullptr;
+    ReceiveBuffers[mDescription].reset();
+
+    CAN_ClearITPendingBit(can, CAN_IT_FOV0);
+    CAN_ClearITPendingBit(can, CAN_IT_FOV1);
+
+    CAN_ITConfig(can, CAN_IT_FMP0 | CAN_IT_FMP1 | CAN_IT_FOV0 | CAN_IT_FOV1, ENABLE);
+}
+
+utility::RingBuffer<Can::RxFrame, Can::RX_BUFFER_SIZE>& Can::receiveBuffer(void) const
+{
+    return ReceiveBuffers[mDescription];
+}
+
+bool Can::receiveBuffered(RxFrame& frame) const
+{
+    return ReceiveBuffers[mDescription].pop(frame);
+}
+
+size_t Can::framesBuffered(void) const
+{
+    return ReceiveBuffers[mDescription].size();
+}
+
+Can::RxStatistics Can::getRxStatistics(void) const
+{
+    return RxStatistics {ReceivedFrames[mDescription],
+                         ReceiveBuffers[mDescription].getOverrunCount(),
+                         FifoOverruns[mDescription]};
+}
+
+void Can::setReceiveTap(utility::Delegate<void(const RxFrame&)> tap) const
+{
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(mPeripherie);
+
+    // The receive interrupt must not see a half assigned function object
+    const uint32_t enabled = can->IER & (CAN_IT_FMP0 | CAN_IT_FMP1);
+    CAN_ITConfig(can, CAN_IT_FMP0 | CAN_IT_FMP1, DISABLE);
+    ReceiveTaps[mDescription] = tap;
+    can->IER |= enabled;
 }
 
 bool Can::send(CanTxMsg& msg) const
 {
-    auto ret = CAN_Transmit(reinterpret_cast<CAN_TypeDef*>(mPeripherie), &msg);
+    os::ThisTask::enterCriticalSection();
+    const bool queued = enqueue(msg, false);
+    refillMailboxes();
+    os::ThisTask::exitCriticalSection();
+    return queued;
+}
+
+bool Can::sendFromISR(CanTxMsg& msg) const
+{
+    const uint32_t savedInterruptStatus = os::ThisTask::enterCriticalSectionFromISR();
+    const bool queued = enqueue(msg, false);
+    refillMailboxes();
+    os::ThisTask::exitCriticalSectionFromISR(savedInterruptStatus);
+    return queued;
+}
+
+size_t Can::txQueueDepth(void) const
+{
+    return TxStates[mDescription].statistics.depth;
+}
+
+Can::TxStatistics Can::getTxStatistics(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    const TxStatistics statistics = TxStates[mDescription].statistics;
+    os::ThisTask::exitCriticalSection();
+    return statistics;
+}
+
+void Can::enableTxPriorityAbort(const bool enable) const
+{
+    TxStates[mDescription].abortEnabled = enable;
+}
+
+bool Can::enqueue(const CanTxMsg& msg, const bool beforeEqualPriority) const
+{
+    TxState& state = TxStates[mDescription];
+    TxStatistics& statistics = state.statistics;
+
+    if (statistics.depth >= TX_QUEUE_SIZE) {
+        statistics.dropped++;
+        return false;
+    }
+
+    const uint32_t key = arbitrationKey(msg);
+    size_t position = statistics.depth;
+
+    while (position > 0) {
+        const uint32_t other = arbitrationKey(state.queue[position - 1]);
+        if ((other < key) || ((other == key) && !beforeEqualPriority)) {
+            break;
+        }
+        state.queue[position] = state.queue[position - 1];
+        position--;
+    }
+    state.queue[position] = msg;
+
+    statistics.depth++;
+    statistics.maxDepth = std::max(statistics.maxDepth, statistics.depth);
+    return true;
+}
+
+void Can::refillMailboxes(void) const
+{
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(mPeripherie);
+    TxState& state = TxStates[mDescription];
+    TxStatistics& statistics = state.statistics;
+    size_t index = 0;
+
+    while ((index < statistics.depth) && (can->TSR & CAN_TSR_TME)) {
+        const uint32_t key = arbitrationKey(state.queue[index]);
+
+        // The hardware sends pending frames with equal identifiers ordered by
+        // mailbox number. Only one of them may be pending to keep their order.
+        const bool blocked = std::any_of(state.mailboxes.begin(), state.mailboxes.end(),
+                                         [key](const TxMailbox& m) { return m.busy && (m.key == key); });
+        if (blocked) {
+            index++;
+            continue;
+        }
+
+        const uint8_t mailbox = CAN_Transmit(can, &state.queue[index]);
+        if (mailbox == CAN_TxStatus_NoMailBox) {
+            break;
+        }
+        state.mailboxes[mailbox] = TxMailbox {state.queue[index], key, true, false};
 
-    return ret != CAN_TxStatus_NoMailBox;
+        std::copy(state.queue.begin() + index + 1, state.queue.begin() + statistics.depth,
+                  state.queue.begin() + index);
+        statistics.depth--;
+    }
+
+    if (state.abortEnabled && (statistics.depth > 0)) {
+        abortLowerPriorityMailbox();
+    }
+}
+
+void Can::abortLowerPriorityMailbox(void) const
+{
+    TxState& state = TxStates[mDescription];
+    TxMailbox* lowest = nullptr;
+
+    for (auto& mailbox : state.mailboxes) {
+        if (!mailbox.busy) {
+            return;
+        }
+        if (mailbox.abortRequested) {
+            continue;
+        }
+        if ((lowest == nullptr) || (mailbox.key > lowest->key)) {
+            lowest = &mailbox;
+        }
+    }
+
+    if ((lowest != nullptr) && (arbitrationKey(state.queue[0]) < lowest->key)) {
+        lowest->abortRequested = true;
+        CAN_CancelTransmit(reinterpret_cast<CAN_TypeDef*>(mPeripherie),
+                           static_cast<uint8_t>(lowest - state.mailboxes.data()));
+    }
+}
+
+void Can::transmitCompleteFromISR(void) const
+{
+    static constexpr std::array<uint32_t, NUMBER_OF_TX_MAILBOXES> REQUEST_COMPLETED = {
+        CAN_TSR_RQCP0, CAN_TSR_RQCP1, CAN_TSR_RQCP2
+    };
+    static constexpr std::array<uint32_t, NUMBER_OF_TX_MAILBOXES> TRANSMISSION_OK = {
+        CAN_TSR_TXOK0, CAN_TSR_TXOK1, CAN_TSR_TXOK2
+    };
+
+    CAN_TypeDef* const can = reinterpret_cast<CAN_TypeDef*>(mPeripherie);
+    TxState& state = TxStates[mDescription];
+    const uint32_t tsr = can->TSR;
+
+    for (size_t i = 0; i < NUMBER_OF_TX_MAILBOXES; i++) {
+        if ((tsr & REQUEST_COMPLETED[i]) == 0) {
+            continue;
+        }
+        // write one to clear RQCP, TXOK, ALST and TERR of this mailbox
+        can->TSR = REQUEST_COMPLETED[i];
+
+        TxMailbox& mailbox = state.mailboxes[i];
+        if (!mailbox.busy) {
+            continue;
+        }
+        mailbox.busy = false;
+
+        if (tsr & TRANSMISSION_OK[i]) {
+            state.statistics.sent++;
+        } else if (mailbox.abortRequested) {
+            state.statistics.aborted++;
+            enqueue(mailbox.msg, true);
+        } else {
+            state.statistics.errors++;
+        }
+    }
+    refillMailboxes();
 }
 
 size_t Can::messagePending(void) const
@@ -112,6 +373,11 @@ void Can::clearOverRunError(void) const
 }
 
 Can::ReceiveCallbackArray Can::ReceiveInterruptCallbacks;
+Can::ReceiveBufferArray Can::ReceiveBuffers;
+Can::ReceiveTapArray Can::ReceiveTaps;
+Can::CounterArray Can::ReceivedFrames;
+Can::CounterArray Can::FifoOverruns;
+Can::TxStateArray Can::TxStates;
 
 constexpr const std::array<const Can, Can::__ENUM__SIZE + 1> Factory<Can>::Container;
-constexpr const std::array<const CAN_FilterInitTypeDef, 1> Factory<Can>::CanFilterContainer;
+constexpr const hal::CanFilterBanks Factory<Can>::CanFilterContainer;
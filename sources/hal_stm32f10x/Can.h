@@ -8,12 +8,15 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
+#include "ringBuffer.h"
+#include "CanFilterCompiler.h"
 #include "stm32f10x_can.h"
 #include "stm32f10x_rcc.h"
 #include "hal_Factory.h"
 
 extern "C" {
+void    USB_HP_CAN1_TX_IRQHandler(void);
 void    USB_LP_CAN1_RX0_IRQHandler(void);
 void    CAN1_RX1_IRQHandler(void);
 }
@@ -23,6 +26,35 @@ namespace hal
 struct Can {
 #include "Can_config.h"
 
+    static constexpr size_t RX_BUFFER_SIZE = 32;
+    static constexpr size_t TX_QUEUE_SIZE = 16;
+    static constexpr size_t NUMBER_OF_TX_MAILBOXES = 3;
+
+    /**
+     * Received frame with the bxCAN time stamp of its start of frame.
+     * The time stamp counts bit times and is only valid if CAN_TTCM is
+     * enabled in the configuration.
+     */
+    struct RxFrame {
+        uint16_t timestamp;
+        CanRxMsg msg;
+    };
+
+    struct RxStatistics {
+        uint32_t received;
+        uint32_t bufferOverruns;
+        uint32_t fifoOverruns;
+    };
+
+    struct TxStatistics {
+        uint32_t depth;
+        uint32_t maxDepth;
+        uint32_t sent;
+        uint32_t dropped;
+        uint32_t aborted;
+        uint32_t errors;
+    };
+
     const enum Description mDescription;
 
     Can() = delete;
@@ -34,14 +66,80 @@ struct Can {
     bool hasOverRunError(void) const;
     void clearOverRunError(void) const;
 
+    /**
+     * Queues a frame for transmission. The queue is ordered by CAN arbitration
+     * priority, frames with equal identifiers keep their order. The transmit
+     * mailbox empty interrupt refills the three hardware mailboxes.
+     * Must not be called from an interrupt.
+     * @return false if the frame was dropped because the queue is full
+     */
     bool send(CanTxMsg&) const;
+
+    /// Same as send(), for interrupts at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+    bool sendFromISR(CanTxMsg&) const;
+    size_t txQueueDepth(void) const;
+    TxStatistics getTxStatistics(void) const;
+
+    /**
+     * If enabled, a queued frame aborts the lowest priority pending mailbox
+     * when all mailboxes are busy with frames of lower priority. The aborted
+     * frame is put back into the queue.
+     */
+    void enableTxPriorityAbort(const bool enable) const;
     size_t messagePending(void) const;
     bool receive(CanRxMsg& msg) const;
 
-    void enableNonBlockingReceive(std::function<void(CanRxMsg)> callback) const;
+    void enableNonBlockingReceive(utility::Delegate<void(CanRxMsg)> callback) const;
     void disableNonBlockingReceive(void) const;
 
+    /**
+     * Drains both hardware FIFOs from the receive interrupt into a lock-free
+     * software buffer. A previously registered receive callback is removed.
+     */
+    void enableBufferedReceive(void) const;
+    bool receiveBuffered(RxFrame& frame) const;
+    size_t framesBuffered(void) const;
+    RxStatistics getRxStatistics(void) const;
+
+    /**
+     * Installs a function called from the receive interrupt with every frame
+     * received in buffered mode, even if the receive buffer is full. Meant for
+     * bus logging, pass nullptr to remove it.
+     */
+    void setReceiveTap(utility::Delegate<void(const RxFrame&)> tap) const;
+
+    /**
+     * Hands every buffered frame to dispatcher.dispatch(const RxFrame&).
+     * @return number of dispatched frames
+     */
+    template<typename Dispatcher>
+    size_t dispatchBuffered(const Dispatcher& dispatcher) const
+    {
+        auto& buffer = receiveBuffer();
+        size_t count = 0;
+
+        for (const RxFrame* frame = buffer.front(); frame != nullptr; frame = buffer.front()) {
+            dispatcher.dispatch(*frame);
+            buffer.commitPop();
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * Arbitration field in transmission order: base identifier, RTR/SRR, IDE,
+     * identifier extension. Lower values win the arbitration on the bus.
+     */
+    static constexpr uint32_t arbitrationKey(const CanTxMsg& msg)
+    {
+        if (msg.IDE == CAN_Id_Standard) {
+            return ((msg.StdId & 0x7ff) << 20) | (msg.RTR == CAN_RTR_Remote ? (1 << 19) : 0);
+        }
+        return (((msg.ExtId >> 18) & 0x7ff) << 20) | (1 << 19) | (1 << 18) | (msg.ExtId & 0x3ffff);
+    }
+
     static void Can_IRQHandler(const Can& peripherie);
+    static void Can_TX_IRQHandler(const Can& peripherie);
 
 private:
     constexpr Can(const enum Description& desc,
@@ -55,10 +153,44 @@ private:
     const CAN_InitTypeDef mConfiguration;
 
     void initialize(void) const;
+    void receiveFromISR(const uint8_t fifo) const;
+    utility::RingBuffer<RxFrame, RX_BUFFER_SIZE>& receiveBuffer(void) const;
+
+    bool enqueue(const CanTxMsg& msg, const bool beforeEqualPriority) const;
+    void refillMailboxes(void) const;
+    void abortLowerPriorityMailbox(void) const;
+    void transmitCompleteFromISR(void) const;
 
-    using ReceiveCallbackArray = std::array<std::function<void (CanRxMsg)>, Can::__ENUM__SIZE>;
+    using ReceiveCallbackArray = std::array<utility::Delegate<void (CanRxMsg)>, Can::__ENUM__SIZE>;
     static ReceiveCallbackArray ReceiveInterruptCallbacks;
 
+    using ReceiveBufferArray = std::array<utility::RingBuffer<RxFrame, RX_BUFFER_SIZE>, Can::__ENUM__SIZE>;
+    static ReceiveBufferArray ReceiveBuffers;
+
+    using ReceiveTapArray = std::array<utility::Delegate<void (const RxFrame&)>, Can::__ENUM__SIZE>;
+    static ReceiveTapArray ReceiveTaps;
+
+    using CounterArray = std::array<uint32_t, Can::__ENUM__SIZE>;
+    static CounterArray ReceivedFrames;
+    static CounterArray FifoOverruns;
+
+    struct TxMailbox {
+        CanTxMsg msg;
+        uint32_t key;
+        bool busy;
+        bool abortRequested;
+    };
+
+    struct TxState {
+        std::array<CanTxMsg, TX_QUEUE_SIZE> queue;
+        std::array<TxMailbox, NUMBER_OF_TX_MAILBOXES> mailboxes;
+        bool abortEnabled;
+        TxStatistics statistics;
+    };
+
+    using TxStateArray = std::array<TxState, Can::__ENUM__SIZE>;
+    static TxStateArray TxStates;
+
     friend class Factory<Can>;
 };
 
@@ -88,6 +220,11 @@ public:
         static_assert(IS_CAN_BS2(Container[index].mConfiguration.CAN_BS2), "Invalid Parameter ");
         static_assert(IS_CAN_PRESCALER(Container[index].mConfiguration.CAN_Prescaler), "Invalid Parameter");
 
+#ifndef CAN_ALLOW_SOFTWARE_FILTERING
+        static_assert(!CanFilterContainer.requiresSoftwareFiltering(),
+                      "CAN filter banks exhausted, define CAN_ALLOW_SOFTWARE_FILTERING to accept a superset");
+#endif
+
         static_assert(index != Can::Description::__ENUM__SIZE, "__ENUM__SIZE is not accessible");
         static_assert(index < Container[index + 1].mDescription, "Incorrect order of instances in Factory");
         static_assert(Container[index].mDescription == index, "Wrong mapping between Description and Container");
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "Can.h"
+
+namespace hal
+{
+struct CanDispatchEntry {
+    using Handler = void (*)(const Can::RxFrame&);
+
+    /// Marks an extended identifier inside a dispatch key
+    static constexpr uint32_t EXTENDED_ID = 0x80000000;
+
+    uint32_t key;
+    Handler handler;
+
+    static constexpr CanDispatchEntry standard(const uint32_t stdId, const Handler h)
+    {
+        return CanDispatchEntry {stdId & 0x7ff, h};
+    }
+
+    static constexpr CanDispatchEntry extended(const uint32_t extId, const Handler h)
+    {
+        return CanDispatchEntry {EXTENDED_ID | (extId & 0x1fffffff), h};
+    }
+
+    static constexpr uint32_t keyOf(const CanRxMsg& msg)
+    {
+        return msg.IDE == CAN_Id_Standard ? msg.StdId : (EXTENDED_ID | msg.ExtId);
+    }
+};
+
+/**
+ * Routes received frames to their consumers by CAN identifier.
+ *
+ * The table is built and sorted at compile time. Dispatching a frame is a
+ * binary search over a constant array followed by a plain function pointer
+ * call, so there is neither a switch statement nor a std::function copy per
+ * frame. Frames without an entry are passed to the fallback handler, if any.
+ *
+ * @code
+ * static constexpr auto table = hal::makeCanDispatchTable(
+ *     hal::CanDispatchEntry::standard(0x3c9, onSpeed),
+ *     hal::CanDispatchEntry::standard(0x210, onFuelLevel));
+ * static_assert(table.hasUniqueKeys(), "Duplicated CAN id in dispatch table");
+ * can.dispatchBuffered(table);
+ * @endcode
+ */
+template<size_t n>
+class CanDispatchTable
+{
+    std::array<CanDispatchEntry, n> mEntries;
+    CanDispatchEntry::Handler mFallback;
+
+    static constexpr std::array<CanDispatchEntry, n> sort(std::array<CanDispatchEntry, n> entries)
+    {
+        for (size_t i = 1; i < n; i++) {
+            const CanDispatchEntry tmp = entries[i];
+            size_t j = i;
+            for ( ; j > 0 && entries[j - 1].key > tmp.key; j--) {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = tmp;
+        }
+        return entries;
+    }
+
+public:
+    constexpr CanDispatchTable(const std::array<CanDispatchEntry, n>& entries,
+                               const CanDispatchEntry::Handler fallback = nullptr) :
+        mEntries(sort(entries)), mFallback(fallback) {}
+
+    constexpr bool hasUniqueKeys(void) const
+    {
+        for (size_t i = 1; i < n; i++) {
+            if (mEntries[i - 1].key == mEntries[i].key) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr CanDispatchEntry::Handler find(const uint32_t key) const
+    {
+        size_t first = 0;
+        size_t last = n;
+
+        while (first < last) {
+            const size_t middle = first + (last - first) / 2;
+            if (mEntries[middle].key < key) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return (first < n && mEntries[first].key == key) ? mEntries[first].handler : mFallback;
+    }
+
+    /// @return true if a handler was called
+    bool dispatch(const Can::RxFrame& frame) const
+    {
+        const CanDispatchEntry::Handler handler = find(CanDispatchEntry::keyOf(frame.msg));
+        if (handler == nullptr) {
+            return false;
+        }
+        handler(frame);
+        return true;
+    }
+
+    static constexpr size_t size(void)
+    {
+        return n;
+    }
+};
+
+template<typename ... Entries>
+constexpr CanDispatchTable<sizeof ... (Entries)> makeCanDispatchTable(const Entries& ... entries)
+{
+    return CanDispatchTable<sizeof ... (Entries)>(std::array<CanDispatchEntry, sizeof ... (Entries)> {{entries ...}});
+}
+
+template<typename ... Entries>
+constexpr CanDispatchTable<sizeof ... (Entries)> makeCanDispatchTableWithFallback(
+                                                                                  const CanDispatchEntry::Handler fallback,
+                                                                                  const Entries& ... entries)
+{
+    return CanDispatchTable<sizeof ... (Entries)>(std::array<CanDispatchEntry, sizeof ... (Entries)> {{entries ...}},
+                                                 fallback);
+}
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <cstring>
+
+#include "unittest.h"
+#include "CanDispatchTable.h"
+
+#define NUM_TEST_LOOPS 255
+
+//--------------------------BUFFERS--------------------------
+uint32_t g_lastHandler;
+uint16_t g_lastTimestamp;
+
+//--------------------------MOCKING--------------------------
+
+static void handlerA(const hal::Can::RxFrame& f) { g_lastHandler = 0xa; g_lastTimestamp = f.timestamp; }
+static void handlerB(const hal::Can::RxFrame& f) { g_lastHandler = 0xb; g_lastTimestamp = f.timestamp; }
+static void handlerC(const hal::Can::RxFrame& f) { g_lastHandler = 0xc; g_lastTimestamp = f.timestamp; }
+static void fallback(const hal::Can::RxFrame& f) { g_lastHandler = 0xf; g_lastTimestamp = f.timestamp; }
+
+static hal::Can::RxFrame makeFrame(const uint32_t id, const bool extended, const uint16_t timestamp)
+{
+    hal::Can::RxFrame frame;
+    std::memset(&frame, 0, sizeof(frame));
+    frame.timestamp = timestamp;
+    frame.msg.IDE = extended ? CAN_Id_Extended : CAN_Id_Standard;
+    if (extended) {
+        frame.msg.ExtId = id;
+    } else {
+        frame.msg.StdId = id;
+    }
+    return frame;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_SortedAtCompileTime(void)
+{
+    TestCaseBegin();
+
+    constexpr auto table = hal::makeCanDispatchTable(hal::CanDispatchEntry::standard(0x7ff, handlerA),
+                                                     hal::CanDispatchEntry::standard(0x001, handlerB),
+                                                     hal::CanDispatchEntry::extended(0x001, handlerC));
+
+    static_assert(table.size() == 3, "Wrong table size");
+    static_assert(table.hasUniqueKeys(), "Keys are unique");
+    static_assert(table.find(0x7ff) == handlerA, "Lookup failed");
+    static_assert(table.find(0x001) == handlerB, "Lookup failed");
+    static_assert(table.find(hal::CanDispatchEntry::EXTENDED_ID | 0x001) == handlerC, "Lookup failed");
+    static_assert(table.find(0x002) == nullptr, "Lookup failed");
+
+    constexpr auto duplicated = hal::makeCanDispatchTable(hal::CanDispatchEntry::standard(0x10, handlerA),
+                                                          hal::CanDispatchEntry::standard(0x20, handlerB),
+                                                          hal::CanDispatchEntry::standard(0x10, handlerC));
+    static_assert(!duplicated.hasUniqueKeys(), "Duplicated key not detected");
+
+    TestCaseEnd();
+}
+
+int ut_Dispatch(void)
+{
+    TestCaseBegin();
+
+    static constexpr auto table = hal::makeCanDispatchTable(hal::CanDispatchEntry::standard(0x123, handlerA),
+                                                            hal::CanDispatchEntry::standard(0x456, handlerB),
+                                                            hal::CanDispatchEntry::extended(0x123, handlerC));
+
+    g_lastHandler = 0;
+    CHECK(table.dispatch(makeFrame(0x456, false, 42)));
+    CHECK(g_lastHandler == 0xb);
+    CHECK(g_lastTimestamp == 42);
+
+    CHECK(table.dispatch(makeFrame(0x123, false, 1)));
+    CHECK(g_lastHandler == 0xa);
+
+    CHECK(table.dispatch(makeFrame(0x123, true, 2)));
+    CHECK(g_lastHandler == 0xc);
+
+    g_lastHandler = 0;
+    CHECK(!table.dispatch(makeFrame(0x124, false, 3)));
+    CHECK(g_lastHandler == 0);
+
+    TestCaseEnd();
+}
+
+int ut_Fallback(void)
+{
+    TestCaseBegin();
+
+    static constexpr auto table = hal::makeCanDispatchTableWithFallback(fallback,
+                                                                        hal::CanDispatchEntry::standard(0x1, handlerA));
+
+    g_lastHandler = 0;
+    CHECK(table.dispatch(makeFrame(0x2, false, 7)));
+    CHECK(g_lastHandler == 0xf);
+    CHECK(g_lastTimestamp == 7);
+
+    CHECK(table.dispatch(makeFrame(0x1, false, 8)));
+    CHECK(g_lastHandler == 0xa);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_SortedAtCompileTime);
+    RunTest(true, ut_Dispatch);
+    RunTest(true, ut_Fallback);
+    UnitTestMainEnd();
+}
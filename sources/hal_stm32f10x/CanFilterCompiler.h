@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "stm32f10x_can.h"
+
+namespace hal
+{
+/**
+ * Identifier or identifier range an application wants to receive.
+ * Only data frames are accepted.
+ */
+struct CanIdRange {
+    uint32_t first;
+    uint32_t last;
+    bool isExtended;
+
+    static constexpr CanIdRange standard(const uint32_t id)
+    {
+        return CanIdRange {id, id, false};
+    }
+
+    static constexpr CanIdRange standard(const uint32_t first, const uint32_t last)
+    {
+        return CanIdRange {first, last, false};
+    }
+
+    static constexpr CanIdRange extended(const uint32_t id)
+    {
+        return CanIdRange {id, id, true};
+    }
+
+    static constexpr CanIdRange extended(const uint32_t first, const uint32_t last)
+    {
+        return CanIdRange {first, last, true};
+    }
+};
+
+/**
+ * Result of the filter compilation. Iterating over it yields the filter banks
+ * which have to be passed to CAN_FilterInit().
+ */
+struct CanFilterBanks {
+    static constexpr size_t NUMBER_OF_BANKS = 14;
+
+    std::array<CAN_FilterInitTypeDef, NUMBER_OF_BANKS> banks;
+    size_t used;
+    size_t required;
+
+    /// True if the ranges did not fit into the hardware and the last bank accepts a superset
+    constexpr bool requiresSoftwareFiltering(void) const
+    {
+        return required > NUMBER_OF_BANKS;
+    }
+
+    constexpr const CAN_FilterInitTypeDef* begin(void) const
+    {
+        return banks.data();
+    }
+
+    constexpr const CAN_FilterInitTypeDef* end(void) const
+    {
+        return banks.data() + used;
+    }
+
+    constexpr size_t size(void) const
+    {
+        return used;
+    }
+};
+
+/**
+ * Computes the acceptance filter bank setup of the bxCAN at compile time.
+ *
+ * Ranges are split into aligned identifier/mask blocks. Exact standard
+ * identifiers are packed four per bank (16 bit list mode), standard blocks two
+ * per bank (16 bit mask mode), exact extended identifiers two per bank (32 bit
+ * list mode) and extended blocks one per bank (32 bit mask mode). The split
+ * between list and mask banks for standard identifiers is chosen to use the
+ * least number of banks. Banks are assigned alternating to FIFO 0 and FIFO 1.
+ *
+ * If more than 14 banks are required, the surplus is merged into the last bank
+ * which then accepts a superset. This is reported by requiresSoftwareFiltering()
+ * and rejected at compile time by Factory<Can>, unless the configuration sets
+ * CAN_ALLOW_SOFTWARE_FILTERING.
+ */
+namespace CanFilterCompiler
+{
+static constexpr uint32_t STD_MASK = 0x7ff;
+static constexpr uint32_t EXT_MASK = 0x1fffffff;
+
+// 32 bit filter register layout
+static constexpr uint32_t REG32_IDE = 0x4;
+static constexpr uint32_t REG32_RTR = 0x2;
+
+// 16 bit filter register layout
+static constexpr uint16_t REG16_RTR = 0x10;
+static constexpr uint16_t REG16_IDE = 0x08;
+
+struct Block {
+    uint32_t id;
+    uint32_t mask;
+    bool isExtended;
+
+    constexpr bool isExact(void) const
+    {
+        return mask == (isExtended ? EXT_MASK : STD_MASK);
+    }
+
+    constexpr uint32_t value32(void) const
+    {
+        return isExtended ? ((id << 3) | REG32_IDE) : (id << 21);
+    }
+
+    constexpr uint32_t mask32(void) const
+    {
+        return (isExtended ? (mask << 3) : (mask << 21)) | REG32_IDE | REG32_RTR;
+    }
+
+    constexpr uint16_t value16(void) const
+    {
+        return static_cast<uint16_t>(id << 5);
+    }
+
+    constexpr uint16_t mask16(void) const
+    {
+        return static_cast<uint16_t>((mask << 5) | REG16_RTR | REG16_IDE);
+    }
+};
+
+// Worst case of an arbitrary range split into aligned blocks
+static constexpr size_t MAX_BLOCKS_PER_RANGE = 2 * 29;
+
+template<size_t n>
+struct BlockList {
+    std::array<Block, n * MAX_BLOCKS_PER_RANGE + 1> blocks {};
+    size_t count = 0;
+
+    constexpr void add(const Block& b)
+    {
+        for (size_t i = 0; i < count; i++) {
+            if ((blocks[i].id == b.id) && (blocks[i].mask == b.mask) && (blocks[i].isExtended == b.isExtended)) {
+                return;
+            }
+        }
+        blocks[count++] = b;
+    }
+};
+
+template<size_t n>
+constexpr void split(BlockList<n>& list, const CanIdRange& range)
+{
+    const uint32_t fullMask = range.isExtended ? EXT_MASK : STD_MASK;
+    uint64_t first = range.first & fullMask;
+    const uint64_t last = range.last & fullMask;
+
+    while (first <= last) {
+        uint64_t size = first == 0 ? (uint64_t(fullMask) + 1) : (first & (~first + 1));
+        while (first + size - 1 > last) {
+            size >>= 1;
+        }
+        list.add(Block {static_cast<uint32_t>(first), static_cast<uint32_t>(~(size - 1)) & fullMask, range.isExtended});
+        first += size;
+    }
+}
+
+constexpr size_t divideRoundUp(const size_t a, const size_t b)
+{
+    return (a + b - 1) / b;
+}
+
+struct Bank {
+    CAN_FilterInitTypeDef init;
+    std::array<uint32_t, 4> values;
+    std::array<uint32_t, 4> masks;
+    size_t entries;
+};
+
+template<size_t n>
+struct BankList {
+    std::array<Bank, n * MAX_BLOCKS_PER_RANGE + 1> banks {};
+    size_t count = 0;
+
+    constexpr Bank& next(const uint8_t mode, const uint8_t scale)
+    {
+        Bank& bank = banks[count];
+        bank.init = CAN_FilterInitTypeDef {0, 0, 0, 0, 0, 0, mode, scale, ENABLE};
+        bank.entries = 0;
+        count++;
+        return bank;
+    }
+};
+
+constexpr void remember(Bank& bank, const Block& block)
+{
+    bank.values[bank.entries] = block.value32();
+    bank.masks[bank.entries] = block.mask32();
+    bank.entries++;
+}
+
+constexpr CAN_FilterInitTypeDef mask32Bank(const uint32_t value, const uint32_t mask)
+{
+    return CAN_FilterInitTypeDef {static_cast<uint16_t>(value >> 16), static_cast<uint16_t>(value),
+                                  static_cast<uint16_t>(mask >> 16), static_cast<uint16_t>(mask),
+                                  0, 0, CAN_FilterMode_IdMask, CAN_FilterScale_32bit, ENABLE};
+}
+
+template<size_t n>
+constexpr CanFilterBanks compile(const std::array<CanIdRange, n>& ranges)
+{
+    BlockList<n> all {};
+    for (const auto& range : ranges) {
+        split(all, range);
+    }
+
+    BlockList<n> stdExact {}, stdBlocks {}, extExact {}, extBlocks {};
+    for (size_t i = 0; i < all.count; i++) {
+        const Block& b = all.blocks[i];
+        if (b.isExtended) {
+            b.isExact() ? extExact.add(b) : extBlocks.add(b);
+        } else {
+            b.isExact() ? stdExact.add(b) : stdBlocks.add(b);
+        }
+    }
+
+    BankList<n> banks {};
+    size_t stdExactUsed = 0;
+
+    // 32 bit list mode: two exact extended identifiers per bank. A free slot
+    // takes an exact standard identifier.
+    for (size_t i = 0; i < extExact.count; i += 2) {
+        Bank& bank = banks.next(CAN_FilterMode_IdList, CAN_FilterScale_32bit);
+        const Block& a = extExact.blocks[i];
+        const Block& b = (i + 1 < extExact.count) ? extExact.blocks[i + 1] :
+                         (stdExactUsed < stdExact.count ? stdExact.blocks[stdExactUsed++] : a);
+        bank.init.CAN_FilterIdHigh = static_cast<uint16_t>(a.value32() >> 16);
+        bank.init.CAN_FilterIdLow = static_cast<uint16_t>(a.value32());
+        bank.init.CAN_FilterMaskIdHigh = static_cast<uint16_t>(b.value32() >> 16);
+        bank.init.CAN_FilterMaskIdLow = static_cast<uint16_t>(b.value32());
+        remember(bank, a);
+        remember(bank, b);
+    }
+
+    // 32 bit mask mode: one extended block per bank
+    for (size_t i = 0; i < extBlocks.count; i++) {
+        Bank& bank = banks.next(CAN_FilterMode_IdMask, CAN_FilterScale_32bit);
+        const Block& a = extBlocks.blocks[i];
+        bank.init = mask32Bank(a.value32(), a.mask32());
+        remember(bank, a);
+    }
+
+    // Choose the number of 16 bit list banks which minimizes the total number of banks
+    const size_t exactLeft = stdExact.count - stdExactUsed;
+    size_t listBanks = 0;
+    size_t bestTotal = divideRoundUp(stdBlocks.count + exactLeft, 2);
+    for (size_t k = 1; k <= divideRoundUp(exactLeft, 4); k++) {
+        const size_t inList = (4 * k < exactLeft) ? 4 * k : exactLeft;
+        const size_t total = k + divideRoundUp(stdBlocks.count + exactLeft - inList, 2);
+        if (total < bestTotal) {
+            bestTotal = total;
+            listBanks = k;
+        }
+    }
+
+    // 16 bit list mode: four exact standard identifiers per bank
+    for (size_t k = 0; k < listBanks; k++) {
+        Bank& bank = banks.next(CAN_FilterMode_IdList, CAN_FilterScale_16bit);
+        std::array<uint16_t, 4> ids {};
+        for (size_t slot = 0; slot < ids.size(); slot++) {
+            const Block& b = stdExactUsed < stdExact.count ? stdExact.blocks[stdExactUsed++] :
+                             stdExact.blocks[stdExactUsed - 1];
+            ids[slot] = b.value16();
+            remember(bank, b);
+        }
+        bank.init.CAN_FilterIdLow = ids[0];
+        bank.init.CAN_FilterMaskIdLow = ids[1];
+        bank.init.CAN_FilterIdHigh = ids[2];
+        bank.init.CAN_FilterMaskIdHigh = ids[3];
+    }
+
+    // 16 bit mask mode: two standard blocks per bank, remaining exact
+    // identifiers are handled as blocks with a full mask
+    BlockList<n> rest {};
+    for (size_t i = stdExactUsed; i < stdExact.count; i++) {
+        rest.add(stdExact.blocks[i]);
+    }
+    for (size_t i = 0; i < stdBlocks.count; i++) {
+        rest.add(stdBlocks.blocks[i]);
+    }
+    for (size_t i = 0; i < rest.count; i += 2) {
+        Bank& bank = banks.next(CAN_FilterMode_IdMask, CAN_FilterScale_16bit);
+        const Block& a = rest.blocks[i];
+        const Block& b = (i + 1 < rest.count) ? rest.blocks[i + 1] : a;
+        bank.init.CAN_FilterIdLow = a.value16();
+        bank.init.CAN_FilterMaskIdLow = a.mask16();
+        bank.init.CAN_FilterIdHigh = b.value16();
+        bank.init.CAN_FilterMaskIdHigh = b.mask16();
+        remember(bank, a);
+        remember(bank, b);
+    }
+
+    CanFilterBanks result {};
+    result.required = banks.count;
+    result.used = banks.count < CanFilterBanks::NUMBER_OF_BANKS ? banks.count : CanFilterBanks::NUMBER_OF_BANKS;
+
+    for (size_t i = 0; i < result.used; i++) {
+        result.banks[i] = banks.banks[i].init;
+    }
+
+    if (result.requiresSoftwareFiltering()) {
+        // Merge all surplus entries into one 32 bit mask bank which accepts a superset
+        const size_t lastBank = CanFilterBanks::NUMBER_OF_BANKS - 1;
+        uint32_t value = banks.banks[lastBank].values[0];
+        uint32_t mask = 0xffffffff;
+        for (size_t i = lastBank; i < banks.count; i++) {
+            const Bank& bank = banks.banks[i];
+            for (size_t e = 0; e < bank.entries; e++) {
+                mask &= bank.masks[e] & ~(bank.values[e] ^ value);
+            }
+        }
+        result.banks[lastBank] = mask32Bank(value & mask, mask);
+    }
+
+    for (size_t i = 0; i < result.used; i++) {
+        result.banks[i].CAN_FilterNumber = static_cast<uint8_t>(i);
+        result.banks[i].CAN_FilterFIFOAssignment = static_cast<uint16_t>(i % 2 == 0 ? CAN_Filter_FIFO0 : CAN_Filter_FIFO1);
+    }
+    return result;
+}
+}
+
+template<typename ... Ranges>
+constexpr CanFilterBanks makeCanFilterBanks(const Ranges& ... ranges)
+{
+    return CanFilterCompiler::compile(std::array<CanIdRange, sizeof ... (Ranges)> {{ranges ...}});
+}
+}
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <cstdlib>
+
+#include "unittest.h"
+#include "CanFilterCompiler.h"
+
+#define NUM_TEST_LOOPS 100000
+
+using hal::CanIdRange;
+
+//--------------------------BUFFERS--------------------------
+
+static constexpr auto g_standardFilters = hal::makeCanFilterBanks(CanIdRange::standard(0x023),
+                                                                  CanIdRange::standard(0x116),
+                                                                  CanIdRange::standard(0x143),
+                                                                  CanIdRange::standard(0x156),
+                                                                  CanIdRange::standard(0x210),
+                                                                  CanIdRange::standard(0x3c9),
+                                                                  CanIdRange::standard(0x100, 0x17f),
+                                                                  CanIdRange::standard(0x6f3, 0x712),
+                                                                  CanIdRange::standard(0x7fe, 0x7ff));
+
+static constexpr auto g_mixedFilters = hal::makeCanFilterBanks(CanIdRange::extended(0x18daf110),
+                                                               CanIdRange::extended(0x18db33f1),
+                                                               CanIdRange::extended(0x18daf100),
+                                                               CanIdRange::extended(0x0cf00400, 0x0cf004ff),
+                                                               CanIdRange::extended(0x1fffff00, 0x1fffffff),
+                                                               CanIdRange::standard(0x7df),
+                                                               CanIdRange::standard(0x7e8, 0x7ef));
+
+//--------------------------MOCKING--------------------------
+
+/// Software model of the bxCAN acceptance filter, working on the filter registers
+struct FilterModel {
+    uint32_t FR1;
+    uint32_t FR2;
+    bool listMode;
+    bool scale32;
+
+    explicit FilterModel(const CAN_FilterInitTypeDef& init) :
+        listMode(init.CAN_FilterMode == CAN_FilterMode_IdList),
+        scale32(init.CAN_FilterScale == CAN_FilterScale_32bit)
+    {
+        // Identical to CAN_FilterInit()
+        if (scale32) {
+            FR1 = (uint32_t(init.CAN_FilterIdHigh) << 16) | init.CAN_FilterIdLow;
+            FR2 = (uint32_t(init.CAN_FilterMaskIdHigh) << 16) | init.CAN_FilterMaskIdLow;
+        } else {
+            FR1 = (uint32_t(init.CAN_FilterMaskIdLow) << 16) | init.CAN_FilterIdLow;
+            FR2 = (uint32_t(init.CAN_FilterMaskIdHigh) << 16) | init.CAN_FilterIdHigh;
+        }
+    }
+
+    bool accepts(const uint32_t id, const bool extended, const bool remote) const
+    {
+        if (scale32) {
+            const uint32_t frame = (extended ? ((id << 3) | 0x4) : (id << 21)) | (remote ? 0x2 : 0);
+            if (listMode) {
+                return frame == FR1 || frame == FR2;
+            }
+            return ((frame ^ FR1) & FR2) == 0;
+        }
+
+        const uint16_t frame = static_cast<uint16_t>(
+                                                     (extended ? (((id >> 18) << 5) | 0x8 | ((id >> 15) & 0x7)) : (id << 5))
+                                                     | (remote ? 0x10 : 0));
+        const uint16_t r[4] = {uint16_t(FR1), uint16_t(FR1 >> 16), uint16_t(FR2), uint16_t(FR2 >> 16)};
+        if (listMode) {
+            return frame == r[0] || frame == r[1] || frame == r[2] || frame == r[3];
+        }
+        return ((frame ^ r[0]) & r[1]) == 0 || ((frame ^ r[2]) & r[3]) == 0;
+    }
+};
+
+static bool hardwareAccepts(const hal::CanFilterBanks& banks, const uint32_t id, const bool extended,
+                            const bool remote)
+{
+    for (const auto& bank : banks) {
+        if (FilterModel(bank).accepts(id, extended, remote)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<size_t n>
+static bool specAccepts(const std::array<CanIdRange, n>& ranges, const uint32_t id, const bool extended)
+{
+    for (const auto& range : ranges) {
+        if ((range.isExtended == extended) && (id >= range.first) && (id <= range.last)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_BankUsage(void)
+{
+    TestCaseBegin();
+
+    constexpr auto fourIds = hal::makeCanFilterBanks(CanIdRange::standard(0x1), CanIdRange::standard(0x2),
+                                                     CanIdRange::standard(0x3), CanIdRange::standard(0x4));
+    static_assert(fourIds.size() == 1, "Four standard ids fit into one bank");
+    static_assert(fourIds.banks[0].CAN_FilterMode == CAN_FilterMode_IdList, "Wrong mode");
+    static_assert(fourIds.banks[0].CAN_FilterScale == CAN_FilterScale_16bit, "Wrong scale");
+
+    constexpr auto twoExtIds = hal::makeCanFilterBanks(CanIdRange::extended(0x1), CanIdRange::extended(0x2));
+    static_assert(twoExtIds.size() == 1, "Two extended ids fit into one bank");
+    static_assert(twoExtIds.banks[0].CAN_FilterScale == CAN_FilterScale_32bit, "Wrong scale");
+
+    constexpr auto alignedRange = hal::makeCanFilterBanks(CanIdRange::standard(0x100, 0x1ff));
+    static_assert(alignedRange.size() == 1, "Aligned range needs one mask");
+    static_assert(alignedRange.banks[0].CAN_FilterMode == CAN_FilterMode_IdMask, "Wrong mode");
+
+    constexpr auto fiveIdsOneRange = hal::makeCanFilterBanks(CanIdRange::standard(0x1), CanIdRange::standard(0x2),
+                                                             CanIdRange::standard(0x3), CanIdRange::standard(0x4),
+                                                             CanIdRange::standard(0x5),
+                                                             CanIdRange::standard(0x200, 0x27f));
+    static_assert(fiveIdsOneRange.size() == 2, "Surplus id has to share the mask bank");
+
+    static_assert(!g_standardFilters.requiresSoftwareFiltering(), "Fits into hardware");
+    static_assert(!g_mixedFilters.requiresSoftwareFiltering(), "Fits into hardware");
+
+    for (size_t i = 0; i < g_standardFilters.size(); i++) {
+        const uint16_t fifo = (i & 1) ? CAN_Filter_FIFO1 : CAN_Filter_FIFO0;
+        CHECK(g_standardFilters.banks[i].CAN_FilterNumber == i);
+        CHECK(g_standardFilters.banks[i].CAN_FilterFIFOAssignment == fifo);
+        CHECK(g_standardFilters.banks[i].CAN_FilterActivation == ENABLE);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_StandardEquivalence(void)
+{
+    TestCaseBegin();
+
+    const std::array<CanIdRange, 9> spec = {{CanIdRange::standard(0x023),
+                                             CanIdRange::standard(0x116),
+                                             CanIdRange::standard(0x143),
+                                             CanIdRange::standard(0x156),
+                                             CanIdRange::standard(0x210),
+                                             CanIdRange::standard(0x3c9),
+                                             CanIdRange::standard(0x100, 0x17f),
+                                             CanIdRange::standard(0x6f3, 0x712),
+                                             CanIdRange::standard(0x7fe, 0x7ff)}};
+
+    for (uint32_t id = 0; id <= 0x7ff; id++) {
+        CHECK(hardwareAccepts(g_standardFilters, id, false, false) == specAccepts(spec, id, false));
+        CHECK(!hardwareAccepts(g_standardFilters, id, false, true));
+    }
+
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        const uint32_t id = static_cast<uint32_t>(std::rand()) & 0x1fffffff;
+        CHECK(!hardwareAccepts(g_standardFilters, id, true, false));
+    }
+
+    TestCaseEnd();
+}
+
+int ut_ExtendedEquivalence(void)
+{
+    TestCaseBegin();
+
+    const std::array<CanIdRange, 7> spec = {{CanIdRange::extended(0x18daf110),
+                                             CanIdRange::extended(0x18db33f1),
+                                             CanIdRange::extended(0x18daf100),
+                                             CanIdRange::extended(0x0cf00400, 0x0cf004ff),
+                                             CanIdRange::extended(0x1fffff00, 0x1fffffff),
+                                             CanIdRange::standard(0x7df),
+                                             CanIdRange::standard(0x7e8, 0x7ef)}};
+
+    for (uint32_t id = 0; id <= 0x7ff; id++) {
+        CHECK(hardwareAccepts(g_mixedFilters, id, false, false) == specAccepts(spec, id, false));
+    }
+
+    // Everything around the configured ranges
+    for (const auto& range : spec) {
+        if (!range.isExtended) {
+            continue;
+        }
+        for (uint32_t id = range.first - 0x200; id != ((range.last + 0x200) & 0x1fffffff); id = (id + 1) & 0x1fffffff) {
+            CHECK(hardwareAccepts(g_mixedFilters, id, true, false) == specAccepts(spec, id, true));
+            CHECK(!hardwareAccepts(g_mixedFilters, id, true, true));
+        }
+    }
+
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        const uint32_t id = static_cast<uint32_t>(std::rand()) & 0x1fffffff;
+        CHECK(hardwareAccepts(g_mixedFilters, id, true, false) == specAccepts(spec, id, true));
+    }
+
+    TestCaseEnd();
+}
+
+int ut_Overflow(void)
+{
+    TestCaseBegin();
+
+    // 15 banks worth of scattered identifiers
+    constexpr std::array<CanIdRange, 60> spec = [] {
+        std::array<CanIdRange, 60> ranges {};
+        for (size_t i = 0; i < ranges.size(); i++) {
+            ranges[i] = CanIdRange::standard(static_cast<uint32_t>(i * 0x21 + 0x5));
+        }
+        return ranges;
+    } ();
+    constexpr auto banks = hal::CanFilterCompiler::compile(spec);
+
+    static_assert(banks.requiresSoftwareFiltering(), "Overflow not detected");
+    static_assert(banks.required == 15, "Wrong number of required banks");
+    static_assert(banks.size() == hal::CanFilterBanks::NUMBER_OF_BANKS, "All banks have to be used");
+
+    // Superset: nothing configured may be lost
+    for (uint32_t id = 0; id <= 0x7ff; id++) {
+        if (specAccepts(spec, id, false)) {
+            CHECK(hardwareAccepts(banks, id, false, false));
+        }
+    }
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_BankUsage);
+    RunTest(true, ut_StandardEquivalence);
+    RunTest(true, ut_ExtendedEquivalence);
+    RunTest(true, ut_Overflow);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/// Alternate implementation for hal::Can, to map the controller to the
+/// hal::VirtualCanBus node attached to the calling thread. Link this file
+/// instead of Can.cpp in host tests. Calls from threads without a node fail.
+
+#include "VirtualCanBus.h"
+
+using hal::Can;
+using hal::VirtualCanBus;
+
+static utility::RingBuffer<Can::RxFrame, Can::RX_BUFFER_SIZE> g_DetachedReceiveBuffer;
+
+bool Can::hasOverRunError(void) const
+{
+    const VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    return node->mFifoOverrun;
+}
+
+void Can::clearOverRunError(void) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    node->mFifoOverrun = false;
+}
+
+bool Can::send(CanTxMsg& msg) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return false;
+    }
+    return node->mBus.send(*node, msg);
+}
+
+bool Can::sendFromISR(CanTxMsg& msg) const
+{
+    return send(msg);
+}
+
+size_t Can::txQueueDepth(void) const
+{
+    const VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    return node->mTxQueue.size();
+}
+
+Can::TxStatistics Can::getTxStatistics(void) const
+{
+    const VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return TxStatistics {};
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    return node->mTxStatistics;
+}
+
+void Can::enableTxPriorityAbort(const bool enable) const
+{
+    // A virtual node always sends its highest priority frame next, which is
+    // what priority abort approximates on the hardware.
+}
+
+size_t Can::messagePending(void) const
+{
+    const VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    return node->mFifo.size();
+}
+
+bool Can::receive(CanRxMsg& msg) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    if (node->mFifo.empty()) {
+        return false;
+    }
+    msg = node->mFifo.front();
+    node->mFifo.pop_front();
+    return true;
+}
+
+void Can::enableNonBlockingReceive(utility::Delegate<void(CanRxMsg)> callback) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    node->mBuffered = false;
+    node->mCallback = callback;
+}
+
+void Can::disableNonBlockingReceive(void) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    node->mBuffered = false;
+    node->mCallback = nullptr;
+}
+
+void Can::enableBufferedReceive(void) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    node->mCallback = nullptr;
+    node->mRxBuffer.reset();
+    node->mBuffered = true;
+}
+
+utility::RingBuffer<Can::RxFrame, Can::RX_BUFFER_SIZE>& Can::receiveBuffer(void) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    return node == nullptr ? g_DetachedReceiveBuffer : node->mRxBuffer;
+}
+
+void Can::setReceiveTap(utility::Delegate<void(const RxFrame&)> tap) const
+{
+    VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    node->mTap = tap;
+}
+
+bool Can::receiveBuffered(RxFrame& frame) const
+{
+    return receiveBuffer().pop(frame);
+}
+
+size_t Can::framesBuffered(void) const
+{
+    return receiveBuffer().size();
+}
+
+Can::RxStatistics Can::getRxStatistics(void) const
+{
+    const VirtualCanBus::Node* const node = VirtualCanBus::attachedNode();
+    if (node == nullptr) {
+        return RxStatistics {};
+    }
+    std::lock_guard<std::mutex> lock(node->mBus.mMutex);
+    return RxStatistics {node->mRxStatistics.received,
+                         node->mRxBuffer.getOverrunCount(),
+                         node->mRxStatistics.fifoOverruns};
+}
@@ -342,7 +342,7 @@ void Dma::unregisterInterruptSemaphore(const InterruptSource source) const
     }
 }
 
-bool Dma::registerInterruptCallback(std::function<void(void)> function, const Dma::InterruptSource source) const
+bool Dma::registerInterruptCallback(utility::Delegate<void(void)> function, const Dma::InterruptSource source) const
 {
     switch (source) {
     case Dma::TC:
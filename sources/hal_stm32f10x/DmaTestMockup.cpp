@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::Dma. A channel
+ * only keeps its data counter, nothing is transferred. The test finishes a
+ * transfer with setCurrentDataCounter(0) and raises the transfer complete
+ * interrupt by calling the IRQ handler of the channel.
+ */
+
+#include <utility>
+#include "Dma.h"
+
+using hal::Dma;
+
+static std::array<uint16_t, Dma::__ENUM__SIZE> g_DataCounters;
+
+/// Channels with an interrupt callback, by peripheral base
+static std::array<std::pair<uint32_t, const Dma*>, Dma::__ENUM__SIZE> g_Channels;
+
+static void raiseTransferComplete(const uint32_t peripherie)
+{
+    for (const auto& channel : g_Channels) {
+        if ((channel.second != nullptr) && (channel.first == peripherie)) {
+            Dma::DMA_TCIRQHandler(*channel.second);
+        }
+    }
+}
+
+void Dma::DMA_TCIRQHandler(const Dma& dma)
+{
+    if (TCInterruptSemaphores[dma.mDescription] != nullptr) {
+        TCInterruptSemaphores[dma.mDescription]->give();
+    }
+    if (TCInterruptCallbacks[dma.mDescription] != nullptr) {
+        TCInterruptCallbacks[dma.mDescription]();
+    }
+}
+
+#if DMA1_CHANNEL4_INTERRUPT_ENABLED
+void DMA1_Channel4_IRQHandler(void)
+{
+    raiseTransferComplete(DMA1_Channel4_BASE);
+}
+#endif
+
+void Dma::initialize(void) const
+{}
+
+void Dma::setupTransfer(uint8_t const* const data, const size_t length, const bool repeat) const
+{
+    disable();
+    g_DataCounters[mDescription] = static_cast<uint16_t>(length);
+}
+
+void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const
+{
+    setupTransfer(data, length);
+}
+
+void Dma::memcpy(void const* const dest, void const* const src, const size_t length) const
+{}
+
+void Dma::enable(void) const
+{}
+
+void Dma::disable(void) const
+{}
+
+bool Dma::registerInterruptSemaphore(os::Semaphore* const semaphore, const Dma::InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptSemaphores[mDescription] = semaphore;
+        return true;
+    }
+    return false;
+}
+
+void Dma::unregisterInterruptSemaphore(const InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptSemaphores[mDescription] = nullptr;
+    }
+}
+
+bool Dma::registerInterruptCallback(utility::Delegate<void(void)> function, const Dma::InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptCallbacks[mDescription] = function;
+        g_Channels[mDescription] = std::make_pair(mPeripherie, this);
+        return true;
+    }
+    return false;
+}
+
+void Dma::unregisterInterruptCallback(const InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptCallbacks[mDescription] = nullptr;
+    }
+}
+
+uint16_t Dma::getCurrentDataCounter(void) const
+{
+    return g_DataCounters[mDescription];
+}
+
+void Dma::setCurrentDataCounter(uint16_t value) const
+{
+    g_DataCounters[mDescription] = value;
+}
+
+Dma::SemaphoreArray Dma::TCInterruptSemaphores;
+Dma::SemaphoreArray Dma::HTInterruptSemaphores;
+Dma::SemaphoreArray Dma::TEInterruptSemaphores;
+Dma::CallbackArray Dma::TCInterruptCallbacks;
+Dma::CallbackArray Dma::HTInterruptCallbacks;
+Dma::CallbackArray Dma::TEInterruptCallbacks;
@@ -9,7 +9,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 
 #include "stm32f10x_tim.h"
 #include "stm32f10x_rcc.h"
@@ -39,7 +39,7 @@ struct Tim {
     ITStatus getInterruptStatus(const uint16_t interruptFlag) const;
     void clearPendingInterruptFlag(const uint16_t interruptFlag) const;
 
-    void registerInterruptCallback(std::function<void(void)> ) const;
+    void registerInterruptCallback(utility::Delegate<void(void)> ) const;
     void unregisterInterruptCallback(void) const;
 
     inline static void TIM_IRQHandler(const Tim& peripherie);
@@ -65,7 +65,7 @@ private:
     void initialize(void) const;
     TIM_TypeDef* getBasePointer(void) const;
 
-    using CallbackArray = std::array<std::function<void (void)>, Tim::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Tim::__ENUM__SIZE>;
     static CallbackArray TimCallbacks;
 
     friend class Factory<Tim>;
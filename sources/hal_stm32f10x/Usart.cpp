@@ -73,6 +73,7 @@ void Usart::initialize() const
     USART_Init(reinterpret_cast<USART_TypeDef*>(mPeripherie), &mConfiguration);
 
     USART_Cmd(reinterpret_cast<USART_TypeDef*>(mPeripherie), ENABLE);
+    mBaudRate = mConfiguration.USART_BaudRate;
     mInitalized = true;
 
     // Initialize Interrupts
@@ -92,11 +93,13 @@ IRQn Usart::getIRQn(void) const
     case USART3_BASE:
         return IRQn::USART3_IRQn;
 
+#if defined (STM32F10X_HD) || defined (STM32F10X_HD_VL) || defined (STM32F10X_XL) || defined (STM32F10X_CL)
     case UART4_BASE:
         return IRQn::UART4_IRQn;
 
     case UART5_BASE:
         return IRQn::UART5_IRQn;
+#endif
     }
 
     return IRQn::UsageFault_IRQn;
@@ -114,9 +117,15 @@ void Usart::setBaudRate(const size_t baudRate) const
 
     USART_Init(reinterpret_cast<USART_TypeDef*>(mPeripherie), &configuration);
     USART_Cmd(reinterpret_cast<USART_TypeDef*>(mPeripherie), ENABLE);
+    mBaudRate = baudRate;
+}
+
+size_t Usart::getBaudRate(void) const
+{
+    return mBaudRate;
 }
 
-void Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const
+void Usart::enableNonBlockingReceive(utility::Delegate<void(uint8_t)> callback) const
 {
     ReceiveInterruptCallbacks[mDescription] = callback;
 
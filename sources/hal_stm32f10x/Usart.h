@@ -9,7 +9,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f10x_usart.h"
 #include "stm32f10x_rcc.h"
 #include "hal_Factory.h"
@@ -63,8 +63,9 @@ struct Usart {
     bool isInitalized(void) const;
 
     void setBaudRate(const size_t) const;
+    size_t getBaudRate(void) const;
 
-    void enableNonBlockingReceive(std::function<void(uint8_t)> callback) const;
+    void enableNonBlockingReceive(utility::Delegate<void(uint8_t)> callback) const;
     void disableNonBlockingReceive(void) const;
 
     static void USART_IRQHandler(const Usart& peripherie);
@@ -75,16 +76,18 @@ private:
                     const USART_InitTypeDef& conf) :
         mDescription(desc),
         mPeripherie(peripherie),
-        mConfiguration(conf) {}
+        mConfiguration(conf),
+        mBaudRate(conf.USART_BaudRate) {}
 
     const uint32_t mPeripherie;
     const USART_InitTypeDef mConfiguration;
+    mutable size_t mBaudRate;
     mutable bool mInitalized = false;
 
     void initialize(void) const;
     IRQn getIRQn(void) const;
 
-    using ReceiveCallbackArray = std::array<std::function<void (uint8_t)>, Usart::__ENUM__SIZE>;
+    using ReceiveCallbackArray = std::array<utility::Delegate<void (uint8_t)>, Usart::__ENUM__SIZE>;
 
     static ReceiveCallbackArray ReceiveInterruptCallbacks;
 
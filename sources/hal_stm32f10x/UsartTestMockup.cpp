@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::Usart. Every
+ * interface is initialized and ready, sent bytes are dropped and nothing is
+ * ever received.
+ */
+
+#include "Usart.h"
+
+using hal::Usart;
+
+extern "C" void USART_DMACmd(USART_TypeDef* USARTx, uint16_t USART_DMAReq, FunctionalState NewState)
+{}
+
+bool Usart::isInitalized(void) const
+{
+    return true;
+}
+
+bool Usart::isReadyToSend(void) const
+{
+    return true;
+}
+
+bool Usart::isReadyToReceive(void) const
+{
+    return false;
+}
+
+size_t Usart::send(uint8_t const* const data, const size_t length) const
+{
+    return length;
+}
+
+size_t Usart::receive(uint8_t* const data, const size_t length) const
+{
+    return 0;
+}
+
+size_t Usart::receiveAvailableData(uint8_t* const data, const size_t length) const
+{
+    return 0;
+}
+
+bool Usart::hasOverRunError(void) const
+{
+    return false;
+}
+
+void Usart::clearOverRunError(void) const
+{}
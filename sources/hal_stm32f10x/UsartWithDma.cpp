@@ -4,7 +4,11 @@
  */
 
 #include "UsartWithDma.h"
+#include "LockGuard.h"
+#include "os_Task.h"
 #include "trace.h"
+#include <algorithm>
+#include <cstring>
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
@@ -15,6 +19,8 @@ using hal::UsartWithDma;
 
 std::array<os::Semaphore, Usart::__ENUM__SIZE> UsartWithDma::DmaTransferCompleteSemaphores;
 std::array<os::Semaphore, Usart::__ENUM__SIZE> UsartWithDma::DmaReceiveCompleteSemaphores;
+std::array<os::Mutex, Usart::__ENUM__SIZE> UsartWithDma::TransferWaitMutexes;
+UsartWithDma::TxStateArray UsartWithDma::TxStates;
 
 void UsartWithDma::initialize() const
 {
@@ -58,6 +64,9 @@ void UsartWithDma::registerInterruptSemaphores(void) const
     if ((mTxDma != nullptr)) {
         mTxDma->registerInterruptSemaphore(&DmaTransferCompleteSemaphores.at(mUsart.mDescription),
                                            Dma::InterruptSource::TC);
+        mTxDma->registerInterruptCallback([this] {
+            transferCompleteInterrupt();
+        }, Dma::InterruptSource::TC);
     }
 
     if ((mRxDma != nullptr)) {
@@ -66,14 +75,15 @@ void UsartWithDma::registerInterruptSemaphores(void) const
     }
 }
 
-void UsartWithDma::registerTransferCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerTransferCompleteCallback(utility::Delegate<void(void)> f) const
 {
-    if (mTxDma != nullptr) {
-        mTxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
-    }
+    // The TC interrupt of the tx channel belongs to the queue
+    os::ThisTask::enterCriticalSection();
+    txState().transferComplete = f;
+    os::ThisTask::exitCriticalSection();
 }
 
-void UsartWithDma::registerReceiveCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerReceiveCompleteCallback(utility::Delegate<void(void)> f) const
 {
     if (mRxDma != nullptr) {
         mRxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
@@ -87,30 +97,268 @@ size_t UsartWithDma::send(std::string_view str, const uint32_t ticksToWait) cons
 
 size_t UsartWithDma::send(uint8_t const* const data, const size_t length, const uint32_t ticksToWait) const
 {
-    if (data == nullptr) {
+    if ((data == nullptr) || (length == 0)) {
         return 0;
     }
 
-    const bool dmaSupport = (mTxDma != nullptr) && (mDmaCmd & USART_DMAReq_Tx);
+    if (!dmaTxSupport()) {
+        return mUsart.send(data, length);
+    }
 
-    if (dmaSupport && (length > MIN_LENGTH_FOR_DMA_TRANSFER)) {
-        // clear Semaphore
-        DmaTransferCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(0));
-        // we have DMA support
-        mTxDma->setupTransfer(data, length);
-        mTxDma->enable();
+    // Short messages don't wait, they used to be written by the CPU anyway
+    if ((length <= MIN_LENGTH_FOR_DMA_TRANSFER) && sendAsync(data, length, nullptr, true)) {
+        return length;
+    }
+
+    os::LockGuard<os::Mutex> lock(TransferWaitMutexes.at(mUsart.mDescription), ticksToWait);
+    if (!lock) {
+        return 0;
+    }
+
+    // clear Semaphore
+    DmaTransferCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(0));
+
+    uint32_t sequence;
+    if (!enqueue(data, length, nullptr, false, sequence)) {
+        Trace(ZONE_INFO, "Queue full\r\n");
+        return 0;
+    }
+
+    if (!waitUntilSent(sequence, ticksToWait)) {
+        Trace(ZONE_INFO, "Failed\r\n");
+        cancel(sequence);
+        return 0;
+    }
+    return length;
+}
+
+bool UsartWithDma::sendAsync(std::string_view str, utility::Delegate<void(void)> callback, const bool copy) const
+{
+    return sendAsync(reinterpret_cast<uint8_t const* const>(str.data()), str.length(), callback, copy);
+}
+
+bool UsartWithDma::sendAsync(uint8_t const* const          data,
+                             const size_t                  length,
+                             utility::Delegate<void(void)> callback,
+                             const bool                    copy) const
+{
+    if ((data == nullptr) || (length == 0)) {
+        return false;
+    }
+
+    if (!dmaTxSupport()) {
+        mUsart.send(data, length);
+        if (callback) {
+            callback();
+        }
+        return true;
+    }
+
+    uint32_t sequence;
+    return enqueue(data, length, callback, copy, sequence);
+}
+
+bool UsartWithDma::flush(const uint32_t ticksToWait) const
+{
+    if (!dmaTxSupport()) {
+        return true;
+    }
+
+    os::LockGuard<os::Mutex> lock(TransferWaitMutexes.at(mUsart.mDescription), ticksToWait);
+    if (!lock) {
+        return false;
+    }
+
+    DmaTransferCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(0));
+
+    os::ThisTask::enterCriticalSection();
+    const uint32_t last = txState().enqueued;
+    os::ThisTask::exitCriticalSection();
+
+    return waitUntilSent(last - 1, ticksToWait);
+}
+
+bool UsartWithDma::waitUntilSent(const uint32_t sequence, const uint32_t ticksToWait) const
+{
+    const TxState& state = txState();
+    const uint32_t start = os::Task::getTickCount();
+
+    while (static_cast<int32_t>(state.completed - sequence) <= 0) {
+        uint32_t remaining = ticksToWait;
+        if (ticksToWait != portMAX_DELAY) {
+            const uint32_t elapsed = os::Task::getTickCount() - start;
+            remaining = (elapsed < ticksToWait) ? (ticksToWait - elapsed) : 0;
+        }
+
+        if (!DmaTransferCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(remaining))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+UsartWithDma::TxStatistics UsartWithDma::getTxStatistics(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    const TxStatistics statistics = txState().statistics;
+    os::ThisTask::exitCriticalSection();
+    return statistics;
+}
+
+bool UsartWithDma::dmaTxSupport(void) const
+{
+    return (mTxDma != nullptr) && (mDmaCmd & USART_DMAReq_Tx);
+}
+
+UsartWithDma::TxState& UsartWithDma::txState(void) const
+{
+    return TxStates.at(mUsart.mDescription);
+}
+
+bool UsartWithDma::enqueue(uint8_t const* const          data,
+                           const size_t                  length,
+                           utility::Delegate<void(void)> callback,
+                           const bool                    copy,
+                           uint32_t&                     sequence) const
+{
+    TxState& state = txState();
+    bool queued = false;
+
+    os::ThisTask::enterCriticalSection();
+    if ((state.enqueued - state.completed < TX_QUEUE_SIZE) && (!copy || (length <= MAX_LENGTH_FOR_TX_COPY))) {
+        TxDescriptor& descriptor = state.queue[state.enqueued % TX_QUEUE_SIZE];
+        descriptor.data = data;
+        descriptor.length = length;
+        descriptor.copyLength = 0;
+        queued = true;
+
+        if (copy) {
+            // Copies stay contiguous for the DMA, a copy doesn't wrap around
+            const size_t tail = (state.copyHead + state.copyUsed) % TX_COPY_BUFFER_SIZE;
+            const size_t padding = (tail + length > TX_COPY_BUFFER_SIZE) ? (TX_COPY_BUFFER_SIZE - tail) : 0;
+            if (state.copyUsed + padding + length <= TX_COPY_BUFFER_SIZE) {
+                uint8_t* const copied = &state.copyBuffer[(tail + padding) % TX_COPY_BUFFER_SIZE];
+                std::memcpy(copied, data, length);
+                descriptor.data = copied;
+                descriptor.copyLength = padding + length;
+                state.copyUsed += descriptor.copyLength;
+                state.statistics.copied++;
+            } else {
+                queued = false;
+            }
+        }
+    }
+
+    if (queued) {
+        state.queue[state.enqueued % TX_QUEUE_SIZE].callback = std::move(callback);
+        sequence = state.enqueued++;
+        state.statistics.depth = state.enqueued - state.completed;
+        state.statistics.maxDepth = std::max(state.statistics.maxDepth, state.statistics.depth);
+
+        if (!state.active) {
+            startNextTransfer();
+        }
+    } else {
+        state.statistics.dropped++;
+    }
+    os::ThisTask::exitCriticalSection();
+    return queued;
+}
 
-        if (DmaTransferCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(ticksToWait))) {
+void UsartWithDma::cancel(const uint32_t sequence) const
+{
+    TxState& state = txState();
+
+    os::ThisTask::enterCriticalSection();
+    if (static_cast<int32_t>(state.completed - sequence) <= 0) {
+        if (state.active && (sequence == state.started - 1)) {
+            if (mTxDma->getCurrentDataCounter() == 0) {
+                // Sent, the pending interrupt completes it
+                os::ThisTask::exitCriticalSection();
+                return;
+            }
+            // On the wire, the aborted transfer raises no interrupt
             mTxDma->disable();
-            return length;
+            state.statistics.aborted++;
+            state.queue[sequence % TX_QUEUE_SIZE].length = 0;
+            completeActive();
         } else {
-            Trace(ZONE_INFO, "Failed\r\n");
+            // Skipped by startNextTransfer()
+            state.queue[sequence % TX_QUEUE_SIZE].length = 0;
+            state.queue[sequence % TX_QUEUE_SIZE].callback = nullptr;
+            state.statistics.aborted++;
+        }
+    }
+    os::ThisTask::exitCriticalSection();
+}
 
-            mTxDma->disable();
-            return 0;
+void UsartWithDma::startNextTransfer(void) const
+{
+    TxState& state = txState();
+
+    while (state.started != state.enqueued) {
+        TxDescriptor& descriptor = state.queue[state.started % TX_QUEUE_SIZE];
+        state.started++;
+
+        if (descriptor.length > 0) {
+            mTxDma->setupTransfer(descriptor.data, descriptor.length);
+            mTxDma->enable();
+            state.active = true;
+            return;
         }
-    } else {
-        return mUsart.send(data, length);
+
+        // Cancelled before it was started
+        state.copyHead = (state.copyHead + descriptor.copyLength) % TX_COPY_BUFFER_SIZE;
+        state.copyUsed -= descriptor.copyLength;
+        state.completed++;
+    }
+    state.active = false;
+}
+
+void UsartWithDma::transferCompleteInterrupt(void) const
+{
+    TxState& state = txState();
+
+    if (!state.active) {
+        // A transfer of sendNonBlocking()
+        if (state.transferComplete) {
+            state.transferComplete();
+        }
+        return;
+    }
+
+    if (mTxDma->getCurrentDataCounter() != 0) {
+        // Raised by a transfer that cancel() completed already
+        return;
+    }
+
+    mTxDma->disable();
+    completeActive();
+}
+
+void UsartWithDma::completeActive(void) const
+{
+    TxState& state = txState();
+
+    TxDescriptor& descriptor = state.queue[state.completed % TX_QUEUE_SIZE];
+    const utility::Delegate<void(void)> callback = std::move(descriptor.callback);
+    descriptor.callback = nullptr;
+    if (descriptor.length > 0) {
+        state.statistics.sent++;
+    }
+
+    state.copyHead = (state.copyHead + descriptor.copyLength) % TX_COPY_BUFFER_SIZE;
+    state.copyUsed -= descriptor.copyLength;
+    state.completed++;
+
+    startNextTransfer();
+    state.statistics.depth = state.enqueued - state.completed;
+
+    if (callback) {
+        callback();
+    }
+    if (state.transferComplete) {
+        state.transferComplete();
     }
 }
 
@@ -193,4 +441,12 @@ void UsartWithDma::stopNonBlockingReceive(void) const
     }
 }
 
+size_t UsartWithDma::getRemainingNonBlockingReceive(void) const
+{
+    if (mRxDma != nullptr) {
+        return mRxDma->getCurrentDataCounter();
+    }
+    return 0;
+}
+
 constexpr const std::array<const UsartWithDma, Factory<UsartWithDma>::CONTAINERSIZE> Factory<UsartWithDma>::Container;
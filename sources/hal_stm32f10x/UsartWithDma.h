@@ -8,15 +8,30 @@
 
 #include <cstdint>
 #include <array>
+#include "delegate.h"
 #include "Dma.h"
 #include "Usart.h"
 #include "Semaphore.h"
+#include "Mutex.h"
 #include "hal_Factory.h"
 #include <string_view>
 
 namespace hal
 {
 struct UsartWithDma {
+    static constexpr size_t TX_QUEUE_SIZE = 8;
+    static constexpr size_t TX_COPY_BUFFER_SIZE = 128;
+    static constexpr size_t MAX_LENGTH_FOR_TX_COPY = 32;
+
+    struct TxStatistics {
+        uint32_t depth;
+        uint32_t maxDepth;
+        uint32_t sent;
+        uint32_t copied;
+        uint32_t dropped;
+        uint32_t aborted;
+    };
+
     UsartWithDma() = delete;
     UsartWithDma(const UsartWithDma&) = delete;
     UsartWithDma(UsartWithDma&&) = default;
@@ -32,6 +47,23 @@ struct UsartWithDma {
     size_t send(uint8_t const* const, const size_t, const uint32_t ticksToWait = portMAX_DELAY) const;
     size_t send(std::string_view, const uint32_t ticksToWait = portMAX_DELAY) const;
 
+    /**
+     * Queues data behind the transfers of other tasks and returns at once.
+     * The transfer complete interrupt starts the next queued transfer and
+     * calls callback afterwards from the ISR. data has to stay valid until
+     * then, unless copy is set and length doesn't exceed
+     * MAX_LENGTH_FOR_TX_COPY, short messages are copied into a ring then.
+     * @return false if the queue or the copy ring is full
+     */
+    bool sendAsync(uint8_t const* const, const size_t, utility::Delegate<void(void)> callback = nullptr,
+                   const bool copy = false) const;
+    bool sendAsync(std::string_view, utility::Delegate<void(void)> callback = nullptr, const bool copy = false) const;
+
+    /// Waits until all queued transfers are sent
+    bool flush(const uint32_t ticksToWait = portMAX_DELAY) const;
+
+    TxStatistics getTxStatistics(void) const;
+
     template<size_t n>
     size_t receive(std::array<uint8_t, n>&) const;
     size_t receive(uint8_t* const, const size_t, const uint32_t ticksToWait = portMAX_DELAY) const;
@@ -46,11 +78,16 @@ struct UsartWithDma {
     void sendNonBlocking(uint8_t const* const, const size_t, const bool repeat) const;
     void receiveNonBlocking(uint8_t const* const, const size_t, const bool repeat) const;
 
+    /// Bypasses the queue of sendAsync(), don't mix both on one USART
     void stopNonBlockingSend(void) const;
     void stopNonBlockingReceive(void) const;
 
-    void registerTransferCompleteCallback(std::function<void(void)> ) const;
-    void registerReceiveCompleteCallback(std::function<void(void)> ) const;
+    /// @return bytes the running receiveNonBlocking() writes until it completes or wraps around
+    size_t getRemainingNonBlockingReceive(void) const;
+
+    /// Called from the ISR after every transfer, including queued ones
+    void registerTransferCompleteCallback(utility::Delegate<void(void)> ) const;
+    void registerReceiveCompleteCallback(utility::Delegate<void(void)> ) const;
 
     const Usart& mUsart;
 
@@ -71,10 +108,56 @@ private:
     void initialize(void) const;
     void registerInterruptSemaphores(void) const;
 
+    struct TxDescriptor {
+        uint8_t const* data;
+        size_t length;
+        size_t copyLength;
+        utility::Delegate<void(void)> callback;
+    };
+
+    /**
+     * Descriptors are completed in order, so transfers are identified by
+     * sequence numbers: all below completed are sent, started - 1 is on the
+     * wire if active is set and everything up to enqueued is waiting.
+     */
+    struct TxState {
+        std::array<TxDescriptor, TX_QUEUE_SIZE> queue;
+        std::array<uint8_t, TX_COPY_BUFFER_SIZE> copyBuffer;
+        size_t copyHead;
+        size_t copyUsed;
+        uint32_t enqueued;
+        uint32_t started;
+        uint32_t completed;
+        bool active;
+        utility::Delegate<void(void)> transferComplete;
+        TxStatistics statistics;
+    };
+
+    bool dmaTxSupport(void) const;
+    bool enqueue(uint8_t const* const          data,
+                 const size_t                  length,
+                 utility::Delegate<void(void)> callback,
+                 const bool                    copy,
+                 uint32_t&                     sequence) const;
+    void cancel(const uint32_t sequence) const;
+    bool waitUntilSent(const uint32_t sequence, const uint32_t ticksToWait) const;
+    void startNextTransfer(void) const;
+    void transferCompleteInterrupt(void) const;
+
+    /// Retires the transfer on the wire and starts the next one, from the interrupt or cancel()
+    void completeActive(void) const;
+    TxState& txState(void) const;
+
     static constexpr const size_t MIN_LENGTH_FOR_DMA_TRANSFER = 5;
     static std::array<os::Semaphore, Usart::__ENUM__SIZE> DmaTransferCompleteSemaphores;
     static std::array<os::Semaphore, Usart::__ENUM__SIZE> DmaReceiveCompleteSemaphores;
 
+    /// Only one task at a time waits for its transfer on DmaTransferCompleteSemaphores
+    static std::array<os::Mutex, Usart::__ENUM__SIZE> TransferWaitMutexes;
+
+    using TxStateArray = std::array<TxState, Usart::__ENUM__SIZE>;
+    static TxStateArray TxStates;
+
     friend class Factory<UsartWithDma>;
     friend struct Dma;
 };
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <chrono>
+
+#include "unittest.h"
+#include "os_Task.h"
+#include "UsartWithDma.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+//--------------------------BUFFERS--------------------------
+
+static constexpr const hal::UsartWithDma& g_usart = hal::Factory<hal::UsartWithDma>::get<hal::Usart::LOGGER_IF>();
+static constexpr const hal::Dma& g_txDma = hal::Factory<hal::Dma>::get<hal::Dma::USART1_TX>();
+
+static const uint8_t g_data[64] = {};
+
+//--------------------------MOCKING--------------------------
+
+uint32_t os::Task::getTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                                 std::chrono::steady_clock::now().time_since_epoch())
+           .count();
+}
+
+void os::ThisTask::enterCriticalSection(void)
+{}
+
+void os::ThisTask::exitCriticalSection(void)
+{}
+
+/// The DMA sent the transfer on the wire and raises its interrupt
+static void finishTransfer(void)
+{
+    g_txDma.setCurrentDataCounter(0);
+    DMA1_Channel4_IRQHandler();
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_SendAsync(void)
+{
+    TestCaseBegin();
+
+    size_t firstDone = 0;
+    size_t secondDone = 0;
+    const auto before = g_usart.getTxStatistics();
+
+    CHECK(g_usart.sendAsync(g_data, 20, [&firstDone] {
+        firstDone++;
+    }));
+    CHECK(g_usart.sendAsync(g_data, 30, [&secondDone] {
+        secondDone++;
+    }));
+    CHECK(g_txDma.getCurrentDataCounter() == 20);
+    CHECK(g_usart.getTxStatistics().depth == 2);
+
+    finishTransfer();
+    CHECK(firstDone == 1);
+    CHECK(secondDone == 0);
+    CHECK(g_txDma.getCurrentDataCounter() == 30);
+
+    finishTransfer();
+    CHECK(secondDone == 1);
+    CHECK(g_usart.getTxStatistics().depth == 0);
+    CHECK(g_usart.getTxStatistics().sent == before.sent + 2);
+
+    TestCaseEnd();
+}
+
+int ut_SendTimeout(void)
+{
+    TestCaseBegin();
+
+    const auto before = g_usart.getTxStatistics();
+
+    // The DMA never finishes, send() gives up and aborts the transfer on the wire
+    CHECK(g_usart.send(g_data, 40, 5) == 0);
+    CHECK(g_usart.getTxStatistics().aborted == before.aborted + 1);
+    CHECK(g_usart.getTxStatistics().depth == 0);
+
+    // The queue is idle again, the next transfer starts right away
+    size_t done = 0;
+    CHECK(g_usart.sendAsync(g_data, 24, [&done] {
+        done++;
+    }));
+    CHECK(g_txDma.getCurrentDataCounter() == 24);
+
+    // A late interrupt of the aborted transfer doesn't complete the new one
+    DMA1_Channel4_IRQHandler();
+    CHECK(done == 0);
+
+    finishTransfer();
+    CHECK(done == 1);
+    CHECK(g_usart.getTxStatistics().depth == 0);
+    CHECK(g_usart.getTxStatistics().sent == before.sent + 1);
+
+    TestCaseEnd();
+}
+
+int ut_SendTimeoutQueued(void)
+{
+    TestCaseBegin();
+
+    const auto before = g_usart.getTxStatistics();
+    size_t done = 0;
+
+    CHECK(g_usart.sendAsync(g_data, 16, [&done] {
+        done++;
+    }));
+
+    // Times out behind the first transfer, it is skipped without being started
+    CHECK(g_usart.send(g_data, 40, 5) == 0);
+    CHECK(g_usart.getTxStatistics().aborted == before.aborted + 1);
+    CHECK(g_txDma.getCurrentDataCounter() == 16);
+
+    finishTransfer();
+    CHECK(done == 1);
+    CHECK(g_usart.getTxStatistics().depth == 0);
+    CHECK(g_usart.getTxStatistics().sent == before.sent + 1);
+
+    CHECK(g_usart.sendAsync(g_data, 12));
+    CHECK(g_txDma.getCurrentDataCounter() == 12);
+    finishTransfer();
+    CHECK(g_usart.getTxStatistics().depth == 0);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    hal::initFactory<hal::Factory<hal::UsartWithDma> >();
+
+    UnitTestMainBegin();
+    RunTest(true, ut_SendAsync);
+    RunTest(true, ut_SendTimeout);
+    RunTest(true, ut_SendTimeoutQueued);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include "VirtualCanBus.h"
+
+using hal::Can;
+using hal::VirtualCanBus;
+
+thread_local VirtualCanBus::Node* VirtualCanBus::AttachedNode = nullptr;
+
+void VirtualCanBus::Node::attach(void)
+{
+    AttachedNode = this;
+}
+
+void VirtualCanBus::Node::setFilter(std::function<bool(const CanRxMsg&)> filter)
+{
+    std::lock_guard<std::mutex> lock(mBus.mMutex);
+    mFilter = filter;
+}
+
+VirtualCanBus::Node::Delivery VirtualCanBus::Node::deliver(const CanRxMsg& msg, const uint16_t timestamp)
+{
+    if (mFilter && !mFilter(msg)) {
+        return Delivery::NONE;
+    }
+
+    if (mCallback) {
+        mRxStatistics.received++;
+        return Delivery::CALLBACK;
+    }
+
+    if (mBuffered) {
+        mRxStatistics.received++;
+        mRxBuffer.push(Can::RxFrame {timestamp, msg});
+        return mTap ? Delivery::TAP : Delivery::NONE;
+    }
+
+    if (mFifo.size() >= FIFO_DEPTH) {
+        mFifoOverrun = true;
+        mRxStatistics.fifoOverruns++;
+        return Delivery::NONE;
+    }
+    mFifo.push_back(msg);
+    return Delivery::NONE;
+}
+
+VirtualCanBus::VirtualCanBus(const uint32_t bitrate) : mBitrate(bitrate) {}
+
+VirtualCanBus::~VirtualCanBus(void)
+{
+    stop();
+}
+
+VirtualCanBus::Node& VirtualCanBus::addNode(const char* name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mNodes.push_back(std::make_unique<Node>(*this, name));
+    return *mNodes.back();
+}
+
+void VirtualCanBus::start(void)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) {
+        return;
+    }
+    mRunning = true;
+    mBusFree = std::chrono::steady_clock::now();
+    mThread = std::thread([this] {
+        run();
+    });
+}
+
+void VirtualCanBus::stop(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mPending.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void VirtualCanBus::setRealTime(const bool realTime)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRealTime = realTime;
+}
+
+void VirtualCanBus::setErrorInjector(std::function<bool(const CanTxMsg&)> injector)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mErrorInjector = injector;
+}
+
+bool VirtualCanBus::waitIdle(const std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mIdle.wait_for(lock, timeout, [this] {
+        return !mTransmitting && !hasPendingFrames();
+    });
+}
+
+VirtualCanBus::Statistics VirtualCanBus::getStatistics(void) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+uint64_t VirtualCanBus::getBitTime(void) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBitTime;
+}
+
+uint32_t VirtualCanBus::getBitrate(void) const
+{
+    return mBitrate;
+}
+
+size_t VirtualCanBus::frameBits(const CanTxMsg& msg)
+{
+    // SOF, arbitration, control, data and CRC field are subject to bit stuffing
+    std::array<uint8_t, 1 + 32 + 6 + 64 + 15> bits {};
+    size_t length = 0;
+
+    auto put = [&bits, &length](const uint32_t value, const size_t count) {
+                   for (size_t i = count; i > 0; i--) {
+                       bits[length++] = (value >> (i - 1)) & 0x1;
+                   }
+               };
+
+    const bool remote = msg.RTR == CAN_RTR_Remote;
+    const uint8_t dlc = msg.DLC & 0xf;
+
+    put(0, 1);
+    if (msg.IDE == CAN_Id_Standard) {
+        put(msg.StdId & 0x7ff, 11);
+        put(remote, 1);
+        put(0, 2);
+    } else {
+        put((msg.ExtId >> 18) & 0x7ff, 11);
+        put(0x3, 2);
+        put(msg.ExtId & 0x3ffff, 18);
+        put(remote, 1);
+        put(0, 2);
+    }
+    put(dlc, 4);
+    for (size_t i = 0; !remote && (i < std::min<size_t>(dlc, sizeof(msg.Data))); i++) {
+        put(msg.Data[i], 8);
+    }
+
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        const bool next = bits[i] ^ ((crc >> 14) & 0x1);
+        crc = (crc << 1) & 0x7fff;
+        if (next) {
+            crc ^= 0x4599;
+        }
+    }
+    put(crc, 15);
+
+    size_t stuffBits = 0;
+    uint8_t last = bits[0];
+    size_t run = 1;
+    for (size_t i = 1; i < length; i++) {
+        if (bits[i] == last) {
+            run++;
+        } else {
+            last = bits[i];
+            run = 1;
+        }
+        if (run == 5) {
+            stuffBits++;
+            last = !last;
+            run = 1;
+        }
+    }
+
+    // CRC delimiter, ACK slot and delimiter, EOF, interframe space
+    return length + stuffBits + 1 + 2 + 7 + 3;
+}
+
+std::chrono::nanoseconds VirtualCanBus::frameTime(const CanTxMsg& msg) const
+{
+    return std::chrono::nanoseconds(frameBits(msg) * 1000000000ull / mBitrate);
+}
+
+VirtualCanBus::Node* VirtualCanBus::attachedNode(void)
+{
+    return AttachedNode;
+}
+
+bool VirtualCanBus::send(Node& node, const CanTxMsg& msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Can::TxStatistics& statistics = node.mTxStatistics;
+
+        if (node.mTxQueue.size() >= Can::TX_QUEUE_SIZE + Can::NUMBER_OF_TX_MAILBOXES) {
+            statistics.dropped++;
+            return false;
+        }
+
+        const uint32_t key = Can::arbitrationKey(msg);
+        const auto position = std::find_if(node.mTxQueue.begin(), node.mTxQueue.end(),
+                                           [key](const CanTxMsg& other) { return Can::arbitrationKey(other) > key; });
+        node.mTxQueue.insert(position, msg);
+
+        statistics.depth = node.mTxQueue.size();
+        statistics.maxDepth = std::max(statistics.maxDepth, statistics.depth);
+    }
+    mPending.notify_one();
+    return true;
+}
+
+VirtualCanBus::Node* VirtualCanBus::arbitrate(void) const
+{
+    Node* winner = nullptr;
+
+    for (const auto& node : mNodes) {
+        if (node->mTxQueue.empty()) {
+            continue;
+        }
+        if ((winner == nullptr) ||
+            (Can::arbitrationKey(node->mTxQueue.front()) < Can::arbitrationKey(winner->mTxQueue.front())))
+        {
+            winner = node.get();
+        }
+    }
+    return winner;
+}
+
+bool VirtualCanBus::hasPendingFrames(void) const
+{
+    return std::any_of(mNodes.begin(), mNodes.end(), [](const std::unique_ptr<Node>& node) {
+        return !node->mTxQueue.empty();
+    });
+}
+
+void VirtualCanBus::run(void)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (mRunning) {
+        Node* const sender = arbitrate();
+        if (sender == nullptr) {
+            mIdle.notify_all();
+            mPending.wait(lock);
+            continue;
+        }
+
+        // The frame on the bus can't be preempted by frames queued meanwhile
+        const CanTxMsg msg = sender->mTxQueue.front();
+        sender->mTxQueue.erase(sender->mTxQueue.begin());
+        mTransmitting = true;
+
+        const bool destroyed = mErrorInjector && mErrorInjector(msg);
+        const size_t bits = destroyed ? (frameBits(msg) / 2 + ERROR_FRAME_BITS) : frameBits(msg);
+        const uint16_t timestamp = static_cast<uint16_t>(mBitTime);
+        mBitTime += bits;
+        mStatistics.busyBits += bits;
+
+        if (mRealTime) {
+            const auto now = std::chrono::steady_clock::now();
+            mBusFree = std::max(mBusFree, now) + std::chrono::nanoseconds(bits * 1000000000ull / mBitrate);
+            const auto busFree = mBusFree;
+            lock.unlock();
+            std::this_thread::sleep_until(busFree);
+            lock.lock();
+        }
+
+        if (destroyed) {
+            mStatistics.errorFrames++;
+            sender->mTxStatistics.errors++;
+
+            // Automatic retransmission, ahead of frames with equal priority
+            const uint32_t key = Can::arbitrationKey(msg);
+            const auto position = std::find_if(sender->mTxQueue.begin(), sender->mTxQueue.end(),
+                                               [key](const CanTxMsg& other) { return Can::arbitrationKey(other) >= key; });
+            sender->mTxQueue.insert(position, msg);
+            mTransmitting = false;
+            continue;
+        }
+
+        mStatistics.frames++;
+        sender->mTxStatistics.sent++;
+        sender->mTxStatistics.depth = sender->mTxQueue.size();
+
+        CanRxMsg rx;
+        std::memset(&rx, 0, sizeof(rx));
+        rx.StdId = msg.StdId;
+        rx.ExtId = msg.ExtId;
+        rx.IDE = msg.IDE;
+        rx.RTR = msg.RTR;
+        rx.DLC = msg.DLC;
+        std::memcpy(rx.Data, msg.Data, sizeof(rx.Data));
+
+        std::vector<std::function<void(CanRxMsg)> > callbacks;
+        std::vector<std::function<void(const Can::RxFrame&)> > taps;
+        for (auto& node : mNodes) {
+            if (node.get() == sender) {
+                continue;
+            }
+            switch (node->deliver(rx, timestamp)) {
+            case Node::Delivery::CALLBACK:
+                callbacks.push_back(node->mCallback);
+                break;
+
+            case Node::Delivery::TAP:
+                taps.push_back(node->mTap);
+                break;
+
+            case Node::Delivery::NONE:
+                break;
+            }
+        }
+
+        // Callbacks and taps run like an interrupt, but may use the bus themselves
+        lock.unlock();
+        for (const auto& callback : callbacks) {
+            callback(rx);
+        }
+        const Can::RxFrame frame {timestamp, rx};
+        for (const auto& tap : taps) {
+            tap(frame);
+        }
+        lock.lock();
+        mTransmitting = false;
+    }
+}
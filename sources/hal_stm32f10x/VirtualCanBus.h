@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Can.h"
+
+namespace hal
+{
+/**
+ * In-process CAN bus for host tests.
+ *
+ * Together with CanTestMockup.cpp, which replaces Can.cpp in host builds, every
+ * thread attached to a node sees hal::Can as its own controller on this bus.
+ * Applications can therefore run against each other as os::Task threads of
+ * the pthread based os mockups.
+ *
+ * The bus thread picks the pending frame with the lowest arbitration key of
+ * all nodes, keeps the bus busy for the exact frame length including stuff
+ * bits and delivers the frame to all other nodes. Frames destroyed by the
+ * error injector produce an error frame and are retransmitted, like the bxCAN
+ * does with automatic retransmission enabled.
+ */
+class VirtualCanBus
+{
+public:
+    struct Statistics {
+        uint64_t frames;
+        uint64_t errorFrames;
+        uint64_t busyBits;
+    };
+
+    class Node
+    {
+        VirtualCanBus& mBus;
+        const std::string mName;
+
+        std::vector<CanTxMsg> mTxQueue;
+        std::deque<CanRxMsg> mFifo;
+        bool mFifoOverrun = false;
+        std::function<void(CanRxMsg)> mCallback;
+        bool mBuffered = false;
+        utility::RingBuffer<Can::RxFrame, Can::RX_BUFFER_SIZE> mRxBuffer;
+        std::function<void(const Can::RxFrame&)> mTap;
+        std::function<bool(const CanRxMsg&)> mFilter;
+        Can::TxStatistics mTxStatistics {};
+        Can::RxStatistics mRxStatistics {};
+
+        /// What the bus thread calls for a delivered frame once it released the bus
+        enum class Delivery {
+            NONE,
+            CALLBACK,
+            TAP
+        };
+
+        Delivery deliver(const CanRxMsg& msg, const uint16_t timestamp);
+
+        friend class VirtualCanBus;
+        friend struct Can;
+
+    public:
+        Node(VirtualCanBus& bus, const char* name) : mBus(bus), mName(name) {}
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        /// Binds the calling thread to this node. hal::Can calls of this thread act on this node.
+        void attach(void);
+
+        /// Acceptance filter of this node, by default every frame is accepted
+        void setFilter(std::function<bool(const CanRxMsg&)> filter);
+
+        const std::string& getName(void) const
+        {
+            return mName;
+        }
+    };
+
+    /// Hardware FIFO 0 and 1 of the bxCAN hold three frames each
+    static constexpr size_t FIFO_DEPTH = 6;
+    static constexpr size_t ERROR_FRAME_BITS = 6 + 8 + 3;
+
+    explicit VirtualCanBus(const uint32_t bitrate = 500000);
+    VirtualCanBus(const VirtualCanBus&) = delete;
+    VirtualCanBus& operator=(const VirtualCanBus&) = delete;
+    ~VirtualCanBus(void);
+
+    Node& addNode(const char* name);
+
+    void start(void);
+    void stop(void);
+
+    /**
+     * If disabled, the bus only advances its virtual bit clock instead of
+     * sleeping for the frame time. Useful for throughput tests in CI.
+     */
+    void setRealTime(const bool realTime);
+
+    /**
+     * The injector is called for every transmission attempt. Returning true
+     * destroys the frame on the bus.
+     */
+    void setErrorInjector(std::function<bool(const CanTxMsg&)> injector);
+
+    /// Blocks until no node has pending frames or the timeout elapsed
+    bool waitIdle(const std::chrono::milliseconds timeout);
+
+    Statistics getStatistics(void) const;
+    uint64_t getBitTime(void) const;
+    uint32_t getBitrate(void) const;
+
+    /// Number of bits on the bus for this frame, including stuff bits and interframe space
+    static size_t frameBits(const CanTxMsg& msg);
+
+    std::chrono::nanoseconds frameTime(const CanTxMsg& msg) const;
+
+    /// Node of the calling thread or nullptr
+    static Node* attachedNode(void);
+
+private:
+    const uint32_t mBitrate;
+    std::vector<std::unique_ptr<Node> > mNodes;
+    mutable std::mutex mMutex;
+    std::condition_variable mPending;
+    std::condition_variable mIdle;
+    std::thread mThread;
+    bool mRunning = false;
+    bool mTransmitting = false;
+    bool mRealTime = true;
+    std::function<bool(const CanTxMsg&)> mErrorInjector;
+    Statistics mStatistics {};
+    uint64_t mBitTime = 0;
+    std::chrono::steady_clock::time_point mBusFree;
+
+    static thread_local Node* AttachedNode;
+
+    bool send(Node& node, const CanTxMsg& msg);
+    Node* arbitrate(void) const;
+    bool hasPendingFrames(void) const;
+    void run(void);
+
+    friend struct Can;
+};
+}
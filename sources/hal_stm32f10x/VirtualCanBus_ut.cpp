@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <cstring>
+#include <string>
+
+#include "unittest.h"
+#include "os_Task.h"
+#include "IsoTp.h"
+#include "VirtualCanBus.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+#define NUM_TEST_LOOPS 100
+
+//--------------------------BUFFERS--------------------------
+bool executeMockupTasks = true;
+
+static constexpr const hal::Can& g_can = hal::Factory<hal::Can>::get<hal::Can::MAINCAN>();
+
+//--------------------------MOCKING--------------------------
+
+uint32_t os::Task::getTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                                 std::chrono::steady_clock::now().time_since_epoch())
+           .count();
+}
+
+static CanTxMsg makeMsg(const uint32_t id, const bool extended, const uint8_t dlc, const bool remote = false)
+{
+    CanTxMsg msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.IDE = extended ? CAN_Id_Extended : CAN_Id_Standard;
+    msg.RTR = remote ? CAN_RTR_Remote : CAN_RTR_Data;
+    msg.StdId = extended ? 0 : id;
+    msg.ExtId = extended ? id : 0;
+    msg.DLC = dlc;
+    for (size_t i = 0; i < dlc; i++) {
+        msg.Data[i] = static_cast<uint8_t>(id + i);
+    }
+    return msg;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_FrameBits(void)
+{
+    TestCaseBegin();
+
+    // 34 dominant bits from SOF to CRC need 6 stuff bits
+    CHECK(hal::VirtualCanBus::frameBits(makeMsg(0x000, false, 0)) == 53);
+
+    for (uint8_t dlc = 0; dlc <= 8; dlc++) {
+        const size_t standardBits = hal::VirtualCanBus::frameBits(makeMsg(0x555, false, dlc));
+        CHECK(standardBits >= 47u + 8 * dlc);
+        CHECK(standardBits <= 47u + 8 * dlc + (34 + 8 * dlc - 1) / 4);
+
+        const size_t extendedBits = hal::VirtualCanBus::frameBits(makeMsg(0x15555555, true, dlc));
+        CHECK(extendedBits >= 67u + 8 * dlc);
+        CHECK(extendedBits <= 67u + 8 * dlc + (54 + 8 * dlc - 1) / 4);
+    }
+
+    // Remote frames carry no data field
+    CHECK(hal::VirtualCanBus::frameBits(makeMsg(0x123, false, 8, true)) < 47 + 8 * 8);
+
+    hal::VirtualCanBus bus(500000);
+    CHECK(bus.frameTime(makeMsg(0x000, false, 0)) == std::chrono::nanoseconds(106000));
+
+    TestCaseEnd();
+}
+
+int ut_Arbitration(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus bus;
+    auto& a = bus.addNode("A");
+    auto& b = bus.addNode("B");
+    auto& observer = bus.addNode("Observer");
+    bus.setRealTime(false);
+
+    observer.attach();
+    g_can.enableBufferedReceive();
+
+    // Queue everything while the bus is stopped, the arbitration decides the order
+    a.attach();
+    CanTxMsg msg = makeMsg(0x200, false, 8);
+    CHECK(g_can.send(msg));
+    msg = makeMsg((0x100 << 18) | 0x5, true, 8);
+    CHECK(g_can.send(msg));
+
+    b.attach();
+    msg = makeMsg(0x100, false, 8, true);
+    CHECK(g_can.send(msg));
+    msg = makeMsg(0x100, false, 2);
+    CHECK(g_can.send(msg));
+    msg = makeMsg(0x100, false, 3);
+    CHECK(g_can.send(msg));
+    CHECK(g_can.txQueueDepth() == 3);
+
+    bus.start();
+    CHECK(bus.waitIdle(std::chrono::milliseconds(1000)));
+
+    observer.attach();
+    CHECK(g_can.framesBuffered() == 5);
+
+    hal::Can::RxFrame frame;
+    uint16_t lastTimestamp = 0;
+
+    CHECK(g_can.receiveBuffered(frame));
+    CHECK(frame.msg.StdId == 0x100 && frame.msg.RTR == CAN_RTR_Data && frame.msg.DLC == 2);
+    lastTimestamp = frame.timestamp;
+
+    CHECK(g_can.receiveBuffered(frame));
+    CHECK(frame.msg.StdId == 0x100 && frame.msg.RTR == CAN_RTR_Data && frame.msg.DLC == 3);
+    CHECK(frame.timestamp == lastTimestamp + hal::VirtualCanBus::frameBits(makeMsg(0x100, false, 2)));
+
+    CHECK(g_can.receiveBuffered(frame));
+    CHECK(frame.msg.StdId == 0x100 && frame.msg.RTR == CAN_RTR_Remote);
+
+    CHECK(g_can.receiveBuffered(frame));
+    CHECK(frame.msg.IDE == CAN_Id_Extended && frame.msg.ExtId == ((0x100 << 18) | 0x5));
+
+    CHECK(g_can.receiveBuffered(frame));
+    CHECK(frame.msg.StdId == 0x200);
+    CHECK(std::memcmp(frame.msg.Data, makeMsg(0x200, false, 8).Data, 8) == 0);
+
+    CHECK(!g_can.receiveBuffered(frame));
+
+    // Senders don't receive their own frames, but the other sender does
+    a.attach();
+    CHECK(g_can.messagePending() == 3);
+    CHECK(g_can.getTxStatistics().sent == 2);
+
+    TestCaseEnd();
+}
+
+int ut_Timing(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus bus(1000000);
+    auto& sender = bus.addNode("Sender");
+    auto& receiver = bus.addNode("Receiver");
+
+    receiver.attach();
+    g_can.enableBufferedReceive();
+
+    sender.attach();
+    uint64_t expectedBits = 0;
+    for (size_t i = 0; i < hal::Can::TX_QUEUE_SIZE; i++) {
+        CanTxMsg msg = makeMsg(0x700 + i, false, 8);
+        expectedBits += hal::VirtualCanBus::frameBits(msg);
+        CHECK(g_can.send(msg));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bus.start();
+    CHECK(bus.waitIdle(std::chrono::milliseconds(1000)));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(bus.getBitTime() == expectedBits);
+    CHECK(bus.getStatistics().busyBits == expectedBits);
+    CHECK(bus.getStatistics().frames == hal::Can::TX_QUEUE_SIZE);
+    CHECK(elapsed >= std::chrono::microseconds(expectedBits));
+
+    receiver.attach();
+    CHECK(g_can.getRxStatistics().received == hal::Can::TX_QUEUE_SIZE);
+
+    TestCaseEnd();
+}
+
+int ut_ErrorInjection(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus bus;
+    auto& sender = bus.addNode("Sender");
+    auto& receiver = bus.addNode("Receiver");
+    bus.setRealTime(false);
+
+    // Destroy the first attempt of every frame
+    size_t attempts = 0;
+    bus.setErrorInjector([&attempts](const CanTxMsg&) {
+        return (attempts++ % 2) == 0;
+    });
+
+    receiver.attach();
+    receiver.setFilter([](const CanRxMsg& msg) {
+        return msg.StdId != 0x7ff;
+    });
+    std::array<CanRxMsg, NUM_TEST_LOOPS> received;
+    size_t count = 0;
+    g_can.enableNonBlockingReceive([&received, &count](CanRxMsg msg) {
+        received[count++] = msg;
+    });
+
+    bus.start();
+    sender.attach();
+    for (size_t i = 0; i < NUM_TEST_LOOPS; i++) {
+        CanTxMsg msg = makeMsg(i % 2 ? 0x7ff : i, false, 1);
+        while (!g_can.send(msg)) {
+            std::this_thread::yield();
+        }
+    }
+    CHECK(bus.waitIdle(std::chrono::milliseconds(1000)));
+
+    CHECK(bus.getStatistics().errorFrames == NUM_TEST_LOOPS);
+    CHECK(bus.getStatistics().frames == NUM_TEST_LOOPS);
+    CHECK(g_can.getTxStatistics().errors == NUM_TEST_LOOPS);
+    CHECK(g_can.getTxStatistics().sent == NUM_TEST_LOOPS);
+
+    CHECK(count == NUM_TEST_LOOPS / 2);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(received[i].StdId == 2 * i);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_TapUsesBus(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus bus;
+    auto& sender = bus.addNode("Sender");
+    auto& logger = bus.addNode("Logger");
+    bus.setRealTime(false);
+
+    static constexpr size_t FRAMES = 16;
+
+    // The tap runs on the bus thread and may call the bus itself
+    std::array<uint64_t, FRAMES> frames {};
+    size_t count = 0;
+    logger.attach();
+    g_can.enableBufferedReceive();
+    g_can.setReceiveTap([&bus, &frames, &count](const hal::Can::RxFrame&) {
+        frames[count++] = bus.getStatistics().frames;
+    });
+
+    bus.start();
+    sender.attach();
+    for (size_t i = 0; i < FRAMES; i++) {
+        CanTxMsg msg = makeMsg(i, false, 1);
+        while (!g_can.send(msg)) {
+            std::this_thread::yield();
+        }
+    }
+    CHECK(bus.waitIdle(std::chrono::milliseconds(1000)));
+
+    CHECK(count == FRAMES);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(frames[i] >= i + 1);
+    }
+
+    logger.attach();
+    g_can.setReceiveTap(nullptr);
+    CHECK(g_can.framesBuffered() == FRAMES);
+
+    TestCaseEnd();
+}
+
+int ut_IsoTpBetweenNodes(void)
+{
+    TestCaseBegin();
+
+    hal::VirtualCanBus bus;
+    auto& tester = bus.addNode("Tester");
+    auto& ecu = bus.addNode("ECU");
+    bus.start();
+
+    std::string message;
+    for (size_t i = 0; i < 300; i++) {
+        message.push_back(static_cast<char>('a' + i % 26));
+    }
+
+    std::array<char, 512> buffer {};
+    size_t sent = 0;
+    size_t received = 0;
+
+    {
+        os::Task receiverTask("ECU", 1024, os::Task::Priority::MEDIUM, [&](const bool&) {
+            ecu.attach();
+            app::ISOTP isotp(g_can, 0x456, 0x734);
+            received = isotp.receive_Message(buffer.data(), buffer.size(), std::chrono::milliseconds(2000));
+        });
+
+        os::Task senderTask("Tester", 1024, os::Task::Priority::MEDIUM, [&](const bool&) {
+            tester.attach();
+            app::ISOTP isotp(g_can, 0x734, 0x456);
+            sent = isotp.send_Message(message, std::chrono::milliseconds(1000));
+        });
+    }
+
+    CHECK(sent == message.size());
+    CHECK(received == message.size());
+    CHECK(std::string(buffer.data(), received) == message);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_FrameBits);
+    RunTest(true, ut_Arbitration);
+    RunTest(true, ut_Timing);
+    RunTest(true, ut_ErrorInjection);
+    RunTest(true, ut_TapUsesBus);
+    RunTest(true, ut_IsoTpBetweenNodes);
+    UnitTestMainEnd();
+}
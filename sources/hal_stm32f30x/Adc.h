@@ -71,6 +71,7 @@ private:
     friend class Factory<Adc>;
     friend class Factory<Adc::Channel>;
     friend struct AdcWithDma;
+    friend struct AdcScanGroup;
     friend void ::ADC1_2_IRQHandler(void);
     friend void ::ADC3_IRQHandler(void);
     friend void ::ADC4_IRQHandler(void);
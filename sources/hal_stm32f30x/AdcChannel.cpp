@@ -15,6 +15,10 @@ using hal::Factory;
 
 uint32_t Adc::Channel::getValue(void) const
 {
+    if (mScanAverage) {
+        return static_cast<uint32_t>(mScanAverage() + 0.5f);
+    }
+
     const int now = static_cast<int>(os::Task::getTickCount());
 
     if (static_cast<uint32_t>(std::abs(now - static_cast<int>(mLastUpdateTicks))) < mCacheTimeInTicks) {
@@ -38,6 +42,10 @@ void Adc::Channel::stopConversion(void) const
 
 float Adc::Channel::getVoltage(void) const
 {
+    if (mScanAverage) {
+        return getVoltage(mScanAverage());
+    }
+
     return mBaseAdc.getVoltage(*this);
 }
 
@@ -10,11 +10,14 @@
 #include <limits>
 #include <array>
 #include <chrono>
+#include "delegate.h"
 #include "hal_Factory.h"
 #include "Adc.h"
 
 namespace hal
 {
+struct AdcScanGroup;
+
 struct Adc::Channel {
 #include "Adc_Channel_config.h"
 
@@ -55,6 +58,8 @@ private:
     const uint8_t mRank;
     mutable uint32_t mLastUpdateTicks = 0;
     mutable uint32_t mCacheValue = 0;
+    /// Set while an AdcScanGroup samples the channel in the background
+    mutable utility::Delegate<float(void)> mScanAverage;
 
     void initialize(void) const;
 
@@ -63,7 +68,9 @@ private:
 
     friend struct Adc;
     friend struct AdcWithDma;
+    friend struct AdcScanGroup;
     friend class Factory<Adc::Channel>;
+    friend class Factory<AdcScanGroup>;
     friend struct PhaseCurrentSensor;
 };
 
@@ -131,6 +138,9 @@ public:
     }
     template<typename U>
     friend const U& getFactory(void);
+
+    friend struct AdcScanGroup;
+    friend class Factory<AdcScanGroup>;
 };
 }
 
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "AdcScanGroup.h"
+#include "trace.h"
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Adc;
+using hal::AdcScanGroup;
+using hal::Dma;
+using hal::Factory;
+
+void AdcScanGroup::initialize(void) const
+{
+    auto ADCx = mAdc.getBasePointer();
+
+    // Single conversions of the ADC aren't used anymore
+    ADC_ITConfig(ADCx, ADC_IT_EOC, DISABLE);
+
+    ADC_InitTypeDef conf = mAdc.mConfiguration;
+    conf.ADC_ContinuousConvMode = ADC_ContinuousConvMode_Disable;
+    conf.ADC_ExternalTrigConvEvent = mExternalTrigger;
+    conf.ADC_ExternalTrigEventEdge = ADC_ExternalTrigEventEdge_RisingEdge;
+    // A late DMA request must not stop the scans
+    conf.ADC_OverrunMode = ADC_OverrunMode_Enable;
+    conf.ADC_NbrOfRegChannel = mNumberOfChannels;
+    ADC_Init(ADCx, &conf);
+
+    for (size_t rank = 0; rank < mNumberOfChannels; rank++) {
+        const Adc::Channel& channel = getChannel(rank);
+        ADC_RegularChannelConfig(ADCx, channel.mChannel, rank + 1, channel.mSampleTime);
+    }
+
+    ADC_DMAConfig(ADCx, ADC_DMAMode_Circular);
+    ADC_DMACmd(ADCx, ENABLE);
+
+    if (!mDma.registerInterruptCallback([this] {
+        decimate(0);
+    }, Dma::HT) ||
+        !mDma.registerInterruptCallback([this] {
+        decimate(1);
+    }, Dma::TC))
+    {
+        Trace(ZONE_ERROR, "Scan group stream needs DMA_IT_HT and DMA_IT_TC\r\n");
+        return;
+    }
+
+    mDma.setupTransfer(reinterpret_cast<uint8_t const*>(SampleBuffers[mDescription].data()),
+                       2 * mNumberOfChannels * mOversampling, true);
+    mDma.enable();
+
+    ADC_StartConversion(ADCx);
+    mTrigger.selectOutputTrigger(TIM_TRGOSource_Update);
+    mTrigger.enable();
+
+    // Runs before the scheduler, the channels read 0 until the first result
+    for (size_t rank = 0; rank < mNumberOfChannels; rank++) {
+        getChannel(rank).mScanAverage = [this, rank] {
+            return getAverage(rank);
+        };
+    }
+}
+
+const Adc::Channel& AdcScanGroup::getChannel(const size_t rank) const
+{
+    return Factory<Adc::Channel>::Container[mChannels[rank]];
+}
+
+void AdcScanGroup::decimate(const size_t half) const
+{
+    State& state = States[mDescription];
+    const size_t samplesPerHalf = mNumberOfChannels * mOversampling;
+    uint16_t const* sample = SampleBuffers[mDescription].data() + half * samplesPerHalf;
+
+    // Only this interrupt writes, so the counter needs no read-modify-write
+    const uint32_t sequence = state.sequence.load(std::memory_order_relaxed);
+    state.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& sums = state.sums[(sequence / 2 + 1) & 1];
+    for (size_t rank = 0; rank < mNumberOfChannels; rank++) {
+        sums[rank] = 0;
+    }
+    for (size_t scan = 0; scan < mOversampling; scan++) {
+        for (size_t rank = 0; rank < mNumberOfChannels; rank++) {
+            sums[rank] += *sample++;
+        }
+    }
+
+    state.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+float AdcScanGroup::getAverage(const size_t rank) const
+{
+    const State& state = States[mDescription];
+    const uint32_t sequence = state.sequence.load(std::memory_order_acquire);
+
+    if (sequence < 2) {
+        return 0;
+    }
+
+    // A single word is never torn, even if the writer laps the reader
+    return static_cast<float>(state.sums[(sequence / 2) & 1][rank]) / mOversampling;
+}
+
+float AdcScanGroup::getVoltage(const size_t rank) const
+{
+    return getChannel(rank).getVoltage(getAverage(rank));
+}
+
+uint32_t AdcScanGroup::snapshot(std::array<float, MAX_CHANNELS>& averages) const
+{
+    const State& state = States[mDescription];
+    std::array<uint32_t, MAX_CHANNELS> copy;
+    uint32_t sequence;
+    uint32_t current;
+
+    do {
+        sequence = state.sequence.load(std::memory_order_acquire);
+        copy = state.sums[(sequence / 2) & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        current = state.sequence.load(std::memory_order_relaxed);
+
+        // The copied buffer is written again by the second decimation after it
+    } while (current - (sequence & ~1u) > 2);
+
+    if (sequence < 2) {
+        return 0;
+    }
+
+    for (size_t rank = 0; rank < mNumberOfChannels; rank++) {
+        averages[rank] = static_cast<float>(copy[rank]) / mOversampling;
+    }
+    return sequence / 2;
+}
+
+uint32_t AdcScanGroup::getNumberOfResults(void) const
+{
+    return States[mDescription].sequence.load(std::memory_order_acquire) / 2;
+}
+
+size_t AdcScanGroup::getNumberOfChannels(void) const
+{
+    return mNumberOfChannels;
+}
+
+std::array<AdcScanGroup::State, AdcScanGroup::Description::__ENUM__SIZE> AdcScanGroup::States;
+std::array<std::array<uint16_t, 2 * AdcScanGroup::MAX_CHANNELS * AdcScanGroup::MAX_OVERSAMPLING>,
+           AdcScanGroup::Description::__ENUM__SIZE> AdcScanGroup::SampleBuffers;
+constexpr std::array<const AdcScanGroup, AdcScanGroup::Description::__ENUM__SIZE> Factory<AdcScanGroup>::Container;
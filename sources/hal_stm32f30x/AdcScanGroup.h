@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#ifndef SOURCES_PMD_ADC_SCAN_GROUP_H_
+#define SOURCES_PMD_ADC_SCAN_GROUP_H_
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include "hal_Factory.h"
+#include "Adc.h"
+#include "AdcChannel.h"
+#include "Dma.h"
+#include "Tim.h"
+
+namespace hal
+{
+/**
+ * Samples the slow channels of one ADC in the background. The trigger timer
+ * starts a scan of the whole regular sequence at a fixed rate, the DMA stream
+ * writes the scans to a circular buffer of two halves. Each half holds
+ * oversampling scans and is decimated in the half transfer and transfer
+ * complete interrupt to one sum per channel.
+ *
+ * The sums are published in one of two buffers flipped by a sequence counter
+ * (seqlock), readers never lock and readers in interrupts never retry.
+ * Adc::Channel::getValue() and getVoltage() of the channels return the
+ * latest average instead of starting a blocking conversion. They return 0
+ * until the first decimation step, one oversampling period after start.
+ *
+ * The ADC is reserved for the group, all channels of it used by the
+ * application have to be part of the group.
+ */
+struct AdcScanGroup {
+#include "AdcScanGroup_config.h"
+
+    AdcScanGroup() = delete;
+    AdcScanGroup(const AdcScanGroup&) = delete;
+    AdcScanGroup(AdcScanGroup&&) = default;
+    AdcScanGroup& operator=(const AdcScanGroup&) = delete;
+    AdcScanGroup& operator=(AdcScanGroup&&) = delete;
+
+    /// Average of the last decimation step of the channel at rank, 0 before the first one
+    float getAverage(const size_t rank) const;
+    float getVoltage(const size_t rank) const;
+
+    /**
+     * Copies the averages of all channels of the same decimation step.
+     * @return number of decimation steps so far, 0 leaves averages untouched
+     */
+    uint32_t snapshot(std::array<float, MAX_CHANNELS>& averages) const;
+
+    uint32_t getNumberOfResults(void) const;
+    size_t getNumberOfChannels(void) const;
+
+    const enum Description mDescription;
+
+private:
+    constexpr AdcScanGroup(const enum Description&                               desc,
+                           const Adc&                                            adc,
+                           const Dma&                                            dma,
+                           const Tim&                                            trigger,
+                           const uint32_t                                        externalTrigger,
+                           const std::initializer_list<Adc::Channel::Description> channels,
+                           const uint16_t                                        oversampling) :
+        mDescription(desc), mAdc(adc), mDma(dma), mTrigger(trigger),
+        mExternalTrigger(externalTrigger),
+        mChannels{}, mNumberOfChannels(channels.size()),
+        mOversampling(oversampling)
+    {
+        size_t rank = 0;
+        for (const auto& channel : channels) {
+            if (rank < MAX_CHANNELS) {
+                mChannels[rank++] = channel;
+            }
+        }
+    }
+
+    const Adc& mAdc;
+    const Dma& mDma;
+    const Tim& mTrigger;
+    const uint32_t mExternalTrigger;
+    /// In the order of the ranks of the regular sequence
+    Adc::Channel::Description mChannels[MAX_CHANNELS];
+    const size_t mNumberOfChannels;
+    const uint16_t mOversampling;
+
+    /// sequence is odd while decimate() writes the buffer that isn't published
+    struct State {
+        std::atomic<uint32_t> sequence;
+        std::array<std::array<uint32_t, MAX_CHANNELS>, 2> sums;
+    };
+
+    void initialize(void) const;
+    const Adc::Channel& getChannel(const size_t rank) const;
+    void decimate(const size_t half) const;
+
+    static std::array<State, Description::__ENUM__SIZE> States;
+    static std::array<std::array<uint16_t, 2 * MAX_CHANNELS * MAX_OVERSAMPLING>,
+                      Description::__ENUM__SIZE> SampleBuffers;
+
+    friend class Factory<AdcScanGroup>;
+};
+
+template<>
+class Factory<AdcScanGroup>
+{
+#include "AdcScanGroup_config.h"
+
+    Factory(void)
+    {
+        for (const auto& obj : Container) {
+            obj.initialize();
+        }
+    }
+
+    static constexpr bool isOnAdc(const AdcScanGroup& group, const size_t rank)
+    {
+        return (rank >= group.mNumberOfChannels) ||
+               ((Factory<Adc::Channel>::Container[group.mChannels[rank]].mBaseAdc.mDescription ==
+                 group.mAdc.mDescription) && isOnAdc(group, rank + 1));
+    }
+
+public:
+
+    template<enum AdcScanGroup::Description index>
+    static constexpr const AdcScanGroup& get(void)
+    {
+        static_assert(Container[index].mNumberOfChannels > 0, "Empty scan group");
+        static_assert(Container[index].mNumberOfChannels <= AdcScanGroup::MAX_CHANNELS, "Too many channels");
+        static_assert((Container[index].mOversampling > 0) &&
+                      (Container[index].mOversampling <= AdcScanGroup::MAX_OVERSAMPLING),
+                      "Invalid oversampling");
+        static_assert(IS_ADC_EXT_TRIG(Container[index].mExternalTrigger), "Invalid Parameter");
+        static_assert(isOnAdc(Container[index], 0), "All channels of a scan group have to be on its ADC");
+
+        static_assert(index != AdcScanGroup::Description::__ENUM__SIZE, "__ENUM__SIZE is not accessible");
+        static_assert(Container[index].mDescription == index, "Wrong mapping between Description and Container");
+
+        return Container[index];
+    }
+
+    template<typename U>
+    friend const U& getFactory(void);
+};
+}
+
+#endif /* SOURCES_PMD_ADC_SCAN_GROUP_H_ */
@@ -37,16 +37,61 @@ void AdcWithDma::startConversion(uint16_t const* const data, const size_t length
     mAdcChannel.startConversion();
 }
 
-void AdcWithDma::startConversion(uint16_t const* const data, const size_t length,
-                                 std::function<void(void)> callBack) const
+void AdcWithDma::startConversion(uint16_t const* const         data, const size_t length,
+                                 utility::Delegate<void(void)> callBack) const
 {
     mDma.setupTransfer(reinterpret_cast<uint8_t const* const>(data), length, true);
+    mDma.unregisterInterruptCallback(Dma::HT);
     mDma.registerInterruptCallback(callBack, Dma::TC);
 
     mDma.enable();
     mAdcChannel.startConversion();
 }
 
+void AdcWithDma::startDoubleBufferedConversion(uint16_t const* const data,
+                                               const size_t          length,
+                                               HalfBufferCallback    callBack) const
+{
+    mBuffer = data;
+    mBufferLength = length & ~static_cast<size_t>(1);
+    mHalfBufferCallback = callBack;
+
+    mDma.setupTransfer(reinterpret_cast<uint8_t const* const>(data), mBufferLength, true);
+    if (!mDma.registerInterruptCallback([this] {
+        halfBufferComplete(0);
+    }, Dma::HT) ||
+        !mDma.registerInterruptCallback([this] {
+        halfBufferComplete(1);
+    }, Dma::TC))
+    {
+        Trace(ZONE_ERROR, "Double buffering needs DMA_IT_HT and DMA_IT_TC\r\n");
+        return;
+    }
+
+    mDma.enable();
+    mAdcChannel.startConversion();
+}
+
+void AdcWithDma::halfBufferComplete(const size_t half) const
+{
+    const size_t halfLength = mBufferLength / 2;
+
+    if (mHalfBufferCallback) {
+        mHalfBufferCallback(mBuffer + half * halfLength, halfLength);
+    }
+
+    // The stream has to be still in the other half, else it overwrote samples meanwhile
+    const size_t position = mBufferLength - mDma.getCurrentDataCounter();
+    if ((position >= halfLength) == (half == 1)) {
+        mOverruns++;
+    }
+}
+
+uint32_t AdcWithDma::getOverruns(void) const
+{
+    return mOverruns;
+}
+
 void AdcWithDma::stopConversion(void) const
 {
     mAdcChannel.stopConversion();
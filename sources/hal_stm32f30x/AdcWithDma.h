@@ -17,6 +17,9 @@
 namespace hal
 {
 struct AdcWithDma {
+    /// Receives the half of the buffer the DMA stream just completed
+    using HalfBufferCallback = utility::Delegate<void(uint16_t const* const samples, const size_t length)>;
+
     AdcWithDma() = delete;
     AdcWithDma(const AdcWithDma&) = delete;
     AdcWithDma(AdcWithDma&&) = default;
@@ -26,11 +29,27 @@ struct AdcWithDma {
     template<size_t n>
     void startConversion(const std::array<uint16_t, n>& data, os::Semaphore* dataAvailable = nullptr) const;
     template<size_t n>
-    void startConversion(const std::array<uint16_t, n>& data, std::function<void(void)> callBack) const;
+    void startConversion(const std::array<uint16_t, n>& data, utility::Delegate<void(void)> callBack) const;
     void stopConversion(void) const;
 
     void startConversion(uint16_t const* const data, const size_t length, os::Semaphore* dataAvailableSemaphore) const;
-    void startConversion(uint16_t const* const data, const size_t length, std::function<void(void)> callBack) const;
+    void startConversion(uint16_t const* const data, const size_t length, utility::Delegate<void(void)> callBack) const;
+
+    /**
+     * Converts into data as a ping-pong buffer. callBack is called from the
+     * half transfer and the transfer complete interrupt with the half just
+     * completed, while the stream writes the other one. The callback has to
+     * return within the time of one half, getOverruns() counts the calls
+     * after which the stream was back in the half handed out.
+     * @param length number of samples, rounded down to an even number
+     */
+    void startDoubleBufferedConversion(uint16_t const* const data,
+                                       const size_t          length,
+                                       HalfBufferCallback    callBack) const;
+    template<size_t n>
+    void startDoubleBufferedConversion(const std::array<uint16_t, n>& data, HalfBufferCallback callBack) const;
+
+    uint32_t getOverruns(void) const;
 
     float getVoltage(const uint16_t) const;
     float getVoltage(const float) const;
@@ -48,7 +67,13 @@ private:
     const uint32_t mAdcDmaMode;
     const Dma& mDma;
 
+    mutable HalfBufferCallback mHalfBufferCallback;
+    mutable uint16_t const* mBuffer = nullptr;
+    mutable size_t mBufferLength = 0;
+    mutable uint32_t mOverruns = 0;
+
     void initialize(void) const;
+    void halfBufferComplete(const size_t half) const;
     friend class Factory<AdcWithDma>;
 };
 
@@ -59,11 +84,19 @@ void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, os::Semaph
 }
 
 template<size_t n>
-void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, std::function<void(void)> callBack) const
+void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, utility::Delegate<void(void)> callBack) const
 {
     startConversion(data.data(), data.size(), callBack);
 }
 
+template<size_t n>
+void AdcWithDma::startDoubleBufferedConversion(const std::array<uint16_t, n>& data,
+                                               HalfBufferCallback             callBack) const
+{
+    static_assert(n % 2 == 0, "Both halves need the same length");
+    startDoubleBufferedConversion(data.data(), data.size(), callBack);
+}
+
 template<>
 class Factory<AdcWithDma>
 {
@@ -9,7 +9,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f30x.h"
 #include "stm32f30x_dma.h"
 #include "stm32f30x_rcc.h"
@@ -55,7 +55,7 @@ struct Dma {
     void enable(void) const;
     void disable(void) const;
     bool registerInterruptSemaphore(os::Semaphore* const semaphore, const InterruptSource) const;
-    bool registerInterruptCallback(std::function<void(void)> callback, const InterruptSource) const;
+    bool registerInterruptCallback(utility::Delegate<void(void)> callback, const InterruptSource) const;
     void unregisterInterruptSemaphore(const InterruptSource) const;
     void unregisterInterruptCallback(const InterruptSource) const;
 
@@ -94,7 +94,7 @@ private:
 
     using SemaphoreArray = std::array<os::Semaphore*, Dma::__ENUM__SIZE>;
     inline static void DMA_IRQHandlerSemaphore(const Dma& peripherie, const SemaphoreArray&);
-    using CallbackArray = std::array<std::function<void (void)>, Dma::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Dma::__ENUM__SIZE>;
     inline static void DMA_IRQHandlerCallback(const Dma& peripherie, const CallbackArray&);
 
     static SemaphoreArray TCInterruptSemaphores; // Transfer Complete
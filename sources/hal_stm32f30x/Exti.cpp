@@ -233,7 +233,7 @@ void Exti::clearInterruptBit(void) const
     EXTI_ClearITPendingBit(mConfiguration.EXTI_Line);
 }
 
-void Exti::registerInterruptCallback(std::function<void(void)> f) const
+void Exti::registerInterruptCallback(utility::Delegate<void(void)> f) const
 {
     ExtiCallbacks[mDescription] = f;
 }
@@ -9,7 +9,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f30x_exti.h"
 #include "stm32f30x_syscfg.h"
 #include "stm32f30x_rcc.h"
@@ -41,7 +41,7 @@ struct Exti {
 
     void enable(void) const;
     void disable(void) const;
-    void registerInterruptCallback(std::function<void(void)> ) const;
+    void registerInterruptCallback(utility::Delegate<void(void)> ) const;
     void unregisterInterruptCallback(void) const;
     void handleInterrupt(void) const;
 
@@ -73,7 +73,7 @@ private:
     void initialize(void) const;
     bool getStatus(void) const;
 
-    using CallbackArray = std::array<std::function<void (void)>, Exti::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Exti::__ENUM__SIZE>;
     static CallbackArray ExtiCallbacks;
 
     friend class Factory<Exti>;
@@ -50,13 +50,13 @@ void PhaseCurrentSensor::setNumberOfMeasurementsForPhaseCurrentValue(uint32_t va
     if (value == 0) {
         value = 1;
     }
+    if (value == mNumberOfMeasurementsForPhaseCurrentValue) {
+        // A restart would drop the half buffer in progress
+        return;
+    }
     mNumberOfMeasurementsForPhaseCurrentValue = value;
     mAdcWithDma.stopConversion();
-    mAdcWithDma.startConversion(
-                                MeasurementValueBuffer[mDescription].data(), mNumberOfMeasurementsForPhaseCurrentValue,
-                                [&] {
-        this->updateCurrentValue();
-    });
+    enable();
 }
 
 size_t PhaseCurrentSensor::getNumberOfMeasurementsForPhaseCurrentValue(void) const
@@ -64,18 +64,27 @@ size_t PhaseCurrentSensor::getNumberOfMeasurementsForPhaseCurrentValue(void) con
     return mNumberOfMeasurementsForPhaseCurrentValue;
 }
 
-void PhaseCurrentSensor::updateCurrentValue(void) const
+void PhaseCurrentSensor::updateCurrentValue(uint16_t const* const samples, const size_t length) const
 {
-    auto& array = MeasurementValueBuffer[mDescription];
+    const uint32_t start = DWT->CYCCNT;
 
-    for (size_t i = 0; i < mNumberOfMeasurementsForPhaseCurrentValue; i++) {
-        mPhaseCurrentValue -= mPhaseCurrentValue / FILTERWIDTH;
-        mPhaseCurrentValue += static_cast<float>(array[i]) / FILTERWIDTH;
+    mPhaseCurrentFilter.update(samples, length);
+
+    if (mValueAvailableCallback) {
+        mValueAvailableCallback();
     }
 
     if (mValueAvailableSemaphore) {
         mValueAvailableSemaphore->giveFromISR();
     }
+
+    const uint32_t cycles = DWT->CYCCNT - start;
+    if (mInterruptTiming.calls++ > 0) {
+        mInterruptTiming.periodCycles = start - mLastInterruptStart;
+    }
+    mInterruptTiming.lastCycles = cycles;
+    mInterruptTiming.maxCycles = std::max(mInterruptTiming.maxCycles, cycles);
+    mLastInterruptStart = start;
 }
 
 void PhaseCurrentSensor::registerValueAvailableSemaphore(os::Semaphore* valueAvailable) const
@@ -88,10 +97,44 @@ void PhaseCurrentSensor::unregisterValueAvailableSemaphore(void) const
     mValueAvailableSemaphore = nullptr;
 }
 
+void PhaseCurrentSensor::registerValueAvailableCallback(utility::Delegate<void(void)> callback) const
+{
+    os::ThisTask::enterCriticalSection();
+    mValueAvailableCallback = callback;
+    os::ThisTask::exitCriticalSection();
+}
+
+void PhaseCurrentSensor::unregisterValueAvailableCallback(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    mValueAvailableCallback = nullptr;
+    os::ThisTask::exitCriticalSection();
+}
+
+PhaseCurrentSensor::InterruptTiming PhaseCurrentSensor::getInterruptTiming(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    InterruptTiming timing = mInterruptTiming;
+    os::ThisTask::exitCriticalSection();
+
+    timing.overruns = mAdcWithDma.getOverruns();
+    return timing;
+}
+
+void PhaseCurrentSensor::resetInterruptTiming(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    mInterruptTiming = InterruptTiming {};
+    os::ThisTask::exitCriticalSection();
+}
+
 void PhaseCurrentSensor::enable(void) const
 {
-    mAdcWithDma.startConversion(MeasurementValueBuffer[mDescription], [&] {
-        this->updateCurrentValue();
+    // One half is filtered while the DMA fills the other one
+    mAdcWithDma.startDoubleBufferedConversion(MeasurementValueBuffer[mDescription].data(),
+                                              2 * mNumberOfMeasurementsForPhaseCurrentValue,
+                                              [this](uint16_t const* const samples, const size_t length) {
+        this->updateCurrentValue(samples, length);
     });
 }
 
@@ -102,30 +145,60 @@ void PhaseCurrentSensor::disable(void) const
 
 void PhaseCurrentSensor::reset(void) const
 {
-    mPhaseCurrentValue = 2 * mOffsetValue - mPhaseCurrentValue;
+    mPhaseCurrentFilter.setRaw(2 * mOffsetValue - mPhaseCurrentFilter.getRaw());
 }
 
 void PhaseCurrentSensor::calibrate(void) const
 {
     os::ThisTask::sleep(std::chrono::milliseconds(250));
-    mOffsetValue = mPhaseCurrentValue;
+    mOffsetValue = mPhaseCurrentFilter.getRaw();
 }
 
 float PhaseCurrentSensor::getPhaseCurrent(void) const
 {
     static constexpr const float A_PER_DIGITS = 1.0 / 53.8;
+    static constexpr const float A_PER_RAW = A_PER_DIGITS / Filter::ONE;
 
-    return static_cast<float>(mOffsetValue - mPhaseCurrentValue) *
-           A_PER_DIGITS;
+    return static_cast<float>(mOffsetValue - mPhaseCurrentFilter.getRaw()) * A_PER_RAW;
 }
 
 float PhaseCurrentSensor::getCurrentVoltage(void) const
 {
-    return mAdcWithDma.getVoltage(mPhaseCurrentValue);
+    return mAdcWithDma.getVoltage(mPhaseCurrentFilter.get());
+}
+
+PhaseCurrentSensor::BenchmarkResult PhaseCurrentSensor::benchmarkFilter(uint16_t const* const samples,
+                                                                        const size_t          length) const
+{
+    BenchmarkResult result {length, 0, 0};
+    volatile float reference = mPhaseCurrentFilter.get();
+    Filter filter;
+    filter.setRaw(mPhaseCurrentFilter.getRaw());
+
+    os::ThisTask::enterCriticalSection();
+    uint32_t start = DWT->CYCCNT;
+    float value = reference;
+    for (size_t i = 0; i < length; i++) {
+        value -= value / FILTERWIDTH;
+        value += static_cast<float>(samples[i]) / FILTERWIDTH;
+    }
+    reference = value;
+    result.floatCycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    filter.update(samples, length);
+    result.fixedPointCycles = DWT->CYCCNT - start;
+    os::ThisTask::exitCriticalSection();
+
+    return result;
 }
 
 void PhaseCurrentSensor::initialize(void) const
 {
+    // The interrupt timing and the benchmark take differences of the free running cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     TIM_OC4Init(mHBridge.mTim.getBasePointer(), &mAdcTrgoConfiguration);
     TIM_OC4PreloadConfig(mHBridge.mTim.getBasePointer(), TIM_OCPreload_Enable);
 
@@ -140,5 +213,5 @@ void PhaseCurrentSensor::initialize(void) const
 constexpr const std::array<const PhaseCurrentSensor,
                            PhaseCurrentSensor::Description::__ENUM__SIZE> Factory<PhaseCurrentSensor>::Container;
 std::array<std::array<uint16_t,
-                      PhaseCurrentSensor::MAX_NUMBER_OF_MEASUREMENTS>,
+                      2 * PhaseCurrentSensor::MAX_NUMBER_OF_MEASUREMENTS>,
            PhaseCurrentSensor::Description::__ENUM__SIZE> PhaseCurrentSensor::MeasurementValueBuffer;
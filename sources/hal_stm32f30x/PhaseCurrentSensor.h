@@ -12,6 +12,8 @@
 #include "stm32f30x_syscfg.h"
 #include "TimHalfBridge.h"
 #include "AdcWithDma.h"
+#include "fixedPointFilter.h"
+#include "delegate.h"
 
 namespace hal
 {
@@ -28,6 +30,29 @@ struct PhaseCurrentSensor {
     float getCurrentVoltage(void) const;
     void registerValueAvailableSemaphore(os::Semaphore* valueAvailable) const;
     void unregisterValueAvailableSemaphore(void) const;
+
+    /**
+     * The callback runs in the DMA interrupt right after the filter got a
+     * half buffer, i.e. once every getNumberOfMeasurementsForPhaseCurrentValue()
+     * periods of the half bridge PWM, which triggers the conversions.
+     */
+    void registerValueAvailableCallback(utility::Delegate<void(void)> callback) const;
+    void unregisterValueAvailableCallback(void) const;
+
+    /// Measured with the DWT cycle counter in the DMA interrupt
+    struct InterruptTiming {
+        uint32_t calls;
+        /// Between the last two interrupts, the budget of one interrupt
+        uint32_t periodCycles;
+        /// Filter and callback of the last interrupt
+        uint32_t lastCycles;
+        uint32_t maxCycles;
+        /// Half buffers completed again before they were handled, since start
+        uint32_t overruns;
+    };
+
+    InterruptTiming getInterruptTiming(void) const;
+    void resetInterruptTiming(void) const;
     void calibrate(void) const;
     void reset(void) const;
     void setPulsWidthForTriggerPerMill(uint32_t) const;
@@ -36,6 +61,19 @@ struct PhaseCurrentSensor {
     void disable(void) const;
     size_t getNumberOfMeasurementsForPhaseCurrentValue(void) const;
 
+    struct BenchmarkResult {
+        size_t length;
+        uint32_t floatCycles;
+        uint32_t fixedPointCycles;
+    };
+
+    /**
+     * Measures the filter of one half buffer with the DWT cycle counter, once
+     * with the former float filter and once with the fixed point one.
+     * Only meaningful on the target.
+     */
+    BenchmarkResult benchmarkFilter(uint16_t const* const samples, const size_t length) const;
+
 private:
     constexpr PhaseCurrentSensor(const enum Description&  desc,
                                  const HalfBridge&        hBridge,
@@ -43,7 +81,7 @@ private:
                                  const TIM_OCInitTypeDef& adcTrgoConf) :
         mDescription(desc), mHBridge(hBridge), mAdcWithDma(adc), mAdcTrgoConfiguration(adcTrgoConf){}
 
-    void updateCurrentValue(void) const;
+    void updateCurrentValue(uint16_t const* const samples, const size_t length) const;
     void initialize(void) const;
 
     const enum Description mDescription;
@@ -51,16 +89,23 @@ private:
     const AdcWithDma& mAdcWithDma;
     const TIM_OCInitTypeDef mAdcTrgoConfiguration;
 
-    mutable float mPhaseCurrentValue = 0;
-    mutable uint16_t mOffsetValue = 2000;
+    using Filter = utility::FixedPointLowPass<static_cast<uint32_t>(FILTERWIDTH)>;
+
+    mutable Filter mPhaseCurrentFilter;
+    /// Same format as Filter::getRaw()
+    mutable int32_t mOffsetValue = 2000 * Filter::ONE;
     mutable size_t mNumberOfMeasurementsForPhaseCurrentValue = MAX_NUMBER_OF_MEASUREMENTS;
 
     mutable os::Semaphore* mValueAvailableSemaphore = nullptr;
+    mutable utility::Delegate<void(void)> mValueAvailableCallback;
+    mutable uint32_t mLastInterruptStart = 0;
+    mutable InterruptTiming mInterruptTiming {};
 
     friend class Factory<PhaseCurrentSensor>;
 
+    /// Two halves of the current number of measurements each
     static std::array<
-                      std::array<uint16_t, MAX_NUMBER_OF_MEASUREMENTS>,
+                      std::array<uint16_t, 2 * MAX_NUMBER_OF_MEASUREMENTS>,
                       Description::__ENUM__SIZE> MeasurementValueBuffer;
 };
 
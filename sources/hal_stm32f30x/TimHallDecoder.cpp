@@ -7,6 +7,7 @@
 #include <cmath>
 #include "Gpio.h"
 #include "TimHallDecoder.h"
+#include "os_Task.h"
 #include "trace.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
@@ -61,6 +62,7 @@ void HallDecoder::interruptHandler(void) const
 
 void HallDecoder::saveTimestamp(const uint32_t timestamp) const
 {
+    mTimestampSum += static_cast<uint64_t>(timestamp) - mTimestamps[mTimestampPosition];
     mTimestamps[mTimestampPosition] = timestamp;
     mTimestampPosition = (mTimestampPosition + 1) % NUMBER_OF_TIMESTAMPS;
 }
@@ -92,12 +94,12 @@ float HallDecoder::getCurrentRPS(void) const
     static constexpr float HALL_EVENTS_PER_ROTATION = 6;
     static const float timerFrequency = mTim.getTimerFrequency();
 
-    uint32_t sumTicksBetweenHallSignals = 0;
-    for (size_t i = 0; i < mTimestamps.size(); i++) {
-        sumTicksBetweenHallSignals += mTimestamps[i];
-    }
+    // Two words, which the capture interrupt may change in between
+    const uint32_t status = os::ThisTask::enterCriticalSectionFromISR();
+    const uint64_t sumTicksBetweenHallSignals = mTimestampSum;
+    os::ThisTask::exitCriticalSectionFromISR(status);
 
-    const uint32_t avgTicksBetweenHallSignals = sumTicksBetweenHallSignals / mTimestamps.size();
+    const float avgTicksBetweenHallSignals = static_cast<float>(sumTicksBetweenHallSignals) / mTimestamps.size();
 
     const float hallSignalFrequency = timerFrequency / avgTicksBetweenHallSignals;
     const float electricalRotationFrequency = hallSignalFrequency / HALL_EVENTS_PER_ROTATION;
@@ -113,6 +115,7 @@ float HallDecoder::getCurrentOmega(void) const
 void HallDecoder::reset(void) const
 {
     mTimestamps.fill(std::numeric_limits<uint32_t>::max());
+    mTimestampSum = static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) * NUMBER_OF_TIMESTAMPS;
 }
 
 uint32_t HallDecoder::getCurrentHallState(void) const
@@ -128,7 +131,7 @@ uint32_t HallDecoder::getCurrentHallState(void) const
     }
 }
 
-void HallDecoder::registerCommutationCallback(std::function<void(void)> callback) const
+void HallDecoder::registerCommutationCallback(utility::Delegate<void(void)> callback) const
 {
     CommutationCallbacks[mDescription] = callback;
 }
@@ -138,7 +141,7 @@ void HallDecoder::unregisterCommutationCallback(void) const
     registerCommutationCallback([] {});
 }
 
-void HallDecoder::registerHallEventCheckCallback(std::function<void(void)> callback) const
+void HallDecoder::registerHallEventCheckCallback(utility::Delegate<void(void)> callback) const
 {
     HallEventCallbacks[mDescription] = callback;
 }
@@ -197,5 +200,5 @@ void HallDecoder::initialize(void) const
 
 constexpr const std::array<const HallDecoder,
                            HallDecoder::Description::__ENUM__SIZE> Factory<HallDecoder>::Container;
-std::array<std::function<void(void)>, HallDecoder::Description::__ENUM__SIZE> HallDecoder::CommutationCallbacks;
-std::array<std::function<void(void)>, HallDecoder::Description::__ENUM__SIZE> HallDecoder::HallEventCallbacks;
+std::array<utility::Delegate<void(void)>, HallDecoder::Description::__ENUM__SIZE> HallDecoder::CommutationCallbacks;
+std::array<utility::Delegate<void(void)>, HallDecoder::Description::__ENUM__SIZE> HallDecoder::HallEventCallbacks;
@@ -11,7 +11,7 @@
 #include "hal_Factory.h"
 #include "dev_Factory.h"
 #include "Tim.h"
-#include <functional>
+#include "delegate.h"
 
 extern "C" {
 void TIM3_IRQHandler(void);
@@ -59,19 +59,21 @@ private:
     void interruptHandler(void) const;
     void saveTimestamp(const uint32_t) const;
 
-    void registerCommutationCallback(std::function<void(void)> ) const;
+    void registerCommutationCallback(utility::Delegate<void(void)> ) const;
     void unregisterCommutationCallback(void) const;
 
-    void registerHallEventCheckCallback(std::function<void(void)> ) const;
+    void registerHallEventCheckCallback(utility::Delegate<void(void)> ) const;
     void unregisterHallEventCheckCallback(void) const;
 
     static const size_t NUMBER_OF_TIMESTAMPS = 10;
 
     mutable std::array<uint32_t, NUMBER_OF_TIMESTAMPS> mTimestamps = {};
     mutable size_t mTimestampPosition = 0;
+    /// Sum of mTimestamps, which doesn't fit into 32 bit after reset()
+    mutable uint64_t mTimestampSum = 0;
 
-    static std::array<std::function<void(void)>, Description::__ENUM__SIZE> CommutationCallbacks;
-    static std::array<std::function<void(void)>, Description::__ENUM__SIZE> HallEventCallbacks;
+    static std::array<utility::Delegate<void(void)>, Description::__ENUM__SIZE> CommutationCallbacks;
+    static std::array<utility::Delegate<void(void)>, Description::__ENUM__SIZE> HallEventCallbacks;
 
     friend class Factory<HallDecoder>;
     friend struct dev::SensorBLDC;
@@ -6,6 +6,7 @@
 #include <limits>
 #include <cmath>
 #include "TimHallMeter.h"
+#include "os_Task.h"
 #include "trace.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
@@ -47,9 +48,17 @@ void HallMeter::interruptHandler(void) const
         TIM_ClearITPendingBit(mTim.getBasePointer(), TIM_IT_Update);
         const uint32_t eventTimestamp = TIM_GetCapture1(mTim.getBasePointer());
         saveTimestamp(eventTimestamp);
+
+        if (CaptureCallbacks[mDescription]) {
+            CaptureCallbacks[mDescription](eventTimestamp);
+        }
     } else if (TIM_GetITStatus(mTim.getBasePointer(), TIM_IT_Update)) {
         TIM_ClearITPendingBit(mTim.getBasePointer(), TIM_IT_Update);
         reset();
+
+        if (OverflowCallbacks[mDescription]) {
+            OverflowCallbacks[mDescription]();
+        }
     } else {
         // this should not happen
     }
@@ -57,6 +66,7 @@ void HallMeter::interruptHandler(void) const
 
 void HallMeter::saveTimestamp(const uint32_t timestamp) const
 {
+    mTimestampSum += static_cast<uint64_t>(timestamp) - mTimestamps[mTimestampPosition];
     mTimestamps[mTimestampPosition] = timestamp;
     mTimestampPosition = (mTimestampPosition + 1) % NUMBER_OF_TIMESTAMPS;
 }
@@ -64,6 +74,32 @@ void HallMeter::saveTimestamp(const uint32_t timestamp) const
 void HallMeter::reset(void) const
 {
     mTimestamps.fill(std::numeric_limits<uint32_t>::max());
+    mTimestampSum = static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) * NUMBER_OF_TIMESTAMPS;
+}
+
+void HallMeter::registerCaptureCallback(utility::Delegate<void(uint32_t)> callback) const
+{
+    CaptureCallbacks[mDescription] = callback;
+}
+
+void HallMeter::unregisterCaptureCallback(void) const
+{
+    CaptureCallbacks[mDescription] = nullptr;
+}
+
+void HallMeter::registerOverflowCallback(utility::Delegate<void(void)> callback) const
+{
+    OverflowCallbacks[mDescription] = callback;
+}
+
+void HallMeter::unregisterOverflowCallback(void) const
+{
+    OverflowCallbacks[mDescription] = nullptr;
+}
+
+uint32_t HallMeter::getTicksSinceLastCapture(void) const
+{
+    return mTim.getCounterValue();
 }
 
 float HallMeter::getCurrentRPS(void) const
@@ -72,12 +108,12 @@ float HallMeter::getCurrentRPS(void) const
 
     const float timerFrequency = mTim.getTimerFrequency();
 
-    uint32_t sumTicksBetweenHallSignals = 0;
-    for (size_t i = 0; i < mTimestamps.size(); i++) {
-        sumTicksBetweenHallSignals += mTimestamps[i];
-    }
+    // Two words, which the capture interrupt may change in between
+    const uint32_t status = os::ThisTask::enterCriticalSectionFromISR();
+    const uint64_t sumTicksBetweenHallSignals = mTimestampSum;
+    os::ThisTask::exitCriticalSectionFromISR(status);
 
-    const uint32_t avgTicksBetweenHallSignals = sumTicksBetweenHallSignals / mTimestamps.size();
+    const float avgTicksBetweenHallSignals = static_cast<float>(sumTicksBetweenHallSignals) / mTimestamps.size();
     const float hallSignalFrequency = timerFrequency / avgTicksBetweenHallSignals;
     const float electricalRotationFrequency = hallSignalFrequency / HALL_EVENTS_PER_ROTATION;
     const float motorRotationFrequency = electricalRotationFrequency / POLE_PAIRS;
@@ -91,7 +127,7 @@ float HallMeter::getCurrentOmega(void) const
 
 void HallMeter::initialize(void) const
 {
-    mTimestamps.fill(std::numeric_limits<uint32_t>::max());
+    reset();
 
     /* HallSensor event is delivered with signal TI1F_ED.
      * Rising and falling edge is used.*/
@@ -124,3 +160,5 @@ void HallMeter::initialize(void) const
 
 constexpr const std::array<const HallMeter,
                            HallMeter::Description::__ENUM__SIZE> Factory<HallMeter>::Container;
+std::array<utility::Delegate<void(uint32_t)>, HallMeter::Description::__ENUM__SIZE> HallMeter::CaptureCallbacks;
+std::array<utility::Delegate<void(void)>, HallMeter::Description::__ENUM__SIZE> HallMeter::OverflowCallbacks;
@@ -10,7 +10,7 @@
 #include <array>
 #include "hal_Factory.h"
 #include "Tim.h"
-#include <functional>
+#include "delegate.h"
 
 extern "C" {
 void TIM2_IRQHandler(void);
@@ -34,6 +34,17 @@ struct HallMeter {
 
     void reset(void) const;
 
+    /// Called in the capture interrupt with the ticks since the previous hall edge
+    void registerCaptureCallback(utility::Delegate<void(uint32_t)> callback) const;
+    void unregisterCaptureCallback(void) const;
+
+    /// Called in the same interrupt after reset(), when the counter overflowed without a hall edge
+    void registerOverflowCallback(utility::Delegate<void(void)> callback) const;
+    void unregisterOverflowCallback(void) const;
+
+    /// The counter restarts at every hall edge
+    uint32_t getTicksSinceLastCapture(void) const;
+
     const enum Description mDescription;
     const Tim& mTim;
 
@@ -54,6 +65,11 @@ private:
 
     mutable std::array<uint32_t, NUMBER_OF_TIMESTAMPS> mTimestamps = {};
     mutable size_t mTimestampPosition = 0;
+    /// Sum of mTimestamps, which doesn't fit into 32 bit after reset()
+    mutable uint64_t mTimestampSum = 0;
+
+    static std::array<utility::Delegate<void(uint32_t)>, Description::__ENUM__SIZE> CaptureCallbacks;
+    static std::array<utility::Delegate<void(void)>, Description::__ENUM__SIZE> OverflowCallbacks;
 
     const uint16_t mInputTrigger;
     const TIM_ICInitTypeDef mIc1Configuration;
@@ -49,14 +49,14 @@ void UsartWithDma::registerInterruptSemaphores(void) const
     }
 }
 
-void UsartWithDma::registerTransferCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerTransferCompleteCallback(utility::Delegate<void(void)> f) const
 {
     if (mTxDma != nullptr) {
         mTxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
     }
 }
 
-void UsartWithDma::registerReceiveCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerReceiveCompleteCallback(utility::Delegate<void(void)> f) const
 {
     if (mRxDma != nullptr) {
         mRxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
@@ -186,4 +186,12 @@ void UsartWithDma::stopNonBlockingReceive(void) const
     }
 }
 
+size_t UsartWithDma::getRemainingNonBlockingReceive(void) const
+{
+    if (mRxDma != nullptr) {
+        return mRxDma->getCurrentDataCounter();
+    }
+    return 0;
+}
+
 constexpr const std::array<const UsartWithDma, 1> Factory<UsartWithDma>::Container;
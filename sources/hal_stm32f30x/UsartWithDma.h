@@ -44,8 +44,11 @@ struct UsartWithDma {
     void stopNonBlockingSend(void) const;
     void stopNonBlockingReceive(void) const;
 
-    void registerTransferCompleteCallback(std::function<void(void)> ) const;
-    void registerReceiveCompleteCallback(std::function<void(void)> ) const;
+    /// @return bytes the running receiveNonBlocking() writes until it completes or wraps around
+    size_t getRemainingNonBlockingReceive(void) const;
+
+    void registerTransferCompleteCallback(utility::Delegate<void(void)> ) const;
+    void registerReceiveCompleteCallback(utility::Delegate<void(void)> ) const;
 
     void enableReceiveTimeout(const size_t bitsUntilTimeout) const;
     void disableReceiveTimeout(void) const;
@@ -45,8 +45,8 @@ void AdcWithDma::startConversion(uint16_t const* const data, const size_t length
     mAdcChannel.startConversion();
 }
 
-void AdcWithDma::startConversion(uint16_t const* const data, const size_t length,
-                                 std::function<void(void)> callBack) const
+void AdcWithDma::startConversion(uint16_t const* const         data, const size_t length,
+                                 utility::Delegate<void(void)> callBack) const
 {
     mDma.setupTransfer(reinterpret_cast<uint8_t const* const>(data), length, true);
     mDma.registerInterruptCallback(callBack, Dma::TC);
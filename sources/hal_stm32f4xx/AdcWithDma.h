@@ -36,11 +36,11 @@ struct AdcWithDma {
     template<size_t n>
     void startConversion(const std::array<uint16_t, n>& data, os::Semaphore* dataAvailable = nullptr) const;
     template<size_t n>
-    void startConversion(const std::array<uint16_t, n>& data, std::function<void(void)> callBack) const;
+    void startConversion(const std::array<uint16_t, n>& data, utility::Delegate<void(void)> callBack) const;
     void stopConversion(void) const;
 
     void startConversion(uint16_t const* const data, const size_t length, os::Semaphore* dataAvailableSemaphore) const;
-    void startConversion(uint16_t const* const data, const size_t length, std::function<void(void)> callBack) const;
+    void startConversion(uint16_t const* const data, const size_t length, utility::Delegate<void(void)> callBack) const;
 
     float getVoltage(const uint16_t) const;
     float getVoltage(const float) const;
@@ -69,7 +69,7 @@ void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, os::Semaph
 }
 
 template<size_t n>
-void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, std::function<void(void)> callBack) const
+void AdcWithDma::startConversion(const std::array<uint16_t, n>& data, utility::Delegate<void(void)> callBack) const
 {
     startConversion(data.data(), data.size(), callBack);
 }
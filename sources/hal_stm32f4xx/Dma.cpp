@@ -44,28 +44,16 @@ void Dma::DMA_IRQHandler(const Dma* const peripherie)
     const uint32_t HTFlag = getHTFlagForStream(peripherie->mPeripherie);
     const uint32_t TEFlag = getTEFlagForStream(peripherie->mPeripherie);
 
-    if (DMA_GetFlagStatus(pPeripheral, TCFlag)) {
-        Dma::DMA_TCIRQHandler(*peripherie);
-    } else if (DMA_GetFlagStatus(pPeripheral, HTFlag)) {
-        Dma::DMA_HTIRQHandler(*peripherie);
-    } else if (DMA_GetFlagStatus(pPeripheral, TEFlag)) {
-        Dma::DMA_TEIRQHandler(*peripherie);
-    }
-}
-
-void Dma::ClearInterruptFlag(const Dma* const peripherie)
-{
-    DMA_Stream_TypeDef* pPeripheral = reinterpret_cast<DMA_Stream_TypeDef*>(peripherie->mPeripherie);
-    const uint32_t TCFlag = getTCFlagForStream(peripherie->mPeripherie);
-    const uint32_t HTFlag = getHTFlagForStream(peripherie->mPeripherie);
-    const uint32_t TEFlag = getTEFlagForStream(peripherie->mPeripherie);
-
+    // Cleared before the handlers run, they may start the next transfer of the stream
     if (DMA_GetFlagStatus(pPeripheral, TCFlag)) {
         DMA_ClearFlag(pPeripheral, TCFlag);
+        Dma::DMA_TCIRQHandler(*peripherie);
     } else if (DMA_GetFlagStatus(pPeripheral, HTFlag)) {
         DMA_ClearFlag(pPeripheral, HTFlag);
+        Dma::DMA_HTIRQHandler(*peripherie);
     } else if (DMA_GetFlagStatus(pPeripheral, TEFlag)) {
         DMA_ClearFlag(pPeripheral, TEFlag);
+        Dma::DMA_TEIRQHandler(*peripherie);
     }
 }
 
@@ -105,9 +93,8 @@ void Dma::initialize(void) const
     if (mDmaInterrupt) {
         DMA_ITConfig(pPeripheral, mDmaInterrupt, ENABLE);
 
-        mpNvic->registerClearInterruptProcedure([this](void) {
-            Dma::ClearInterruptFlag(this);
-        });
+        // DMA_IRQHandler() clears the flags itself, Nvic only enables with a clear procedure
+        mpNvic->registerClearInterruptProcedure([](void) {});
         mpNvic->registerGetInterruptStatusProcedure([this](void) -> bool {
             return Dma::GetInterruptFlagStatus(this);
         });
@@ -160,28 +147,51 @@ void Dma::memcpy(void const* const dest, void const* const src, const size_t len
         return;
     }
 
+    setupMemcpy(const_cast<void*>(dest), src, static_cast<uint16_t>(length), 1, false);
+    enable();
+}
+
+void Dma::setupMemcpy(void* const       dest,
+                      void const* const src,
+                      const uint16_t    items,
+                      const size_t      width,
+                      const bool        burst) const
+{
     disable();
 
+    const uint32_t peripheralDataSize = (width == 4) ? DMA_PeripheralDataSize_Word :
+                                        (width == 2) ? DMA_PeripheralDataSize_HalfWord :
+                                        DMA_PeripheralDataSize_Byte;
+    const uint32_t memoryDataSize = (width == 4) ? DMA_MemoryDataSize_Word :
+                                    (width == 2) ? DMA_MemoryDataSize_HalfWord :
+                                    DMA_MemoryDataSize_Byte;
+
+    // Memory to memory transfers always run through the FIFO
     DMA_InitTypeDef initStruct {
         mConfiguration.DMA_Channel,
         reinterpret_cast<uint32_t>(src),
         reinterpret_cast<uint32_t>(dest),
         DMA_DIR_MemoryToMemory,
-        static_cast<uint16_t>(length),
+        items,
         DMA_PeripheralInc_Enable,
         DMA_MemoryInc_Enable,
-        DMA_PeripheralDataSize_Byte,
-        DMA_MemoryDataSize_Byte,
+        peripheralDataSize,
+        memoryDataSize,
         DMA_Mode_Normal,
         DMA_Priority_Low,
-        DMA_FIFOMode_Disable,
+        DMA_FIFOMode_Enable,
         DMA_FIFOThreshold_Full,
-        DMA_MemoryBurst_Single,
-        DMA_PeripheralBurst_Single
+        burst ? DMA_MemoryBurst_INC4 : DMA_MemoryBurst_Single,
+        burst ? DMA_PeripheralBurst_INC4 : DMA_PeripheralBurst_Single
     };
     DMA_Stream_TypeDef* pPeripheral = reinterpret_cast<DMA_Stream_TypeDef*>(mPeripherie);
+    DMA_ClearFlag(pPeripheral, getTCFlagForStream(mPeripherie) | getHTFlagForStream(mPeripherie) |
+                  getTEFlagForStream(mPeripherie) | getFEFlagForStream(mPeripherie) |
+                  getDMEFlagForStream(mPeripherie));
     DMA_Init(pPeripheral, &initStruct);
-    DMA_Cmd(pPeripheral, ENABLE);
+    if (mDmaInterrupt) {
+        DMA_ITConfig(pPeripheral, mDmaInterrupt, ENABLE);
+    }
 }
 
 void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const
@@ -199,6 +209,11 @@ void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size
     }
 }
 
+void Dma::setupReceiveSingleCharMultipleTimes(uint8_t* const data, const size_t length) const
+{
+    setupSendSingleCharMultipleTimes(data, length);
+}
+
 void Dma::enable(void) const
 {
     DMA_Cmd(reinterpret_cast<DMA_Stream_TypeDef*>(mPeripherie), ENABLE);
@@ -260,7 +275,7 @@ void Dma::unregisterInterruptSemaphore(const InterruptSource source) const
     }
 }
 
-bool Dma::registerInterruptCallback(std::function<void(void)> function, const Dma::InterruptSource source) const
+bool Dma::registerInterruptCallback(utility::Delegate<void(void)> function, const Dma::InterruptSource source) const
 {
     switch (source) {
     case Dma::TC:
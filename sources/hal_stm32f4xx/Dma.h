@@ -16,10 +16,11 @@
 #ifndef SOURCES_PMD_DMA_H_
 #define SOURCES_PMD_DMA_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f4xx.h"
 #include "stm32f4xx_dma.h"
 #include "stm32f4xx_rcc.h"
@@ -68,11 +69,12 @@ struct Dma {
     void setupTransfer(uint8_t const* const data, const size_t length, const bool repeat = false) const;
     void setupTransfer(uint16_t const* const data, const size_t length, const bool repeat = false) const;
     void setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const;
+    void setupReceiveSingleCharMultipleTimes(uint8_t* const data, const size_t length) const;
 
     void enable(void) const;
     void disable(void) const;
     bool registerInterruptSemaphore(os::Semaphore* const semaphore, const InterruptSource) const;
-    bool registerInterruptCallback(std::function<void(void)> callback, const InterruptSource) const;
+    bool registerInterruptCallback(utility::Delegate<void(void)> callback, const InterruptSource) const;
     void unregisterInterruptSemaphore(const InterruptSource) const;
     void unregisterInterruptCallback(const InterruptSource) const;
 
@@ -81,7 +83,17 @@ struct Dma {
 
     void memcpy(void const* const dest, void const* const src, const size_t length) const;
 
-    inline static void ClearInterruptFlag(const Dma* const peripherie);
+    /**
+     * Prepares a memory to memory transfer of items of width bytes (1, 2 or 4),
+     * enable() starts it. burst moves four items at once, addresses have to
+     * be aligned to a burst then.
+     */
+    void setupMemcpy(void* const       dest,
+                     void const* const src,
+                     const uint16_t    items,
+                     const size_t      width,
+                     const bool        burst) const;
+
     inline static bool GetInterruptFlagStatus(const Dma* const peripherie);
     inline static void DMA_IRQHandler(const Dma* const peripherie);
     inline static void DMA_TCIRQHandler(const Dma& peripherie);
@@ -111,7 +123,7 @@ private:
 
     using SemaphoreArray = std::array<os::Semaphore*, Dma::__ENUM__SIZE>;
     inline static void DMA_IRQHandlerSemaphore(const Dma& peripherie, const SemaphoreArray&);
-    using CallbackArray = std::array<std::function<void (void)>, Dma::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Dma::__ENUM__SIZE>;
     inline static void DMA_IRQHandlerCallback(const Dma& peripherie, const CallbackArray&);
 
     inline static uint32_t getFEFlagForStream(const uint32_t& DMAy_Streamx);
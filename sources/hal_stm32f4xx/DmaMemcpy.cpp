@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "DmaMemcpy.h"
+#include "Dma.h"
+#include "LockGuard.h"
+#include "os_Task.h"
+#include "trace.h"
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Dma;
+using hal::DmaMemcpy;
+using hal::Factory;
+
+DmaMemcpy::State DmaMemcpy::CopyState;
+os::Semaphore DmaMemcpy::CopyCompleteSemaphore;
+os::Mutex DmaMemcpy::WaitMutex;
+constexpr const size_t DmaMemcpy::MAX_ITEMS_PER_TRANSFER;
+
+static const Dma& memoryStream(void)
+{
+    return Factory<Dma>::get<Dma::MEMORY>();
+}
+
+void DmaMemcpy::initialize(void)
+{
+    if (!memoryStream().registerInterruptCallback([] {
+        transferCompleteInterrupt();
+    }, Dma::InterruptSource::TC))
+    {
+        Trace(ZONE_ERROR, "MEMORY stream needs DMA_IT_TC\r\n");
+    }
+}
+
+bool DmaMemcpy::copy(void* const                   dest,
+                     void const* const             src,
+                     const size_t                  length,
+                     utility::Delegate<void(void)> callback)
+{
+    uint32_t sequence;
+    return enqueue(reinterpret_cast<uint8_t*>(dest), reinterpret_cast<uint8_t const*>(src), length,
+                   std::move(callback), sequence);
+}
+
+bool DmaMemcpy::copyAndWait(void* const dest, void const* const src, const size_t length)
+{
+    os::LockGuard<os::Mutex> lock(WaitMutex);
+
+    CopyCompleteSemaphore.take(std::chrono::milliseconds(0));
+
+    uint32_t sequence;
+    if (!enqueue(reinterpret_cast<uint8_t*>(dest), reinterpret_cast<uint8_t const*>(src), length, nullptr,
+                 sequence))
+    {
+        return false;
+    }
+    return waitUntilDone(sequence, portMAX_DELAY);
+}
+
+bool DmaMemcpy::waitUntilIdle(const uint32_t ticksToWait)
+{
+    os::LockGuard<os::Mutex> lock(WaitMutex, ticksToWait);
+    if (!lock) {
+        return false;
+    }
+
+    CopyCompleteSemaphore.take(std::chrono::milliseconds(0));
+
+    os::ThisTask::enterCriticalSection();
+    const uint32_t last = CopyState.enqueued;
+    os::ThisTask::exitCriticalSection();
+
+    return waitUntilDone(last - 1, ticksToWait);
+}
+
+DmaMemcpy::Statistics DmaMemcpy::getStatistics(void)
+{
+    os::ThisTask::enterCriticalSection();
+    const Statistics statistics = CopyState.statistics;
+    os::ThisTask::exitCriticalSection();
+    return statistics;
+}
+
+DmaMemcpy::BenchmarkResult DmaMemcpy::benchmark(void* const dest, void const* const src, const size_t length)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    BenchmarkResult result {length, 0, 0};
+
+    os::ThisTask::enterCriticalSection();
+    uint32_t start = DWT->CYCCNT;
+    std::memcpy(dest, src, length);
+    result.cpuCycles = DWT->CYCCNT - start;
+    os::ThisTask::exitCriticalSection();
+
+    // The same path copy() takes, but polled to keep the scheduler out of the measurement
+    const Plan p = plan(reinterpret_cast<uintptr_t>(dest), reinterpret_cast<uintptr_t>(src), length);
+    const size_t width = static_cast<size_t>(p.width);
+    uint8_t* const d = reinterpret_cast<uint8_t*>(dest);
+    uint8_t const* const s = reinterpret_cast<uint8_t const*>(src);
+
+    waitUntilIdle();
+
+    // The interrupt of the stream finds the queue idle and ignores the transfers
+    os::ThisTask::enterCriticalSection();
+    if (CopyState.active) {
+        os::ThisTask::exitCriticalSection();
+        return result;
+    }
+
+    start = DWT->CYCCNT;
+    std::memcpy(d, s, p.head);
+    for (size_t offset = 0; offset < p.body; offset += MAX_ITEMS_PER_TRANSFER * width) {
+        const size_t items = std::min(MAX_ITEMS_PER_TRANSFER, (p.body - offset) / width);
+        memoryStream().setupMemcpy(d + p.head + offset, s + p.head + offset, items, width, p.burst);
+        memoryStream().enable();
+        while (memoryStream().getCurrentDataCounter() != 0) {}
+    }
+    std::memcpy(d + p.head + p.body, s + p.head + p.body, p.tail);
+    result.dmaCycles = DWT->CYCCNT - start;
+    os::ThisTask::exitCriticalSection();
+    return result;
+}
+
+bool DmaMemcpy::enqueue(uint8_t* const                dest,
+                        uint8_t const* const          src,
+                        const size_t                  length,
+                        utility::Delegate<void(void)> callback,
+                        uint32_t&                     sequence)
+{
+    if ((dest == nullptr) || (src == nullptr)) {
+        return false;
+    }
+
+    if (isInCcm(reinterpret_cast<uintptr_t>(dest), length) || isInCcm(reinterpret_cast<uintptr_t>(src), length)) {
+        Trace(ZONE_ERROR, "DMA can't access CCM RAM\r\n");
+        return false;
+    }
+
+    const Plan p = plan(reinterpret_cast<uintptr_t>(dest), reinterpret_cast<uintptr_t>(src), length);
+
+    os::ThisTask::enterCriticalSection();
+    if ((p.body == 0) && (CopyState.enqueued == CopyState.completed)) {
+        // Nothing to keep the order with
+        CopyState.statistics.cpuCopies++;
+        sequence = CopyState.completed - 1;
+        os::ThisTask::exitCriticalSection();
+
+        std::memcpy(dest, src, length);
+        if (callback) {
+            callback();
+        }
+        return true;
+    }
+
+    if (CopyState.enqueued - CopyState.completed >= QUEUE_SIZE) {
+        CopyState.statistics.dropped++;
+        os::ThisTask::exitCriticalSection();
+        return false;
+    }
+
+    Request& request = CopyState.queue[CopyState.enqueued % QUEUE_SIZE];
+    request.dest = dest;
+    request.src = src;
+    request.plan = p;
+    request.offset = 0;
+    request.callback = std::move(callback);
+    sequence = CopyState.enqueued++;
+
+    CopyState.statistics.depth = CopyState.enqueued - CopyState.completed;
+    CopyState.statistics.maxDepth = std::max(CopyState.statistics.maxDepth, CopyState.statistics.depth);
+
+    if (!CopyState.active) {
+        startNextRequest();
+    }
+    os::ThisTask::exitCriticalSection();
+    return true;
+}
+
+bool DmaMemcpy::waitUntilDone(const uint32_t sequence, const uint32_t ticksToWait)
+{
+    const uint32_t start = os::Task::getTickCount();
+
+    while (static_cast<int32_t>(CopyState.completed - sequence) <= 0) {
+        uint32_t remaining = ticksToWait;
+        if (ticksToWait != portMAX_DELAY) {
+            const uint32_t elapsed = os::Task::getTickCount() - start;
+            remaining = (elapsed < ticksToWait) ? (ticksToWait - elapsed) : 0;
+        }
+
+        if (!CopyCompleteSemaphore.take(std::chrono::milliseconds(remaining))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DmaMemcpy::startNextRequest(void)
+{
+    while (CopyState.started != CopyState.enqueued) {
+        Request& request = CopyState.queue[CopyState.started % QUEUE_SIZE];
+        CopyState.started++;
+
+        std::memcpy(request.dest, request.src, request.plan.head);
+        std::memcpy(request.dest + request.plan.head + request.plan.body,
+                    request.src + request.plan.head + request.plan.body,
+                    request.plan.tail);
+
+        if (request.plan.body > 0) {
+            CopyState.statistics.dmaCopies++;
+            startNextTransfer(request);
+            CopyState.active = true;
+            return;
+        }
+
+        // Short copy queued behind DMA copies
+        CopyState.statistics.cpuCopies++;
+        CopyState.completed++;
+        if (request.callback) {
+            request.callback();
+            request.callback = nullptr;
+        }
+    }
+    CopyState.active = false;
+}
+
+bool DmaMemcpy::startNextTransfer(Request& request)
+{
+    if (request.offset >= request.plan.body) {
+        return false;
+    }
+
+    const size_t width = static_cast<size_t>(request.plan.width);
+    const size_t items = std::min(MAX_ITEMS_PER_TRANSFER, (request.plan.body - request.offset) / width);
+    const size_t position = request.plan.head + request.offset;
+
+    memoryStream().setupMemcpy(request.dest + position, request.src + position, items, width, request.plan.burst);
+    memoryStream().enable();
+    request.offset += items * width;
+    CopyState.statistics.transfers++;
+    return true;
+}
+
+void DmaMemcpy::transferCompleteInterrupt(void)
+{
+    if (!CopyState.active) {
+        // A transfer of Dma::memcpy()
+        return;
+    }
+
+    Request& request = CopyState.queue[CopyState.completed % QUEUE_SIZE];
+    if (startNextTransfer(request)) {
+        return;
+    }
+
+    CopyState.completed++;
+    if (request.callback) {
+        request.callback();
+        request.callback = nullptr;
+    }
+
+    startNextRequest();
+    CopyState.statistics.depth = CopyState.enqueued - CopyState.completed;
+    CopyCompleteSemaphore.giveFromISR();
+}
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "delegate.h"
+#include "FreeRTOS.h"
+#include "Mutex.h"
+#include "Semaphore.h"
+
+namespace hal
+{
+/**
+ * Copies memory in the background with the MEMORY stream of the Dma factory.
+ * Requests are queued and completed in order, the transfer complete interrupt
+ * starts the next one. Copies longer than a stream can handle at once are
+ * chained. Bytes in front of and behind a word aligned body are copied by the
+ * CPU, so most copies run with word transfers.
+ *
+ * Copies shorter than CPU_COPY_THRESHOLD are done by the CPU, setting up the
+ * stream costs more than it saves. If the queue is empty they are done right
+ * away in the caller, otherwise they are queued to keep the order.
+ *
+ * DMA2 can't reach the CCM RAM, copies from or to it are rejected.
+ */
+class DmaMemcpy
+{
+public:
+    static constexpr size_t QUEUE_SIZE = 8;
+
+    /// Multiple of a burst of four items
+    static constexpr size_t MAX_ITEMS_PER_TRANSFER = 0xfffc;
+
+    /**
+     * Estimated crossover on the discovery board at 168 MHz with a quiet bus,
+     * not measured yet. The memcpy benchmark task of the discovery project
+     * prints the numbers of benchmark() to measure it.
+     */
+    static constexpr size_t CPU_COPY_THRESHOLD = 64;
+
+    static constexpr uintptr_t CCM_BASE = 0x10000000;
+    static constexpr uintptr_t CCM_END = 0x10010000;
+
+    enum class Width : uint8_t {
+        BYTE = 1,
+        HALFWORD = 2,
+        WORD = 4
+    };
+
+    /// Split of a copy into the parts done by the CPU and the DMA
+    struct Plan {
+        size_t head;
+        size_t body;
+        size_t tail;
+        Width width;
+        bool burst;
+    };
+
+    struct Statistics {
+        uint32_t dmaCopies;
+        uint32_t cpuCopies;
+        uint32_t transfers;
+        uint32_t dropped;
+        uint32_t depth;
+        uint32_t maxDepth;
+    };
+
+    struct BenchmarkResult {
+        size_t length;
+        uint32_t cpuCycles;
+        uint32_t dmaCycles;
+    };
+
+    DmaMemcpy() = delete;
+
+    /// Registers the transfer complete interrupt, call after the Dma factory is initialized
+    static void initialize(void);
+
+    /**
+     * Queues a copy of length bytes and returns at once. callback is called
+     * from the ISR, or from the caller if the CPU copied right away. dest and
+     * src have to stay valid until then.
+     * @return false if the queue is full or a buffer is in the CCM RAM
+     */
+    static bool copy(void* const                   dest,
+                     void const* const             src,
+                     const size_t                  length,
+                     utility::Delegate<void(void)> callback = nullptr);
+
+    /// Queues a copy and waits until it is done
+    static bool copyAndWait(void* const dest, void const* const src, const size_t length);
+
+    /**
+     * Waits until all queued copies are done. Only one task waits at a
+     * time, others block on WaitMutex for up to ticksToWait first.
+     * @return false if the mutex or the copies time out
+     */
+    static bool waitUntilIdle(const uint32_t ticksToWait = portMAX_DELAY);
+
+    static Statistics getStatistics(void);
+
+    /**
+     * Measures a blocking copy of length bytes with the DWT cycle counter,
+     * once with std::memcpy and once with the DMA including the setup.
+     * Only meaningful on the target.
+     */
+    static BenchmarkResult benchmark(void* const dest, void const* const src, const size_t length);
+
+    static constexpr bool isInCcm(const uintptr_t address, const size_t length)
+    {
+        return (address < CCM_END) && (address + length > CCM_BASE);
+    }
+
+    static constexpr Plan plan(const uintptr_t dest, const uintptr_t src, const size_t length)
+    {
+        if (length < CPU_COPY_THRESHOLD) {
+            return Plan {length, 0, 0, Width::BYTE, false};
+        }
+
+        if (((dest ^ src) & 0x3) == 0) {
+            const size_t head = (4 - (src & 0x3)) & 0x3;
+            const size_t body = (length - head) & ~static_cast<size_t>(0x3);
+            // A burst of four words must not cross a 1 KiB boundary
+            const bool burst = (((src + head) & 0xf) == 0) && (((dest + head) & 0xf) == 0) && ((body & 0xf) == 0);
+            return Plan {head, body, length - head - body, Width::WORD, burst};
+        }
+
+        if (((dest ^ src) & 0x1) == 0) {
+            const size_t head = src & 0x1;
+            const size_t body = (length - head) & ~static_cast<size_t>(0x1);
+            return Plan {head, body, length - head - body, Width::HALFWORD, false};
+        }
+
+        return Plan {0, length, 0, Width::BYTE, false};
+    }
+
+private:
+    struct Request {
+        uint8_t* dest;
+        uint8_t const* src;
+        Plan plan;
+        size_t offset;
+        utility::Delegate<void(void)> callback;
+    };
+
+    /**
+     * Requests are identified by sequence numbers: all below completed are
+     * done, started - 1 is running if active is set.
+     */
+    struct State {
+        std::array<Request, QUEUE_SIZE> queue;
+        uint32_t enqueued;
+        uint32_t started;
+        uint32_t completed;
+        bool active;
+        Statistics statistics;
+    };
+
+    static State CopyState;
+    static os::Semaphore CopyCompleteSemaphore;
+
+    /// Only one task at a time waits on CopyCompleteSemaphore
+    static os::Mutex WaitMutex;
+
+    static bool enqueue(uint8_t* const                dest,
+                        uint8_t const* const          src,
+                        const size_t                  length,
+                        utility::Delegate<void(void)> callback,
+                        uint32_t&                     sequence);
+    static bool waitUntilDone(const uint32_t sequence, const uint32_t ticksToWait);
+    static void startNextRequest(void);
+    static bool startNextTransfer(Request& request);
+    static void transferCompleteInterrupt(void);
+};
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::DmaMemcpy. Copies
+ * are done right away with the CPU, callbacks are called from the caller.
+ */
+
+#include <cstring>
+#include "DmaMemcpy.h"
+
+namespace hal
+{
+static DmaMemcpy::Statistics g_MockupStatistics;
+
+void DmaMemcpy::initialize(void)
+{
+    g_MockupStatistics = DmaMemcpy::Statistics {};
+}
+
+bool DmaMemcpy::copy(void* const                   dest,
+                     void const* const             src,
+                     const size_t                  length,
+                     utility::Delegate<void(void)> callback)
+{
+    if ((dest == nullptr) || (src == nullptr)) {
+        return false;
+    }
+
+    const Plan p = plan(reinterpret_cast<uintptr_t>(dest), reinterpret_cast<uintptr_t>(src), length);
+    if (p.body > 0) {
+        g_MockupStatistics.dmaCopies++;
+        g_MockupStatistics.transfers += (p.body / static_cast<size_t>(p.width) + MAX_ITEMS_PER_TRANSFER - 1) /
+                                        MAX_ITEMS_PER_TRANSFER;
+    } else {
+        g_MockupStatistics.cpuCopies++;
+    }
+
+    std::memmove(dest, src, length);
+    if (callback) {
+        callback();
+    }
+    return true;
+}
+
+bool DmaMemcpy::copyAndWait(void* const dest, void const* const src, const size_t length)
+{
+    return copy(dest, src, length);
+}
+
+bool DmaMemcpy::waitUntilIdle(const uint32_t)
+{
+    return true;
+}
+
+DmaMemcpy::Statistics DmaMemcpy::getStatistics(void)
+{
+    return g_MockupStatistics;
+}
+
+DmaMemcpy::BenchmarkResult DmaMemcpy::benchmark(void* const dest, void const* const src, const size_t length)
+{
+    copy(dest, src, length);
+    return BenchmarkResult {length, 0, 0};
+}
+}
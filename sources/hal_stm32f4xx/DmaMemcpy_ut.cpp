@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <array>
+#include <cstring>
+
+#include "DmaMemcpy.h"
+#include "unittest.h"
+
+using hal::DmaMemcpy;
+
+//--------------------------BUFFERS--------------------------
+static constexpr size_t BUFFERSIZE = 300000;
+std::array<uint8_t, BUFFERSIZE> g_src;
+std::array<uint8_t, BUFFERSIZE> g_dest;
+
+//--------------------------MOCKING--------------------------
+
+//-------------------------TESTCASES-------------------------
+
+int ut_plan(void)
+{
+    TestCaseBegin();
+
+    for (uintptr_t dest = 0x20000000; dest < 0x20000010; dest++) {
+        for (uintptr_t src = 0x20010000; src < 0x20010010; src++) {
+            for (size_t length = 0; length < 200; length++) {
+                const DmaMemcpy::Plan p = DmaMemcpy::plan(dest, src, length);
+                const size_t widthMask = static_cast<size_t>(p.width) - 1;
+
+                CHECK(p.head + p.body + p.tail == length);
+                CHECK((p.body & widthMask) == 0);
+                CHECK(((src + p.head) & widthMask) == 0);
+                CHECK(((dest + p.head) & widthMask) == 0);
+                CHECK(p.head < 4 || p.body == 0);
+                CHECK(p.tail < 4);
+                CHECK((length < DmaMemcpy::CPU_COPY_THRESHOLD) == (p.body == 0));
+
+                if (p.burst) {
+                    CHECK(p.width == DmaMemcpy::Width::WORD);
+                    CHECK(((src + p.head) & 0xf) == 0);
+                    CHECK(((dest + p.head) & 0xf) == 0);
+                    CHECK((p.body & 0xf) == 0);
+                }
+            }
+        }
+    }
+
+    const DmaMemcpy::Plan aligned = DmaMemcpy::plan(0x20000000, 0x20010000, 4096);
+    CHECK(aligned.width == DmaMemcpy::Width::WORD);
+    CHECK(aligned.burst);
+    CHECK(aligned.body == 4096);
+
+    const DmaMemcpy::Plan halfword = DmaMemcpy::plan(0x20000002, 0x20010001, 1000);
+    CHECK(halfword.width == DmaMemcpy::Width::BYTE);
+    CHECK(halfword.body == 1000);
+
+    const DmaMemcpy::Plan shifted = DmaMemcpy::plan(0x20000003, 0x20010001, 1000);
+    CHECK(shifted.width == DmaMemcpy::Width::HALFWORD);
+    CHECK(shifted.head == 1);
+    CHECK(shifted.tail == 1);
+
+    CHECK(DmaMemcpy::isInCcm(0x1000fff0, 16));
+    CHECK(DmaMemcpy::isInCcm(0x0ffffff0, 17));
+    CHECK(!DmaMemcpy::isInCcm(0x0ffffff0, 16));
+    CHECK(!DmaMemcpy::isInCcm(0x10010000, 16));
+    CHECK((DmaMemcpy::MAX_ITEMS_PER_TRANSFER & 0x3) == 0);
+    CHECK(DmaMemcpy::MAX_ITEMS_PER_TRANSFER <= 0xffff);
+
+    TestCaseEnd();
+}
+
+int ut_copy(void)
+{
+    TestCaseBegin();
+
+    DmaMemcpy::initialize();
+
+    for (size_t i = 0; i < BUFFERSIZE; i++) {
+        g_src[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+
+    size_t callbacks = 0;
+    const auto callback = [&callbacks] {
+        callbacks++;
+    };
+
+    g_dest.fill(0);
+    CHECK(DmaMemcpy::copy(g_dest.data() + 3, g_src.data() + 1, 17, callback));
+    CHECK(std::memcmp(g_dest.data() + 3, g_src.data() + 1, 17) == 0);
+    CHECK(g_dest[2] == 0);
+    CHECK(g_dest[20] == 0);
+
+    CHECK(DmaMemcpy::copy(g_dest.data(), g_src.data(), BUFFERSIZE, callback));
+    CHECK(std::memcmp(g_dest.data(), g_src.data(), BUFFERSIZE) == 0);
+    CHECK(callbacks == 2);
+
+    CHECK(DmaMemcpy::copyAndWait(g_dest.data() + 1, g_src.data() + 2, 1000));
+    CHECK(std::memcmp(g_dest.data() + 1, g_src.data() + 2, 1000) == 0);
+    CHECK(DmaMemcpy::waitUntilIdle(0));
+
+    CHECK(!DmaMemcpy::copy(nullptr, g_src.data(), 10));
+
+    const DmaMemcpy::Statistics statistics = DmaMemcpy::getStatistics();
+    CHECK(statistics.cpuCopies == 1);
+    CHECK(statistics.dmaCopies == 2);
+    // 300000 bytes in words need two transfers
+    CHECK(statistics.transfers == 3);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_plan);
+    RunTest(true, ut_copy);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::Dma. A stream
+ * only keeps its data counter, nothing is transferred. The test finishes a
+ * transfer by calling the IRQ handler of the stream, which disables it like
+ * the hardware does at transfer complete. A disabled stream counts 0.
+ */
+
+#include <utility>
+#include "Dma.h"
+
+using hal::Dma;
+using hal::Factory;
+
+static std::array<uint16_t, Dma::__ENUM__SIZE> g_DataCounters;
+static std::array<bool, Dma::__ENUM__SIZE> g_Enabled;
+
+/// Streams with an interrupt callback or semaphore, by peripheral base
+static std::array<std::pair<uint32_t, const Dma*>, Dma::__ENUM__SIZE> g_Streams;
+
+static void raiseTransferComplete(const uint32_t peripherie)
+{
+    for (const auto& stream : g_Streams) {
+        if ((stream.second != nullptr) && (stream.first == peripherie)) {
+            Dma::DMA_TCIRQHandler(*stream.second);
+        }
+    }
+}
+
+void Dma::DMA_TCIRQHandler(const Dma& dma)
+{
+    g_Enabled[dma.mDescription] = false;
+    if (TCInterruptSemaphores[dma.mDescription] != nullptr) {
+        TCInterruptSemaphores[dma.mDescription]->give();
+    }
+    if (TCInterruptCallbacks[dma.mDescription] != nullptr) {
+        TCInterruptCallbacks[dma.mDescription]();
+    }
+}
+
+extern "C" {
+#if DMA2_Stream2_IRQn_ENABLE
+void DMA2_Stream2_IRQHandler(void)
+{
+    raiseTransferComplete(DMA2_Stream2_BASE);
+}
+#endif
+}
+
+void Dma::initialize(void) const
+{}
+
+void Dma::setupTransfer(uint8_t const* const data, const size_t length, const bool repeat) const
+{
+    disable();
+    g_DataCounters[mDescription] = static_cast<uint16_t>(length);
+}
+
+void Dma::setupTransfer(uint16_t const* const data, const size_t length, const bool repeat) const
+{
+    disable();
+    g_DataCounters[mDescription] = static_cast<uint16_t>(length);
+}
+
+void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const
+{
+    setupTransfer(data, length);
+}
+
+void Dma::setupReceiveSingleCharMultipleTimes(uint8_t* const data, const size_t length) const
+{
+    setupTransfer(data, length);
+}
+
+void Dma::memcpy(void const* const dest, void const* const src, const size_t length) const
+{}
+
+void Dma::enable(void) const
+{
+    g_Enabled[mDescription] = true;
+}
+
+void Dma::disable(void) const
+{
+    g_Enabled[mDescription] = false;
+}
+
+bool Dma::registerInterruptSemaphore(os::Semaphore* const semaphore, const Dma::InterruptSource source) const
+{
+    if ((source == Dma::TC) && (mDmaInterrupt & DMA_IT_TC)) {
+        Dma::TCInterruptSemaphores[mDescription] = semaphore;
+        g_Streams[mDescription] = std::make_pair(mPeripherie, this);
+        return true;
+    }
+    return false;
+}
+
+void Dma::unregisterInterruptSemaphore(const InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptSemaphores[mDescription] = nullptr;
+    }
+}
+
+bool Dma::registerInterruptCallback(utility::Delegate<void(void)> function, const Dma::InterruptSource source) const
+{
+    if ((source == Dma::TC) && (mDmaInterrupt & DMA_IT_TC)) {
+        Dma::TCInterruptCallbacks[mDescription] = function;
+        g_Streams[mDescription] = std::make_pair(mPeripherie, this);
+        return true;
+    }
+    return false;
+}
+
+void Dma::unregisterInterruptCallback(const InterruptSource source) const
+{
+    if (source == Dma::TC) {
+        Dma::TCInterruptCallbacks[mDescription] = nullptr;
+    }
+}
+
+uint16_t Dma::getCurrentDataCounter(void) const
+{
+    return g_Enabled[mDescription] ? g_DataCounters[mDescription] : 0;
+}
+
+void Dma::setCurrentDataCounter(uint16_t value) const
+{
+    g_DataCounters[mDescription] = value;
+}
+
+Dma::SemaphoreArray Dma::TCInterruptSemaphores;
+Dma::SemaphoreArray Dma::HTInterruptSemaphores;
+Dma::SemaphoreArray Dma::TEInterruptSemaphores;
+Dma::CallbackArray Dma::TCInterruptCallbacks;
+Dma::CallbackArray Dma::HTInterruptCallbacks;
+Dma::CallbackArray Dma::TEInterruptCallbacks;
+
+constexpr const std::array<const Dma, Dma::Description::__ENUM__SIZE + 1> Factory<Dma>::Container;
+
+// The configuration of the streams refers to their Nvics
+constexpr const std::array<const hal::Nvic, hal::Nvic::Description::__ENUM__SIZE + 1> Factory<hal::Nvic>::Container;
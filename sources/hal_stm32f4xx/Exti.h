@@ -19,7 +19,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f4xx_exti.h"
 #include "stm32f4xx_syscfg.h"
 #include "stm32f4xx_rcc.h"
@@ -52,7 +52,7 @@ struct Exti {
 
     void enable(void) const;
     void disable(void) const;
-    void registerInterruptCallback(std::function<void(void)> ) const;
+    void registerInterruptCallback(utility::Delegate<void(void)> ) const;
     void unregisterInterruptCallback(void) const;
     void handleInterrupt(void) const;
 
@@ -85,7 +85,7 @@ private:
     void initialize(void) const;
     bool getStatus(void) const;
 
-    using CallbackArray = std::array<std::function<void (void)>, Exti::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Exti::__ENUM__SIZE>;
     static CallbackArray ExtiCallbacks;
 
     friend class Factory<Exti>;
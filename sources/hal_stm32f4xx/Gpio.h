@@ -123,6 +123,7 @@ private:
     template<typename>
     friend class Factory;
     friend struct Exti;
+    friend class SoftwareSpi;
 };
 
 template<>
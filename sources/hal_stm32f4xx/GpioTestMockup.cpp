@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::Gpio. A pin only
+ * keeps the level last assigned to it, all pins start low.
+ */
+
+#include "Gpio.h"
+
+using hal::Factory;
+using hal::Gpio;
+
+static std::array<bool, Gpio::__ENUM__SIZE> g_Levels;
+
+Gpio::operator bool() const
+{
+    return g_Levels[mDescription];
+}
+
+void Gpio::operator=(const bool& state) const
+{
+    g_Levels[mDescription] = state;
+}
+
+constexpr const std::array<const Gpio, Gpio::Description::__ENUM__SIZE + 1> Factory<Gpio>::Container;
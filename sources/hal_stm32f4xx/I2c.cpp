@@ -13,9 +13,11 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <algorithm>
 #include "I2c.h"
 #include "trace.h"
 #include "LockGuard.h"
+#include "os_Task.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
@@ -33,6 +35,51 @@ void I2c::initialize() const
     I2C_InitTypeDef tmpConfiguration = mConfiguration;
     I2C_Init(pPeripherie, &tmpConfiguration);
     I2C_Cmd(pPeripherie, ENABLE);
+
+    if (interruptSupport()) {
+        registerInterruptCallbacks();
+    }
+}
+
+void I2c::registerInterruptCallbacks(void) const
+{
+    // The interrupt routines check and clear the flags themselves
+    mEventNvic->registerGetInterruptStatusProcedure([](void) -> bool {
+        return true;
+    });
+    mEventNvic->registerClearInterruptProcedure([](void) {});
+    mEventNvic->registerInterruptCallback([this](void) {
+        eventInterrupt();
+    });
+    mEventNvic->enable();
+
+    mErrorNvic->registerGetInterruptStatusProcedure([](void) -> bool {
+        return true;
+    });
+    mErrorNvic->registerClearInterruptProcedure([](void) {});
+    mErrorNvic->registerInterruptCallback([this](void) {
+        errorInterrupt();
+    });
+    mErrorNvic->enable();
+
+    if (mTxDma && !mTxDma->registerInterruptCallback([this] {
+        txDmaCompleteInterrupt();
+    }, Dma::InterruptSource::TC))
+    {
+        Trace(ZONE_ERROR, "I2c tx stream needs DMA_IT_TC\r\n");
+    }
+
+    if (mRxDma && !mRxDma->registerInterruptCallback([this] {
+        rxDmaCompleteInterrupt();
+    }, Dma::InterruptSource::TC))
+    {
+        Trace(ZONE_ERROR, "I2c rx stream needs DMA_IT_TC\r\n");
+    }
+}
+
+bool I2c::interruptSupport(void) const
+{
+    return mEventNvic && mErrorNvic;
 }
 
 bool I2c::timeoutDuringWaitUntilFlagIsEqualState(const uint32_t flag, const FlagStatus state) const
@@ -64,6 +111,11 @@ bool I2c::timeoutDuringWaitEvent(const uint32_t event) const
 size_t I2c::write(const uint16_t deviceAddr, const uint8_t regAddr, uint8_t const* const data,
                   const size_t length) const
 {
+    if (interruptSupport()) {
+        return transfer(Transaction {static_cast<uint8_t>(deviceAddr), true, regAddr, data, length, nullptr, 0,
+                                     nullptr}) ? length : 0;
+    }
+
     // prepare communication
     os::LockGuard<os::Mutex> lock(MutexArray[static_cast<size_t>(mDescription)]);
 
@@ -89,6 +141,11 @@ size_t I2c::write(const uint16_t deviceAddr, const uint8_t regAddr, uint8_t cons
 
 size_t I2c::write(const uint16_t deviceAddr, uint8_t const* const data, const size_t length) const
 {
+    if (interruptSupport()) {
+        return transfer(Transaction {static_cast<uint8_t>(deviceAddr), false, 0, data, length, nullptr, 0,
+                                     nullptr}) ? length : 0;
+    }
+
     // prepare communication
     os::LockGuard<os::Mutex> lock(MutexArray[static_cast<size_t>(mDescription)]);
     if (!initMasterCommunication(deviceAddr, length)) {
@@ -120,6 +177,11 @@ size_t I2c::write(const uint16_t deviceAddr, uint8_t const* const data, const si
 
 size_t I2c::read(const uint16_t deviceAddr, const uint8_t regAddr, uint8_t* const data, const size_t length) const
 {
+    if (interruptSupport()) {
+        return transfer(Transaction {static_cast<uint8_t>(deviceAddr), true, regAddr, nullptr, 0, data, length,
+                                     nullptr}) ? length : 0;
+    }
+
     // prepare communication
     os::LockGuard<os::Mutex> lock(MutexArray[static_cast<size_t>(mDescription)]);
 
@@ -160,6 +222,487 @@ size_t I2c::read(const uint16_t deviceAddr, const uint8_t regAddr, uint8_t* cons
     return bytesReceived;
 }
 
+bool I2c::enqueue(const Transaction& transaction) const
+{
+    uint32_t sequence;
+    if (enqueue(transaction, sequence)) {
+        return true;
+    }
+
+    os::ThisTask::enterCriticalSection();
+    transactionState().statistics.dropped++;
+    os::ThisTask::exitCriticalSection();
+    return false;
+}
+
+bool I2c::transfer(const Transaction& transaction, const uint32_t ticksToWait) const
+{
+    os::Semaphore& semaphore = TransactionCompleteSemaphores[static_cast<size_t>(mDescription)];
+    os::LockGuard<os::Mutex> lock(MutexArray[static_cast<size_t>(mDescription)]);
+
+    semaphore.take(std::chrono::milliseconds(0));
+
+    bool success = false;
+    Transaction blocking = transaction;
+    blocking.callback = [&success](bool result) {
+        success = result;
+    };
+
+    TransactionState& state = transactionState();
+    uint32_t sequence;
+    while (!enqueue(blocking, sequence)) {
+        if (!interruptSupport() || (state.enqueued == state.completed)) {
+            return false;
+        }
+        if (state.recoveryPending) {
+            recoverPendingBus();
+            continue;
+        }
+        // The queue is full, every completed transaction frees a slot
+        if (!semaphore.take(std::chrono::milliseconds(ticksToWait * portTICK_RATE_MS))) {
+            abortActive();
+        }
+    }
+
+    while (static_cast<int32_t>(state.completed - sequence) <= 0) {
+        if (state.recoveryPending) {
+            recoverPendingBus();
+            continue;
+        }
+        if (!semaphore.take(std::chrono::milliseconds(ticksToWait * portTICK_RATE_MS))) {
+            // Each abort completes one transaction, ours is done after a few
+            abortActive();
+        }
+    }
+
+    // Don't leave a bus that failed our transaction to the next caller
+    if (state.recoveryPending) {
+        recoverPendingBus();
+    }
+    return success;
+}
+
+I2c::Statistics I2c::getStatistics(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    const Statistics statistics = transactionState().statistics;
+    os::ThisTask::exitCriticalSection();
+    return statistics;
+}
+
+bool I2c::enqueue(const Transaction& transaction, uint32_t& sequence) const
+{
+    if (!interruptSupport() || ((transaction.address & 0x80) != 0)) {
+        return false;
+    }
+
+    if (((transaction.tx == nullptr) && (transaction.txLength > 0)) ||
+        ((transaction.rx == nullptr) && (transaction.rxLength > 0)) ||
+        (transaction.txLength > MAX_DMA_LENGTH) || (transaction.rxLength > MAX_DMA_LENGTH))
+    {
+        return false;
+    }
+
+    TransactionState& state = transactionState();
+
+    os::ThisTask::enterCriticalSection();
+    if (state.enqueued - state.completed >= TRANSACTION_QUEUE_SIZE) {
+        os::ThisTask::exitCriticalSection();
+        return false;
+    }
+
+    state.queue[state.enqueued % TRANSACTION_QUEUE_SIZE] = transaction;
+    sequence = state.enqueued++;
+    state.statistics.maxDepth = std::max(state.statistics.maxDepth, state.enqueued - state.completed);
+
+    if (!state.active) {
+        startNextTransaction();
+    }
+    os::ThisTask::exitCriticalSection();
+    return true;
+}
+
+void I2c::startNextTransaction(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+
+    if ((state.completed == state.enqueued) || state.recoveryPending) {
+        state.active = false;
+        i2c->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    // The stop of the previous transaction is generated after its last byte
+    uint32_t timeoutCounter = TIMEOUT;
+    while ((i2c->CR1 & I2C_CR1_STOP) && (--timeoutCounter > 0)) {}
+
+    if (i2c->SR2 & I2C_SR2_BUSY) {
+        // Nobody else drives this bus, a slave holds SDA low. The queue holds
+        // until a task recovered it, see recoverBus().
+        state.recoveryPending = true;
+        state.active = false;
+        i2c->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    state.active = true;
+    state.phase = Phase::START_WRITE;
+    state.offset = 0;
+
+    const Transaction& transaction = state.queue[state.completed % TRANSACTION_QUEUE_SIZE];
+    if (!transaction.hasRegister && (transaction.txLength == 0) && (transaction.rxLength > 0)) {
+        state.phase = Phase::START_READ;
+    }
+
+    i2c->CR1 |= I2C_CR1_ACK;
+    i2c->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+    i2c->CR1 |= I2C_CR1_START;
+}
+
+void I2c::addressedForWrite(const Transaction& transaction) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+    const size_t writeLength = (transaction.hasRegister ? 1 : 0) + transaction.txLength;
+
+    // Reading SR2 after SR1 clears ADDR
+    (void)i2c->SR2;
+    state.phase = Phase::WRITE;
+
+    if (writeLength == 0) {
+        endOfWrite(transaction);
+    } else if (mTxDma && (transaction.txLength >= MIN_LENGTH_FOR_DMA_TRANSFER)) {
+        if (transaction.hasRegister) {
+            i2c->DR = transaction.regAddr;
+        }
+        state.offset = writeLength;
+
+        // BTF would fire during the transfer, txDmaCompleteInterrupt() enables the events again
+        i2c->CR2 &= ~I2C_CR2_ITEVTEN;
+        mTxDma->setupTransfer(transaction.tx, transaction.txLength);
+        i2c->CR2 |= I2C_CR2_DMAEN;
+        mTxDma->enable();
+    } else {
+        i2c->CR2 |= I2C_CR2_ITBUFEN;
+    }
+}
+
+void I2c::addressedForRead(const Transaction& transaction) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+    state.phase = Phase::READ;
+    state.offset = 0;
+
+    if (transaction.rxLength == 1) {
+        // The single byte is not acknowledged, the stop follows it
+        i2c->CR1 &= ~I2C_CR1_ACK;
+        (void)i2c->SR2;
+        i2c->CR1 |= I2C_CR1_STOP;
+        i2c->CR2 |= I2C_CR2_ITBUFEN;
+    } else if (mRxDma && (transaction.rxLength >= MIN_LENGTH_FOR_DMA_TRANSFER)) {
+        // LAST makes the peripheral not acknowledge the last byte of the stream
+        i2c->CR2 &= ~I2C_CR2_ITEVTEN;
+        mRxDma->setupTransfer(transaction.rx, transaction.rxLength);
+        mRxDma->enable();
+        i2c->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST;
+        (void)i2c->SR2;
+    } else {
+        (void)i2c->SR2;
+        i2c->CR2 |= I2C_CR2_ITBUFEN;
+    }
+}
+
+void I2c::endOfWrite(const Transaction& transaction) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+
+    if (transaction.rxLength > 0) {
+        transactionState().phase = Phase::START_READ;
+        i2c->CR1 |= I2C_CR1_START;
+    } else {
+        i2c->CR1 |= I2C_CR1_STOP;
+        complete(true);
+    }
+}
+
+void I2c::complete(const bool success) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+
+    i2c->CR2 &= ~(I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+
+    // The slot is free after completed++
+    const utility::Delegate<void(bool)> callback = state.queue[state.completed % TRANSACTION_QUEUE_SIZE].callback;
+    state.completed++;
+    state.statistics.transactions++;
+    if (!success) {
+        state.statistics.failed++;
+    }
+    if (callback) {
+        callback(success);
+    }
+
+    startNextTransaction();
+    TransactionCompleteSemaphores[static_cast<size_t>(mDescription)].giveFromISR();
+}
+
+void I2c::abortActive(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+
+    os::ThisTask::enterCriticalSection();
+    if (!state.active || state.recoveryPending) {
+        os::ThisTask::exitCriticalSection();
+        return;
+    }
+    state.statistics.timeouts++;
+    // Keeps the interrupts and enqueue() away from the bus while it is recovered
+    state.recoveryPending = true;
+    i2c->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+    if (mTxDma) {
+        mTxDma->disable();
+    }
+    if (mRxDma) {
+        mRxDma->disable();
+    }
+    os::ThisTask::exitCriticalSection();
+
+    clockBusFree();
+
+    os::ThisTask::enterCriticalSection();
+    state.recoveryPending = false;
+    const utility::Delegate<void(bool)> callback = state.queue[state.completed % TRANSACTION_QUEUE_SIZE].callback;
+    state.completed++;
+    state.statistics.transactions++;
+    state.statistics.failed++;
+    if (callback) {
+        callback(false);
+    }
+    startNextTransaction();
+    os::ThisTask::exitCriticalSection();
+}
+
+void I2c::recoverBus(void) const
+{
+    os::LockGuard<os::Mutex> lock(MutexArray[static_cast<size_t>(mDescription)]);
+    TransactionState& state = transactionState();
+
+    os::ThisTask::enterCriticalSection();
+    const bool running = state.active && !state.recoveryPending;
+    os::ThisTask::exitCriticalSection();
+
+    if (running) {
+        abortActive();
+    } else {
+        recoverPendingBus();
+    }
+}
+
+bool I2c::isRecoveryPending(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    const bool pending = transactionState().recoveryPending;
+    os::ThisTask::exitCriticalSection();
+    return pending;
+}
+
+void I2c::recoverPendingBus(void) const
+{
+    TransactionState& state = transactionState();
+
+    clockBusFree();
+
+    os::ThisTask::enterCriticalSection();
+    state.recoveryPending = false;
+    if (!state.active) {
+        startNextTransaction();
+    }
+    os::ThisTask::exitCriticalSection();
+}
+
+void I2c::clockBusFree(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    // About a quarter period of 100 kHz, the loop takes more than one cycle
+    const uint32_t delayCycles = SystemCoreClock / 400000;
+    const auto delay = [delayCycles] {
+        for (volatile uint32_t i = 0; i < delayCycles; i++) {}
+    };
+
+    i2c->CR1 &= ~I2C_CR1_PE;
+
+    if (mScl && mSda && mScl->isReconfigurable() && mSda->isReconfigurable()) {
+        // Open drain by hand: input releases a line, output low pulls it down
+        mSda->changeGpioMode(GPIO_Mode_IN);
+        for (size_t i = 0; (i < 9) && !static_cast<bool>(*mSda); i++) {
+            mScl->changeGpioMode(GPIO_Mode_OUT);
+            *mScl = false;
+            delay();
+            mScl->changeGpioMode(GPIO_Mode_IN);
+            delay();
+        }
+
+        // Stop condition: SDA rises while SCL is high
+        mScl->changeGpioMode(GPIO_Mode_OUT);
+        *mScl = false;
+        mSda->changeGpioMode(GPIO_Mode_OUT);
+        *mSda = false;
+        delay();
+        mScl->changeGpioMode(GPIO_Mode_IN);
+        delay();
+        mSda->changeGpioMode(GPIO_Mode_IN);
+        delay();
+
+        mScl->changeGpioMode(GPIO_Mode_AF);
+        mSda->changeGpioMode(GPIO_Mode_AF);
+    }
+
+    i2c->CR1 |= I2C_CR1_SWRST;
+    i2c->CR1 &= ~I2C_CR1_SWRST;
+
+    I2C_InitTypeDef tmpConfiguration = mConfiguration;
+    I2C_Init(i2c, &tmpConfiguration);
+    I2C_Cmd(i2c, ENABLE);
+
+    os::ThisTask::enterCriticalSection();
+    transactionState().statistics.recoveries++;
+    os::ThisTask::exitCriticalSection();
+}
+
+void I2c::eventInterrupt(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+    const uint16_t sr1 = i2c->SR1;
+
+    if (!state.active || state.recoveryPending) {
+        i2c->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    const Transaction& transaction = state.queue[state.completed % TRANSACTION_QUEUE_SIZE];
+
+    if (sr1 & I2C_SR1_SB) {
+        const uint8_t direction = (state.phase == Phase::START_READ) ? 1 : 0;
+        i2c->DR = static_cast<uint8_t>(transaction.address << 1) | direction;
+        return;
+    }
+
+    if (sr1 & I2C_SR1_ADDR) {
+        if (state.phase == Phase::START_WRITE) {
+            addressedForWrite(transaction);
+        } else {
+            addressedForRead(transaction);
+        }
+        return;
+    }
+
+    if (state.phase == Phase::WRITE) {
+        const size_t writeLength = (transaction.hasRegister ? 1 : 0) + transaction.txLength;
+        if ((sr1 & I2C_SR1_TXE) && (state.offset < writeLength)) {
+            if (transaction.hasRegister) {
+                i2c->DR = (state.offset == 0) ? transaction.regAddr : transaction.tx[state.offset - 1];
+            } else {
+                i2c->DR = transaction.tx[state.offset];
+            }
+            state.offset++;
+            if (state.offset == writeLength) {
+                // Wait for BTF, the last byte is still being sent
+                i2c->CR2 &= ~I2C_CR2_ITBUFEN;
+            }
+        } else if (sr1 & I2C_SR1_BTF) {
+            endOfWrite(transaction);
+        }
+        return;
+    }
+
+    if ((state.phase == Phase::READ) && (sr1 & I2C_SR1_RXNE)) {
+        transaction.rx[state.offset] = static_cast<uint8_t>(i2c->DR);
+        state.offset++;
+        const size_t remaining = transaction.rxLength - state.offset;
+        if (remaining == 1) {
+            // The last byte is on the wire, don't acknowledge it and stop after it
+            i2c->CR1 &= ~I2C_CR1_ACK;
+            i2c->CR1 |= I2C_CR1_STOP;
+        } else if (remaining == 0) {
+            complete(true);
+        }
+    }
+}
+
+void I2c::errorInterrupt(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    TransactionState& state = transactionState();
+    const uint16_t errors = i2c->SR1 & (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT);
+
+    // The error flags are cleared by writing zero
+    i2c->SR1 = static_cast<uint16_t>(~errors);
+
+    if (!state.active || state.recoveryPending || (errors == 0)) {
+        return;
+    }
+
+    if (mTxDma) {
+        mTxDma->disable();
+    }
+    if (mRxDma) {
+        mRxDma->disable();
+    }
+
+    if (errors & I2C_SR1_AF) {
+        state.statistics.nacks++;
+    }
+    if (errors & I2C_SR1_BERR) {
+        state.statistics.busErrors++;
+    }
+    if (errors & I2C_SR1_ARLO) {
+        state.statistics.arbitrationLost++;
+    }
+
+    if (errors & (I2C_SR1_BERR | I2C_SR1_ARLO)) {
+        // The peripheral may have lost track of the bus, clocking it free takes
+        // too long for the interrupt. A task does it in recoverBus() or transfer().
+        i2c->CR1 &= ~I2C_CR1_PE;
+        state.recoveryPending = true;
+    } else {
+        i2c->CR1 |= I2C_CR1_STOP;
+    }
+    complete(false);
+}
+
+void I2c::txDmaCompleteInterrupt(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    if (!transactionState().active || transactionState().recoveryPending) {
+        return;
+    }
+
+    // BTF follows when the last byte left the shift register
+    i2c->CR2 &= ~I2C_CR2_DMAEN;
+    i2c->CR2 |= I2C_CR2_ITEVTEN;
+}
+
+void I2c::rxDmaCompleteInterrupt(void) const
+{
+    I2C_TypeDef* const i2c = reinterpret_cast<I2C_TypeDef*>(mPeripherie);
+    if (!transactionState().active || transactionState().recoveryPending) {
+        return;
+    }
+
+    i2c->CR1 |= I2C_CR1_STOP;
+    complete(true);
+}
+
+I2c::TransactionState& I2c::transactionState(void) const
+{
+    return TransactionStates[static_cast<size_t>(mDescription)];
+}
+
 bool I2c::initMasterCommunication(const uint16_t deviceAddr, const size_t length) const
 {
     if (length > 255) {
@@ -211,3 +754,5 @@ bool I2c::sendRegisterAddress(const uint16_t deviceAddr, const uint8_t regAddr,
 constexpr const std::array<const I2c, I2c::__ENUM__SIZE> hal::Factory<I2c>::Container;
 constexpr const std::array<const uint32_t, I2c::__ENUM__SIZE> hal::Factory<I2c>::Clocks;
 std::array<os::Mutex, I2c::Description::__ENUM__SIZE> I2c::MutexArray;
+std::array<os::Semaphore, I2c::Description::__ENUM__SIZE> I2c::TransactionCompleteSemaphores;
+std::array<I2c::TransactionState, I2c::Description::__ENUM__SIZE> I2c::TransactionStates;
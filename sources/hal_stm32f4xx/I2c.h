@@ -21,10 +21,15 @@
 #include "stm32f4xx.h"
 #include <cstdint>
 #include <array>
+#include "delegate.h"
 #include "hal_Factory.h"
+#include "Dma.h"
+#include "Gpio.h"
+#include "Nvic.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "Mutex.h"
+#include "Semaphore.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 #define IS_I2C_ALL_PERIPH_BASE(PERIPH) (((PERIPH) == I2C1_BASE) || \
@@ -39,10 +44,49 @@ namespace hal
  *  - 10 bit addressing
  *  - Slave mode
  *  - Multimaster
+ *
+ * With an event and an error Nvic the interface runs a queue of transactions
+ * driven by interrupts, the calling task sleeps until its transaction is done.
+ * Payloads of two bytes and more use the tx and rx streams, if configured. A
+ * bus that stays busy or a hung transaction is recovered by clocking SCL until
+ * the slave releases SDA, this needs reconfigurable scl and sda Gpios. The
+ * recovery busy waits, so it runs in a task and the queue holds until then:
+ * transfer() recovers the bus itself, users of enqueue() call recoverBus()
+ * once isRecoveryPending(). Without Nvics the interface polls as before.
  */
 struct I2c {
 #include "I2c_config.h"
 
+    static constexpr size_t TRANSACTION_QUEUE_SIZE = 4;
+
+    /**
+     * Writes the register (if hasRegister) and tx, then reads rx after a
+     * repeated start. callback is called with the result from the ISR, or
+     * from the task that aborts a hung transaction.
+     */
+    struct Transaction {
+        uint8_t address;
+        bool hasRegister;
+        uint8_t regAddr;
+        uint8_t const* tx;
+        size_t txLength;
+        uint8_t* rx;
+        size_t rxLength;
+        utility::Delegate<void(bool)> callback;
+    };
+
+    struct Statistics {
+        uint32_t transactions;
+        uint32_t failed;
+        uint32_t nacks;
+        uint32_t busErrors;
+        uint32_t arbitrationLost;
+        uint32_t timeouts;
+        uint32_t recoveries;
+        uint32_t dropped;
+        uint32_t maxDepth;
+    };
+
     I2c() = delete;
     I2c(const I2c&) = delete;
     I2c(I2c&&) = default;
@@ -54,25 +98,105 @@ struct I2c {
     size_t write(const uint16_t deviceAddr, uint8_t const* const data, const size_t length) const;
     size_t read(const uint16_t deviceAddr, const uint8_t regAddr, uint8_t* const data, const size_t length) const;
 
+    /**
+     * Queues a transaction and returns at once, the buffers have to stay valid
+     * until the callback is called. Only with interrupts.
+     * @return false if the queue is full or the transaction is invalid
+     */
+    bool enqueue(const Transaction& transaction) const;
+
+    /// Queues a transaction and waits until it is done, aborts it after ticksToWait
+    bool transfer(const Transaction& transaction, const uint32_t ticksToWait = TRANSACTION_TIMEOUT) const;
+
+    /**
+     * Clocks SCL until SDA is released, generates a stop and resets the
+     * peripheral, then continues with the queue. A running transaction is
+     * taken for hung and fails. Busy waits, only from tasks.
+     */
+    void recoverBus(void) const;
+
+    /// The queue holds until recoverBus() after a bus error, a lost arbitration or a busy bus
+    bool isRecoveryPending(void) const;
+
+    Statistics getStatistics(void) const;
+
 private:
     constexpr I2c(const enum Description& desc,
                   const uint32_t&         peripherie,
-                  const I2C_InitTypeDef&  conf) :
-        mDescription(desc), mPeripherie(peripherie), mConfiguration(conf) {}
+                  const I2C_InitTypeDef&  conf,
+                  const Nvic*             eventNvic = nullptr,
+                  const Nvic*             errorNvic = nullptr,
+                  const Dma*              txDma = nullptr,
+                  const Dma*              rxDma = nullptr,
+                  const Gpio*             scl = nullptr,
+                  const Gpio*             sda = nullptr) :
+        mDescription(desc), mPeripherie(peripherie), mConfiguration(conf),
+        mEventNvic(eventNvic), mErrorNvic(errorNvic), mTxDma(txDma), mRxDma(rxDma), mScl(scl), mSda(sda) {}
 
     const enum Description mDescription;
     const uint32_t mPeripherie;
     const I2C_InitTypeDef mConfiguration;
+    const Nvic* mEventNvic;
+    const Nvic* mErrorNvic;
+    const Dma* mTxDma;
+    const Dma* mRxDma;
+    const Gpio* mScl;
+    const Gpio* mSda;
 
     static constexpr const uint32_t TIMEOUT = 0x10000; // Timeout for I2c write/read routines
+    static constexpr const uint32_t TRANSACTION_TIMEOUT = 100 / portTICK_RATE_MS;
+    static constexpr const size_t MIN_LENGTH_FOR_DMA_TRANSFER = 2;
+    static constexpr const size_t MAX_DMA_LENGTH = 0xffff;
+
+    enum class Phase : uint8_t {
+        START_WRITE,
+        WRITE,
+        START_READ,
+        READ
+    };
+
+    /**
+     * Transactions are identified by sequence numbers: all below completed
+     * are done, completed is running if active is set. No transaction starts
+     * while recoveryPending is set.
+     */
+    struct TransactionState {
+        std::array<Transaction, TRANSACTION_QUEUE_SIZE> queue;
+        uint32_t enqueued;
+        uint32_t completed;
+        bool active;
+        bool recoveryPending;
+        Phase phase;
+        size_t offset;
+        Statistics statistics;
+    };
 
     void initialize(void) const;
+    void registerInterruptCallbacks(void) const;
+    bool interruptSupport(void) const;
+    bool enqueue(const Transaction& transaction, uint32_t& sequence) const;
+    void startNextTransaction(void) const;
+    void addressedForWrite(const Transaction& transaction) const;
+    void addressedForRead(const Transaction& transaction) const;
+    void endOfWrite(const Transaction& transaction) const;
+    void complete(const bool success) const;
+    void abortActive(void) const;
+    void recoverPendingBus(void) const;
+    void clockBusFree(void) const;
+    void eventInterrupt(void) const;
+    void errorInterrupt(void) const;
+    void txDmaCompleteInterrupt(void) const;
+    void rxDmaCompleteInterrupt(void) const;
+    TransactionState& transactionState(void) const;
+
     bool timeoutDuringWaitUntilFlagIsEqualState(const uint32_t flag, const FlagStatus state) const;
     bool timeoutDuringWaitEvent(const uint32_t event) const;
     bool initMasterCommunication(const uint16_t deviceAddr, const size_t length) const;
     bool sendRegisterAddress(const uint16_t deviceAddr, const uint8_t regAddr, const size_t length) const;
 
     static std::array<os::Mutex, Description::__ENUM__SIZE> MutexArray;
+    static std::array<os::Semaphore, Description::__ENUM__SIZE> TransactionCompleteSemaphores;
+    static std::array<TransactionState, Description::__ENUM__SIZE> TransactionStates;
 
     friend class Factory<I2c>;
 };
@@ -84,17 +84,17 @@ void Nvic::handleInterrupt(void) const
     }
 }
 
-void Nvic::registerGetInterruptStatusProcedure(std::function<bool(void)> f) const
+void Nvic::registerGetInterruptStatusProcedure(utility::Delegate<bool(void)> f) const
 {
     NvicGetInterruptStatusProcedeures[mDescription] = f;
 }
 
-void Nvic::registerClearInterruptProcedure(std::function<void(void)> f) const
+void Nvic::registerClearInterruptProcedure(utility::Delegate<void(void)> f) const
 {
     NvicClearInterruptProcedeures[mDescription] = f;
 }
 
-void Nvic::registerInterruptCallback(std::function<void(void)> f) const
+void Nvic::registerInterruptCallback(utility::Delegate<void(void)> f) const
 {
     NvicCallbacks[mDescription] = f;
 }
@@ -22,8 +22,9 @@
 #ifndef SOURCES_HAL_STM32F4XX_NVIC_H_
 #define SOURCES_HAL_STM32F4XX_NVIC_H_
 
+#include <array>
 #include "hal_Factory.h"
-#include <functional>
+#include "delegate.h"
 #include "stm32f4xx_misc.h"
 
 namespace hal
@@ -49,14 +50,14 @@ struct Nvic {
      * desired interrupt really happened.
      * @param procedure the checking procedure (bool procedure(void))
      */
-    void registerGetInterruptStatusProcedure(std::function<bool(void)> procedure) const;
+    void registerGetInterruptStatusProcedure(utility::Delegate<bool(void)> procedure) const;
     /**
      * Registers a void procedure that clears the interrupt status of the
      * hardware.
      */
-    void registerClearInterruptProcedure(std::function<void(void)> procedure) const;
+    void registerClearInterruptProcedure(utility::Delegate<void(void)> procedure) const;
 
-    void registerInterruptCallback(std::function<void(void)> callback) const;
+    void registerInterruptCallback(utility::Delegate<void(void)> callback) const;
     void unregisterInterruptCallback(void) const;
     void handleInterrupt(void) const;
 
@@ -79,13 +80,13 @@ private:
     const enum Description mDescription;
     const IRQn mInterruptChannel;
 
-    using CallbackArray = std::array<std::function<void (void)>, Nvic::__ENUM__SIZE>;
+    using CallbackArray = std::array<utility::Delegate<void (void)>, Nvic::__ENUM__SIZE>;
     static CallbackArray NvicCallbacks;
 
-    using GetInterruptStatusProcedureArray = std::array<std::function<bool (void)>, Nvic::__ENUM__SIZE>;
+    using GetInterruptStatusProcedureArray = std::array<utility::Delegate<bool (void)>, Nvic::__ENUM__SIZE>;
     static GetInterruptStatusProcedureArray NvicGetInterruptStatusProcedeures;
 
-    using ClearInterruptProcedureArray = std::array<std::function<void (void)>, Nvic::__ENUM__SIZE>;
+    using ClearInterruptProcedureArray = std::array<utility::Delegate<void (void)>, Nvic::__ENUM__SIZE>;
     static ClearInterruptProcedureArray NvicClearInterruptProcedeures;
 
     void clearInterruptBit(void) const;
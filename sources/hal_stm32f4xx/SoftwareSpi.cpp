@@ -15,24 +15,74 @@
 /// You should have received a copy of the GNU General Public License along with this program.
 /// If not, see <https://www.gnu.org/licenses/>.
 #include <SoftwareSpi.h>
+#include "trace.h"
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
 namespace hal
 {
+void SoftwareSpi::initialize(void) const
+{
+    if (mTimer == nullptr) {
+        return;
+    }
+
+    const hal::Dma* const lastStream = mInputDma ? mInputDma : mOutputDma;
+    if (!lastStream->registerInterruptCallback([this] {
+        dmaFrameDone();
+    }, hal::Dma::InterruptSource::TC))
+    {
+        Trace(ZONE_ERROR, "SoftwareSpi stream needs DMA_IT_TC\r\n");
+    }
+}
+
 void SoftwareSpi::send(const uint16_t data) const
+{
+    sendFrame(data, 16);
+    // keeps send() blocking like the bit-banged one
+    waitUntilDone();
+}
+
+bool SoftwareSpi::sendFrame(const uint32_t data, const size_t bits) const
+{
+    if ((bits == 0) || (bits > MAX_FRAME_BITS)) {
+        return false;
+    }
+
+    if (mTimer) {
+        waitUntilDone();
+        startDmaFrame(data, bits);
+    } else {
+        bitBangFrame(data, bits);
+    }
+    return true;
+}
+
+bool SoftwareSpi::waitUntilDone(const uint32_t ticksToWait) const
+{
+    while (dmaFrames[mDescription].running) {
+        if (!frameDoneSemaphores[mDescription].take(std::chrono::milliseconds(ticksToWait * portTICK_RATE_MS))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t SoftwareSpi::bitPosition(const size_t n, const size_t bits) const
+{
+    return mMsbFirst ? (bits - 1 - n) : n;
+}
+
+void SoftwareSpi::bitBangFrame(const uint32_t data, const size_t bits) const
 {
     readyToReceiveFlags[mDescription] = false;
     rxBuffers[mDescription] = 0;
-    uint16_t position = 0;
 
     wait();
 
-    for (int i = 0; i < 16; i++) {
-        if (mMsbFirst) {
-            position = (15 - i);
-        } else {
-            position = i;
-        }
-        const bool output = (data & (1 << position)) != 0;
+    for (size_t i = 0; i < bits; i++) {
+        const uint32_t position = bitPosition(i, bits);
+        const bool output = (data & (1UL << position)) != 0;
 
         risingEdge(output, position);
         wait();
@@ -42,12 +92,80 @@ void SoftwareSpi::send(const uint16_t data) const
     readyToReceiveFlags[mDescription] = true;
 }
 
+void SoftwareSpi::startDmaFrame(const uint32_t data, const size_t bits) const
+{
+    DmaFrame& frame = dmaFrames[mDescription];
+    const uint32_t clockMask = mClockPin.mConfiguration.GPIO_Pin;
+    const uint32_t mosiMask = mMosiPin.mConfiguration.GPIO_Pin;
+
+    // BSRR: the lower half sets pins, the upper half resets them
+    for (size_t i = 0; i < bits; i++) {
+        const bool output = (data & (1UL << bitPosition(i, bits))) != 0;
+        const uint32_t mosiWord = output ? mosiMask : (mosiMask << 16);
+
+        frame.outputWords[2 * i] = clockMask | (mWriteOnRisingEdge ? mosiWord : 0);
+        frame.outputWords[2 * i + 1] = (clockMask << 16) | (mWriteOnRisingEdge ? 0 : mosiWord);
+    }
+    frame.bits = bits;
+    frame.running = true;
+    readyToReceiveFlags[mDescription] = false;
+    frameDoneSemaphores[mDescription].take(std::chrono::milliseconds(0));
+
+    TIM_TypeDef* const tim = mTimer->getBasePointer();
+    mTimer->disable();
+    mTimer->setCounterValue(0);
+    // Samples in the middle of each half clock period
+    TIM_SetCompare1(tim, mTimer->getPeriode() / 2);
+    TIM_ClearFlag(tim, TIM_FLAG_Update | TIM_FLAG_CC1);
+
+    mOutputDma->setupTransfer(reinterpret_cast<uint8_t const*>(frame.outputWords.data()), 2 * bits);
+    mOutputDma->enable();
+    if (mInputDma) {
+        mInputDma->setupTransfer(frame.inputSamples.data(), 2 * bits + 1);
+        mInputDma->enable();
+        TIM_DMACmd(tim, TIM_DMA_Update | TIM_DMA_CC1, ENABLE);
+    } else {
+        TIM_DMACmd(tim, TIM_DMA_Update, ENABLE);
+    }
+    mTimer->enable();
+}
+
+void SoftwareSpi::dmaFrameDone(void) const
+{
+    DmaFrame& frame = dmaFrames[mDescription];
+
+    mTimer->disable();
+    TIM_DMACmd(mTimer->getBasePointer(), TIM_DMA_Update | TIM_DMA_CC1, DISABLE);
+
+    uint32_t received = 0;
+    if (mInputDma) {
+        const uint32_t misoMask = mMisoPin.mConfiguration.GPIO_Pin;
+        // Sample k + 1 is the first one that sees output word k
+        const size_t edge = mReadOnRisingEdge ? 1 : 2;
+        for (size_t i = 0; i < frame.bits; i++) {
+            if (frame.inputSamples[2 * i + edge] & misoMask) {
+                received |= 1UL << bitPosition(i, frame.bits);
+            }
+        }
+    }
+
+    rxBuffers[mDescription] = received;
+    readyToReceiveFlags[mDescription] = true;
+    frame.running = false;
+    frameDoneSemaphores[mDescription].giveFromISR();
+}
+
 bool SoftwareSpi::isReadyToReceive(void) const
 {
     return readyToReceiveFlags[mDescription];
 }
 
 uint16_t SoftwareSpi::receive(void) const
+{
+    return static_cast<uint16_t>(receiveFrame());
+}
+
+uint32_t SoftwareSpi::receiveFrame(void) const
 {
     readyToReceiveFlags[mDescription] = false;
     return rxBuffers[mDescription];
@@ -70,7 +188,7 @@ void SoftwareSpi::risingEdge(const bool output, const uint16_t position) const
     wait();
 
     if (mReadOnRisingEdge) {
-        rxBuffers[mDescription] |= static_cast<bool>(mMisoPin) << position;
+        rxBuffers[mDescription] |= static_cast<uint32_t>(static_cast<bool>(mMisoPin)) << position;
     }
 }
 
@@ -84,11 +202,13 @@ void SoftwareSpi::fallingEdge(const bool output, uint16_t position) const
     wait();
 
     if (!mReadOnRisingEdge) {
-        rxBuffers[mDescription] |= static_cast<bool>(mMisoPin) << position;
+        rxBuffers[mDescription] |= static_cast<uint32_t>(static_cast<bool>(mMisoPin)) << position;
     }
 }
 
 constexpr const std::array<const SoftwareSpi, SoftwareSpi::__ENUM__SIZE> Factory<SoftwareSpi>::Container;
 std::array<bool, SoftwareSpi::__ENUM__SIZE> SoftwareSpi::readyToReceiveFlags;
-std::array<uint16_t, SoftwareSpi::__ENUM__SIZE> SoftwareSpi::rxBuffers;
+std::array<uint32_t, SoftwareSpi::__ENUM__SIZE> SoftwareSpi::rxBuffers;
+std::array<SoftwareSpi::DmaFrame, SoftwareSpi::__ENUM__SIZE> SoftwareSpi::dmaFrames;
+std::array<os::Semaphore, SoftwareSpi::__ENUM__SIZE> SoftwareSpi::frameDoneSemaphores;
 } // namespace hal
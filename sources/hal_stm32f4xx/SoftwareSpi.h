@@ -17,8 +17,12 @@
 #ifndef SOURCES_HAL_STM32F4XX_SOFTWARESPI_H_
 #define SOURCES_HAL_STM32F4XX_SOFTWARESPI_H_
 
+#include <array>
 #include "hal_Factory.h"
+#include "Dma.h"
 #include "Gpio.h"
+#include "Tim.h"
+#include "Semaphore.h"
 
 namespace hal
 {
@@ -29,10 +33,23 @@ namespace hal
 /// ---- | -------------------
 /// MoSi | Master out Slave in
 /// MiSo | Master in Slave out
+///
+/// With a timer the frames are clocked out by DMA instead: the GPIO BSRR words of
+/// every clock edge are computed in advance and the update event of the timer
+/// moves one of them to the port per half clock period. The compare event of
+/// channel 1 samples the MiSo port in the middle of each half period, the same
+/// way. The CPU is free meanwhile and the timing doesn't jitter with interrupts.
+/// Clock and MoSi have to be on the same port then. The streams must be DMA2
+/// streams of the timer requests (e.g. TIM1_UP and TIM1_CH1, or TIM8_UP and
+/// TIM8_CH1): the output stream memory to peripheral with words on the BSRR of
+/// the clock port, the input stream peripheral to memory with half words from
+/// the IDR of the MiSo port. The last stream of a frame needs DMA_IT_TC.
 class SoftwareSpi
 {
 public:
 #include "SoftwareSpi_config.h"
+    /// Longest frame of sendFrame().
+    static constexpr size_t MAX_FRAME_BITS = 32;
     SoftwareSpi() = delete;
     SoftwareSpi(const SoftwareSpi&) = delete;
     SoftwareSpi(SoftwareSpi&&) = default;
@@ -43,6 +60,20 @@ public:
     /// @param Data to send.
     void send(const uint16_t data) const;
 
+    /// @brief Sends a frame of 1 to MAX_FRAME_BITS bits.
+    ///
+    /// With a timer the call returns as soon as the frame started, isReadyToReceive()
+    /// turns true when it is done. A frame still running is waited for first.
+    /// @param data Bits to send, right aligned.
+    /// @param bits Length of the frame.
+    /// @return False if the length is invalid.
+    bool sendFrame(const uint32_t data, const size_t bits) const;
+
+    /// @brief Waits until the frame clocked out by DMA is done.
+    /// @param ticksToWait Maximum time to wait.
+    /// @return False on timeout.
+    bool waitUntilDone(const uint32_t ticksToWait = portMAX_DELAY) const;
+
     /// @brief Indicates whether new data is in the receive buffer.
     /// @return True if the receive Buffer contains 16 bit.
     bool isReadyToReceive(void) const;
@@ -53,6 +84,12 @@ public:
     /// @return Content of the receive Buffer.
     uint16_t receive(void) const;
 
+    /// @brief Returns the frame received by sendFrame(), right aligned.
+    ///
+    /// The isReadyToReceive flag is reset by a call to this method.
+    /// @return Content of the receive Buffer.
+    uint32_t receiveFrame(void) const;
+
 private:
     /// @brief Private constructor used by @ref hal::Factory.
     ///
@@ -67,6 +104,10 @@ private:
     /// @param readOnRisingEdge  Specifies the clock edge to read on.
     /// @param writeOnRisingEdge Specifies the clock edge to write on.
     /// @param msbFirst          Specifies the data direction.
+    /// @param timer     Timer with the half clock period, nullptr to bit-bang.
+    /// @param outputDma Stream of the timer update event writing the clock and MoSi port.
+    /// @param inputDma  Stream of the timer channel 1 compare event reading the MiSo port,
+    ///                  nullptr if nothing is received.
     constexpr SoftwareSpi(const Description& desc,
                           const hal::Gpio&   clockPin,
                           const hal::Gpio&   mosiPin,
@@ -74,7 +115,10 @@ private:
                           const size_t       clockInterval = 2,
                           const bool         readOnRisingEdge = true,
                           const bool         writeOnRisingEdge = false,
-                          const bool         msbFirst = true) :
+                          const bool         msbFirst = true,
+                          const hal::Tim*    timer = nullptr,
+                          const hal::Dma*    outputDma = nullptr,
+                          const hal::Dma*    inputDma = nullptr) :
         mDescription(desc),
         mClockPin(clockPin),
         mMosiPin(mosiPin),
@@ -82,15 +126,34 @@ private:
         mClockInterval(clockInterval),
         mReadOnRisingEdge(readOnRisingEdge),
         mWriteOnRisingEdge(writeOnRisingEdge),
-        mMsbFirst(msbFirst)
+        mMsbFirst(msbFirst),
+        mTimer(timer),
+        mOutputDma(outputDma),
+        mInputDma(inputDma)
     {}
 
+    /// Precomputed BSRR words and MiSo samples of a frame clocked out by DMA.
+    struct DmaFrame {
+        /// Two words per bit, the first and the second clock edge.
+        std::array<uint32_t, 2 * MAX_FRAME_BITS> outputWords;
+        /// The first sample is taken before the first word is written.
+        std::array<uint16_t, 2 * MAX_FRAME_BITS + 1> inputSamples;
+        size_t bits;
+        bool running;
+    };
+
     /// Receive buffers for all class instances.
-    static std::array<uint16_t, __ENUM__SIZE> rxBuffers;
+    static std::array<uint32_t, __ENUM__SIZE> rxBuffers;
 
     /// Receive flags for all class instances.
     static std::array<bool, __ENUM__SIZE> readyToReceiveFlags;
 
+    /// Frames clocked out by DMA for all class instances.
+    static std::array<DmaFrame, __ENUM__SIZE> dmaFrames;
+
+    /// Given when a frame clocked out by DMA is done.
+    static std::array<os::Semaphore, __ENUM__SIZE> frameDoneSemaphores;
+
     /// Instance description for factory pattern.
     const enum Description mDescription;
     /// Gpio for the clock signal.
@@ -107,6 +170,31 @@ private:
     const bool mWriteOnRisingEdge;
     /// Specifier for the data direction.
     const bool mMsbFirst;
+    /// Timer with the half clock period in DMA mode.
+    const hal::Tim* mTimer;
+    /// Stream writing the BSRR words in DMA mode.
+    const hal::Dma* mOutputDma;
+    /// Stream sampling the MiSo port in DMA mode.
+    const hal::Dma* mInputDma;
+
+    /// @brief Registers the interrupt of the last stream of a frame in DMA mode.
+    void initialize(void) const;
+
+    /// @brief Bit-bangs a frame with the Gpios.
+    /// @param data Bits to send, right aligned.
+    /// @param bits Length of the frame.
+    void bitBangFrame(const uint32_t data, const size_t bits) const;
+
+    /// @brief Computes the BSRR words of a frame and starts the timer.
+    /// @param data Bits to send, right aligned.
+    /// @param bits Length of the frame.
+    void startDmaFrame(const uint32_t data, const size_t bits) const;
+
+    /// @brief Stops the timer and decodes the MiSo samples, called from the ISR.
+    void dmaFrameDone(void) const;
+
+    /// @brief Position of the n-th bit of a frame in the data word.
+    uint32_t bitPosition(const size_t n, const size_t bits) const;
 
     /// @brief Executes the actions for a rising edge of a clock pulse.
     ///
@@ -136,7 +224,12 @@ class Factory<SoftwareSpi>
 {
 #include "SoftwareSpi_config.h"
 
-    Factory(void) {}
+    Factory(void)
+    {
+        for (const auto& spi : Container) {
+            spi.initialize();
+        }
+    }
 
 public:
     /// @brief Returns a specific SoftwareSpi instance.
@@ -156,6 +249,13 @@ public:
         static_assert((Container[index].mMisoPin.getModeFromConfig() == GPIO_Mode_IN) ||
                       Container[index].mMisoPin.isReconfigurable(), "Pin must be mode out or reconfigurable!");
 
+        // one BSRR word sets clock and MoSi at once
+        static_assert((Container[index].mTimer == nullptr) ||
+                      (Container[index].mClockPin.mPeripherie == Container[index].mMosiPin.mPeripherie),
+                      "Clock and MoSi must be on the same port for DMA!");
+        static_assert((Container[index].mTimer == nullptr) || (Container[index].mOutputDma != nullptr),
+                      "Output Dma not assigned");
+
         return Container[index];
     }
 
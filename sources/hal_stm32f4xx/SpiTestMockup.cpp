@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+/**
+ * Mockup for software tests of classes dependent on hal::Spi. Every
+ * interface is ready, sent bytes are dropped and nothing is ever received.
+ */
+
+#include "Spi.h"
+
+using hal::Factory;
+using hal::Spi;
+
+extern "C" void SPI_I2S_DMACmd(SPI_TypeDef* SPIx, uint16_t SPI_I2S_DMAReq, FunctionalState NewState)
+{}
+
+bool Spi::isReadyToSend(void) const
+{
+    return true;
+}
+
+bool Spi::isReadyToReceive(void) const
+{
+    return false;
+}
+
+size_t Spi::send(uint8_t const* const data, const size_t length) const
+{
+    return length;
+}
+
+uint16_t Spi::receive(void) const
+{
+    return 0;
+}
+
+size_t Spi::receive(uint8_t* const data, const size_t length) const
+{
+    return 0;
+}
+
+size_t Spi::transmitReceive(uint8_t const* const txData, uint8_t* const rxData, const size_t length) const
+{
+    return 0;
+}
+
+constexpr const std::array<const Spi, Spi::__ENUM__SIZE> Factory<Spi>::Container;
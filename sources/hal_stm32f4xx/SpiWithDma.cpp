@@ -13,7 +13,10 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <algorithm>
 #include "SpiWithDma.h"
+#include "LockGuard.h"
+#include "os_Task.h"
 #include "trace.h"
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR |
@@ -24,6 +27,12 @@ using hal::Spi;
 using hal::SpiWithDma;
 
 std::array<os::Semaphore, Spi::__ENUM__SIZE> SpiWithDma::DmaTransferCompleteSemaphores;
+std::array<SpiWithDma::TransactionState, Spi::__ENUM__SIZE> SpiWithDma::TransactionStates;
+std::array<os::Mutex, Spi::__ENUM__SIZE> SpiWithDma::TransactionWaitMutexes;
+constexpr const size_t SpiWithDma::MAX_SEGMENT_LENGTH;
+
+static const uint8_t g_DummyTx = 0xff;
+static uint8_t g_DummyRx;
 
 void SpiWithDma::initialize() const
 {
@@ -31,6 +40,7 @@ void SpiWithDma::initialize() const
         return;
     }
     SPI_I2S_DMACmd(reinterpret_cast<SPI_TypeDef*>(mSpi->mPeripherie), mDmaCmd, ENABLE);
+    transactionState().clockBits = mSpi->mConfiguration.SPI_CPOL | mSpi->mConfiguration.SPI_CPHA;
 
     if (!DmaTransferCompleteSemaphores[(size_t)mSpi->mDescription]) {
         Trace(ZONE_ERROR, "Semaphore allocation failed\r\n");
@@ -41,15 +51,25 @@ void SpiWithDma::initialize() const
 
 void SpiWithDma::registerInterruptCallbacks(void) const
 {
+    if (dmaTransactionSupport()) {
+        if (!mRxDma->registerInterruptCallback([this] {
+            segmentCompleteInterrupt();
+        }, Dma::InterruptSource::TC))
+        {
+            Trace(ZONE_ERROR, "Rx stream needs DMA_IT_TC for transactions\r\n");
+        }
+        return;
+    }
+
     if (mTxDma) {
         mTxDma->registerInterruptSemaphore(&DmaTransferCompleteSemaphores.at(mSpi->mDescription),
                                            Dma::InterruptSource::TC);
     }
+}
 
-    if (mRxDma) {
-        mRxDma->registerInterruptSemaphore(&DmaTransferCompleteSemaphores.at(mSpi->mDescription),
-                                           Dma::InterruptSource::TC);
-    }
+bool SpiWithDma::dmaTransactionSupport(void) const
+{
+    return mTxDma && (mDmaCmd & SPI_I2S_DMAReq_Tx) && mRxDma && (mDmaCmd & SPI_I2S_DMAReq_Rx);
 }
 
 size_t SpiWithDma::send(uint8_t const* const data, const size_t length) const
@@ -58,13 +78,14 @@ size_t SpiWithDma::send(uint8_t const* const data, const size_t length) const
         return 0;
     }
 
-    if (mTxDma && (mDmaCmd & SPI_I2S_DMAReq_Tx)
-        && (length > MIN_LENGTH_FOR_DMA_TRANSFER))
+    if (dmaTransactionSupport()) {
+        return transferSegment(data, nullptr, length);
+    } else if (mTxDma && (mDmaCmd & SPI_I2S_DMAReq_Tx)
+               && (length > MIN_LENGTH_FOR_DMA_TRANSFER))
     {
         // clear Semaphore
         DmaTransferCompleteSemaphores.at(mSpi->mDescription).take(std::chrono::microseconds(1));
         // we have DMA support
-//        mTxDma->setupTransfer((uint8_t* const)data, length);
         mTxDma->setupTransfer(data, length, false);
         mTxDma->enable();
 
@@ -88,75 +109,251 @@ size_t SpiWithDma::receive(uint8_t* const data, const size_t length) const
         return 0;
     }
 
+    if (dmaTransactionSupport()) {
+        return transferSegment(nullptr, data, length);
+    }
+
     // clear receive buffer
     if (mSpi->isReadyToReceive()) {
         mSpi->receive();
     }
+    return mSpi->receive(data, length);
+}
 
-    if (mRxDma && (mDmaCmd & SPI_I2S_DMAReq_Rx)
-        && (length > MIN_LENGTH_FOR_DMA_TRANSFER) && (mTxDma && (mDmaCmd & SPI_I2S_DMAReq_Tx)))
-    {
-        // we have DMA support
-        // disable TX interrupt to avoid two callback calls
-        mTxDma->unregisterInterruptSemaphore(Dma::InterruptSource::TC);
+size_t SpiWithDma::transmitReceive(uint8_t const* const txData, uint8_t* const rxData, const size_t length) const
+{
+    if ((txData == nullptr) || (rxData == nullptr)) {
+        return 0;
+    }
 
-//        mRxDma->setupTransfer((uint8_t* const)data, length);
-        mRxDma->setupTransfer(data, length, false);
-        const uint8_t dummy = 0xff;
-        mTxDma->setupSendSingleCharMultipleTimes(&dummy, length);
+    if (dmaTransactionSupport()) {
+        return transferSegment(txData, rxData, length);
+    }
 
-        mRxDma->enable();
-        mTxDma->enable();
+    // clear receive buffer
+    if (mSpi->isReadyToReceive()) {
+        Trace(ZONE_INFO, "clear buffer\n");
+        mSpi->receive();
+    }
+    return mSpi->transmitReceive(txData, rxData, length);
+}
 
-        DmaTransferCompleteSemaphores.at(mSpi->mDescription).take();
+size_t SpiWithDma::transferSegment(uint8_t const* const tx, uint8_t* const rx, const size_t length) const
+{
+    size_t transferred = 0;
+    while (transferred < length) {
+        const Segment segment {tx ? tx + transferred : nullptr,
+                               rx ? rx + transferred : nullptr,
+                               std::min(length - transferred, MAX_SEGMENT_LENGTH)};
+        if (!transfer(Transaction {nullptr, Mode::CONFIGURED, &segment, 1, nullptr})) {
+            break;
+        }
+        transferred += segment.length;
+    }
+    return transferred;
+}
 
-        mTxDma->disable();
-        mRxDma->disable();
+bool SpiWithDma::enqueue(const Transaction& transaction) const
+{
+    uint32_t sequence;
+    if (enqueue(transaction, sequence)) {
+        return true;
+    }
 
-        // reregister TX Callback
-        registerInterruptCallbacks();
-        return length;
-    } else {
-        return mSpi->receive(data, length);
+    os::ThisTask::enterCriticalSection();
+    transactionState().statistics.dropped++;
+    os::ThisTask::exitCriticalSection();
+    return false;
+}
+
+bool SpiWithDma::transfer(const Transaction& transaction) const
+{
+    os::Semaphore& semaphore = DmaTransferCompleteSemaphores.at(mSpi->mDescription);
+    os::LockGuard<os::Mutex> lock(TransactionWaitMutexes.at(mSpi->mDescription));
+
+    semaphore.take(std::chrono::milliseconds(0));
+
+    uint32_t sequence;
+    while (!enqueue(transaction, sequence)) {
+        if (!dmaTransactionSupport() || (transaction.segments == nullptr) || (transaction.numberOfSegments == 0)) {
+            return false;
+        }
+        // The queue is full, every completed transaction frees a slot
+        semaphore.take();
     }
+
+    TransactionState& state = transactionState();
+    while (static_cast<int32_t>(state.completed - sequence) <= 0) {
+        semaphore.take();
+    }
+    return true;
 }
 
-size_t SpiWithDma::transmitReceive(uint8_t const* const txData, uint8_t* const rxData, const size_t length) const
+bool SpiWithDma::waitUntilIdle(const uint32_t ticksToWait) const
 {
-    if ((txData == nullptr) || (rxData == nullptr)) {
-        return 0;
+    os::Semaphore& semaphore = DmaTransferCompleteSemaphores.at(mSpi->mDescription);
+    os::LockGuard<os::Mutex> lock(TransactionWaitMutexes.at(mSpi->mDescription), ticksToWait);
+    if (!lock) {
+        return false;
     }
 
+    semaphore.take(std::chrono::milliseconds(0));
+
+    TransactionState& state = transactionState();
+    const uint32_t start = os::Task::getTickCount();
+    while (state.completed != state.enqueued) {
+        uint32_t remaining = ticksToWait;
+        if (ticksToWait != portMAX_DELAY) {
+            const uint32_t elapsed = os::Task::getTickCount() - start;
+            remaining = (elapsed < ticksToWait) ? (ticksToWait - elapsed) : 0;
+        }
+
+        if (!semaphore.take(std::chrono::milliseconds(remaining))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SpiWithDma::TransactionStatistics SpiWithDma::getTransactionStatistics(void) const
+{
+    os::ThisTask::enterCriticalSection();
+    const TransactionStatistics statistics = transactionState().statistics;
+    os::ThisTask::exitCriticalSection();
+    return statistics;
+}
+
+bool SpiWithDma::enqueue(const Transaction& transaction, uint32_t& sequence) const
+{
+    if (!dmaTransactionSupport() || (transaction.segments == nullptr) || (transaction.numberOfSegments == 0)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < transaction.numberOfSegments; i++) {
+        if ((transaction.segments[i].length == 0) || (transaction.segments[i].length > MAX_SEGMENT_LENGTH)) {
+            return false;
+        }
+    }
+
+    TransactionState& state = transactionState();
+
+    os::ThisTask::enterCriticalSection();
+    if (state.enqueued - state.completed >= TRANSACTION_QUEUE_SIZE) {
+        os::ThisTask::exitCriticalSection();
+        return false;
+    }
+
+    state.queue[state.enqueued % TRANSACTION_QUEUE_SIZE] = transaction;
+    sequence = state.enqueued++;
+    state.statistics.maxDepth = std::max(state.statistics.maxDepth, state.enqueued - state.completed);
+
+    if (!state.active) {
+        startNextTransaction();
+    }
+    os::ThisTask::exitCriticalSection();
+    return true;
+}
+
+void SpiWithDma::startNextTransaction(void) const
+{
+    TransactionState& state = transactionState();
+    if (state.started == state.enqueued) {
+        state.active = false;
+        return;
+    }
+
+    const Transaction& transaction = state.queue[state.started % TRANSACTION_QUEUE_SIZE];
+    state.started++;
+    state.segment = 0;
+    state.active = true;
+
+    applyMode(transaction.mode);
+
     // clear receive buffer
     if (mSpi->isReadyToReceive()) {
-        Trace(ZONE_INFO, "clear buffer\n");
         mSpi->receive();
     }
 
-    if (mRxDma && (mDmaCmd & SPI_I2S_DMAReq_Rx)
-        && (length > MIN_LENGTH_FOR_DMA_TRANSFER) && (mTxDma && (mDmaCmd & SPI_I2S_DMAReq_Tx)))
-    {
-        // we have DMA support
-        // disable TX interrupt to avoid two callback calls
-        mTxDma->unregisterInterruptSemaphore(Dma::InterruptSource::TC);
+    if (transaction.chipSelect) {
+        *transaction.chipSelect = false;
+    }
+    startSegment(transaction.segments[0]);
+}
 
-        mRxDma->setupTransfer((uint8_t* const)rxData, length);
-        mTxDma->setupTransfer(txData, length);
+void SpiWithDma::startSegment(const Segment& segment) const
+{
+    if (segment.rx) {
+        mRxDma->setupTransfer(segment.rx, segment.length);
+    } else {
+        mRxDma->setupReceiveSingleCharMultipleTimes(&g_DummyRx, segment.length);
+    }
 
-        mRxDma->enable();
-        mTxDma->enable();
+    if (segment.tx) {
+        mTxDma->setupTransfer(segment.tx, segment.length);
+    } else {
+        mTxDma->setupSendSingleCharMultipleTimes(&g_DummyTx, segment.length);
+    }
 
-        DmaTransferCompleteSemaphores.at(mSpi->mDescription).take();
+    mRxDma->enable();
+    mTxDma->enable();
+}
 
-        mTxDma->disable();
-        mRxDma->disable();
+void SpiWithDma::applyMode(const Mode mode) const
+{
+    TransactionState& state = transactionState();
+    const uint16_t clockBits = (mode == Mode::CONFIGURED) ?
+                               (mSpi->mConfiguration.SPI_CPOL | mSpi->mConfiguration.SPI_CPHA) :
+                               static_cast<uint16_t>(mode);
 
-        // reregister TX Callback
-        registerInterruptCallbacks();
-        return length;
-    } else {
-        return mSpi->transmitReceive(txData, rxData, length);
+    if (state.clockBits != clockBits) {
+        SPI_TypeDef* const spi = reinterpret_cast<SPI_TypeDef*>(mSpi->mPeripherie);
+        SPI_InitTypeDef configuration = mSpi->mConfiguration;
+        configuration.SPI_CPOL = clockBits & SPI_CR1_CPOL;
+        configuration.SPI_CPHA = clockBits & SPI_CR1_CPHA;
+
+        // CPOL and CPHA may only change while the peripheral is disabled
+        SPI_Cmd(spi, DISABLE);
+        SPI_Init(spi, &configuration);
+        SPI_Cmd(spi, ENABLE);
+        state.clockBits = clockBits;
+    }
+}
+
+void SpiWithDma::segmentCompleteInterrupt(void) const
+{
+    TransactionState& state = transactionState();
+    if (!state.active) {
+        return;
+    }
+
+    // The rx stream completes after the last byte was clocked in, the bus is idle
+    const Transaction& transaction = state.queue[state.completed % TRANSACTION_QUEUE_SIZE];
+    state.statistics.segments++;
+    state.segment++;
+    if (state.segment < transaction.numberOfSegments) {
+        startSegment(transaction.segments[state.segment]);
+        return;
+    }
+
+    if (transaction.chipSelect) {
+        *transaction.chipSelect = true;
     }
+
+    // The slot is free after completed++
+    const utility::Delegate<void(void)> callback = transaction.callback;
+    state.completed++;
+    state.statistics.transactions++;
+    if (callback) {
+        callback();
+    }
+
+    startNextTransaction();
+    DmaTransferCompleteSemaphores.at(mSpi->mDescription).giveFromISR();
+}
+
+SpiWithDma::TransactionState& SpiWithDma::transactionState(void) const
+{
+    return TransactionStates[static_cast<size_t>(mSpi->mDescription)];
 }
 
 bool SpiWithDma::isReadyToSend(void) const
@@ -18,14 +18,66 @@
 
 #include <cstdint>
 #include <array>
+#include "delegate.h"
 #include "Dma.h"
+#include "Gpio.h"
 #include "Spi.h"
+#include "Mutex.h"
 #include "Semaphore.h"
 #include "hal_Factory.h"
 
 namespace hal
 {
+/**
+ * With a tx and an rx stream the bus runs a queue of transactions. The rx
+ * transfer complete interrupt starts the next segment or transaction, so
+ * transactions of several devices follow each other without waking a task.
+ * send(), receive() and transmitReceive() queue a transaction without chip
+ * select then, don't access such a bus through Spi directly.
+ */
 struct SpiWithDma {
+    static constexpr size_t TRANSACTION_QUEUE_SIZE = 8;
+
+    /// Clock polarity and phase of a transaction, CONFIGURED keeps those of the Spi configuration
+    enum class Mode : uint16_t {
+        MODE0 = SPI_CPOL_Low | SPI_CPHA_1Edge,
+        MODE1 = SPI_CPOL_Low | SPI_CPHA_2Edge,
+        MODE2 = SPI_CPOL_High | SPI_CPHA_1Edge,
+        MODE3 = SPI_CPOL_High | SPI_CPHA_2Edge,
+        CONFIGURED = 0xffff
+    };
+
+    /**
+     * Part of a transaction, e.g. a command or a payload. Without tx 0xff is
+     * clocked out, without rx the received bytes are discarded.
+     */
+    struct Segment {
+        uint8_t const* tx;
+        uint8_t* rx;
+        size_t length;
+    };
+
+    /**
+     * Access of one device: chipSelect (active low, nullptr if the device has
+     * none) is asserted, the segments are transferred back to back and
+     * chipSelect is released again. callback is called from the ISR then,
+     * it may give a semaphore but not enqueue().
+     */
+    struct Transaction {
+        Gpio const* chipSelect;
+        Mode mode;
+        Segment const* segments;
+        size_t numberOfSegments;
+        utility::Delegate<void(void)> callback;
+    };
+
+    struct TransactionStatistics {
+        uint32_t transactions;
+        uint32_t segments;
+        uint32_t dropped;
+        uint32_t maxDepth;
+    };
+
     SpiWithDma() = delete;
     SpiWithDma(const SpiWithDma&) = delete;
     SpiWithDma(SpiWithDma&&) = default;
@@ -44,6 +96,22 @@ struct SpiWithDma {
     size_t transmitReceive(const std::array<uint8_t, n>&, std::array<uint8_t, n>&) const;
     size_t transmitReceive(uint8_t const* const, uint8_t* const, const size_t) const;
 
+    /**
+     * Queues a transaction and returns at once. The segments and their
+     * buffers have to stay valid until the callback is called. Needs the tx
+     * and the rx stream, the rx stream with DMA_IT_TC.
+     * @return false if the queue is full or the transaction is invalid
+     */
+    bool enqueue(const Transaction& transaction) const;
+
+    /// Queues a transaction and waits until it is done
+    bool transfer(const Transaction& transaction) const;
+
+    /// Waits until all queued transactions are done
+    bool waitUntilIdle(const uint32_t ticksToWait = portMAX_DELAY) const;
+
+    TransactionStatistics getTransactionStatistics(void) const;
+
 private:
     constexpr SpiWithDma(Spi const* const spiInterface = nullptr,
                          const uint16_t&  dmaCmd = 0,
@@ -64,8 +132,38 @@ private:
     bool isReadyToReceive(void) const;
     bool isReadyToTransmitReceive(void) const;
 
+    /**
+     * Transactions are identified by sequence numbers: all below completed
+     * are done, segment counts the finished segments of the one running.
+     * clockBits are CPOL and CPHA the peripheral runs with.
+     */
+    struct TransactionState {
+        std::array<Transaction, TRANSACTION_QUEUE_SIZE> queue;
+        size_t segment;
+        uint32_t enqueued;
+        uint32_t started;
+        uint32_t completed;
+        bool active;
+        uint16_t clockBits;
+        TransactionStatistics statistics;
+    };
+
+    bool dmaTransactionSupport(void) const;
+    bool enqueue(const Transaction& transaction, uint32_t& sequence) const;
+    size_t transferSegment(uint8_t const* const tx, uint8_t* const rx, const size_t length) const;
+    void startNextTransaction(void) const;
+    void startSegment(const Segment& segment) const;
+    void applyMode(const Mode mode) const;
+    void segmentCompleteInterrupt(void) const;
+    TransactionState& transactionState(void) const;
+
     static constexpr const size_t MIN_LENGTH_FOR_DMA_TRANSFER = 2;
+    static constexpr const size_t MAX_SEGMENT_LENGTH = 0xffff;
     static std::array<os::Semaphore, Spi::__ENUM__SIZE> DmaTransferCompleteSemaphores;
+    static std::array<TransactionState, Spi::__ENUM__SIZE> TransactionStates;
+
+    /// Only one task at a time waits on the DmaTransferCompleteSemaphore of a bus
+    static std::array<os::Mutex, Spi::__ENUM__SIZE> TransactionWaitMutexes;
 
     friend class Factory<SpiWithDma>;
     friend class Dma;
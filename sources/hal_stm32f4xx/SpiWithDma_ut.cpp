@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "unittest.h"
+#include "os_Task.h"
+#include "SpiWithDma.h"
+
+static const int __attribute__((unused)) g_DebugZones = 0;
+
+using hal::SpiWithDma;
+
+//--------------------------BUFFERS--------------------------
+
+static constexpr const SpiWithDma& g_spi = hal::Factory<SpiWithDma>::get<hal::Spi::MEMS_SPI>();
+static constexpr const hal::Dma& g_rxDma = hal::Factory<hal::Dma>::get<hal::Dma::MEMS_SPI_RX>();
+static constexpr const hal::Gpio& g_chipSelect = hal::Factory<hal::Gpio>::get<hal::Gpio::MEMS_CS>();
+
+static const uint8_t g_command[1] = {0x8f};
+static uint8_t g_response[2];
+static const uint8_t g_payload[5] = {};
+
+//--------------------------MOCKING--------------------------
+
+uint32_t os::Task::getTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                                 std::chrono::steady_clock::now().time_since_epoch())
+           .count();
+}
+
+void os::ThisTask::enterCriticalSection(void)
+{}
+
+void os::ThisTask::exitCriticalSection(void)
+{}
+
+extern "C" void DMA2_Stream2_IRQHandler(void);
+
+static SPI_InitTypeDef g_spiConfiguration;
+static size_t g_spiReconfigurations = 0;
+static bool g_spiEnabled = true;
+static bool g_spiInitWhileEnabled = false;
+
+extern "C" void SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState)
+{
+    g_spiEnabled = (NewState == ENABLE);
+}
+
+extern "C" void SPI_Init(SPI_TypeDef* SPIx, SPI_InitTypeDef const* const SPI_InitStruct)
+{
+    g_spiInitWhileEnabled |= g_spiEnabled;
+    g_spiConfiguration = *SPI_InitStruct;
+    g_spiReconfigurations++;
+}
+
+/// The rx stream clocked in the last byte of a segment and raises its interrupt
+static void finishSegment(void)
+{
+    DMA2_Stream2_IRQHandler();
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_ChipSelect(void)
+{
+    TestCaseBegin();
+
+    size_t done = 0;
+    const SpiWithDma::Segment segment {g_command, g_response, 2};
+    const auto before = g_spi.getTransactionStatistics();
+
+    g_chipSelect = true;
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {&g_chipSelect, SpiWithDma::Mode::CONFIGURED, &segment, 1,
+                                                 [&done] {
+        done++;
+    }}));
+    CHECK(!bool(g_chipSelect));
+    CHECK(g_rxDma.getCurrentDataCounter() == 2);
+    CHECK(done == 0);
+
+    finishSegment();
+    CHECK(bool(g_chipSelect));
+    CHECK(done == 1);
+    CHECK(g_rxDma.getCurrentDataCounter() == 0);
+    CHECK(g_spi.getTransactionStatistics().transactions == before.transactions + 1);
+
+    // Without a chip select the pin isn't touched
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::CONFIGURED, &segment, 1, nullptr}));
+    CHECK(bool(g_chipSelect));
+    finishSegment();
+    CHECK(bool(g_chipSelect));
+    CHECK(g_spi.waitUntilIdle(0));
+
+    // Invalid transactions are dropped
+    const SpiWithDma::Segment empty {g_command, nullptr, 0};
+    CHECK(!g_spi.enqueue(SpiWithDma::Transaction {&g_chipSelect, SpiWithDma::Mode::CONFIGURED, &empty, 1, nullptr}));
+    CHECK(!g_spi.enqueue(SpiWithDma::Transaction {&g_chipSelect, SpiWithDma::Mode::CONFIGURED, nullptr, 1, nullptr}));
+    CHECK(g_spi.getTransactionStatistics().dropped == before.dropped + 2);
+    CHECK(bool(g_chipSelect));
+
+    TestCaseEnd();
+}
+
+int ut_SegmentChaining(void)
+{
+    TestCaseBegin();
+
+    size_t firstDone = 0;
+    size_t secondDone = 0;
+    const SpiWithDma::Segment first[] = {{g_command, nullptr, 1},
+                                         {nullptr, g_response, 2},
+                                         {g_payload, nullptr, 5}};
+    const SpiWithDma::Segment second[] = {{g_command, g_response, 1}};
+    const auto before = g_spi.getTransactionStatistics();
+
+    g_chipSelect = true;
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {&g_chipSelect, SpiWithDma::Mode::CONFIGURED, first, 3,
+                                                 [&firstDone] {
+        firstDone++;
+    }}));
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::CONFIGURED, second, 1,
+                                                 [&secondDone] {
+        secondDone++;
+    }}));
+    CHECK(g_spi.getTransactionStatistics().maxDepth >= 2);
+    CHECK(g_rxDma.getCurrentDataCounter() == 1);
+
+    // The segments follow each other with chip select held low
+    finishSegment();
+    CHECK(g_rxDma.getCurrentDataCounter() == 2);
+    CHECK(!bool(g_chipSelect));
+    finishSegment();
+    CHECK(g_rxDma.getCurrentDataCounter() == 5);
+    CHECK(!bool(g_chipSelect));
+    CHECK(firstDone == 0);
+
+    // The interrupt releases chip select and starts the next transaction
+    finishSegment();
+    CHECK(bool(g_chipSelect));
+    CHECK(firstDone == 1);
+    CHECK(secondDone == 0);
+    CHECK(g_rxDma.getCurrentDataCounter() == 1);
+
+    finishSegment();
+    CHECK(secondDone == 1);
+    CHECK(g_rxDma.getCurrentDataCounter() == 0);
+    CHECK(g_spi.getTransactionStatistics().segments == before.segments + 4);
+    CHECK(g_spi.getTransactionStatistics().transactions == before.transactions + 2);
+
+    // A late interrupt doesn't complete anything
+    finishSegment();
+    CHECK(g_spi.getTransactionStatistics().segments == before.segments + 4);
+
+    TestCaseEnd();
+}
+
+int ut_QueueFull(void)
+{
+    TestCaseBegin();
+
+    const SpiWithDma::Segment segment {g_command, nullptr, 1};
+    const SpiWithDma::Transaction transaction {nullptr, SpiWithDma::Mode::CONFIGURED, &segment, 1, nullptr};
+    const auto before = g_spi.getTransactionStatistics();
+
+    for (size_t i = 0; i < SpiWithDma::TRANSACTION_QUEUE_SIZE; i++) {
+        CHECK(g_spi.enqueue(transaction));
+    }
+    CHECK(!g_spi.enqueue(transaction));
+    CHECK(g_spi.getTransactionStatistics().dropped == before.dropped + 1);
+    CHECK(g_spi.getTransactionStatistics().maxDepth == SpiWithDma::TRANSACTION_QUEUE_SIZE);
+
+    // Every completed transaction frees a slot
+    finishSegment();
+    CHECK(g_spi.enqueue(transaction));
+
+    for (size_t i = 0; i < SpiWithDma::TRANSACTION_QUEUE_SIZE; i++) {
+        finishSegment();
+    }
+    CHECK(g_spi.waitUntilIdle(0));
+    CHECK(g_spi.getTransactionStatistics().transactions ==
+          before.transactions + SpiWithDma::TRANSACTION_QUEUE_SIZE + 1);
+
+    TestCaseEnd();
+}
+
+int ut_Mode(void)
+{
+    TestCaseBegin();
+
+    const SpiWithDma::Segment segment {g_command, g_response, 2};
+    const size_t before = g_spiReconfigurations;
+
+    // The configuration runs in mode 3 already
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::MODE3, &segment, 1, nullptr}));
+    finishSegment();
+    CHECK(g_spiReconfigurations == before);
+
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::MODE0, &segment, 1, nullptr}));
+    CHECK(g_spiReconfigurations == before + 1);
+    CHECK(g_spiConfiguration.SPI_CPOL == SPI_CPOL_Low);
+    CHECK(g_spiConfiguration.SPI_CPHA == SPI_CPHA_1Edge);
+    CHECK(g_spiConfiguration.SPI_BaudRatePrescaler == SPI_BaudRatePrescaler_16);
+    CHECK(g_spiEnabled);
+    finishSegment();
+
+    // Back to back transactions in the same mode keep the peripheral running
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::MODE0, &segment, 1, nullptr}));
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::CONFIGURED, &segment, 1, nullptr}));
+    CHECK(g_spiReconfigurations == before + 1);
+
+    // The next transaction is started from the interrupt in its own mode
+    finishSegment();
+    CHECK(g_spiReconfigurations == before + 2);
+    CHECK(g_spiConfiguration.SPI_CPOL == SPI_CPOL_High);
+    CHECK(g_spiConfiguration.SPI_CPHA == SPI_CPHA_2Edge);
+    CHECK(g_spiEnabled);
+    finishSegment();
+
+    // CPOL and CPHA only change while the peripheral is disabled
+    CHECK(!g_spiInitWhileEnabled);
+    CHECK(g_spi.waitUntilIdle(0));
+
+    TestCaseEnd();
+}
+
+int ut_WaitUntilIdleTimeout(void)
+{
+    TestCaseBegin();
+
+    const SpiWithDma::Segment segment {g_command, g_response, 2};
+    std::atomic<bool> idle(false);
+
+    CHECK(g_spi.enqueue(SpiWithDma::Transaction {nullptr, SpiWithDma::Mode::CONFIGURED, &segment, 1, nullptr}));
+    CHECK(!g_spi.waitUntilIdle(5));
+
+    std::thread waiter([&idle] {
+        idle = g_spi.waitUntilIdle();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // The other task holds the wait mutex, a timeout must not release it
+    CHECK(!g_spi.waitUntilIdle(5));
+    CHECK(!g_spi.waitUntilIdle(5));
+    CHECK(!idle);
+
+    finishSegment();
+    waiter.join();
+    CHECK(idle);
+    CHECK(g_spi.waitUntilIdle(5));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    hal::initFactory<hal::Factory<SpiWithDma> >();
+
+    UnitTestMainBegin();
+    RunTest(true, ut_ChipSelect);
+    RunTest(true, ut_SegmentChaining);
+    RunTest(true, ut_QueueFull);
+    RunTest(true, ut_Mode);
+    RunTest(true, ut_WaitUntilIdleTimeout);
+    UnitTestMainEnd();
+}
@@ -110,6 +110,7 @@ private:
     friend struct PhaseCurrentSensor;
     friend class TimInterrupt;
     friend class TimInputCapture;
+    friend class SoftwareSpi;
 };
 
 template<>
@@ -53,7 +53,7 @@ void hal::TimInterrupt::disable(void) const
 }
 
 void hal::TimInterrupt::registerInterruptCallback(
-                                                  std::function<void(void)> function) const
+                                                  utility::Delegate<void(void)> function) const
 {
     mNvic.registerInterruptCallback(function);
 }
@@ -35,7 +35,7 @@ public:
 
     void enable(void) const;
     void disable(void) const;
-    void registerInterruptCallback(std::function<void(void)> ) const;
+    void registerInterruptCallback(utility::Delegate<void(void)> ) const;
     void unregisterInterruptCallback(void) const;
     void handleInterrupt(void) const;
 
@@ -34,9 +34,12 @@ void Usart::initialize() const
     mNvic.setPriority(0xf);
 
     mNvic.registerGetInterruptStatusProcedure([this](void) -> bool {
-        return USART_GetITStatus(reinterpret_cast<USART_TypeDef*>(this->
-                                                                  mPeripherie),
-                                 USART_IT_RXNE) == SET;
+        return (USART_GetITStatus(reinterpret_cast<USART_TypeDef*>(this->
+                                                                   mPeripherie),
+                                  USART_IT_RXNE) == SET) ||
+               (USART_GetITStatus(reinterpret_cast<USART_TypeDef*>(this->
+                                                                   mPeripherie),
+                                  USART_IT_IDLE) == SET);
     });
 
     mNvic.registerClearInterruptProcedure([this](void) -> void {
@@ -46,12 +49,20 @@ void Usart::initialize() const
     });
 
     mNvic.registerInterruptCallback([this](void) -> void {
-        uint8_t databyte =
-            static_cast<uint8_t>(USART_ReceiveData(reinterpret_cast<USART_TypeDef*>(
-                                                                                    this
-                                                                                    ->
-                                                                                    mPeripherie)));
-        Usart::ReceiveInterruptCallbacks[this->mDescription](databyte);
+        USART_TypeDef* const usart = reinterpret_cast<USART_TypeDef*>(this->mPeripherie);
+
+        if (USART_GetITStatus(usart, USART_IT_RXNE) == SET) {
+            uint8_t databyte = static_cast<uint8_t>(USART_ReceiveData(usart));
+            Usart::ReceiveInterruptCallbacks[this->mDescription](databyte);
+        }
+
+        if (USART_GetITStatus(usart, USART_IT_IDLE) == SET) {
+            // Reading the data register clears the flag, the DMA already moved the data
+            USART_ReceiveData(usart);
+            if (Usart::IdleInterruptCallbacks[this->mDescription]) {
+                Usart::IdleInterruptCallbacks[this->mDescription]();
+            }
+        }
     });
 
     mNvic.enable();
@@ -93,7 +104,7 @@ void Usart::setBaudRate(const size_t baudRate) const
     USART_Cmd(reinterpret_cast<USART_TypeDef*>(mPeripherie), ENABLE);
 }
 
-void Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const
+void Usart::enableNonBlockingReceive(utility::Delegate<void(uint8_t)> callback) const
 {
     ReceiveInterruptCallbacks[mDescription] = callback;
 
@@ -108,6 +119,23 @@ void Usart::disableNonBlockingReceive(void) const
     USART_ITConfig(reinterpret_cast<USART_TypeDef*>(mPeripherie), USART_IT_RXNE, DISABLE);
 }
 
+void Usart::enableIdleLineInterrupt(utility::Delegate<void(void)> callback) const
+{
+    IdleInterruptCallbacks[mDescription] = callback;
+
+    // The flag is cleared by reading the status register followed by the data register
+    USART_GetFlagStatus(reinterpret_cast<USART_TypeDef*>(mPeripherie), USART_FLAG_IDLE);
+    USART_ReceiveData(reinterpret_cast<USART_TypeDef*>(mPeripherie));
+    USART_ITConfig(reinterpret_cast<USART_TypeDef*>(mPeripherie), USART_IT_IDLE, ENABLE);
+}
+
+void Usart::disableIdleLineInterrupt(void) const
+{
+    USART_ITConfig(reinterpret_cast<USART_TypeDef*>(mPeripherie), USART_IT_IDLE, DISABLE);
+
+    IdleInterruptCallbacks[mDescription] = nullptr;
+}
+
 void Usart::send(const uint16_t data) const
 {
     USART_SendData(reinterpret_cast<USART_TypeDef*>(mPeripherie), data);
@@ -251,6 +279,7 @@ void Usart::clearParityError(void) const
 }
 
 Usart::ReceiveCallbackArray Usart::ReceiveInterruptCallbacks;
+Usart::IdleCallbackArray Usart::IdleInterruptCallbacks;
 
 constexpr const std::array<const Usart, Usart::__ENUM__SIZE> Factory<Usart>::Container;
 constexpr const std::array<const uint32_t, Usart::__ENUM__SIZE> Factory<Usart>::Clocks;
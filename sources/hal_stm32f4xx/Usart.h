@@ -19,7 +19,7 @@
 #include <cstdint>
 #include <limits>
 #include <array>
-#include <functional>
+#include "delegate.h"
 #include "stm32f4xx_usart.h"
 #include "stm32f4xx_rcc.h"
 #include "hal_Factory.h"
@@ -86,10 +86,15 @@ struct Usart {
 
     void setBaudRate(const size_t) const;
 
-    void enableNonBlockingReceive(std::function<void(uint8_t)> callback) const;
+    void enableNonBlockingReceive(utility::Delegate<void(uint8_t)> callback) const;
 
     void disableNonBlockingReceive(void) const;
 
+    /// callback is called from the interrupt when the line gets idle after receiving
+    void enableIdleLineInterrupt(utility::Delegate<void(void)> callback) const;
+
+    void disableIdleLineInterrupt(void) const;
+
 private:
     constexpr Usart(const enum Description&  desc,
                     const uint32_t&          peripherie,
@@ -107,10 +112,14 @@ private:
 
     void initialize(void) const;
 
-    using ReceiveCallbackArray = std::array<std::function<void (uint8_t)>, Usart::__ENUM__SIZE>;
+    using ReceiveCallbackArray = std::array<utility::Delegate<void (uint8_t)>, Usart::__ENUM__SIZE>;
 
     static ReceiveCallbackArray ReceiveInterruptCallbacks;
 
+    using IdleCallbackArray = std::array<utility::Delegate<void (void)>, Usart::__ENUM__SIZE>;
+
+    static IdleCallbackArray IdleInterruptCallbacks;
+
     friend class Factory<Usart>;
     friend struct UsartWithDma;
 };
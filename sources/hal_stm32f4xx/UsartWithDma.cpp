@@ -13,7 +13,9 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <algorithm>
 #include "UsartWithDma.h"
+#include "os_Task.h"
 #include "trace.h"
 
 static const int __attribute__((unused)) g_DebugZones = 0;//ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
@@ -25,6 +27,7 @@ using hal::UsartWithDma;
 
 std::array<os::Semaphore, Usart::__ENUM__SIZE> UsartWithDma::DmaTransferCompleteSemaphores;
 std::array<os::Semaphore, Usart::__ENUM__SIZE> UsartWithDma::DmaReceiveCompleteSemaphores;
+std::array<UsartWithDma::CircularReceive, Usart::__ENUM__SIZE> UsartWithDma::CircularReceives;
 
 void UsartWithDma::initialize() const
 {
@@ -59,14 +62,14 @@ void UsartWithDma::registerInterruptSemaphores(void) const
     }
 }
 
-void UsartWithDma::registerTransferCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerTransferCompleteCallback(utility::Delegate<void(void)> f) const
 {
     if (mTxDma != nullptr) {
         mTxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
     }
 }
 
-void UsartWithDma::registerReceiveCompleteCallback(std::function<void(void)> f) const
+void UsartWithDma::registerReceiveCompleteCallback(utility::Delegate<void(void)> f) const
 {
     if (mRxDma != nullptr) {
         mRxDma->registerInterruptCallback(f, Dma::InterruptSource::TC);
@@ -222,6 +225,140 @@ void UsartWithDma::stopNonBlockingReceive(void) const
     }
 }
 
+size_t UsartWithDma::getRemainingNonBlockingReceive(void) const
+{
+    if (mRxDma != nullptr) {
+        return mRxDma->getCurrentDataCounter();
+    }
+    return 0;
+}
+
+void UsartWithDma::startCircularReceive(uint8_t* const                data, const size_t length,
+                                        utility::Delegate<void(void)> callback) const
+{
+    if ((data == nullptr) || (length == 0) || (mRxDma == nullptr) || !(mDmaCmd & USART_DMAReq_Rx)) {
+        return;
+    }
+
+    CircularReceive& rx = CircularReceives.at(mUsart.mDescription);
+    mRxDma->disable();
+    rx.data = data;
+    rx.length = length;
+    rx.written = 0;
+    rx.read = 0;
+    rx.overruns = 0;
+    rx.callback = callback;
+    DmaReceiveCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(0));
+
+    mRxDma->registerInterruptCallback([this] {
+        circularReceiveInterrupt();
+    }, Dma::InterruptSource::TC);
+    if (!mRxDma->registerInterruptCallback([this] {
+        circularReceiveInterrupt();
+    }, Dma::InterruptSource::HT))
+    {
+        Trace(ZONE_WARNING, "No half transfer interrupt, data is published late\r\n");
+    }
+    mUsart.enableIdleLineInterrupt([this] {
+        circularReceiveInterrupt();
+    });
+
+    if (mUsart.hasOverRunError()) {
+        mUsart.clearOverRunError();
+    }
+    mRxDma->setupTransfer(data, length, true);
+    mRxDma->enable();
+}
+
+void UsartWithDma::stopCircularReceive(void) const
+{
+    if (mRxDma == nullptr) {
+        return;
+    }
+
+    mRxDma->disable();
+    mUsart.disableIdleLineInterrupt();
+    mRxDma->unregisterInterruptCallback(Dma::InterruptSource::TC);
+    mRxDma->unregisterInterruptCallback(Dma::InterruptSource::HT);
+    CircularReceives.at(mUsart.mDescription).data = nullptr;
+}
+
+void UsartWithDma::circularReceiveInterrupt(void) const
+{
+    CircularReceive& rx = CircularReceives[mUsart.mDescription];
+
+    if (rx.data == nullptr) {
+        return;
+    }
+
+    // The USART and the DMA interrupt may preempt each other
+    const uint32_t savedInterruptStatus = os::ThisTask::enterCriticalSectionFromISR();
+    const size_t position = (rx.length - mRxDma->getCurrentDataCounter()) % rx.length;
+    const size_t lap = (rx.written >= rx.length) ? rx.length : 0;
+    size_t written = lap + position;
+
+    // Each half of the ring raises an interrupt, so the DMA wrapped at most once
+    if (written < rx.written) {
+        written = (lap + rx.length) % (2 * rx.length) + position;
+    }
+    rx.written = written;
+    os::ThisTask::exitCriticalSectionFromISR(savedInterruptStatus);
+
+    DmaReceiveCompleteSemaphores[mUsart.mDescription].giveFromISR();
+    if (rx.callback) {
+        rx.callback();
+    }
+}
+
+size_t UsartWithDma::getReceivedData(uint8_t const*& data) const
+{
+    CircularReceive& rx = CircularReceives.at(mUsart.mDescription);
+
+    if (rx.data == nullptr) {
+        return 0;
+    }
+
+    const size_t written = rx.written;
+    size_t available = (written + 2 * rx.length - rx.read) % (2 * rx.length);
+
+    if (available > rx.length) {
+        Trace(ZONE_WARNING, "Receive overrun, %d bytes dropped\r\n", available);
+        rx.overruns++;
+        rx.read = written;
+        available = 0;
+    }
+
+    const size_t offset = rx.read % rx.length;
+    data = rx.data + offset;
+    return std::min(available, rx.length - offset);
+}
+
+size_t UsartWithDma::waitForReceivedData(uint8_t const*& data, const uint32_t ticksToWait) const
+{
+    const size_t length = getReceivedData(data);
+
+    if ((length == 0) &&
+        DmaReceiveCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(ticksToWait)))
+    {
+        return getReceivedData(data);
+    }
+    return length;
+}
+
+void UsartWithDma::consumeReceivedData(const size_t length) const
+{
+    CircularReceive& rx = CircularReceives.at(mUsart.mDescription);
+
+    if (rx.length > 0) {
+        rx.read = (rx.read + length) % (2 * rx.length);
+    }
+}
+
+size_t UsartWithDma::getReceiveOverruns(void) const
+{
+    return CircularReceives.at(mUsart.mDescription).overruns;
+}
+
 bool UsartWithDma::isReadyToReceive(void) const
 {
     return mUsart.isReadyToReceive();
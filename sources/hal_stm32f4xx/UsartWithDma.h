@@ -66,8 +66,34 @@ struct UsartWithDma {
     void stopNonBlockingSend(void) const;
     void stopNonBlockingReceive(void) const;
 
-    void registerTransferCompleteCallback(std::function<void(void)> ) const;
-    void registerReceiveCompleteCallback(std::function<void(void)> ) const;
+    /// @return bytes the running receiveNonBlocking() writes until it completes or wraps around
+    size_t getRemainingNonBlockingReceive(void) const;
+
+    /**
+     * Receives continuously into the ring buffer data. The half and full
+     * transfer interrupts of the DMA and the idle line interrupt of the USART
+     * publish the received bytes and call callback. Replaces the callback of
+     * registerReceiveCompleteCallback() until stopCircularReceive().
+     */
+    void startCircularReceive(uint8_t* const                data, const size_t length,
+                              utility::Delegate<void(void)> callback = nullptr) const;
+    void stopCircularReceive(void) const;
+
+    /**
+     * Received bytes are read in place from the ring buffer.
+     * @param data set to the oldest byte that isn't consumed
+     * @return number of contiguous bytes at data, bytes behind the wrap around
+     *         are returned after consuming these
+     */
+    size_t getReceivedData(uint8_t const*& data) const;
+    /// Like getReceivedData(), blocks until new data is published if there is none
+    size_t waitForReceivedData(uint8_t const*& data, const uint32_t ticksToWait = portMAX_DELAY) const;
+    void consumeReceivedData(const size_t length) const;
+    /// @return how often unread data was overwritten, it is dropped then
+    size_t getReceiveOverruns(void) const;
+
+    void registerTransferCompleteCallback(utility::Delegate<void(void)> ) const;
+    void registerReceiveCompleteCallback(utility::Delegate<void(void)> ) const;
 
     bool isReadyToReceive(void) const;
     bool isReadyToSend(void) const;
@@ -97,10 +123,22 @@ private:
     void initialize(void) const;
     void registerInterruptSemaphores(void) const;
     void receiveTimeoutCallback(void) const;
+    void circularReceiveInterrupt(void) const;
+
+    struct CircularReceive {
+        uint8_t* data = nullptr;
+        size_t length = 0;
+        // Positions count up to twice the length, to tell a full from an empty ring
+        volatile size_t written = 0;
+        size_t read = 0;
+        size_t overruns = 0;
+        utility::Delegate<void(void)> callback;
+    };
 
     static constexpr const size_t MIN_LENGTH_FOR_DMA_TRANSFER = 0;
     static std::array<os::Semaphore, Usart::__ENUM__SIZE> DmaTransferCompleteSemaphores;
     static std::array<os::Semaphore, Usart::__ENUM__SIZE> DmaReceiveCompleteSemaphores;
+    static std::array<CircularReceive, Usart::__ENUM__SIZE> CircularReceives;
 
     friend class Factory<UsartWithDma>;
     friend struct Dma;
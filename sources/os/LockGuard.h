@@ -25,7 +25,8 @@ public:
 
     ~LockGuard()
     {
-        if (mLock) {
+        // After a timeout the lock belongs to another task
+        if (mLock && mLockObtained) {
             mLock.give();
         }
     }
@@ -17,6 +17,7 @@
 /// You should have received a copy of the GNU General Public License along with this program.
 /// If not, see <https://www.gnu.org/licenses/>.
 #include "unittest.h"
+#include <atomic>
 
 #include "os_Task.h"
 #include "Semaphore.h"
@@ -261,6 +262,41 @@ int ut_SemaphoreMockTimeout(void)
     TestCaseEnd();
 }
 
+int ut_LockGuardTimeout(void)
+{
+    TestCaseBegin();
+
+    const os::Mutex mutex;
+    std::atomic<bool> released(false);
+
+    os::Task holder("holder", 42, os::Task::Priority::MEDIUM, [&](const bool& join){
+                    os::LockGuard<os::Mutex> lock(mutex);
+                    while (!released) {
+                        os::ThisTask::sleep(std::chrono::milliseconds(1));
+                    }
+        });
+
+    os::ThisTask::sleep(std::chrono::milliseconds(10));
+    {
+        os::LockGuard<os::Mutex> lock(mutex, 5);
+        CHECK(!lock);
+    }
+
+    // Still held by the other task
+    CHECK(!mutex.take(0));
+    released = true;
+    os::ThisTask::sleep(std::chrono::milliseconds(10));
+
+    {
+        os::LockGuard<os::Mutex> lock(mutex, 5);
+        CHECK(lock);
+    }
+    CHECK(mutex.take(0));
+    mutex.give();
+
+    TestCaseEnd();
+}
+
 int main(int argc, char** argv)
 {
     UnitTestMainBegin();
@@ -272,6 +308,7 @@ int main(int argc, char** argv)
     RunTest(true, ut_TaskInterruptableMockStartStop);
     RunTest(true, ut_TaskInterruptableMockDetach);
     RunTest(true, ut_SemaphoreMockTimeout);
+    RunTest(true, ut_LockGuardTimeout);
 
     UnitTestMainEnd();
 }
@@ -69,6 +69,16 @@ bool Semaphore::give(void) const
     return false;
 }
 
+bool Semaphore::takeFromISR(void) const
+{
+    return take(0);
+}
+
+bool Semaphore::giveFromISR(void) const
+{
+    return give();
+}
+
 Semaphore::operator bool() const
 {
     return mSemaphoreHandle != nullptr;
@@ -32,6 +32,8 @@ using os::Task;
 
 bool Task::schedulerRunning = false;
 
+static void (* g_TickHook)(void) = nullptr;
+
 Task::Task(char const* const                      name,
            const uint16_t                         stackSize,
            const os::Task::Priority               priority,
@@ -154,6 +156,11 @@ uint32_t Task::getTickCountFromISR(void)
     return xTaskGetTickCountFromISR();
 }
 
+void Task::setTickHook(void (* hook)(void))
+{
+    g_TickHook = hook;
+}
+
 uint32_t Task::calcTimeInterval(const uint32_t& before, const uint32_t& after)
 {
     // Unsigned operation with underflow defined behavior in standard C++17 (6.9.1.4).
@@ -222,7 +229,22 @@ void os::ThisTask::exitCriticalSection(void)
     taskEXIT_CRITICAL();
 }
 
-extern "C" void vApplicationTickHook(void) {}
+uint32_t os::ThisTask::enterCriticalSectionFromISR(void)
+{
+    return taskENTER_CRITICAL_FROM_ISR();
+}
+
+void os::ThisTask::exitCriticalSectionFromISR(const uint32_t savedInterruptStatus)
+{
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+}
+
+extern "C" void vApplicationTickHook(void)
+{
+    if (g_TickHook != nullptr) {
+        g_TickHook();
+    }
+}
 
 /*-----------------------------------------------------------*/
 extern "C" void vApplicationMallocFailedHook(void)
@@ -73,6 +73,12 @@ public:
 
     static uint32_t calcTimeInterval(const uint32_t& before, const uint32_t& after);
 
+    /**
+     * Installs a function called from the tick interrupt on every system tick.
+     * It has to be interrupt safe and short.
+     */
+    static void setTickHook(void (* hook)(void));
+
     /// @return True if timestamp a is after timestamp b.
     static uint32_t isTimeStampAfter(const uint32_t& a, const uint32_t& b);
 
@@ -92,6 +98,8 @@ struct ThisTask {
 
     static void enterCriticalSection(void);
     static void exitCriticalSection(void);
+    static uint32_t enterCriticalSectionFromISR(void);
+    static void exitCriticalSectionFromISR(const uint32_t savedInterruptStatus);
 
     static char* getName(void);
 };
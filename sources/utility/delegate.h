@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utility
+{
+template<typename Signature, size_t capacity = 3 * sizeof(void*)>
+class Delegate;
+
+/**
+ * Callback for interrupt service routines. Unlike std::function it never
+ * allocates: the callable is stored inline and has to be trivially copyable,
+ * e.g. a function pointer or a lambda capturing a few pointers or references.
+ * A call is one indirect call of a thunk that knows the type of the callable.
+ *
+ * Registering a callable that doesn't fit fails to compile, capture a pointer
+ * to a struct instead of many references then.
+ *
+ * @tparam capacity bytes available for the captures of a lambda
+ */
+template<typename R, typename ... Args, size_t capacity>
+class Delegate<R(Args ...), capacity>
+{
+    using Invoker = R (*)(void*, Args ...);
+
+    alignas(void*) mutable unsigned char mStorage[capacity];
+    Invoker mInvoker = nullptr;
+
+    template<typename F>
+    static R invoke(void* storage, Args ... args)
+    {
+        return (*reinterpret_cast<F*>(storage))(std::forward<Args>(args) ...);
+    }
+
+public:
+    constexpr Delegate(void) : mStorage {} {}
+    constexpr Delegate(std::nullptr_t) : mStorage {} {}
+
+    template<typename F,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Delegate>::value> >
+    Delegate(F&& f)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(sizeof(Callable) <= capacity, "Callable too large for Delegate, capture less");
+        static_assert(alignof(Callable) <= alignof(void*), "Callable alignment not supported by Delegate");
+        static_assert(std::is_trivially_copyable<Callable>::value,
+                      "Delegate needs a trivially copyable callable, capture pointers or references");
+
+        new (mStorage) Callable(std::forward<F>(f));
+        mInvoker = &invoke<Callable>;
+    }
+
+    Delegate(const Delegate&) = default;
+    Delegate& operator=(const Delegate&) = default;
+
+    inline R operator()(Args ... args) const
+    {
+        return mInvoker(mStorage, std::forward<Args>(args) ...);
+    }
+
+    inline explicit operator bool(void) const
+    {
+        return mInvoker != nullptr;
+    }
+
+    inline bool operator==(std::nullptr_t) const
+    {
+        return mInvoker == nullptr;
+    }
+
+    inline bool operator!=(std::nullptr_t) const
+    {
+        return mInvoker != nullptr;
+    }
+};
+}
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <array>
+#include <chrono>
+#include <functional>
+
+#include "unittest.h"
+#include "delegate.h"
+
+static constexpr size_t NUM_BENCHMARK_LOOPS = 10000000;
+
+//--------------------------BUFFERS--------------------------
+static uint32_t g_calls = 0;
+
+//--------------------------MOCKING--------------------------
+static void countCall(void)
+{
+    g_calls++;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Call(void)
+{
+    TestCaseBegin();
+
+    utility::Delegate<void(void)> empty;
+    CHECK(!empty);
+    CHECK(empty == nullptr);
+
+    g_calls = 0;
+    utility::Delegate<void(void)> function = &countCall;
+    CHECK(function != nullptr);
+    function();
+    CHECK(g_calls == 1);
+
+    uint32_t sum = 0;
+    utility::Delegate<void(uint32_t)> lambda = [&sum](uint32_t value) {
+        sum += value;
+    };
+    lambda(3);
+    lambda(4);
+    CHECK(sum == 7);
+
+    utility::Delegate<bool(uint8_t, uint8_t)> result = [](uint8_t a, uint8_t b) {
+        return a > b;
+    };
+    CHECK(result(2, 1));
+    CHECK(!result(1, 2));
+
+    TestCaseEnd();
+}
+
+int ut_CopyAndReset(void)
+{
+    TestCaseBegin();
+
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+    // The largest callable the default capacity holds
+    utility::Delegate<void(void)> original = [&a, &b, &c] {
+        a++;
+        b += 2;
+        c += 3;
+    };
+
+    const utility::Delegate<void(void)> copy = original;
+    original = nullptr;
+    CHECK(!original);
+
+    copy();
+    CHECK(a == 1);
+    CHECK(b == 2);
+    CHECK(c == 3);
+
+    std::array<utility::Delegate<void(void)>, 2> table;
+    table[1] = copy;
+    CHECK(!table[0]);
+    table[1]();
+    CHECK(c == 6);
+
+    TestCaseEnd();
+}
+
+int ut_DispatchCost(void)
+{
+    TestCaseBegin();
+
+    volatile uint32_t counter = 0;
+    const auto callback = [&counter] {
+        counter = counter + 1;
+    };
+
+    const std::function<void(void)> function = callback;
+    const utility::Delegate<void(void)> delegate = callback;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        function();
+    }
+    const auto functionElapsed = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        delegate();
+    }
+    const auto delegateElapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(counter == 2 * NUM_BENCHMARK_LOOPS);
+
+    using Nanoseconds = std::chrono::duration<double, std::nano>;
+    printf("Dispatch per call: std::function %.2f ns, Delegate %.2f ns\n",
+           Nanoseconds(functionElapsed).count() / NUM_BENCHMARK_LOOPS,
+           Nanoseconds(delegateElapsed).count() / NUM_BENCHMARK_LOOPS);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Call);
+    RunTest(true, ut_CopyAndReset);
+    RunTest(true, ut_DispatchCost);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utility
+{
+/**
+ * First order IIR low pass y += (x - y) / width in fixed point, for
+ * interrupt service routines without float divisions. The coefficient is
+ * a Q15 value computed at compile time, the state keeps fractionBits below
+ * the input LSB. An update is one subtraction, one 32x32->64 multiplication
+ * and one shift, independent of the input.
+ *
+ * @tparam width       filter width of the float reference
+ * @tparam fractionBits fractional bits of the state, inputs have to fit into
+ *                     31 - fractionBits bits
+ */
+template<uint32_t width, size_t fractionBits = 16>
+class FixedPointLowPass
+{
+public:
+    static constexpr int32_t ONE = 1L << fractionBits;
+    static constexpr int32_t ALPHA_Q15 = static_cast<int32_t>(((1UL << 15) + width / 2) / width);
+
+    static_assert(width > 0, "Filter width has to be positive");
+    static_assert(ALPHA_Q15 > 0, "Filter width too large for a Q15 coefficient");
+    static_assert(fractionBits < 31, "No bits left for the input");
+
+    constexpr FixedPointLowPass(const int32_t initial = 0) : mState(initial * ONE) {}
+
+    inline void update(const int32_t sample)
+    {
+        mState = step(mState, sample);
+    }
+
+    /// Filters a block, the state is written once at the end
+    inline void update(uint16_t const* const samples, const size_t length)
+    {
+        int32_t state = mState;
+        for (size_t i = 0; i < length; i++) {
+            state = step(state, samples[i]);
+        }
+        mState = state;
+    }
+
+    /// Filtered value with fractionBits fractional bits
+    inline int32_t getRaw(void) const
+    {
+        return mState;
+    }
+
+    inline void setRaw(const int32_t value)
+    {
+        mState = value;
+    }
+
+    inline float get(void) const
+    {
+        return static_cast<float>(mState) * (1.0f / ONE);
+    }
+
+private:
+    static inline int32_t step(const int32_t state, const int32_t sample)
+    {
+        const int64_t error = static_cast<int64_t>(sample) * ONE - state;
+        return state + static_cast<int32_t>((error * ALPHA_Q15) >> 15);
+    }
+
+    int32_t mState;
+};
+}
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+#include "unittest.h"
+#include "fixedPointFilter.h"
+
+static constexpr float FILTERWIDTH = 128;
+static constexpr size_t NUM_SAMPLES = 4096;
+static constexpr size_t NUM_BENCHMARK_LOOPS = 2000;
+
+using Filter = utility::FixedPointLowPass<static_cast<uint32_t>(FILTERWIDTH)>;
+
+//--------------------------BUFFERS--------------------------
+static std::array<uint16_t, NUM_SAMPLES> g_samples;
+
+//--------------------------MOCKING--------------------------
+/// 12 bit ADC values, noisy around a slowly moving offset
+static void generateSamples(void)
+{
+    uint32_t lfsr = 0xACE1u;
+    for (size_t i = 0; i < g_samples.size(); i++) {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        const int32_t noise = static_cast<int32_t>((lfsr >> 16) & 0x1ff) - 0x100;
+        const int32_t base = 2000 + static_cast<int32_t>(i % 1024) - 512;
+        g_samples[i] = static_cast<uint16_t>(std::min(4095, std::max(0, base + noise)));
+    }
+}
+
+/// The float filter PhaseCurrentSensor used before
+static float referenceUpdate(float value, uint16_t const* const samples, const size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        value -= value / FILTERWIDTH;
+        value += static_cast<float>(samples[i]) / FILTERWIDTH;
+    }
+    return value;
+}
+
+/// Rounding errors of the float filter itself reach 0.01 digits near full scale
+static double exactUpdate(double value, uint16_t const* const samples, const size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        value += (samples[i] - value) / FILTERWIDTH;
+    }
+    return value;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_StepResponse(void)
+{
+    TestCaseBegin();
+
+    static const uint16_t FULL_SCALE = 4095;
+    Filter filter(0);
+    float reference = 0;
+    double exact = 0;
+
+    CHECK(filter.getRaw() == 0);
+
+    for (size_t i = 0; i < 2000; i++) {
+        filter.update(FULL_SCALE);
+        reference = referenceUpdate(reference, &FULL_SCALE, 1);
+        exact = exactUpdate(exact, &FULL_SCALE, 1);
+        CHECK(std::fabs(filter.get() - exact) < 0.005);
+        CHECK(std::fabs(filter.get() - reference) < 0.05f);
+    }
+
+    // Settles at the input, not one LSB below
+    CHECK(std::fabs(filter.get() - FULL_SCALE) < 0.01f);
+
+    Filter initialized(2000);
+    CHECK(initialized.getRaw() == 2000 * Filter::ONE);
+    initialized.update(2000);
+    CHECK(initialized.getRaw() == 2000 * Filter::ONE);
+
+    TestCaseEnd();
+}
+
+int ut_CompareWithFloat(void)
+{
+    TestCaseBegin();
+
+    generateSamples();
+
+    Filter filter(2000);
+    float reference = 2000;
+    double exact = 2000;
+    float maxError = 0;
+    double maxExactError = 0;
+
+    // In half buffers, like the DMA delivers them
+    for (size_t offset = 0; offset < g_samples.size(); offset += 64) {
+        filter.update(g_samples.data() + offset, 64);
+        reference = referenceUpdate(reference, g_samples.data() + offset, 64);
+        exact = exactUpdate(exact, g_samples.data() + offset, 64);
+        maxError = std::max(maxError, std::fabs(filter.get() - reference));
+        maxExactError = std::max(maxExactError, std::fabs(filter.get() - exact));
+    }
+
+    CHECK(maxExactError < 0.005);
+    CHECK(maxError < 0.05f);
+
+    Filter single(2000);
+    for (const auto sample : g_samples) {
+        single.update(sample);
+    }
+    CHECK(single.getRaw() == filter.getRaw());
+
+    printf("Max deviation: float filter %.5f digits, exact filter %.5f digits\n", maxError, maxExactError);
+
+    TestCaseEnd();
+}
+
+int ut_UpdateCost(void)
+{
+    TestCaseBegin();
+
+    generateSamples();
+
+    volatile float reference = 2000;
+    Filter filter(2000);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        reference = referenceUpdate(reference, g_samples.data(), g_samples.size());
+    }
+    const auto floatElapsed = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_BENCHMARK_LOOPS; i++) {
+        filter.update(g_samples.data(), g_samples.size());
+    }
+    const auto fixedPointElapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(std::fabs(filter.get() - reference) < 0.05f);
+
+    using Nanoseconds = std::chrono::duration<double, std::nano>;
+    printf("Filter per sample: float %.2f ns, fixed point %.2f ns\n",
+           Nanoseconds(floatElapsed).count() / (NUM_BENCHMARK_LOOPS * NUM_SAMPLES),
+           Nanoseconds(fixedPointElapsed).count() / (NUM_BENCHMARK_LOOPS * NUM_SAMPLES));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_StepResponse);
+    RunTest(true, ut_CompareWithFloat);
+    RunTest(true, ut_UpdateCost);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace utility
+{
+/**
+ * Lock-free single producer / single consumer ring buffer.
+ *
+ * The producer is typically an interrupt service routine, the consumer a task.
+ * Neither side ever disables interrupts or blocks. If the buffer is full, new
+ * elements are dropped and counted as overrun.
+ *
+ * @tparam T element type
+ * @tparam n number of elements, has to be a power of two
+ */
+template<typename T, size_t n>
+class RingBuffer
+{
+    static_assert(n >= 2 && (n & (n - 1)) == 0, "RingBuffer size has to be a power of two");
+
+    static constexpr size_t MASK = n - 1;
+
+    std::array<T, n> mBuffer;
+    std::atomic<size_t> mHead {0};
+    std::atomic<size_t> mTail {0};
+    std::atomic<uint32_t> mOverruns {0};
+
+public:
+    RingBuffer(void) = default;
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer(RingBuffer&&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    RingBuffer& operator=(RingBuffer&&) = delete;
+
+    /**
+     * Producer side. Returns a pointer to the next free slot, which can be
+     * filled in place. The element becomes visible to the consumer only after
+     * commitPush(). Returns nullptr and counts an overrun if the buffer is full.
+     */
+    T* beginPush(void)
+    {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) >= n) {
+            mOverruns.store(mOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &mBuffer[head & MASK];
+    }
+
+    void commitPush(void)
+    {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T& element)
+    {
+        T* const slot = beginPush();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = element;
+        commitPush();
+        return true;
+    }
+
+    /**
+     * Consumer side. Returns a pointer to the oldest element or nullptr if the
+     * buffer is empty. The slot is released with commitPop().
+     */
+    const T* front(void) const
+    {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (mHead.load(std::memory_order_acquire) == tail) {
+            return nullptr;
+        }
+        return &mBuffer[tail & MASK];
+    }
+
+    void commitPop(void)
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T& element)
+    {
+        const T* const slot = front();
+        if (slot == nullptr) {
+            return false;
+        }
+        element = *slot;
+        commitPop();
+        return true;
+    }
+
+    size_t size(void) const
+    {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty(void) const
+    {
+        return size() == 0;
+    }
+
+    bool isFull(void) const
+    {
+        return size() >= n;
+    }
+
+    uint32_t getOverrunCount(void) const
+    {
+        return mOverruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Drops all elements. Must only be called from the consumer side while
+     * the producer is inactive.
+     */
+    void reset(void)
+    {
+        mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+        mOverruns.store(0, std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity(void)
+    {
+        return n;
+    }
+};
+}
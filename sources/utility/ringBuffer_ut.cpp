@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2020 Nils Weiss
+ */
+
+#include <thread>
+#include <cstring>
+
+#include "unittest.h"
+#include "ringBuffer.h"
+
+#define NUM_TEST_LOOPS 255
+
+//--------------------------BUFFERS--------------------------
+
+//--------------------------MOCKING--------------------------
+
+//-------------------------TESTCASES-------------------------
+
+int ut_PushPop(void)
+{
+    TestCaseBegin();
+
+    utility::RingBuffer<uint32_t, 4> testee;
+    uint32_t value = 0;
+
+    CHECK(testee.isEmpty());
+    CHECK(!testee.pop(value));
+
+    CHECK(testee.push(1));
+    CHECK(testee.push(2));
+    CHECK(testee.size() == 2);
+
+    CHECK(testee.pop(value));
+    CHECK(value == 1);
+    CHECK(testee.pop(value));
+    CHECK(value == 2);
+    CHECK(testee.isEmpty());
+
+    TestCaseEnd();
+}
+
+int ut_Overrun(void)
+{
+    TestCaseBegin();
+
+    utility::RingBuffer<uint32_t, 4> testee;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK(testee.push(i));
+    }
+    CHECK(testee.isFull());
+    CHECK(!testee.push(4));
+    CHECK(!testee.push(5));
+    CHECK(testee.getOverrunCount() == 2);
+
+    uint32_t value = 0;
+    CHECK(testee.pop(value));
+    CHECK(value == 0);
+    CHECK(testee.push(6));
+
+    for (uint32_t expected : {1, 2, 3, 6}) {
+        CHECK(testee.pop(value));
+        CHECK(value == expected);
+    }
+
+    testee.reset();
+    CHECK(testee.getOverrunCount() == 0);
+
+    TestCaseEnd();
+}
+
+int ut_InPlace(void)
+{
+    TestCaseBegin();
+
+    utility::RingBuffer<uint32_t, 2> testee;
+
+    uint32_t* slot = testee.beginPush();
+    CHECK(slot != nullptr);
+    *slot = 0xdeadbeef;
+    CHECK(testee.isEmpty());
+    testee.commitPush();
+    CHECK(testee.size() == 1);
+
+    const uint32_t* front = testee.front();
+    CHECK(front != nullptr);
+    CHECK(*front == 0xdeadbeef);
+    testee.commitPop();
+    CHECK(testee.front() == nullptr);
+
+    TestCaseEnd();
+}
+
+int ut_ProducerConsumer(void)
+{
+    TestCaseBegin();
+
+    static utility::RingBuffer<uint32_t, 16> testee;
+    constexpr uint32_t NUM_ELEMENTS = 100000;
+
+    std::thread producer([] {
+        for (uint32_t i = 0; i < NUM_ELEMENTS; ) {
+            if (testee.push(i)) {
+                i++;
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    while (expected < NUM_ELEMENTS) {
+        uint32_t value;
+        if (testee.pop(value)) {
+            CHECK(value == expected);
+            expected++;
+        }
+    }
+    producer.join();
+
+    CHECK(testee.isEmpty());
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_PushPop);
+    RunTest(true, ut_Overrun);
+    RunTest(true, ut_InPlace);
+    RunTest(true, ut_ProducerConsumer);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0
+# Copyright (c) 2014-2020 Nils Weiss
+"""Converts the binary log of app::CanLogger into candump or pcap files.
+
+The format is described in sources/app/CanLogFormat.h.
+
+    canlog.py /dev/ttyUSB0 -o capture.pcap
+    canlog.py capture.bin --format candump
+"""
+
+import argparse
+import struct
+import sys
+
+BLOCK_MAGIC = 0x4c43
+BLOCK_HEADER = struct.Struct('<HHHHH')
+DELTA8, DELTA16, SYNC = 0, 1, 2
+SYNC_INTERVAL_MS = 32
+
+CAN_EFF_FLAG = 0x80000000
+CAN_RTR_FLAG = 0x40000000
+LINKTYPE_CAN_SOCKETCAN = 227
+
+
+class Frame:
+    def __init__(self, time_us, can_id, extended, remote, dlc, data):
+        self.time_us = time_us
+        self.can_id = can_id
+        self.extended = extended
+        self.remote = remote
+        self.dlc = dlc
+        self.data = data
+
+
+class Decoder:
+    """Mirrors app::CanLog::Decoder, keeps the bit timer time base across blocks"""
+
+    def __init__(self):
+        self.bitrate = 1
+        self.anchor_us = 0
+        self.bits = 0
+        self.last_sync_tick = 0
+        self.last_timer = 0
+        self.anchored = False
+
+    def decode_block(self, payload, bitrate):
+        """Yields the frames of one block, None marks a corrupt record"""
+        self.bitrate = (bitrate or 1) * 1000
+        block_synced = False
+        position = 0
+        while position < len(payload):
+            flags = payload[position]
+            record_type = flags >> 6
+            remote = bool(flags & 0x20)
+            extended = bool(flags & 0x10)
+            dlc = flags & 0x0f
+            time_length = {DELTA8: 1, DELTA16: 2, SYNC: 6}.get(record_type)
+            data_length = 0 if remote else min(dlc, 8)
+            id_length = 4 if extended else 2
+            length = 1 + (time_length or 0) + id_length + data_length
+            if time_length is None or position + length > len(payload) or \
+                    (record_type != SYNC and not block_synced):
+                yield None
+                return
+
+            field = payload[position + 1:position + 1 + time_length]
+            if record_type == SYNC:
+                tick, timer = struct.unpack('<IH', field)
+                elapsed = (tick - self.last_sync_tick) & 0xffffffff
+                if self.anchored and elapsed < SYNC_INTERVAL_MS * 4 and \
+                        (elapsed + 1) * self.bitrate // 1000 < 0x10000:
+                    self.bits += (timer - self.last_timer) & 0xffff
+                else:
+                    self.anchor_us = tick * 1000
+                    self.bits = 0
+                    self.anchored = True
+                self.last_sync_tick = tick
+                self.last_timer = timer
+                block_synced = True
+            else:
+                delta = int.from_bytes(field, 'little')
+                self.bits += delta
+                self.last_timer = (self.last_timer + delta) & 0xffff
+            offset = position + 1 + time_length
+            can_id = int.from_bytes(payload[offset:offset + id_length], 'little')
+            data = payload[offset + id_length:offset + id_length + data_length]
+            yield Frame(self.anchor_us + self.bits * 1000000 // self.bitrate, can_id, extended, remote, dlc, data)
+            position += length
+
+
+def read_blocks(stream, statistics):
+    """Yields (header, payload) of all blocks, resynchronizing on the magic"""
+    buffer = bytearray()
+    expected_sequence = None
+    while True:
+        chunk = stream.read(4096)
+        if chunk:
+            buffer += chunk
+        while True:
+            start = buffer.find(struct.pack('<H', BLOCK_MAGIC))
+            if start < 0:
+                del buffer[:max(len(buffer) - 1, 0)]
+                break
+            if start > 0:
+                statistics['skipped'] += start
+                del buffer[:start]
+            if len(buffer) < BLOCK_HEADER.size:
+                break
+            _magic, sequence, length, dropped, bitrate = BLOCK_HEADER.unpack_from(buffer)
+            if len(buffer) < BLOCK_HEADER.size + length:
+                break
+            payload = bytes(buffer[BLOCK_HEADER.size:BLOCK_HEADER.size + length])
+            del buffer[:BLOCK_HEADER.size + length]
+
+            if expected_sequence is not None and sequence != expected_sequence:
+                statistics['lost_blocks'] += (sequence - expected_sequence) & 0xffff
+            expected_sequence = (sequence + 1) & 0xffff
+            statistics['blocks'] += 1
+            statistics['dropped'] += dropped
+            yield bitrate, payload
+        if not chunk:
+            return
+
+
+def write_candump(output, frames, interface):
+    for frame in frames:
+        can_id = '%08X' % frame.can_id if frame.extended else '%03X' % frame.can_id
+        data = 'R' if frame.remote else frame.data.hex().upper()
+        line = '(%d.%06d) %s %s#%s\n' % (frame.time_us // 1000000, frame.time_us % 1000000, interface, can_id, data)
+        output.write(line.encode())
+
+
+def write_pcap(output, frames):
+    output.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 0xffff, LINKTYPE_CAN_SOCKETCAN))
+    for frame in frames:
+        can_id = frame.can_id | (CAN_EFF_FLAG if frame.extended else 0) | (CAN_RTR_FLAG if frame.remote else 0)
+        record = struct.pack('>IB3x', can_id, frame.dlc) + frame.data.ljust(8, b'\0')
+        output.write(struct.pack('<IIII', frame.time_us // 1000000, frame.time_us % 1000000,
+                                 len(record), len(record)))
+        output.write(record)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='log file or serial device')
+    parser.add_argument('-o', '--output', help='output file, stdout if omitted')
+    parser.add_argument('-f', '--format', choices=['candump', 'pcap'],
+                        help='output format, derived from the output file name if omitted')
+    parser.add_argument('-i', '--interface', default='can0', help='interface name in candump output')
+    parser.add_argument('-b', '--baudrate', type=int, default=1000000, help='baudrate of serial devices')
+    args = parser.parse_args()
+
+    output_format = args.format or ('pcap' if args.output and args.output.endswith('.pcap') else 'candump')
+
+    if args.input.startswith('/dev/'):
+        import serial
+        stream = serial.Serial(args.input, args.baudrate, timeout=1)
+    else:
+        stream = open(args.input, 'rb')
+
+    output = open(args.output, 'wb') if args.output else sys.stdout.buffer
+    statistics = {'blocks': 0, 'lost_blocks': 0, 'dropped': 0, 'skipped': 0, 'frames': 0, 'corrupt': 0}
+
+    decoder = Decoder()
+
+    def frames():
+        for bitrate, payload in read_blocks(stream, statistics):
+            for frame in decoder.decode_block(payload, bitrate):
+                if frame is None:
+                    statistics['corrupt'] += 1
+                    continue
+                statistics['frames'] += 1
+                yield frame
+
+    try:
+        if output_format == 'pcap':
+            write_pcap(output, frames())
+        else:
+            write_candump(output, frames(), args.interface)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        output.flush()
+
+    sys.stderr.write('%(frames)d frames in %(blocks)d blocks, %(dropped)d frames dropped on the device, '
+                     '%(lost_blocks)d blocks lost, %(corrupt)d corrupt blocks, %(skipped)d bytes skipped\n'
+                     % statistics)
+
+
+if __name__ == '__main__':
+    main()
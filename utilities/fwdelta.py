@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0
+# Copyright (c) 2014-2020 Nils Weiss
+"""Generates block based deltas of SecCo firmware images.
+
+The format is described in sources/app/FirmwareDelta.h. Deltas only apply to
+images carrying a trailer, so stamp every image that is shipped as
+binaryfile.bin. Put the delta next to it as deltafile.bin, the dongle falls
+back to the full image if the SecCo doesn't run the base image.
+
+    fwdelta.py stamp secco.bin -o project_tunnel/binaryfile.bin
+    fwdelta.py diff old/binaryfile.bin project_tunnel/binaryfile.bin -o project_tunnel/deltafile.bin
+    fwdelta.py apply old/binaryfile.bin project_tunnel/deltafile.bin -o check.bin
+    fwdelta.py info project_tunnel/deltafile.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+DELTA_MAGIC = 0x4c445746
+TRAILER_MAGIC = 0x4d495746
+HEADER = struct.Struct('<IHHIIII')
+TRAILER = struct.Struct('<III')
+RECORD = struct.Struct('<H')
+
+# Multiple of the 1 KiB and 2 KiB pages of the F1 and F3 devices
+DEFAULT_BLOCK_SIZE = 2048
+
+
+def read_trailer(image):
+    """@return (length, crc) of a stamped image, None otherwise"""
+    if len(image) < TRAILER.size:
+        return None
+    magic, length, crc = TRAILER.unpack_from(image, len(image) - TRAILER.size)
+    if magic != TRAILER_MAGIC or length != len(image) or zlib.crc32(image[:-TRAILER.size]) != crc:
+        return None
+    return length, crc
+
+
+def stamp(image):
+    if read_trailer(image):
+        return image
+    image = image + b'\xff' * (-len(image) % 4)
+    length = len(image) + TRAILER.size
+    return image + TRAILER.pack(TRAILER_MAGIC, length, zlib.crc32(image))
+
+
+def block(image, index, block_size):
+    data = image[index * block_size:(index + 1) * block_size]
+    return data + b'\xff' * (block_size - len(data))
+
+
+def diff(base, target, block_size):
+    base_trailer = read_trailer(base)
+    target_trailer = read_trailer(target)
+    if base_trailer is None or target_trailer is None:
+        raise ValueError('images have to be stamped')
+
+    blocks = (max(len(base), len(target)) + block_size - 1) // block_size
+    changed = [i for i in range(blocks) if block(base, i, block_size) != block(target, i, block_size)]
+
+    # The block with the new trailer goes last, an interrupted update then
+    # leaves no valid trailer behind
+    trailer_block = (len(target) - 1) // block_size
+    if trailer_block in changed:
+        changed.remove(trailer_block)
+        changed.append(trailer_block)
+
+    delta = bytearray(HEADER.pack(DELTA_MAGIC, block_size, len(changed), base_trailer[0], base_trailer[1],
+                                  target_trailer[0], target_trailer[1]))
+    for i in changed:
+        delta += RECORD.pack(i) + block(target, i, block_size)
+    return bytes(delta)
+
+
+def parse(delta):
+    """@return header tuple and list of (index, data)"""
+    if len(delta) < HEADER.size:
+        raise ValueError('delta is truncated')
+    header = HEADER.unpack_from(delta)
+    magic, block_size, count = header[:3]
+    if magic != DELTA_MAGIC or block_size == 0 or len(delta) != HEADER.size + count * (RECORD.size + block_size):
+        raise ValueError('not a delta')
+    records = []
+    for n in range(count):
+        position = HEADER.size + n * (RECORD.size + block_size)
+        index, = RECORD.unpack_from(delta, position)
+        records.append((index, delta[position + RECORD.size:position + RECORD.size + block_size]))
+    return header, records
+
+
+def apply(base, delta):
+    header, records = parse(delta)
+    _, block_size, _, base_length, base_crc, target_length, target_crc = header
+    if read_trailer(base) != (base_length, base_crc):
+        raise ValueError('base image does not match the delta')
+
+    image = bytearray(base)
+    for index, data in records:
+        start = index * block_size
+        image += b'\xff' * max(0, start + block_size - len(image))
+        image[start:start + block_size] = data
+    image = bytes(image[:target_length])
+    if read_trailer(image) != (target_length, target_crc):
+        raise ValueError('result does not match the target image')
+    return image
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    command = commands.add_parser('stamp', help='append the trailer identifying an image')
+    command.add_argument('image')
+    command.add_argument('-o', '--output', required=True)
+
+    command = commands.add_parser('diff', help='generate the delta from base to target')
+    command.add_argument('base')
+    command.add_argument('target')
+    command.add_argument('-o', '--output', required=True)
+    command.add_argument('-b', '--block-size', type=int, default=DEFAULT_BLOCK_SIZE,
+                         help='multiple of the flash page size of the SecCo')
+
+    command = commands.add_parser('apply', help='apply a delta to base like the dongle does')
+    command.add_argument('base')
+    command.add_argument('delta')
+    command.add_argument('-o', '--output', required=True)
+
+    command = commands.add_parser('info', help='show trailer or delta header')
+    command.add_argument('file')
+
+    args = parser.parse_args()
+
+    def load(name):
+        with open(name, 'rb') as f:
+            return f.read()
+
+    def store(name, data):
+        with open(name, 'wb') as f:
+            f.write(data)
+
+    try:
+        if args.command == 'stamp':
+            store(args.output, stamp(load(args.image)))
+        elif args.command == 'diff':
+            if args.block_size <= 0 or args.block_size % 256 or args.block_size > 0xffff:
+                raise ValueError('block size has to be a multiple of 256 below 64 KiB')
+            base = load(args.base)
+            target = load(args.target)
+            delta = diff(base, target, args.block_size)
+            store(args.output, delta)
+            print('{} of {} blocks changed, delta has {} bytes, target {} bytes'.format(
+                HEADER.unpack_from(delta)[2], (max(len(base), len(target)) + args.block_size - 1) // args.block_size,
+                len(delta), len(target)), file=sys.stderr)
+        elif args.command == 'apply':
+            store(args.output, apply(load(args.base), load(args.delta)))
+        else:
+            data = load(args.file)
+            trailer = read_trailer(data)
+            if trailer:
+                print('image: {} bytes, crc 0x{:08x}'.format(*trailer))
+            else:
+                header, records = parse(data)
+                print('delta: block size {}, base {} bytes crc 0x{:08x}, target {} bytes crc 0x{:08x}'.format(
+                    header[1], *header[3:]))
+                print('blocks: {}'.format(' '.join(str(index) for index, _ in records)))
+    except (OSError, ValueError) as e:
+        print('{}: {}'.format(args.command, e), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())